@@ -2,6 +2,12 @@
 #include <server/router.h>
 #include <server/request.h>
 #include <server/response.h>
+#include <server/multipart_stream_parser.h>
+#include <server/event_stream.h>
+#include <server/websocket.h>
+#include <map>
+#include <mutex>
+#include <thread>
 
 using namespace ic::server;
 
@@ -43,6 +49,14 @@ int main() {
         std::string filename = HttpServer::GetBinDirUtf8() + "../data/web/img/" + uri;
         res.SetFileBody(filename);
     });
+    // 2.3.1 模式路由，不使用正则表达式，按名称获取参数
+    router->AddPatternRoute("/user/{id:uint}/posts/{slug}", HttpMethod::kGET, [](Request& req, Json::Value& res){
+        res["code"] = 0;
+        res["data"]["id"] = req.GetRouteParam("id");
+        res["data"]["slug"] = req.GetRouteParam("slug");
+    });
+    // 2.3.2 静态文件目录(内存缓存、ETag、304)
+    router->AddStaticDirectory("/web", HttpServer::GetBinDirUtf8() + "../data/web/");
     // 2.4 响应application/json
     router->AddStaticRoute("/server/time", HttpMethod::kGET, [](Request& req, Json::Value& res){
         res["code"] = 0;
@@ -56,6 +70,103 @@ int main() {
         res["msg"] = "OK";
     });
 
+    // 2.6 异步路由：回调函数返回后不立即响应，调用done()之后才返回响应内容
+    //     后台线程只持有done，不引用req/res(调用done之后就不能再访问); done的所有副本都释放而没有调用时，返回500
+    router->AddStaticRoute("/delay", HttpMethod::kGET, [](Request& req, Response& res, ResponseCompletion done){
+        res.SetStringBody("OK", "text/plain");
+        std::thread([done]{
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            done();
+        }).detach();
+    });
+
+    // 2.7 流式接收body(上传大文件)：body不缓存在内存中，分块写入文件，单独限制大小
+    auto upload = std::make_shared<StaticRoute>("/upload", HttpMethod::kPOST, [](Request& req, Response& res){
+        res.SetStringBody("received " + req.custom_data("size").asString() + " bytes", "text/plain");
+    }, "上传文件", std::unordered_map<std::string, std::string>{});
+    upload->body_limit = 4ULL * 1024 * 1024 * 1024;  // 最大4GB
+    upload->body_chunk_callback = [](Request& req, Response& res, const char* data, size_t size){
+        std::string filename = HttpServer::GetBinDirUtf8() + "../data/upload_" + std::to_string(req.id());
+        FILE* fp = fopen(filename.c_str(), "ab");
+        if (!fp || fwrite(data, 1, size, fp) != size) {
+            if (fp) fclose(fp);
+            res.SetStringBody(500U, "write file failed", "text/plain");
+            return false;  // 中止接收
+        }
+        fclose(fp);
+        req.custom_data("size") = (Json::UInt64)(req.custom_data("size").asUInt64() + size);
+        return true;
+    };
+    router->AddStaticRoute(upload);
+
+    // 2.8 流式解析multipart/form-data：边接收边解析，文件直接写入临时文件
+    auto form_upload = std::make_shared<StaticRoute>("/upload/form", HttpMethod::kPOST, [](Request& req, Response& res){
+        auto parser = MultipartStreamParser::FromRequest(req);
+        if (!parser || !parser->is_done()) {
+            return res.SetBadRequest("incomplete multipart/form-data");
+        }
+        for (const auto& file : parser->files()) {
+            // 文件名由客户端指定，只保留最后一级(防止"../"写到data目录之外)
+            std::string filename = file.filename.substr(file.filename.find_last_of("/\\:") + 1);
+            if (filename.empty() || filename == "." || filename == "..") {
+                return res.SetBadRequest("invalid filename");
+            }
+            // 临时文件在请求结束后删除，需要保留时移动到其他位置
+            if (std::rename(file.path.c_str(), (HttpServer::GetBinDirUtf8() + "../data/" + filename).c_str()) != 0) {
+                return res.SetStringBody(500U, "save file failed", "text/plain");
+            }
+        }
+        res.SetStringBody("received " + std::to_string(parser->files().size()) + " files", "text/plain");
+    }, "上传文件(表单)", std::unordered_map<std::string, std::string>{});
+    form_upload->body_limit = 4ULL * 1024 * 1024 * 1024;
+    form_upload->body_chunk_callback = MultipartStreamParser::MakeBodyChunkCallback([](Request& req, MultipartStreamParser& parser){
+        parser.set_upload_dir(HttpServer::GetBinDirUtf8() + "../data/tmp/");
+    });
+    router->AddStaticRoute(form_upload);
+
+    // 2.9 流式响应(分块传输编码)：边生成边发送，缓冲区已满时Write()阻塞，内存占用固定
+    router->AddStaticRoute("/export", HttpMethod::kGET, [](Request& req, Response& res){
+        auto writer = res.SetStreamBody("text/csv");
+        std::thread([writer]{
+            writer->Write("id,square\n");
+            for (int i = 0; i < 1000000 && writer->Write(std::to_string(i) + "," + std::to_string((long long)i * i) + "\n"); ++i) {
+            }
+            writer->Close();
+        }).detach();
+    });
+
+    // 2.10 服务器推送事件(SSE)：连接保持打开，后台线程定时向所有订阅者推送，不占用工作线程
+    auto metrics = std::make_shared<EventBroadcaster>();
+    router->AddEventStreamRoute("/metrics/live", [metrics](Request& req, EventStreamPtr stream){
+        metrics->Add(stream);
+    });
+    std::thread([metrics]{
+        for (int seq = 0; ; ++seq) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            metrics->Publish("{\"time\":" + std::to_string(time(NULL)) + "}", "metrics", std::to_string(seq));
+        }
+    }).detach();
+
+    // 2.11 WebSocket：聊天室，收到的消息广播给所有连接(与HTTP共用同一端口)
+    auto chat_members = std::make_shared<std::map<int64_t, WebSocketConnectionPtr>>();
+    auto chat_mutex = std::make_shared<std::mutex>();
+    WebSocketHandler chat;
+    chat.on_open = [chat_members, chat_mutex](const WebSocketConnectionPtr& conn, Request& req) {
+        std::lock_guard<std::mutex> lck(*chat_mutex);
+        (*chat_members)[conn->id()] = conn;
+    };
+    chat.on_message = [chat_members, chat_mutex](const WebSocketConnectionPtr& conn, const std::string& message, bool binary) {
+        std::lock_guard<std::mutex> lck(*chat_mutex);
+        for (const auto& member : *chat_members) {
+            member.second->SendText(conn->client_ip() + ": " + message);
+        }
+    };
+    chat.on_close = [chat_members, chat_mutex](const WebSocketConnectionPtr& conn) {
+        std::lock_guard<std::mutex> lck(*chat_mutex);
+        chat_members->erase(conn->id());
+    };
+    router->AddWebSocketRoute("/chat", chat);
+
     // 3. 启动服务器
     svr.Start();
 
@@ -0,0 +1,119 @@
+/**
+ * @file async_logger.h
+ * @brief 异步日志记录器.
+ * @author Leopard-C (leopard.c@outlook.com)
+ * @date 2023-11-29
+ *
+ * @copyright Copyright (c) 2023-present, Jinbao Chen.
+ */
+#ifndef IC_SERVER_ASYNC_LOGGER_H_
+#define IC_SERVER_ASYNC_LOGGER_H_
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "server/logger.h"
+
+namespace ic {
+namespace server {
+
+class AsyncLogRing;
+
+/**
+ * @brief 异步日志记录器，由后台线程批量写入控制台或文件.
+ *
+ * @details 每个写日志的线程有各自的环形缓冲区(单生产者单消费者，无锁)，`Log`只复制日志内容，不格式化时间、不进行I/O.
+ * @details 后台线程定时(或者某个缓冲区超过一半时)取出所有缓冲区中的日志，格式化后一次写入(`writev`).
+ * @details 时间前缀每秒只格式化一次.
+ * @details 缓冲区已满时丢弃新的日志(不阻塞请求处理)，丢弃的数量在之后输出一条警告.
+ * @note 输出格式与`ConsoleLogger`相同，各个线程的日志之间不保证严格按照时间排序.
+ */
+class AsyncLogger : public ILogger {
+public:
+    /** 每个线程的环形缓冲区的默认容量(日志条数) */
+    static constexpr size_t kDefaultRingCapacity = 4096;
+
+    /**
+     * @brief 构造函数.
+     *
+     * @param min_level 只记录等于或高于该级别的日志
+     * @param detailed_min_level 等于或高于该级别的日志，显示详细信息(当前文件、当前行、当前函数名等)
+     * @param filename 日志文件(追加写入)，为空时输出到控制台(标准输出)
+     * @param ring_capacity 每个线程的环形缓冲区的容量(日志条数，向上取整为2的幂)
+     * @param flush_interval_ms 后台线程写入的间隔
+     */
+    AsyncLogger(LogLevel min_level, LogLevel detailed_min_level, const std::string& filename = std::string(),
+        size_t ring_capacity = kDefaultRingCapacity, unsigned int flush_interval_ms = 100);
+
+    /**
+     * @brief 写入所有尚未写入的日志后返回.
+     */
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    /**
+     * @brief 是否输出到日志文件(未指定文件或者打开失败时输出到控制台).
+     */
+    bool is_open() const { return file_ != stdout; }
+
+    /**
+     * @brief 因缓冲区已满而丢弃的日志数量.
+     */
+    uint64_t dropped_count() const { return dropped_.load(std::memory_order_relaxed); }
+
+protected:
+    /**
+     * @brief 日志记录(放入当前线程的环形缓冲区).
+     * @param level 日志级别
+     * @param context 当前上下文
+     * @param msg 日志内容
+     */
+    virtual void Log(LogLevel level, const LogContext& context, const std::string& msg) const override;
+
+private:
+    AsyncLogRing* GetThreadRing() const;
+    void Run();
+    size_t Drain();
+    void Write(const std::vector<std::shared_ptr<AsyncLogRing>>& rings, const std::vector<size_t>& ends, uint64_t dropped);
+    void AppendTime(const std::chrono::system_clock::time_point& tp, std::string* out);
+
+private:
+    /** 区分各个实例(线程局部的缓冲区按照实例查找) */
+    const uint64_t id_;
+    const LogLevel detailed_min_level_;
+    const size_t ring_capacity_;
+    const unsigned int flush_interval_ms_;
+    FILE* file_{stdout};
+
+    /** 所有线程的缓冲区(只在线程第一次写日志、线程退出后移除时加锁) */
+    mutable std::mutex mutex_;
+    mutable std::vector<std::shared_ptr<AsyncLogRing>> rings_;
+    mutable std::condition_variable cv_;
+    mutable std::atomic<bool> wakeup_{false};
+    bool stop_{false};
+    mutable std::atomic<uint64_t> dropped_{0};
+    uint64_t dropped_reported_{0};
+
+    /* 以下只在后台线程中使用 */
+    /** 格式化后的日志前缀和后缀(依次存放，与日志内容交替写入) */
+    std::string meta_;
+    std::vector<size_t> meta_offsets_;
+    /** 时间前缀缓存(精确到秒) */
+    time_t cached_second_{-1};
+    char cached_time_[32]{0};
+    size_t cached_time_len_{0};
+
+    std::thread thread_;
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_ASYNC_LOGGER_H_
@@ -0,0 +1,150 @@
+/**
+ * @file event_stream.h
+ * @brief 服务器推送事件(Server-Sent Events, `text/event-stream`).
+ * @author Leopard-C (leopard.c@outlook.com)
+ * @date 2023-11-29
+ *
+ * @copyright Copyright (c) 2023-present, Jinbao Chen.
+ */
+#ifndef IC_SERVER_EVENT_STREAM_H_
+#define IC_SERVER_EVENT_STREAM_H_
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "response_writer.h"
+#include "router.h"
+
+namespace ic {
+namespace server {
+
+/**
+ * @brief 一个订阅者(客户端连接)的事件流.
+ *
+ * @details 事件先放入该连接的有界队列(`ResponseWriter`的缓冲区)，由I/O线程发送，不占用工作线程.
+ * @details 队列已满(客户端接收太慢)时丢弃新的事件，发送超时(`tcp_stream_timeout_ms`)后关闭连接.
+ * @details 连接空闲时自动发送心跳(注释行)，间隔默认为`tcp_stream_timeout_ms`的一半，客户端断开后可以及时发现.
+ * @note 线程安全，可以在任意线程中发送事件.
+ */
+class EventStream {
+public:
+    friend class EventBroadcaster;
+
+    /**
+     * @brief 新的订阅者连接时调用(在I/O线程中，应当尽快返回).
+     *
+     * @details 回调函数返回后开始发送，之后通过`stream`推送事件，调用`Close`结束.
+     */
+    using Callback = std::function<void(Request& req, std::shared_ptr<EventStream> stream)>;
+
+    /** 默认的队列大小(字节) */
+    static constexpr size_t kDefaultMaxQueueSize = 64 * 1024;
+
+public:
+    explicit EventStream(std::shared_ptr<ResponseWriter> writer, const std::string& last_event_id = "");
+    EventStream(const EventStream&) = delete;
+    EventStream& operator=(const EventStream&) = delete;
+
+    /**
+     * @brief 发送一个事件.
+     *
+     * @param data 事件内容，可以包含多行
+     * @param event 事件类型，为空表示`message`
+     * @param id 事件ID，客户端重连时通过`Last-Event-ID`请求头带回
+     *
+     * @return 连接已断开或者队列已满时返回false(不阻塞)
+     */
+    bool Send(const std::string& data, const std::string& event = "", const std::string& id = "");
+
+    /**
+     * @brief 发送注释行(客户端忽略).
+     */
+    bool SendComment(const std::string& comment);
+
+    /**
+     * @brief 设置客户端断开后的重连间隔.
+     */
+    bool SetRetry(unsigned int retry_ms);
+
+    /**
+     * @brief 结束事件流，发送完队列中的事件后结束响应.
+     */
+    void Close();
+
+    /**
+     * @brief 是否可以继续发送(未调用`Close`，且连接未断开).
+     */
+    bool is_open() const { return writer_->is_open(); }
+
+    /**
+     * @brief 客户端重连时带回的上一个事件ID(`Last-Event-ID`请求头).
+     */
+    const std::string& last_event_id() const { return last_event_id_; }
+
+    /**
+     * @brief 因队列已满而丢弃的事件数量.
+     */
+    uint64_t dropped_count() const { return dropped_count_; }
+
+    /**
+     * @brief 格式化事件(`event:`、`id:`、`data:`行，以空行结束).
+     */
+    static std::string Format(const std::string& data, const std::string& event = "", const std::string& id = "");
+
+    /**
+     * @brief 生成事件流路由的回调函数(见`Router::AddEventStreamRoute`).
+     *
+     * @param max_queue_size 每个连接的队列大小(字节)
+     */
+    static Route::ResponseCallback MakeResponseCallback(Callback cb, size_t max_queue_size = kDefaultMaxQueueSize);
+
+private:
+    bool Write(const std::string& text);
+
+private:
+    std::shared_ptr<ResponseWriter> writer_;
+    std::string last_event_id_;
+    std::atomic<uint64_t> dropped_count_{0};
+};
+
+using EventStreamPtr = std::shared_ptr<EventStream>;
+
+/**
+ * @brief 向所有订阅者广播事件.
+ *
+ * @details 每个事件只格式化一次，放入各个连接的队列后立即返回，不等待发送.
+ * @details 已断开的订阅者在广播时自动移除.
+ * @note 线程安全.
+ */
+class EventBroadcaster {
+public:
+    void Add(EventStreamPtr stream);
+
+    /**
+     * @brief 广播一个事件.
+     *
+     * @return 成功放入队列的订阅者数量
+     */
+    size_t Publish(const std::string& data, const std::string& event = "", const std::string& id = "");
+
+    /**
+     * @brief 结束所有事件流.
+     */
+    void CloseAll();
+
+    /**
+     * @brief 订阅者数量(包括尚未移除的已断开的订阅者).
+     */
+    size_t size() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<EventStreamPtr> streams_;
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_EVENT_STREAM_H_
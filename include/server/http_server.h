@@ -10,6 +10,7 @@
 #define IC_SERVER_HTTP_SERVER_H_
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <mutex>
 #include <set>
@@ -30,10 +31,17 @@ namespace asio {
 namespace ic {
 namespace server {
 
+class AccessLogWriter;
+class RequestRegistry;
+class RouteMetrics;
+class FileCache;
+class HandlerPool;
 class Listener;
 class Route;
 class Router;
 class Session;
+class Http2Session;
+class TlsContext;
 class Request;
 class Response;
 class HttpServer;
@@ -83,6 +91,8 @@ class HttpServer {
 public:
     friend class Listener;
     friend class Session;
+    friend class Http2Session;
+    friend class WebSocketSession;
 
     /**
      * @brief 构造函数.
@@ -166,22 +176,71 @@ public:
      */
     SnapshotResult CreateSnapshot();
 
+    /**
+     * @brief 获取统计数据(Prometheus文本格式)，包括每个路由的延迟直方图.
+     *
+     * @details 需要开启`metrics_enabled`，否则只有服务器级别的计数.
+     * @details 没有匹配路由的请求统计在`route=""`中.
+     */
+    std::string CreateMetrics();
+
+    /**
+     * @brief 重新加载所有TLS监听地址的证书和私钥(如证书续期后).
+     *
+     * @details 新连接使用新的证书，已建立的连接不受影响，加载失败时继续使用原来的证书.
+     * @details 配置`tls_cert_check_interval_ms`后，文件被修改时也会自动重新加载.
+     *
+     * @return 全部加载成功时返回true
+     */
+    bool ReloadTlsCertificates();
+
 private:
+    /**
+     * @brief 启动监听器.
+     */
+    bool StartListeners();
+
+    /**
+     * @brief 加载TLS证书.
+     *
+     * @param force 为false时，只重新加载文件已被修改的证书
+     */
+    bool LoadTlsCertificates(bool force);
+
+    /**
+     * @brief 轮换TLS会话票据的密钥(距离上一次轮换超过会话有效期时).
+     */
+    void RotateTlsTicketKeys();
+
     /**
      * @brief 创建新的工作线程.
      */
     void NewWorkerThreads(uint32_t n);
 
+    /**
+     * @brief 创建新的工作线程，运行指定的io_context.
+     */
+    void NewWorkerThread(boost::asio::io_context* ioc);
+
     /**
      * @brief 工作线程.
      */
-    void ThreadFunc_Worker();
+    void ThreadFunc_Worker(boost::asio::io_context* ioc);
+
+    /**
+     * @brief 工作线程空闲时间过长，尝试退出该线程.
+     */
+    bool TryRetireWorkerThread(const std::chrono::steady_clock::time_point& last_active_time);
 
     /**
      * @brief 管理者线程.
      */
     void ThreadFunc_Manager();
 
+    bool NeedScaleUp() const;
+    void RequestScaleUp();
+    void NotifyManager();
+
     void OnNewSession();
     void OnDestroySession();
 
@@ -193,17 +252,42 @@ private:
     std::atomic_int64_t current_request_id_{-1};
 
     std::shared_ptr<ILogger> logger_;
-    std::shared_ptr<boost::asio::io_context> ioc_;
+    /** 所有线程共享一个io_context，或每个工作线程独占一个io_context */
+    std::vector<std::shared_ptr<boost::asio::io_context>> iocs_;
+    bool io_context_per_thread_{false};
     std::shared_ptr<Router> router_;
     std::vector<std::shared_ptr<Listener>> listeners_;
+    /** TLS监听地址的证书(与`endpoints`一一对应，普通监听地址为空)，由`mutex_tls_contexts_`保护 */
+    std::vector<std::shared_ptr<TlsContext>> tls_contexts_;
+    std::mutex mutex_tls_contexts_;
+
+    /** 执行阻塞型路由的处理线程池 */
+    std::shared_ptr<HandlerPool> handler_pool_;
+
+    /** 文件缓存(已打开的文件描述符)，用于返回文件内容 */
+    std::shared_ptr<FileCache> file_cache_;
+
+    /** 二进制访问日志(配置了`access_log_file`时使用) */
+    std::shared_ptr<AccessLogWriter> access_log_;
+
+    /** 没有匹配路由的请求的统计数据 */
+    std::shared_ptr<RouteMetrics> unmatched_metrics_;
 
     std::mutex mutex_server_state_;
-    bool is_running_{false};
-    bool should_stop_{false};
+    std::atomic_bool is_running_{false};
+    std::atomic_bool should_stop_{false};
 
     /* 当前所有工作线程的线程ID集合 */
+    std::mutex mutex_worker_threads_;
     std::set<size_t> worker_thread_ids_;
 
+    /* 管理者线程等待扩容请求或服务器停止 */
+    std::mutex mutex_manager_;
+    std::condition_variable cv_manager_;
+    std::atomic_bool scale_up_requested_{false};
+    /** 已经决定因空闲而退出、但尚未结束的工作线程数量(由`mutex_manager_`保护) */
+    uint32_t num_retiring_worker_threads_{0};
+
     /** 当前会话数量 */
     std::atomic_uint32_t curr_num_sessions_{0};
     /** 当前工作线程数量 */
@@ -216,8 +300,8 @@ private:
     /** 总计处理的请求数量 */
     std::atomic_uint64_t total_num_requests_{0};
 
-    std::mutex mutex_requests_;
-    std::set<Request*> handling_requests_;
+    /** 正在处理的请求(用于快照) */
+    std::shared_ptr<RequestRegistry> handling_requests_;
 
     std::function<bool(Request&, Response&)> cb_before_parse_body_;
     std::function<bool(Request&, Response&)> cb_before_handle_request_;
@@ -25,6 +25,12 @@ public:
         std::string ip;
         unsigned short port;
         bool reuse_address;
+        /** 证书链文件(PEM格式，服务器证书在前，中间证书在后)，不为空时该地址只接受TLS连接 */
+        std::string cert_file;
+        /** 私钥文件(PEM格式，不能有密码) */
+        std::string key_file;
+
+        bool tls() const { return !cert_file.empty(); }
     };
 
     HttpServerConfig() = default;
@@ -37,16 +43,50 @@ public:
      * @details {
      * @details   "min_num_threads": 2,
      * @details   "max_num_threads": 8,
+     * @details   "thread_scale_up_busy_percent": 100,
+     * @details   "thread_scale_up_cooldown_ms": 50,
+     * @details   "thread_scale_down_idle_ms": 5000,
+     * @details   "thread_scale_max_step": 32,
+     * @details   "thread_scale_latency_target_ms": 0,
+     * @details   "handler_pool_num_threads": 4,
+     * @details   "handler_pool_queue_limit": 1024,
      * @details   "version": "1.0.0",
      * @details   "tcp_stream_timeout_ms": 15000,
      * @details   "body_limit": 11534334,
+     * @details   "max_pipeline_depth": 8,
      * @details   "log_access": true,
      * @details   "log_access_verbose": false,
+     * @details   "access_log_file": "/var/log/example/access.bin",
+     * @details   "access_log_file_size": 67108864,
+     * @details   "access_log_max_files": 8,
+     * @details   "metrics_enabled": false,
+     * @details   "metrics_path": "/metrics",
+     * @details   "io_context_per_thread": false,
+     * @details   "use_sendfile": true,
+     * @details   "file_cache_max_files": 256,
+     * @details   "file_cache_check_interval_ms": 1000,
+     * @details   "file_cache_max_content_size": 65536,
+     * @details   "file_cache_max_memory": 33554432,
+     * @details   "compression_enabled": true,
+     * @details   "compression_min_size": 1024,
+     * @details   "compression_level": 6,
+     * @details   "tls_session_cache_size": 20480,
+     * @details   "tls_session_timeout_s": 300,
+     * @details   "tls_cert_check_interval_ms": 60000,
+     * @details   "http2_enabled": true,
+     * @details   "http2_max_concurrent_streams": 100,
      * @details   "endpoints": [
      * @details     {
      * @details       "ip": "0.0.0.0",
      * @details       "port": 8099,
      * @details       "reuse_address": true
+     * @details     },
+     * @details     {
+     * @details       "ip": "0.0.0.0",
+     * @details       "port": 8443,
+     * @details       "reuse_address": true,
+     * @details       "cert_file": "/etc/ssl/example.com/fullchain.pem",
+     * @details       "key_file": "/etc/ssl/example.com/privkey.pem"
      * @details     }
      * @details   ]
      * @details }
@@ -68,22 +108,81 @@ public:
 public:
     unsigned int min_num_threads() const { return min_num_threads_; }
     unsigned int max_num_threads() const { return max_num_threads_; }
+    unsigned int thread_scale_up_busy_percent() const { return thread_scale_up_busy_percent_; }
+    unsigned int thread_scale_up_cooldown_ms() const { return thread_scale_up_cooldown_ms_; }
+    unsigned int thread_scale_down_idle_ms() const { return thread_scale_down_idle_ms_; }
+    unsigned int thread_scale_max_step() const { return thread_scale_max_step_; }
+    unsigned int thread_scale_latency_target_ms() const { return thread_scale_latency_target_ms_; }
+    unsigned int handler_pool_num_threads() const { return handler_pool_num_threads_; }
+    unsigned int handler_pool_queue_limit() const { return handler_pool_queue_limit_; }
     const std::vector<Endpoint>& endpoints() const { return endpoints_; }
     std::vector<Endpoint>& endpoints() { return endpoints_; }
     bool log_access() const { return log_access_; }
     bool log_access_verbose() const { return log_access_verbose_; }
+    const std::string& access_log_file() const { return access_log_file_; }
+    uint64_t access_log_file_size() const { return access_log_file_size_; }
+    unsigned int access_log_max_files() const { return access_log_max_files_; }
+    bool metrics_enabled() const { return metrics_enabled_; }
+    const std::string& metrics_path() const { return metrics_path_; }
     unsigned int tcp_stream_timeout_ms() const { return tcp_stream_timeout_ms_; }
     uint64_t body_limit() const { return body_limit_; }
+    unsigned int max_pipeline_depth() const { return max_pipeline_depth_; }
+    bool io_context_per_thread() const { return io_context_per_thread_; }
+    bool use_sendfile() const { return use_sendfile_; }
+    unsigned int file_cache_max_files() const { return file_cache_max_files_; }
+    unsigned int file_cache_check_interval_ms() const { return file_cache_check_interval_ms_; }
+    unsigned int file_cache_max_content_size() const { return file_cache_max_content_size_; }
+    uint64_t file_cache_max_memory() const { return file_cache_max_memory_; }
+    bool compression_enabled() const { return compression_enabled_; }
+    unsigned int compression_min_size() const { return compression_min_size_; }
+    unsigned int compression_level() const { return compression_level_; }
+    unsigned int tls_session_cache_size() const { return tls_session_cache_size_; }
+    unsigned int tls_session_timeout_s() const { return tls_session_timeout_s_; }
+    unsigned int tls_cert_check_interval_ms() const { return tls_cert_check_interval_ms_; }
+    bool http2_enabled() const { return http2_enabled_; }
+    unsigned int http2_max_concurrent_streams() const { return http2_max_concurrent_streams_; }
     const std::string& version() const { return version_; }
 
     void set_min_num_threads(unsigned int min_num_threads) { min_num_threads_ = min_num_threads; }
     void set_max_num_threads(unsigned int max_num_threads) { max_num_threads_ = max_num_threads; }
+    void set_thread_scale_up_busy_percent(unsigned int percent) { thread_scale_up_busy_percent_ = percent; }
+    void set_thread_scale_up_cooldown_ms(unsigned int cooldown_ms) { thread_scale_up_cooldown_ms_ = cooldown_ms; }
+    void set_thread_scale_down_idle_ms(unsigned int idle_ms) { thread_scale_down_idle_ms_ = idle_ms; }
+    void set_thread_scale_max_step(unsigned int max_step) { thread_scale_max_step_ = max_step; }
+    void set_thread_scale_latency_target_ms(unsigned int target_ms) { thread_scale_latency_target_ms_ = target_ms; }
+    void set_handler_pool_num_threads(unsigned int num_threads) { handler_pool_num_threads_ = num_threads; }
+    void set_handler_pool_queue_limit(unsigned int queue_limit) { handler_pool_queue_limit_ = queue_limit; }
     void add_endpoint(const Endpoint& endpoint) { endpoints_.push_back(endpoint); }
     void add_endpoint(const std::string& ip, unsigned short port, bool reuse_address = true) { endpoints_.emplace_back(ip, port, reuse_address); }
+    void add_tls_endpoint(const std::string& ip, unsigned short port, const std::string& cert_file, const std::string& key_file, bool reuse_address = true) {
+        endpoints_.emplace_back(ip, port, reuse_address);
+        endpoints_.back().cert_file = cert_file;
+        endpoints_.back().key_file = key_file;
+    }
     void set_log_access(bool log_access) { log_access_ = log_access; }
     void set_log_access_verbose(bool verbose) { log_access_verbose_ = verbose; }
+    void set_access_log_file(const std::string& filename) { access_log_file_ = filename; }
+    void set_access_log_file_size(uint64_t file_size) { access_log_file_size_ = file_size; }
+    void set_access_log_max_files(unsigned int max_files) { access_log_max_files_ = max_files; }
+    void set_metrics_enabled(bool enabled) { metrics_enabled_ = enabled; }
+    void set_metrics_path(const std::string& path) { metrics_path_ = path; }
     void set_tcp_stream_timeout_ms(unsigned int timeout_ms) { tcp_stream_timeout_ms_ = timeout_ms; }
     void set_body_limit(uint64_t body_limit) { body_limit_ = body_limit; }
+    void set_max_pipeline_depth(unsigned int depth) { max_pipeline_depth_ = depth; }
+    void set_io_context_per_thread(bool per_thread) { io_context_per_thread_ = per_thread; }
+    void set_use_sendfile(bool use_sendfile) { use_sendfile_ = use_sendfile; }
+    void set_file_cache_max_files(unsigned int max_files) { file_cache_max_files_ = max_files; }
+    void set_file_cache_check_interval_ms(unsigned int interval_ms) { file_cache_check_interval_ms_ = interval_ms; }
+    void set_file_cache_max_content_size(unsigned int max_size) { file_cache_max_content_size_ = max_size; }
+    void set_file_cache_max_memory(uint64_t max_memory) { file_cache_max_memory_ = max_memory; }
+    void set_compression_enabled(bool enabled) { compression_enabled_ = enabled; }
+    void set_compression_min_size(unsigned int min_size) { compression_min_size_ = min_size; }
+    void set_compression_level(unsigned int level) { compression_level_ = level; }
+    void set_tls_session_cache_size(unsigned int cache_size) { tls_session_cache_size_ = cache_size; }
+    void set_tls_session_timeout_s(unsigned int timeout_s) { tls_session_timeout_s_ = timeout_s; }
+    void set_tls_cert_check_interval_ms(unsigned int interval_ms) { tls_cert_check_interval_ms_ = interval_ms; }
+    void set_http2_enabled(bool enabled) { http2_enabled_ = enabled; }
+    void set_http2_max_concurrent_streams(unsigned int max_streams) { http2_max_concurrent_streams_ = max_streams; }
     void set_version(const std::string& version) { version_ = version; }
 
 private:
@@ -93,6 +192,38 @@ private:
     /** 线程数量最大值 */
     unsigned int max_num_threads_{8};
 
+    /**
+     * @brief 扩容阈值：正在处理的请求数量达到工作线程数量的该百分比时，立即扩容.
+     */
+    unsigned int thread_scale_up_busy_percent_{100};
+
+    /** 两次扩容之间的最小间隔(单位:毫秒)，避免突发请求导致线程数量抖动 */
+    unsigned int thread_scale_up_cooldown_ms_{50};
+
+    /** 工作线程空闲超过该时间后退出(单位:毫秒)，线程数量不低于`min_num_threads` */
+    unsigned int thread_scale_down_idle_ms_{5000};
+
+    /** 单次扩容最多新增的线程数量 */
+    unsigned int thread_scale_max_step_{32};
+
+    /**
+     * @brief 延迟目标(单位:毫秒)，0表示不启用.
+     *
+     * @details 请求处理耗时超过该值，且半数以上工作线程正忙时，立即扩容.
+     */
+    unsigned int thread_scale_latency_target_ms_{0};
+
+    /**
+     * @brief 处理线程池的线程数量，用于执行阻塞型路由(`Route::blocking`)，0表示不启用.
+     *
+     * @details 不启用时，阻塞型路由与普通路由一样在I/O线程中执行.
+     * @details 线程在第一个阻塞型路由的请求到达时才创建.
+     */
+    unsigned int handler_pool_num_threads_{4};
+
+    /** 处理线程池的等待队列长度上限，队列已满时返回`503 Service Unavailable` */
+    unsigned int handler_pool_queue_limit_{1024};
+
     /** 监听地址 */
     std::vector<Endpoint> endpoints_;
 
@@ -108,12 +239,128 @@ private:
      */
     bool log_access_verbose_{false};
 
+    /**
+     * @brief 二进制访问日志的文件路径(UTF8编码)，为空表示不使用.
+     *
+     * @details 设置后，每个请求写入一条固定大小的二进制记录(代替文本格式的ACCESS日志)，仍然受`log_access`控制.
+     * @details 实际的文件名为`<access_log_file>.<创建时间>-<序号>`，写满后切换到新的文件.
+     * @details 使用`tools/decode_access_log.py`转换为文本或者JSON.
+     */
+    std::string access_log_file_;
+
+    /** 每个二进制访问日志文件的大小(单位:字节)，默认64MB */
+    uint64_t access_log_file_size_{64 * 1024 * 1024};
+
+    /** 最多保留的二进制访问日志文件数量(包括正在写入的文件)，超出后删除最早的文件，0表示不删除 */
+    unsigned int access_log_max_files_{8};
+
+    /**
+     * @brief 是否统计每个路由的延迟直方图(排队、处理、发送耗时)和请求/响应body的大小.
+     *
+     * @details 按照状态码分类(1xx ~ 5xx)统计，通过`HttpServer::CreateMetrics`获取Prometheus文本格式的结果.
+     */
+    bool metrics_enabled_{false};
+
+    /**
+     * @brief 内置的统计数据路由的路径(`metrics_enabled`为true时，启动服务器时添加)，为空表示不添加.
+     *
+     * @details 已存在同一路径的路由时不添加.
+     */
+    std::string metrics_path_{"/metrics"};
+
     /** tcp超时时间(单位:毫秒)，0表示不限制，默认15s */
     unsigned int tcp_stream_timeout_ms_{15000};
 
     /** body大小限制(单位:字节)，默认11MB */
     uint64_t body_limit_{1024 * 1024 * 11};
 
+    /**
+     * @brief HTTP管线化(pipelining)的最大深度，即同一连接上已读取、尚未响应完毕的请求数量上限.
+     *
+     * @details 响应内容按照请求顺序依次返回. 设为1表示不预读后续请求.
+     */
+    unsigned int max_pipeline_depth_{8};
+
+    /**
+     * @brief 是否每个工作线程独占一个io_context.
+     *
+     * @details 开启后，工作线程数量固定为`max_num_threads`，不再动态调整.
+     * @details 每个线程在每个监听地址上各自创建一个`SO_REUSEPORT`监听器，由内核分配新连接，
+     * @details 会话始终只在所属线程的io_context上运行.
+     * @details 当前平台不支持`SO_REUSEPORT`时，回退为所有线程共享一个io_context.
+     */
+    bool io_context_per_thread_{false};
+
+    /**
+     * @brief 返回文件内容时，是否使用`sendfile`由内核直接发送(不经过用户态缓冲区).
+     *
+     * @details 仅Linux支持，其他平台始终使用`http::file_body`.
+     */
+    bool use_sendfile_{true};
+
+    /**
+     * @brief 文件缓存最多保留的文件数量(已打开的文件描述符及其`stat`信息)，0表示不缓存.
+     *
+     * @details 超出后淘汰最久未使用的文件.
+     */
+    unsigned int file_cache_max_files_{256};
+
+    /**
+     * @brief 文件缓存的检查间隔(单位:毫秒).
+     *
+     * @details 距离上次检查超过该时间后，重新`stat`文件，文件被修改或替换时重新打开.
+     */
+    unsigned int file_cache_check_interval_ms_{1000};
+
+    /**
+     * @brief 不超过该大小(单位:字节)的文件，内容缓存在内存中，0表示不缓存文件内容.
+     *
+     * @details 内容缓存在内存中的文件，ETag为内容的MD5，否则由文件大小和修改时间生成.
+     */
+    unsigned int file_cache_max_content_size_{64 * 1024};
+
+    /** 文件缓存中文件内容的总大小上限(单位:字节)，默认32MB */
+    uint64_t file_cache_max_memory_{32 * 1024 * 1024};
+
+    /**
+     * @brief 是否根据`Accept-Encoding`请求头压缩响应内容.
+     *
+     * @details 只压缩`Content-Type`适合压缩的内容(文本、JSON、JS、SVG等).
+     * @details 类型适合压缩的文件优先使用同目录下的预压缩文件(`.br`, `.gz`)，其次使用文件缓存中的压缩结果.
+     */
+    bool compression_enabled_{true};
+
+    /** 小于该大小(单位:字节)的响应内容不压缩 */
+    unsigned int compression_min_size_{1024};
+
+    /** 动态内容的压缩等级(gzip/deflate, 1~9)，文件缓存中的内容始终使用最高压缩等级 */
+    unsigned int compression_level_{6};
+
+    /** TLS会话ID缓存的数量上限(每个TLS监听地址)，0表示不缓存(客户端仍然可以通过会话票据恢复会话) */
+    unsigned int tls_session_cache_size_{20480};
+
+    /** TLS会话(包括会话票据)的有效期(单位:秒)，会话票据的密钥也按照该间隔轮换 */
+    unsigned int tls_session_timeout_s_{300};
+
+    /**
+     * @brief 检查证书和私钥文件是否更新的间隔(单位:毫秒)，0表示不检查.
+     *
+     * @details 文件被修改后自动重新加载，新连接使用新的证书，无需重启服务器(也可以调用`HttpServer::ReloadTlsCertificates`).
+     * @details 加载失败时继续使用原来的证书，之后每次检查都会重新尝试.
+     */
+    unsigned int tls_cert_check_interval_ms_{60000};
+
+    /**
+     * @brief 是否支持HTTP/2.
+     *
+     * @details TLS监听地址通过ALPN协商(`h2`)，普通监听地址支持以连接前言开始的h2c(客户端预先知道服务器支持HTTP/2).
+     * @details 每个流按照普通请求处理(路由、拦截器、处理线程池等)，路由的回调函数无需区分.
+     */
+    bool http2_enabled_{true};
+
+    /** HTTP/2连接上同时处理的流(请求)数量上限，超出时拒绝新的流(`REFUSED_STREAM`) */
+    unsigned int http2_max_concurrent_streams_{100};
+
     /** HTTP Server版本号 */
     std::string version_{"1.0.0"};
 
@@ -0,0 +1,179 @@
+/**
+ * @file multipart_stream_parser.h
+ * @brief 增量解析multipart/form-data(流式接收的请求体).
+ * @author Leopard-C (leopard.c@outlook.com)
+ * @date 2023-11-29
+ *
+ * @copyright Copyright (c) 2023-present, Jinbao Chen.
+ */
+#ifndef IC_SERVER_MULTIPART_STREAM_PARSER_H_
+#define IC_SERVER_MULTIPART_STREAM_PARSER_H_
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "form_param.h"
+#include "logger.h"
+#include "router.h"
+
+namespace ic {
+namespace server {
+
+class MultipartParser;
+
+/**
+ * @brief 增量解析multipart/form-data的状态机.
+ *
+ * @details 每次传入一块数据(如`Route::body_chunk_callback`收到的数据)，不需要完整的body，内存占用与body大小无关.
+ * @details 解析出一个part的头部后调用`on_part_begin`，之后每解析出一段内容调用`on_part_data`，结束时调用`on_part_end`.
+ * @details 未设置`on_part_data`时: 文件保存到`upload_dir`下的临时文件中(见`files()`)，其他字段保存在内存中(见`fields()`).
+ * @details 回调函数中的`FormParam::content()`始终为空.
+ *
+ * @note 非线程安全.
+ */
+class MultipartStreamParser {
+public:
+    using PartCallback = std::function<bool(const FormParam& part)>;
+    using PartDataCallback = std::function<bool(const FormParam& part, const char* data, size_t size)>;
+    /**
+     * @brief 每个请求开始接收body时调用，用于设置解析器.
+     */
+    using SetupCallback = std::function<void(Request& req, MultipartStreamParser& parser)>;
+
+    /**
+     * @brief 保存到临时文件中的文件.
+     */
+    struct File {
+        /** 字段名 */
+        std::string name;
+        /** 客户端上传的文件名 */
+        std::string filename;
+        std::string content_type;
+        /** 临时文件的路径 */
+        std::string path;
+        uint64_t size{0};
+    };
+
+public:
+    /**
+     * @param boundary `Content-Type`中的boundary参数(不含开头的`--`)
+     */
+    MultipartStreamParser(const std::string& boundary, std::shared_ptr<ILogger> logger);
+    MultipartStreamParser(const MultipartStreamParser&) = delete;
+    MultipartStreamParser& operator=(const MultipartStreamParser&) = delete;
+    /**
+     * @brief 删除尚未被移走的临时文件.
+     */
+    ~MultipartStreamParser();
+
+    /**
+     * @brief 解析一块数据.
+     *
+     * @return 格式错误、超出限制或者回调函数返回false时返回false，之后不能继续使用
+     */
+    bool Feed(const char* data, size_t size);
+
+    /**
+     * @brief 是否已经解析到结束分隔符.
+     */
+    bool is_done() const { return state_ == State::kDone; }
+
+    /**
+     * @brief 解析失败的原因.
+     */
+    const std::string& error() const { return error_; }
+
+    /**
+     * @brief 内存中的字段(未设置`on_part_data`时).
+     */
+    const std::multimap<std::string, std::string>& fields() const { return fields_; }
+
+    /**
+     * @brief 保存到临时文件中的文件(未设置`on_part_data`时).
+     *
+     * @note 解析器析构时删除临时文件，需要保留时应当在此之前移动(重命名)文件
+     */
+    const std::vector<File>& files() const { return files_; }
+
+    void set_on_part_begin(PartCallback cb) { on_part_begin_ = cb; }
+    void set_on_part_data(PartDataCallback cb) { on_part_data_ = cb; }
+    void set_on_part_end(PartCallback cb) { on_part_end_ = cb; }
+
+    /**
+     * @brief 保存文件的目录(UTF8编码)，为空时拒绝上传文件.
+     */
+    void set_upload_dir(const std::string& dir);
+
+    /**
+     * @brief 内存中的字段的大小上限，默认64KB.
+     */
+    void set_max_field_size(size_t size) { max_field_size_ = size; }
+
+    /**
+     * @brief 生成流式接收multipart/form-data的`Route::body_chunk_callback`.
+     *
+     * @details 收到第一块body时创建解析器，附加到请求上，并调用`setup`.
+     * @details 格式错误时返回`400 Bad Request`并中止接收.
+     */
+    static Route::BodyChunkCallback MakeBodyChunkCallback(SetupCallback setup);
+
+    /**
+     * @brief 获取`MakeBodyChunkCallback`附加到请求上的解析器.
+     *
+     * @details 在路由的回调函数中调用，需要检查`is_done()`，确认body完整.
+     *
+     * @return body为空时返回nullptr
+     */
+    static MultipartStreamParser* FromRequest(Request& req);
+
+private:
+    enum class State {
+        kPreamble,
+        kBoundaryTail,
+        kHeaders,
+        kData,
+        kDone,
+        kError
+    };
+
+    bool Fail(const std::string& error);
+    bool Abort(const char* callback);
+    bool OnPartBegin();
+    bool OnPartData(const char* data, size_t size);
+    bool OnPartEnd();
+
+private:
+    State state_{State::kPreamble};
+    /** 分隔符(`\r\n--boundary`) */
+    std::string delimiter_;
+    /** 尚未解析的数据(不超过一次传入的数据加上分隔符的长度) */
+    std::string buffer_;
+    std::vector<std::string> header_lines_;
+    size_t header_size_{0};
+    FormParam part_;
+    std::string error_;
+    /** 是否被回调函数中止(此时由回调函数设置响应内容) */
+    bool aborted_{false};
+    std::shared_ptr<ILogger> logger_;
+    std::unique_ptr<MultipartParser> header_parser_;
+
+    PartCallback on_part_begin_;
+    PartDataCallback on_part_data_;
+    PartCallback on_part_end_;
+
+    std::string upload_dir_;
+    size_t max_field_size_{64 * 1024};
+    std::multimap<std::string, std::string> fields_;
+    std::string field_value_;
+    std::vector<File> files_;
+    /** 正在写入的临时文件 */
+    FILE* file_{nullptr};
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_MULTIPART_STREAM_PARSER_H_
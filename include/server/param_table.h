@@ -0,0 +1,94 @@
+/**
+ * @file param_table.h
+ * @brief 参数表(URL参数、cookie、body参数).
+ * @author Leopard-C (leopard.c@outlook.com)
+ * @date 2023-11-29
+ *
+ * @copyright Copyright (c) 2023-present, Jinbao Chen.
+ */
+#ifndef IC_SERVER_PARAM_TABLE_H_
+#define IC_SERVER_PARAM_TABLE_H_
+#include <map>
+#include <string>
+#include <boost/container/small_vector.hpp>
+#include "string_view.h"
+#include "util/arena.h"
+
+namespace ic {
+namespace server {
+
+/**
+ * @brief 参数表.
+ *
+ * @details 键和值都是指向原始请求内容的`StringView`，解析时不复制.
+ * @details 只有包含`%`或`+`时才需要URL解码，且在第一次访问该值时才进行.
+ *
+ * @note 原始请求内容必须在参数表的生命周期内保持有效.
+ * @note 指定`arena`时，条目较多时扩容的内存从`arena`分配.
+ * @note 非线程安全(访问时可能会缓存解码结果).
+ */
+class ParamTable {
+public:
+    struct Entry {
+        /** 键(原始内容) */
+        StringView key;
+        /** 值(原始内容) */
+        StringView value;
+        /** 键是否需要URL解码 */
+        bool key_encoded{false};
+        /** 值是否需要URL解码 */
+        bool value_encoded{false};
+        /** 解码后的键(仅`key_encoded`为true时有效) */
+        std::string key_decoded;
+
+        /** 是否已经生成`value_str` */
+        mutable bool materialized{false};
+        /** 值是否合法(URL解码失败时为false) */
+        mutable bool valid{true};
+        /** 解码后的值 */
+        mutable std::string value_str;
+    };
+
+    using EntryVector = boost::container::small_vector<Entry, 8, util::ArenaAllocator<Entry>>;
+
+public:
+    explicit ParamTable(util::Arena* arena = nullptr)
+        : entries_(EntryVector::allocator_type(util::ArenaAllocator<void>(arena))) {}
+
+    /**
+     * @brief 解析KeyValue格式的字符串，如`a=1&b=2`.
+     *
+     * @param outer_delimiter 键值对之间的分隔符
+     * @param inner_delimiter 键和值之间的分隔符
+     * @param trim 是否去除键和值两端的空格
+     */
+    void Parse(const char* str, size_t len, char outer_delimiter, char inner_delimiter, bool trim);
+
+    void Clear() { entries_.clear(); }
+
+    bool empty() const { return entries_.empty(); }
+    size_t size() const { return entries_.size(); }
+
+    /**
+     * @brief 查找第一个指定名称的参数值(已解码).
+     * @return 不存在返回nullptr
+     */
+    const std::string* Find(const std::string& name) const;
+
+    /**
+     * @brief 转换为`std::multimap`(已解码，忽略解码失败的参数).
+     */
+    std::multimap<std::string, std::string> ToMap() const;
+
+private:
+    static bool KeyEquals(const Entry& entry, const std::string& name);
+    static const std::string* Value(const Entry& entry);
+
+private:
+    EntryVector entries_;
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_PARAM_TABLE_H_
@@ -10,12 +10,15 @@
 #define IC_SERVER_REQUEST_H_
 #include <chrono>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <jsoncpp/json/value.h>
 #include "content_type.h"
 #include "form_param.h"
 #include "http_method.h"
+#include "param_table.h"
+#include "string_view.h"
 
 namespace ic {
 namespace server {
@@ -23,7 +26,10 @@ namespace server {
 class HttpServer;
 class RequestRaw;
 class Session;
+class Http2Session;
 class Route;
+class MultipartStreamParser;
+struct RequestSlot;
 
 /**
  * @brief HTTP请求.
@@ -32,10 +38,15 @@ class Request {
 public:
     friend class HttpServer;
     friend class Session;
+    friend class Http2Session;
     friend class Router;
+    friend class MultipartStreamParser;
 
 public:
-    Request(HttpServer* svr, RequestRaw* raw, const std::string& client_ip);
+    /**
+     * @param arena 内存池(可选)，参数表、表单项等从中分配，生命周期必须长于该对象
+     */
+    Request(HttpServer* svr, RequestRaw* raw, const std::string& client_ip, util::Arena* arena = nullptr);
     Request(const Request&) = delete;
     Request& operator=(const Request&) = delete;
     ~Request();
@@ -126,6 +137,14 @@ public:
      */
     std::string GetHeader(const std::string& name) const;
 
+    /**
+     * @brief 获取请求头(不复制，指向原始请求).
+     * 
+     * @param  name 字段名称，不区分大小写
+     * @return StringView 字段值，如果不存在则为空
+     */
+    StringView GetHeaderView(const std::string& name) const;
+
     /**
      * @brief 获取请求头(可能存在多个同名的).
      * 
@@ -156,7 +175,7 @@ public:
     /**
      * @brief 获取本次请求携带的所有cookie.
      */
-    const std::multimap<std::string, std::string>& cookies() const { return cookies_; }
+    std::multimap<std::string, std::string> cookies() const { return cookies_.ToMap(); }
 
     /**
      * @brief 获取本次请求的某项cookie.
@@ -164,15 +183,29 @@ public:
     const std::string& GetCookie(const std::string& name, bool* exist = nullptr) const;
 
     /**
-     * @brief 正则路由的匹配项.
+     * @brief 正则路由(或模式路由)的匹配项.
      * 
      * @details 例如对于正则路由 /article/post/(.+)/([0-9]+), 用户请求 /article/post/Tom/16
      * @details GetRouteRegexMatch(0) 返回第1个匹配项 Tom
      * @details GetRouteRegexMatch(1) 返回第2个匹配项 16
      * 
      * @param index 下标索引，第index个匹配项，从0开始编号
+     * @note 第一次调用时复制所有匹配项，只需要读取时使用`route_matches()`
+     */
+    const std::string& GetRouteRegexMatch(size_t index) const;
+
+    /**
+     * @brief 路由匹配项(指向请求路径，不复制).
+     */
+    const std::vector<StringView>& route_matches() const { return route_regex_match_; }
+
+    /**
+     * @brief 模式路由中指定名称的参数值.
+     * 
+     * @details 例如对于模式路由 /user/{id:int}/posts/{slug}, 用户请求 /user/16/posts/hello
+     * @details GetRouteParam("id") 返回 16
      */
-    const std::string& GetRouteRegexMatch(size_t index) const { return route_regex_match_[index]; }
+    std::string GetRouteParam(const std::string& name, bool* exist = nullptr) const;
 
     /**
      * @brief 获取URL中的指定名称的参数值.
@@ -216,12 +249,12 @@ public:
     /**
      * @brief 获取所有的URL参数名和参数值.
      */
-    const std::multimap<std::string, std::string>& url_params() const { return url_params_; }
+    std::multimap<std::string, std::string> url_params() const { return url_params_.ToMap(); }
 
     /**
      * @brief 内容类型为application/x-www-form-urlencoded时，获取body中所有的参数.
      */
-    const std::multimap<std::string, std::string>& body_params() const { return body_params_; }
+    std::multimap<std::string, std::string> body_params() const { return body_params_.ToMap(); }
 
     /**
      * @brief 内容类型为multipart/form-data时，获取form表单所有内容.
@@ -249,6 +282,7 @@ private:
 private:
     HttpServer* svr_;
     RequestRaw* raw_;
+    util::Arena* arena_;
 
     /**
      * @brief 客户端地址.
@@ -278,6 +312,9 @@ private:
     /** 本次请求的ID(全局唯一) */
     int64_t id_;
 
+    /** 处理期间在`RequestRegistry`中所在的槽位 */
+    RequestSlot* registry_slot_{nullptr};
+
     /** 请求路径，如/user/getInfo */
     std::string path_;
 
@@ -288,21 +325,26 @@ private:
     ContentType content_type_;
 
     /**
-     * @brief 正则路由匹配项.
+     * @brief 正则路由(或模式路由)匹配项，指向`path_`.
      */
-    std::vector<std::string> route_regex_match_;
+    std::vector<StringView> route_regex_match_;
+    /** `GetRouteRegexMatch`返回的匹配项副本(第一次调用时生成) */
+    mutable std::vector<std::string> route_regex_match_strings_;
 
     /** 自定义信息，程序内修改和使用 */
     Json::Value custom_data_;
 
-    /** cookie */
-    std::multimap<std::string, std::string> cookies_;
+    /** 流式接收multipart/form-data时的解析器(`MultipartStreamParser::MakeBodyChunkCallback`创建)，随请求一起释放 */
+    std::shared_ptr<MultipartStreamParser> multipart_stream_parser_;
+
+    /** cookie(指向Cookie请求头) */
+    ParamTable cookies_;
 
-    /** URL中的参数 */
-    std::multimap<std::string, std::string> url_params_;
+    /** URL中的参数(指向请求行) */
+    ParamTable url_params_;
 
-    /** (1)内容类型为application/x-www-form-urlencoded时body中的参数 */
-    std::multimap<std::string, std::string> body_params_;
+    /** (1)内容类型为application/x-www-form-urlencoded时body中的参数(指向body) */
+    ParamTable body_params_;
 
     /** (2)内容类型为multipart/form-data，存放解析后的表单对象 */
     std::multimap<std::string, const FormParam*> form_params_;
@@ -9,12 +9,15 @@
 #ifndef IC_SERVER_RESPONSE_H_
 #define IC_SERVER_RESPONSE_H_
 #include <map>
+#include <memory>
 #include <jsoncpp/json/value.h>
+#include "response_writer.h"
 
 namespace ic {
 namespace server {
 
 class Session;
+class Http2Session;
 class HttpServer;
 class HttpCookie;
 
@@ -24,6 +27,7 @@ class HttpCookie;
 class Response {
 public:
     friend class Session;
+    friend class Http2Session;
 
     Response(HttpServer* svr);
     Response(Response&&) = delete;
@@ -35,6 +39,7 @@ public:
     bool keep_alive() const { return keep_alive_; }
 
     bool is_file_body() const { return is_file_body_; }
+    bool is_stream_body() const { return static_cast<bool>(stream_writer_); }
 
     /**
      * @brief 设置响应头.
@@ -80,10 +85,24 @@ public:
     void SetFileBody(const std::string& filepath, const std::string& content_type = "");
     void SetFileBody(unsigned int status_code, const std::string& filepath, const std::string& content_type = "");
 
+    /**
+     * @brief 流式响应内容(分块传输编码)，通过返回的写入器写入.
+     *
+     * @details 适合生成大量内容(如导出CSV)，不需要一次性生成全部内容，内存占用不超过缓冲区大小.
+     * @details 路由回调函数返回后开始发送，写入器调用`Close`之后结束响应.
+     *
+     * @param max_buffer_size 写入器的缓冲区大小
+     */
+    std::shared_ptr<ResponseWriter> SetStreamBody(const std::string& content_type,
+        size_t max_buffer_size = ResponseWriter::kDefaultMaxBufferSize);
+    std::shared_ptr<ResponseWriter> SetStreamBody(unsigned int status_code, const std::string& content_type,
+        size_t max_buffer_size = ResponseWriter::kDefaultMaxBufferSize);
+
     void SetBadRequest(const std::string& why = "Bad Request!");
 
 private:
     void SetContentType(const std::string& content_type);
+    void ResetStreamBody();
 
 private:
     HttpServer* svr_;
@@ -92,6 +111,7 @@ private:
     unsigned int status_code_{200U};
     std::string string_body_;
     std::string filepath_;  // Response file body. The path must be utf-8 encoded.
+    std::shared_ptr<ResponseWriter> stream_writer_;  // Response stream body.
     std::multimap<std::string, std::string> headers_;
 };
 
@@ -0,0 +1,175 @@
+/**
+ * @file response_writer.h
+ * @brief 流式响应内容的写入器.
+ * @author Leopard-C (leopard.c@outlook.com)
+ * @date 2023-11-29
+ *
+ * @copyright Copyright (c) 2023-present, Jinbao Chen.
+ */
+#ifndef IC_SERVER_RESPONSE_WRITER_H_
+#define IC_SERVER_RESPONSE_WRITER_H_
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ic {
+namespace server {
+
+class Response;
+class Session;
+class Http2Session;
+
+/**
+ * @brief 流式响应内容的写入器(`Response::SetStreamBody`).
+ *
+ * @details 写入的内容先放入有界的缓冲区，由服务器以分块传输编码(chunked)依次发送，发送完毕后释放.
+ * @details 缓冲区已满时，`Write`阻塞直到发送出去一部分，`TryWrite`直接返回false，内存占用不超过缓冲区大小.
+ * @details 也可以通过`set_on_writable`在缓冲区有空间时按需生成内容(不阻塞任何线程).
+ * @details 写入完毕后调用`Close`，之后才会结束该响应.
+ * @note 线程安全，可以在任意线程中写入.
+ * @note 路由回调函数返回之前，响应尚未开始发送，此时写入的内容不能超过缓冲区大小(否则`Write`一直阻塞).
+ */
+class ResponseWriter {
+public:
+    friend class Response;
+    friend class Session;
+    friend class Http2Session;
+
+    /** 默认的缓冲区大小 */
+    static constexpr size_t kDefaultMaxBufferSize = 256 * 1024;
+
+    /**
+     * @brief 缓冲区有空间时的回调函数(在I/O线程中调用).
+     */
+    using WritableCallback = std::function<void(ResponseWriter& writer)>;
+
+    explicit ResponseWriter(size_t max_buffer_size = kDefaultMaxBufferSize);
+    ResponseWriter(const ResponseWriter&) = delete;
+    ResponseWriter& operator=(const ResponseWriter&) = delete;
+
+    /**
+     * @brief 写入一块内容，缓冲区已满时阻塞.
+     *
+     * @note 不能在I/O线程中调用(会阻塞发送)，I/O线程中使用`TryWrite`或`set_on_writable`
+     *
+     * @return 已经调用过`Close`或者连接已断开时返回false
+     */
+    bool Write(const char* data, size_t size);
+    bool Write(const std::string& data) { return Write(data.data(), data.size()); }
+
+    /**
+     * @brief 写入一块内容，缓冲区已满时不写入，直接返回false.
+     */
+    bool TryWrite(const char* data, size_t size);
+    bool TryWrite(const std::string& data) { return TryWrite(data.data(), data.size()); }
+
+    /**
+     * @brief 写入完毕，发送完缓冲区中的内容后结束响应.
+     */
+    void Close();
+
+    /**
+     * @brief 是否可以继续写入(未调用`Close`，且连接未断开).
+     */
+    bool is_open() const;
+
+    /**
+     * @brief 连接是否已断开(或者响应被丢弃)，之后的写入都会失败.
+     */
+    bool aborted() const;
+
+    /**
+     * @brief 缓冲区中尚未发送完毕的字节数.
+     */
+    size_t buffered_size() const;
+
+    size_t max_buffer_size() const { return max_buffer_size_; }
+
+    /**
+     * @brief 设置缓冲区有空间时的回调函数.
+     *
+     * @details 响应头发送之后回调一次，之后每当已缓冲的内容不超过缓冲区大小的一半时回调.
+     * @details 在I/O线程中调用，应当只使用`TryWrite`写入，并尽快返回.
+     */
+    void set_on_writable(WritableCallback cb);
+
+    /**
+     * @brief 设置心跳内容，连接空闲(一段时间内没有发送任何内容)时自动发送.
+     *
+     * @details 用于长连接(如`text/event-stream`)，防止连接被中间代理或客户端因空闲而断开，也能及时发现已断开的连接.
+     * @details 缓冲区已满时不发送心跳.
+     * @note 需要在路由回调函数返回之前设置.
+     *
+     * @param interval_ms 空闲多久发送一次心跳，0表示服务器配置`tcp_stream_timeout_ms`的一半
+     */
+    void set_heartbeat(const std::string& data, unsigned int interval_ms = 0);
+
+private:
+    /**
+     * @brief 开始发送，有新的内容可以发送时调用`notify`(由`Session`调用).
+     */
+    void Attach(std::function<void()> notify);
+
+    /**
+     * @brief 取出缓冲区中的内容用于发送(仍计入缓冲区大小，直到`OnSent`).
+     *
+     * @param[out] closed 是否已经写入完毕
+     */
+    void Take(std::vector<std::string>* chunks, bool* closed);
+
+    /**
+     * @brief 已发送`size`字节.
+     *
+     * @return 是否应当调用`on_writable`回调函数
+     */
+    bool OnSent(size_t size);
+
+    /**
+     * @brief 调用`on_writable`回调函数(I/O线程).
+     */
+    void NotifyWritable();
+
+    /**
+     * @brief 全部发送完毕.
+     */
+    void Finish();
+
+    /**
+     * @brief 连接断开或者响应被丢弃，唤醒阻塞的写入.
+     */
+    void Abort();
+
+    /**
+     * @brief 获取心跳设置(由`Session`调用).
+     *
+     * @return 是否设置了心跳
+     */
+    bool GetHeartbeat(std::string* data, unsigned int* interval_ms) const;
+
+    bool Push(const char* data, size_t size, bool block);
+
+private:
+    const size_t max_buffer_size_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::string> queue_;
+    /** 缓冲区中(包括正在发送)的字节数 */
+    size_t buffered_{0};
+    bool closed_{false};
+    bool aborted_{false};
+    bool finished_{false};
+    /** 是否已经通知`Session`，且尚未取出内容(避免重复通知) */
+    bool notified_{false};
+    std::function<void()> notify_;
+    WritableCallback on_writable_;
+    std::string heartbeat_;
+    unsigned int heartbeat_interval_ms_{0};
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_RESPONSE_WRITER_H_
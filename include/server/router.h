@@ -11,24 +11,13 @@
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <jsoncpp/json/value.h>
 #include "http_method.h"
 
-/**
- * @brief 是否使用`Boost.shared_mutex`.
- * @note `std::shared_mutex`是`C++17`才引入的
- */
-#define IC_SERVER_USE_BOOST_SHARED_MUTEX 1
-
-#if IC_SERVER_USE_BOOST_SHARED_MUTEX == 1
-#  include <boost/thread/lock_types.hpp>
-#  include <boost/thread/shared_mutex.hpp>
-#else
-#  include <shared_mutex>
-#endif
-
 /**
  * @brief 是否使用`Boost.Regex`.
  * @note 使用`Boost.Regex`正则表达式库，比`std::regex`性能更好
@@ -49,6 +38,42 @@ namespace server {
 class Request;
 class Response;
 class HttpServer;
+class EventStream;
+class RouteMetrics;
+struct WebSocketHandler;
+
+/**
+ * @brief 异步路由的完成通知.
+ *
+ * @details 可以复制，可以在任意线程中调用，只有第一次调用有效.
+ * @details 调用之后，服务器才会返回响应内容，之后不能再访问对应的`Request`和`Response`对象.
+ * @details 所有副本都被释放而没有调用时，先执行`abandoned`(如设置500响应)，再视为已经完成.
+ */
+class ResponseCompletion {
+public:
+    ResponseCompletion() = default;
+    explicit ResponseCompletion(std::function<void()> done, std::function<void()> abandoned = nullptr);
+
+    /**
+     * @brief 通知服务器，响应内容已经准备好.
+     */
+    void operator()() const { Complete(); }
+    void Complete() const;
+
+    /**
+     * @brief 是否已经调用过`Complete()`.
+     */
+    bool completed() const;
+
+private:
+    struct State {
+        ~State();
+        std::atomic_bool completed{false};
+        std::function<void()> done;
+        std::function<void()> abandoned;
+    };
+    std::shared_ptr<State> state_;
+};
 
 /**
  * @brief 路由.
@@ -57,21 +82,41 @@ class Route {
 public:
     using ResponseCallback = std::function<void(Request&, Response&)>;
     using ResponseJsonCallback = std::function<void(Request&, Json::Value&)>;
+    /**
+     * @brief 异步回调函数，返回后不会立即响应，直到调用`ResponseCompletion`.
+     *
+     * @note 调用`ResponseCompletion`之前，`Request`和`Response`对象一直有效，且不占用工作线程.
+     */
+    using AsyncResponseCallback = std::function<void(Request&, Response&, ResponseCompletion)>;
+    /**
+     * @brief 流式接收请求body的回调函数，每读取一块body调用一次.
+     *
+     * @return 返回false表示中止接收，直接返回当前的响应内容，之后关闭连接
+     */
+    using BodyChunkCallback = std::function<bool(Request&, Response&, const char* data, size_t size)>;
 
 public:
     Route(const std::string& path, int methods, ResponseCallback cb, const std::string& desc, const std::unordered_map<std::string, std::string>& cfg)
-        : path(path), description(desc), methods(methods), response_callback_(cb), configuration(cfg) {}
+        : id(NextId()), methods(methods), path(path), description(desc), configuration(cfg), response_callback_(cb) {}
     Route(const std::string& path, int methods, ResponseJsonCallback cb, const std::string& desc, const std::unordered_map<std::string, std::string>& cfg)
-        : path(path), description(desc), methods(methods), response_json_callback_(cb), configuration(cfg) {}
-    virtual ~Route() = default;
+        : id(NextId()), methods(methods), path(path), description(desc), configuration(cfg), response_json_callback_(cb) {}
+    Route(const std::string& path, int methods, AsyncResponseCallback cb, const std::string& desc, const std::unordered_map<std::string, std::string>& cfg)
+        : id(NextId()), methods(methods), path(path), description(desc), configuration(cfg), response_async_callback_(cb) {}
+    virtual ~Route();
 
     virtual bool is_static() const = 0;
-    bool is_regex() const { return !is_static(); }
+    virtual bool is_pattern() const { return false; }
+    bool is_regex() const { return !is_static() && !is_pattern(); }
+    bool is_async() const { return static_cast<bool>(response_async_callback_); }
     std::string GetMethodsString() const;
     Json::Value ToJson() const;
     void Invoke(Request& req, Response& res) const;
+    void InvokeAsync(Request& req, Response& res, ResponseCompletion completion) const;
 
 public:
+    /** 路由ID(进程内唯一，从1开始递增，用于二进制访问日志) */
+    const uint32_t id;
+
     /** 支持的HTTP请求方法(如果支持多种方法，使用或运算，如 HttpMethod::kGET | HttpMethod::kPOST) */
     int methods = HttpMethod::kNotSupport;
 
@@ -87,9 +132,56 @@ public:
     /** 配置信息(可以用于请求拦截器中，如是否需要鉴权) */
     std::unordered_map<std::string, std::string> configuration;
 
+    /**
+     * @brief 是否是阻塞型路由(如访问数据库等耗时操作).
+     *
+     * @details 阻塞型路由的回调函数在独立的处理线程池中执行，不占用I/O线程.
+     * @details 需要在添加到路由管理器之前设置.
+     */
+    bool blocking{false};
+
+    /**
+     * @brief 请求body的大小上限(单位:字节)，0表示使用服务器配置`body_limit`.
+     *
+     * @details 匹配路由之后、读取body之前设置，超出时返回`413`并关闭连接.
+     */
+    uint64_t body_limit{0};
+
+    /**
+     * @brief 流式接收请求body(如上传大文件)，需要在添加到路由管理器之前设置.
+     *
+     * @details 设置后body不再缓存在内存中，每读取一块(不超过64KB)调用一次，内存占用与body大小无关.
+     * @details 接收完毕后再调用路由的回调函数，此时`Request::body()`为空，也不解析body参数.
+     * @details 请求拦截器(1)在接收body之前执行，可以据此提前拒绝请求(如鉴权失败).
+     * @details 在I/O线程中调用，应当尽快返回.
+     */
+    BodyChunkCallback body_chunk_callback;
+
+    /**
+     * @brief WebSocket路由(见`Router::AddWebSocketRoute`)，收到升级请求时移交给WebSocket会话.
+     */
+    std::shared_ptr<const WebSocketHandler> websocket;
+
+private:
+    friend class AccessLogWriter;
+    friend class HttpServer;
+    friend class Session;
+    static uint32_t NextId();
+
+    /**
+     * @brief 统计数据(延迟直方图等)，第一次使用时创建.
+     */
+    RouteMetrics* metrics() const;
+
 private:
     ResponseCallback response_callback_;
     ResponseJsonCallback response_json_callback_;
+    AsyncResponseCallback response_async_callback_;
+
+    /** 二进制访问日志中最近一次写入该路由信息的文件序号 */
+    mutable std::atomic<uint64_t> access_log_file_seq_{0};
+
+    mutable std::atomic<RouteMetrics*> metrics_{nullptr};
 };
 
 /**
@@ -103,6 +195,8 @@ public:
         : Route(path, methods, cb, desc, cfg) {}
     StaticRoute(const std::string& path, int methods, ResponseJsonCallback cb, const std::string& desc, const std::unordered_map<std::string, std::string>& cfg)
         : Route(path, methods, cb, desc, cfg) {}
+    StaticRoute(const std::string& path, int methods, AsyncResponseCallback cb, const std::string& desc, const std::unordered_map<std::string, std::string>& cfg)
+        : Route(path, methods, cb, desc, cfg) {}
     virtual bool is_static() const override { return true; }
 };
 
@@ -117,6 +211,8 @@ public:
         : Route(path, methods, cb, desc, cfg), regex(path), priority(priority) {}
     RegexRoute(const std::string& path, int methods, ResponseJsonCallback cb, const std::string& desc, const std::unordered_map<std::string, std::string>& cfg, int priority = 0)
         : Route(path, methods, cb, desc, cfg), regex(path), priority(priority) {}
+    RegexRoute(const std::string& path, int methods, AsyncResponseCallback cb, const std::string& desc, const std::unordered_map<std::string, std::string>& cfg, int priority = 0)
+        : Route(path, methods, cb, desc, cfg), regex(path), priority(priority) {}
     virtual bool is_static() const override { return false; }
     /** 匹配优先级(值越大，越优先匹配) */
     int priority;
@@ -124,18 +220,70 @@ public:
     REGEX_NAMESPACE::regex regex;
 };
 
+/**
+ * @brief 模式路由(基于前缀树匹配，不使用正则表达式).
+ *
+ * @details 以`/`分隔路径，每一段可以是普通字符串或者参数`{name:type}`.
+ * @details 参数类型: `str`(默认，非空的一段)、`int`(可带负号的整数)、`uint`(非负整数)、`path`(剩余的全部路径，只能位于最后).
+ * @details 匹配优先级: 普通字符串 > uint > int > str > path.
+ * @example /user/{id:int}/posts/{slug}
+ * @example /static/{file:path}
+ *
+ * @note 模式不合法时，构造函数抛出`std::invalid_argument`异常.
+ */
+class PatternRoute : public Route {
+public:
+    /**
+     * @brief 路径中的一段.
+     */
+    struct Segment {
+        enum Type { kLiteral, kUint, kInt, kString, kPath };
+        Type type;
+        /** 普通字符串的内容，或者参数名称 */
+        std::string text;
+    };
+
+public:
+    PatternRoute(const std::string& path, int methods, ResponseCallback cb, const std::string& desc, const std::unordered_map<std::string, std::string>& cfg)
+        : Route(path, methods, cb, desc, cfg) { Compile(); }
+    PatternRoute(const std::string& path, int methods, ResponseJsonCallback cb, const std::string& desc, const std::unordered_map<std::string, std::string>& cfg)
+        : Route(path, methods, cb, desc, cfg) { Compile(); }
+    PatternRoute(const std::string& path, int methods, AsyncResponseCallback cb, const std::string& desc, const std::unordered_map<std::string, std::string>& cfg)
+        : Route(path, methods, cb, desc, cfg) { Compile(); }
+    virtual bool is_static() const override { return false; }
+    virtual bool is_pattern() const override { return true; }
+
+    /**
+     * @brief 获取参数的下标索引，不存在则返回-1.
+     */
+    int GetParamIndex(const std::string& name) const;
+
+    /** 编译后的路径 */
+    std::vector<Segment> segments;
+    /** 参数名称(按照出现顺序) */
+    std::vector<std::string> param_names;
+
+private:
+    void Compile();
+};
+
 using RoutePtr = std::shared_ptr<Route>;
 using StaticRoutePtr = std::shared_ptr<StaticRoute>;
 using RegexRoutePtr = std::shared_ptr<RegexRoute>;
+using PatternRoutePtr = std::shared_ptr<PatternRoute>;
 
 using RouteConstPtr = std::shared_ptr<const Route>;
 using StaticRouteConstPtr = std::shared_ptr<const StaticRoute>;
 using RegexRouteConstPtr = std::shared_ptr<const RegexRoute>;
+using PatternRouteConstPtr = std::shared_ptr<const PatternRoute>;
+
+struct RouteTable;
 
 /**
  * @brief 路由管理器.
  * 
  * @note 服务器运行过程中，可以动态新增或删除路由，且线程安全.
+ * @note 路由表是不可修改的快照，修改路由时复制一份新的路由表并原子地发布，匹配路由时不加锁.
  */
 class Router {
 public:
@@ -154,6 +302,10 @@ public:
         std::function<void(Request&, Json::Value&)> callback,
         const std::string& description = "",
         const std::unordered_map<std::string, std::string>& configuration = {});
+    bool AddStaticRoute(const std::string& path, int methods,
+        std::function<void(Request&, Response&, ResponseCompletion)> callback,
+        const std::string& description = "",
+        const std::unordered_map<std::string, std::string>& configuration = {});
 
     /**
      * @brief 添加正则路由，如果已存在则覆盖.
@@ -163,6 +315,59 @@ public:
         const std::string& description = "", const std::unordered_map<std::string, std::string>& configuration = {}, int priority = 0);
     bool AddRegexRoute(const std::string& path, int methods, std::function<void(Request&, Json::Value&)> callback,
         const std::string& description = "", const std::unordered_map<std::string, std::string>& configuration = {}, int priority = 0);
+    bool AddRegexRoute(const std::string& path, int methods, std::function<void(Request&, Response&, ResponseCompletion)> callback,
+        const std::string& description = "", const std::unordered_map<std::string, std::string>& configuration = {}, int priority = 0);
+
+    /**
+     * @brief 添加模式路由，如果已存在则覆盖.
+     *
+     * @details 例如 /user/{id:int}/posts/{slug}，通过`Request::GetRouteParam("id")`获取参数.
+     * @details 与已有路由的路径结构相同(如仅参数名称或请求方法不同)时无法区分，返回false.
+     * @details 支持多种请求方法时，使用同一个路由(如 HttpMethod::kGET | HttpMethod::kPOST).
+     * @details 匹配顺序: 静态路由 > 模式路由 > 正则路由.
+     */
+    bool AddPatternRoute(PatternRoutePtr route);
+    bool AddPatternRoute(const std::string& path, int methods, std::function<void(Request&, Response&)> callback,
+        const std::string& description = "", const std::unordered_map<std::string, std::string>& configuration = {});
+    bool AddPatternRoute(const std::string& path, int methods, std::function<void(Request&, Json::Value&)> callback,
+        const std::string& description = "", const std::unordered_map<std::string, std::string>& configuration = {});
+    bool AddPatternRoute(const std::string& path, int methods, std::function<void(Request&, Response&, ResponseCompletion)> callback,
+        const std::string& description = "", const std::unordered_map<std::string, std::string>& configuration = {});
+
+    /**
+     * @brief 添加静态文件目录.
+     *
+     * @details 例如 AddStaticDirectory("/web", "/var/www")，请求`/web/js/app.js`返回文件`/var/www/js/app.js`.
+     * @details 注册为模式路由`{prefix}/{path:path}`，只允许GET、HEAD方法.
+     * @details 路径包含`..`等无法安全映射到`root`目录下的请求，返回`404 Not Found`.
+     * @details 文件经过文件缓存返回，附带`ETag`、`Last-Modified`响应头，支持条件请求(`304 Not Modified`).
+     *
+     * @param prefix URL前缀
+     * @param root 本地目录(UTF8编码)
+     * @param index 请求目录(以`/`结尾)时返回的文件名称，为空表示不支持
+     */
+    bool AddStaticDirectory(const std::string& prefix, const std::string& root, const std::string& index = "index.html");
+
+    /**
+     * @brief 添加服务器推送事件(`text/event-stream`)路由，如果已存在则覆盖.
+     *
+     * @details 注册为静态路由，只允许GET方法，响应头发送后连接保持打开，通过`EventStream`推送事件.
+     * @details 需要修改每个连接的队列大小时，使用`EventStream::MakeResponseCallback`生成回调函数，再调用`AddStaticRoute`.
+     */
+    bool AddEventStreamRoute(const std::string& path,
+        std::function<void(Request&, std::shared_ptr<EventStream>)> callback,
+        const std::string& description = "",
+        const std::unordered_map<std::string, std::string>& configuration = {});
+
+    /**
+     * @brief 添加WebSocket路由，如果已存在则覆盖.
+     *
+     * @details 注册为静态路由，只允许GET方法，请求拦截器通过之后完成握手，该连接之后不再处理HTTP请求.
+     * @details 不是升级请求(没有`Upgrade: websocket`请求头)时返回`426 Upgrade Required`.
+     */
+    bool AddWebSocketRoute(const std::string& path, const WebSocketHandler& handler,
+        const std::string& description = "",
+        const std::unordered_map<std::string, std::string>& configuration = {});
 
     /**
      * @brief 删除路由.
@@ -182,6 +387,7 @@ public:
     std::unordered_map<std::string, RouteConstPtr> routes();
     std::unordered_map<std::string, StaticRouteConstPtr> static_routes();
     std::vector<RegexRouteConstPtr> regex_routes();
+    std::unordered_map<std::string, PatternRouteConstPtr> pattern_routes();
 
     const HttpServer* svr() const { return svr_; }
 
@@ -195,40 +401,41 @@ private:
     bool CheckRoute(RoutePtr route) const;
 
     /**
-     * @brief 删除路由(无锁).
+     * @brief 删除路由(修改的是尚未发布的路由表).
      */
-    void DeleteRoute_WithoutLock(const std::string& path);
+    void DeleteRoute(RouteTable* table, const std::string& path) const;
 
-private:
-    HttpServer* svr_;
+    /**
+     * @brief 获取当前路由表(当前线程缓存的快照，无锁).
+     *
+     * @note 返回的指针在当前线程下一次调用之前有效.
+     */
+    const RouteTable* GetTable() const;
 
-#if IC_SERVER_USE_BOOST_SHARED_MUTEX == 1
-    using SharedMutex = boost::shared_mutex;
-    using ReadLock = boost::shared_lock<boost::shared_mutex>;
-    using WriteLock = boost::unique_lock<boost::shared_mutex>;
-#else
-    using SharedMutex = std::shared_mutex;
-    using ReadLock = std::shared_lock<std::shared_mutex>;
-    using WriteLock = std::unique_lock<std::shared_mutex>;
-#endif
+    /**
+     * @brief 复制当前路由表，用于修改(需要持有`mutex_`).
+     */
+    std::shared_ptr<RouteTable> CloneTable() const;
 
-    /** 读写锁 */
-    SharedMutex mutex_;
+    /**
+     * @brief 发布新的路由表(需要持有`mutex_`).
+     */
+    void PublishTable(std::shared_ptr<RouteTable> table);
 
-    /** 所有路由 */
-    std::unordered_map<std::string, RoutePtr> routes_;
+private:
+    HttpServer* svr_;
 
-    /** 静态路由 */
-    std::unordered_map<std::string, StaticRoutePtr> static_routes_;
+    /** 路由管理器的唯一ID(用于线程缓存) */
+    const uint64_t id_;
 
-    /** 正则表达式路由 */
-    std::vector<RegexRoutePtr> regex_routes_;
+    /** 写锁(仅修改路由表时使用) */
+    std::mutex mutex_;
 
-    /** 路径无效的回调函数 */
-    Route::ResponseCallback cb_invalid_path_;
+    /** 当前路由表(通过`std::atomic_load`/`std::atomic_store`访问) */
+    std::shared_ptr<const RouteTable> table_;
 
-    /** 请求方法无效的回调函数 */
-    Route::ResponseCallback cb_invalid_method_;
+    /** 路由表版本号，每次发布新的路由表时加1 */
+    std::atomic<uint64_t> version_{0};
 };
 
 } // namespace server
@@ -0,0 +1,121 @@
+/**
+ * @file arena.h
+ * @brief 单调内存池.
+ * @author Leopard-C (leopard.c@outlook.com)
+ * @date 2023-11-29
+ *
+ * @copyright Copyright (c) 2023-present Jinbao Chen.
+ */
+#ifndef IC_SERVER_UTIL_ARENA_H_
+#define IC_SERVER_UTIL_ARENA_H_
+#include <cstddef>
+#include <new>
+
+namespace ic {
+namespace server {
+namespace util {
+
+/**
+ * @brief 单调内存池.
+ *
+ * @details 只分配，不单独释放，调用`Reset()`时整体回收.
+ * @details 用于生命周期相同的一组对象(如一次请求中的`Request`、`Response`及其内部数据).
+ *
+ * @note 非线程安全.
+ */
+class Arena {
+public:
+    /**
+     * @param block_size 每个内存块的大小(第一个内存块在`Reset()`后保留)
+     */
+    explicit Arena(size_t block_size = 4096);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @brief 分配内存.
+     */
+    void* Allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    /**
+     * @brief 回收全部内存(调用之前，在内存池中构造的对象必须已经析构).
+     */
+    void Reset();
+
+    /**
+     * @brief 从上次`Reset()`以来分配的字节数.
+     */
+    size_t bytes_allocated() const { return bytes_allocated_; }
+
+private:
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+
+    void NewBlock(size_t min_size);
+
+private:
+    size_t block_size_;
+    size_t bytes_allocated_{0};
+    Block* head_{nullptr};
+    char* ptr_{nullptr};
+    char* end_{nullptr};
+};
+
+/**
+ * @brief 从`Arena`分配内存的分配器，可用于标准容器和`std::allocate_shared`.
+ *
+ * @details `arena`为nullptr时，使用全局`operator new`/`operator delete`.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = ArenaAllocator<U>;
+    };
+
+    ArenaAllocator() noexcept {}
+    explicit ArenaAllocator(Arena* arena) noexcept : arena_(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+    T* allocate(size_t n) {
+        if (arena_) {
+            return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t/* n*/) noexcept {
+        if (!arena_) {
+            ::operator delete(p);
+        }
+    }
+
+    Arena* arena() const { return arena_; }
+
+private:
+    Arena* arena_{nullptr};
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena() != rhs.arena();
+}
+
+} // namespace util
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_UTIL_ARENA_H_
@@ -14,6 +14,14 @@ namespace util {
  */
 std::string get_gmt_time(time_t time);
 
+/**
+ * @brief 解析GMT格式的时间(如`If-Modified-Since`请求头).
+ *
+ * @note 仅支持`Wed, 09 Jun 2021 10:18:14 GMT`格式
+ * @return 格式错误返回false
+ */
+bool parse_gmt_time(const char* str, size_t len, time_t* time);
+
 } // namespace util
 } // namespace server
 } // namespace ic
@@ -19,6 +19,11 @@ namespace util {
  */
 size_t thread_id();
 
+/**
+ * @brief 获取当前线程的序号(进程内从0开始依次分配，用于选择分片).
+ */
+size_t thread_index();
+
 } // namespace util
 } // namespace server
 } // namespace ic
@@ -0,0 +1,134 @@
+/**
+ * @file websocket.h
+ * @brief WebSocket连接.
+ * @author Leopard-C (leopard.c@outlook.com)
+ * @date 2023-11-29
+ *
+ * @copyright Copyright (c) 2023-present, Jinbao Chen.
+ */
+#ifndef IC_SERVER_WEBSOCKET_H_
+#define IC_SERVER_WEBSOCKET_H_
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace ic {
+namespace server {
+
+class Request;
+class WebSocketSession;
+class WebSocketConnection;
+
+using WebSocketConnectionPtr = std::shared_ptr<WebSocketConnection>;
+
+/**
+ * @brief WebSocket路由的回调函数和设置(`Router::AddWebSocketRoute`).
+ *
+ * @details 同一连接的回调函数在其I/O线程中依次调用，应当尽快返回(耗时操作交给其他线程，之后再发送结果).
+ */
+struct WebSocketHandler {
+    /**
+     * @brief 握手完成.
+     *
+     * @details 此时可以访问升级请求(URL参数、Cookie等)，返回之后不能再访问.
+     */
+    std::function<void(const WebSocketConnectionPtr& conn, Request& req)> on_open;
+
+    /**
+     * @brief 收到一条完整的消息.
+     *
+     * @param binary 是否是二进制消息
+     */
+    std::function<void(const WebSocketConnectionPtr& conn, const std::string& message, bool binary)> on_message;
+
+    /**
+     * @brief 连接关闭(客户端关闭、超时、出错或者服务器停止)，之后不再回调.
+     */
+    std::function<void(const WebSocketConnectionPtr& conn)> on_close;
+
+    /** 是否启用`permessage-deflate`压缩(客户端支持时) */
+    bool permessage_deflate{true};
+
+    /** 单条消息的大小上限(字节)，超出时关闭连接 */
+    size_t max_message_size{1024 * 1024};
+
+    /** 每个连接的发送队列大小上限(字节)，超出时发送失败 */
+    size_t max_send_queue_size{1024 * 1024};
+
+    /**
+     * @brief 空闲超时(单位:毫秒)，0表示使用服务器配置`tcp_stream_timeout_ms`.
+     *
+     * @details 空闲一半时间后发送ping，超时前仍未收到任何数据(包括pong)时关闭连接.
+     */
+    unsigned int idle_timeout_ms{0};
+};
+
+/**
+ * @brief 一个WebSocket连接.
+ *
+ * @details 发送的消息先放入该连接的有界队列，由I/O线程依次发送.
+ * @note 发送、关闭等操作线程安全，可以在任意线程中调用；`attachment()`非线程安全.
+ */
+class WebSocketConnection {
+public:
+    friend class WebSocketSession;
+
+    WebSocketConnection(const WebSocketConnection&) = delete;
+    WebSocketConnection& operator=(const WebSocketConnection&) = delete;
+
+    /**
+     * @brief 发送文本消息.
+     *
+     * @return 连接已关闭或者发送队列已满时返回false(不阻塞)
+     */
+    bool SendText(const std::string& message);
+
+    /**
+     * @brief 发送二进制消息.
+     */
+    bool SendBinary(const std::string& data);
+
+    /**
+     * @brief 发送完队列中的消息后关闭连接.
+     *
+     * @param code 关闭码(如1000表示正常关闭)
+     */
+    void Close(uint16_t code = 1000, const std::string& reason = "");
+
+    /**
+     * @brief 是否可以继续发送(已握手，且未关闭).
+     */
+    bool is_open() const;
+
+    /**
+     * @brief 发送队列中尚未发送完毕的字节数.
+     */
+    size_t queued_size() const;
+
+    /**
+     * @brief 连接ID(即升级请求的ID，服务器运行期间唯一).
+     */
+    int64_t id() const { return id_; }
+
+    const std::string& client_ip() const { return client_ip_; }
+
+    /**
+     * @brief 附加到连接上的对象(如用户信息)，随连接一起释放.
+     */
+    std::shared_ptr<void>& attachment() { return attachment_; }
+
+private:
+    WebSocketConnection(std::weak_ptr<WebSocketSession> session, int64_t id, const std::string& client_ip);
+
+private:
+    std::weak_ptr<WebSocketSession> session_;
+    int64_t id_;
+    std::string client_ip_;
+    std::shared_ptr<void> attachment_;
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_WEBSOCKET_H_
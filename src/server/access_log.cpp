@@ -0,0 +1,424 @@
+#include "access_log.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <boost/asio/ip/address.hpp>
+#include "server/request.h"
+#include "server/request_raw.h"
+#include "server/router.h"
+#include "server/util/format_time.h"
+#include "server/util/path.h"
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <sys/types.h>
+#  include <unistd.h>
+#endif
+
+namespace ic {
+namespace server {
+
+/** 文件大小的下限 */
+constexpr uint64_t kAccessLogMinFileSize = 64 * 1024;
+/** 路由记录中路径的最大长度(超出部分截断) */
+constexpr size_t kAccessLogMaxRoutePathSize = 4096;
+/** 打开文件失败后，间隔一段时间再尝试 */
+constexpr std::chrono::seconds kAccessLogRetryInterval(1);
+/** 创建文件时，文件名已经存在则尝试下一个序号，最多尝试的次数 */
+constexpr unsigned int kAccessLogMaxOpenAttempts = 1000;
+
+/*******************************************************************
+**
+**                        AccessLogFile
+**
+*******************************************************************/
+
+/**
+ * @brief 映射到内存中的日志文件.
+ *
+ * @details 最后一个引用释放时(没有线程正在写入)解除映射，并截断未使用的部分.
+ */
+class AccessLogFile {
+public:
+    AccessLogFile(uint64_t seq) : seq(seq) {}
+    ~AccessLogFile();
+
+    /**
+     * @brief 创建文件并映射到内存.
+     * @param[out] exists 文件已经存在(不打开，也不覆盖)
+     */
+    bool Open(const std::string& path, uint64_t size, bool* exists);
+
+    /**
+     * @brief 分配写入的位置.
+     * @return 文件已满时返回nullptr
+     */
+    char* Allocate(size_t size) {
+        uint64_t offset = offset_.fetch_add(size, std::memory_order_relaxed);
+        if (offset + size > capacity_) {
+            return nullptr;
+        }
+        return data_ + offset;
+    }
+
+    /** 文件序号 */
+    const uint64_t seq;
+
+private:
+    char* data_{nullptr};
+    uint64_t capacity_{0};
+    std::atomic<uint64_t> offset_{0};
+#ifdef _WIN32
+    HANDLE file_{INVALID_HANDLE_VALUE};
+    HANDLE mapping_{NULL};
+#else
+    int fd_{-1};
+#endif
+};
+
+#ifdef _WIN32
+static std::wstring s_utf8_to_wide(const std::string& str) {
+    int n = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), (int)str.length(), NULL, 0);
+    std::wstring wstr(n, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), (int)str.length(), &wstr[0], n);
+    return wstr;
+}
+#endif
+
+AccessLogFile::~AccessLogFile() {
+    /* 写满时`offset_`可能超出文件大小，跨越末尾的记录没有写入 */
+    uint64_t used = std::min(offset_.load(std::memory_order_relaxed), capacity_);
+#ifdef _WIN32
+    if (data_) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_) {
+        CloseHandle(mapping_);
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER li;
+        li.QuadPart = (LONGLONG)used;
+        if (data_ && SetFilePointerEx(file_, li, NULL, FILE_BEGIN)) {
+            SetEndOfFile(file_);
+        }
+        CloseHandle(file_);
+    }
+#else
+    if (data_) {
+        ::munmap(data_, (size_t)capacity_);
+    }
+    if (fd_ >= 0) {
+        if (data_ && ::ftruncate(fd_, (off_t)used) != 0) {
+            /* 截断失败时保留整个文件，未使用的部分为空记录 */
+        }
+        ::close(fd_);
+    }
+#endif
+}
+
+/**
+ * @brief 创建文件并映射到内存.
+ *
+ * @details 只创建新文件，不覆盖已经存在的文件(如同一秒内重启前的进程创建的文件).
+ */
+bool AccessLogFile::Open(const std::string& path, uint64_t size, bool* exists) {
+    *exists = false;
+#ifdef _WIN32
+    file_ = CreateFileW(s_utf8_to_wide(path).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+        NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        *exists = (GetLastError() == ERROR_FILE_EXISTS);
+        return false;
+    }
+    mapping_ = CreateFileMappingW(file_, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+    if (!mapping_) {
+        return false;
+    }
+    data_ = (char*)MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+    if (!data_) {
+        return false;
+    }
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        *exists = (errno == EEXIST);
+        return false;
+    }
+#  ifdef __linux__
+    /* 预先分配磁盘空间，避免写入映射的内存时因磁盘已满而收到SIGBUS */
+    if (::posix_fallocate(fd_, 0, (off_t)size) != 0) {
+        return false;
+    }
+#  else
+    if (::ftruncate(fd_, (off_t)size) != 0) {
+        return false;
+    }
+#  endif
+    void* data = ::mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    data_ = (char*)data;
+#endif
+    capacity_ = size;
+    return true;
+}
+
+/*******************************************************************
+**
+**                        AccessLogWriter
+**
+*******************************************************************/
+
+AccessLogWriter::AccessLogWriter(const std::string& filename, uint64_t file_size, unsigned int max_files, std::shared_ptr<ILogger> logger)
+    : filename_(filename), file_size_(std::max(file_size, kAccessLogMinFileSize) / kAccessLogRecordSize * kAccessLogRecordSize),
+      max_files_(max_files), logger_(logger)
+{
+    ListOldFiles();
+}
+
+AccessLogWriter::~AccessLogWriter() {
+    Close();
+}
+
+/**
+ * @brief 写入一条请求记录.
+ */
+void AccessLogWriter::Write(const Request& req, unsigned int status, uint64_t body_size) {
+    AccessLogRequestRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = kAccessLogRecordRequest;
+    record.http_version = (uint8_t)req.raw()->version();
+    record.status = (uint16_t)status;
+    record.method = (uint16_t)req.method();
+    record.request_id = req.id();
+    record.body_size = body_size;
+    record.arrive_time_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        req.arrive_timepoint().time_since_epoch()).count();
+    auto to_us = [](const std::chrono::nanoseconds& ns) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(ns).count();
+        return (uint32_t)std::max<int64_t>(0, std::min<int64_t>(us, std::numeric_limits<uint32_t>::max()));
+    };
+    record.time_total_us = to_us(req.time_consumed_total());
+    record.time_handle_us = to_us(req.time_consumed_handle());
+
+    boost::system::error_code ec;
+    auto address = boost::asio::ip::make_address(req.client_real_ip(), ec);
+    if (!ec) {
+        if (address.is_v4()) {
+            auto bytes = address.to_v4().to_bytes();
+            record.ip_family = 4;
+            memcpy(record.ip, bytes.data(), bytes.size());
+        }
+        else {
+            auto bytes = address.to_v6().to_bytes();
+            record.ip_family = 6;
+            memcpy(record.ip, bytes.data(), bytes.size());
+        }
+    }
+
+    auto route = req.route();
+    if (route) {
+        record.route_id = route->id;
+    }
+
+    /* 最多切换两次文件(其他线程可能同时写满了新的文件) */
+    std::shared_ptr<AccessLogFile> file = std::atomic_load(&current_);
+    for (int i = 0; i < 3; ++i) {
+        if (!file) {
+            file = Rotate(nullptr);
+            if (!file) {
+                break;
+            }
+        }
+        /* 当前文件中还没有该路由的信息 */
+        if (route && route->access_log_file_seq_.load(std::memory_order_relaxed) != file->seq && !WriteRoute(file.get(), *route)) {
+            file = Rotate(file);
+            continue;
+        }
+        char* data = file->Allocate(sizeof(record));
+        if (data) {
+            memcpy(data, &record, sizeof(record));
+            return;
+        }
+        file = Rotate(file);
+    }
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 关闭当前文件(截断未使用的部分)，之后写入时再打开新的文件.
+ */
+void AccessLogWriter::Close() {
+    std::lock_guard<std::mutex> lck(mutex_);
+    std::atomic_store(&current_, std::shared_ptr<AccessLogFile>());
+}
+
+/**
+ * @brief 写入路由记录(路径依次存放在之后的记录中).
+ *
+ * @return 文件已满时返回false
+ */
+bool AccessLogWriter::WriteRoute(AccessLogFile* file, const Route& route) {
+    /* 其他线程已经(或者正在)写入 */
+    if (route.access_log_file_seq_.exchange(file->seq, std::memory_order_relaxed) == file->seq) {
+        return true;
+    }
+    size_t path_size = std::min(route.path.length(), kAccessLogMaxRoutePathSize);
+    size_t extra_size = 0;
+    if (path_size > sizeof(AccessLogRouteRecord::path)) {
+        extra_size = (path_size - sizeof(AccessLogRouteRecord::path) + kAccessLogRecordSize - 1) / kAccessLogRecordSize * kAccessLogRecordSize;
+    }
+    char* data = file->Allocate(kAccessLogRecordSize + extra_size);
+    if (!data) {
+        return false;
+    }
+    AccessLogRouteRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = kAccessLogRecordRoute;
+    record.path_size = (uint16_t)path_size;
+    record.route_id = route.id;
+    record.methods = (uint32_t)route.methods;
+    size_t head_size = std::min(path_size, sizeof(record.path));
+    memcpy(record.path, route.path.data(), head_size);
+    memcpy(data, &record, sizeof(record));
+    if (extra_size > 0) {
+        memset(data + kAccessLogRecordSize, 0, extra_size);
+        memcpy(data + kAccessLogRecordSize, route.path.data() + head_size, path_size - head_size);
+    }
+    return true;
+}
+
+/**
+ * @brief 当前文件已满，切换到新的文件.
+ *
+ * @param full 已满的文件(为空表示当前没有打开的文件)
+ * @return 新的文件，打开失败时返回nullptr
+ */
+std::shared_ptr<AccessLogFile> AccessLogWriter::Rotate(const std::shared_ptr<AccessLogFile>& full) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    auto current = std::atomic_load(&current_);
+    /* 其他线程已经切换 */
+    if (current != full) {
+        return current;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now < retry_timepoint_) {
+        return nullptr;
+    }
+    auto file = OpenFile();
+    if (!file) {
+        retry_timepoint_ = now + kAccessLogRetryInterval;
+    }
+    std::atomic_store(&current_, file);
+    return file;
+}
+
+/**
+ * @brief 创建新的文件并写入文件头(调用者持有锁).
+ */
+std::shared_ptr<AccessLogFile> AccessLogWriter::OpenFile() {
+    static std::atomic<uint64_t> s_next_seq{1};
+
+    auto now = std::chrono::system_clock::now();
+    std::string prefix = filename_ + '.' + util::format_time(now, "%Y%m%d-%H%M%S");
+    std::string path;
+    std::shared_ptr<AccessLogFile> file;
+    uint64_t seq = s_next_seq.fetch_add(1, std::memory_order_relaxed);
+    bool exists = true;
+    /* 同一秒内重启时，之前的进程可能已经创建了同名的文件，跳过这些序号 */
+    for (unsigned int i = 0; exists && i < kAccessLogMaxOpenAttempts; ++i) {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), "-%06llu", (unsigned long long)(next_index_++ % 1000000));
+        path = prefix + suffix;
+        file = std::make_shared<AccessLogFile>(seq);
+        if (file->Open(path, file_size_, &exists)) {
+            break;
+        }
+        file.reset();
+    }
+    if (!file) {
+        logger_->Error(LOG_CTX, "Open access log file failed: %s", path.c_str());
+        if (!exists) {
+            util::path::remove_file(path);
+        }
+        return nullptr;
+    }
+
+    AccessLogFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.type = kAccessLogRecordFileHeader;
+    header.endian_mark = kAccessLogEndianMark;
+    memcpy(header.magic, kAccessLogMagic, sizeof(header.magic));
+    header.version = kAccessLogVersion;
+    header.record_size = (uint32_t)kAccessLogRecordSize;
+    header.create_time_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+    header.file_seq = file->seq;
+    memcpy(file->Allocate(sizeof(header)), &header, sizeof(header));
+
+    if (std::find(files_.begin(), files_.end(), path) == files_.end()) {
+        files_.push_back(path);
+    }
+    RemoveOldFiles();
+    return file;
+}
+
+/**
+ * @brief 查找之前运行时创建的文件(`<filename>.YYYYmmdd-HHMMSS-NNNNNN`)，一起计入`max_files`.
+ */
+void AccessLogWriter::ListOldFiles() {
+    size_t pos = filename_.find_last_of("/\\");
+    std::string dir = (pos == std::string::npos) ? std::string() : filename_.substr(0, pos + 1);
+    std::string prefix = filename_.substr(dir.length()) + '.';
+    if (!dir.empty() && !util::path::is_path_exist(dir)) {
+        util::path::create_dir(dir, true);
+        return;
+    }
+
+    std::vector<std::string> names;
+    util::path::list_dir(dir.empty() ? std::string(".") : dir, &names, util::path::FilePathPolicy::NameOnly);
+    std::vector<std::string> files;
+    for (const auto& name : names) {
+        if (name.length() <= prefix.length() || name.compare(0, prefix.length(), prefix) != 0) {
+            continue;
+        }
+        const char* p = name.c_str() + prefix.length();
+        bool ok = true;
+        for (size_t i = 0; p[i]; ++i) {
+            bool is_separator = (i == 8 || i == 15);
+            if (is_separator ? p[i] != '-' : !isdigit((unsigned char)p[i])) {
+                ok = false;
+                break;
+            }
+        }
+        if (ok && name.length() - prefix.length() > 16) {
+            files.push_back(dir + name);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files_.assign(files.begin(), files.end());
+    RemoveOldFiles();
+}
+
+/**
+ * @brief 删除超出数量的最早的文件(调用者持有锁).
+ */
+void AccessLogWriter::RemoveOldFiles() {
+    if (max_files_ == 0) {
+        return;
+    }
+    while (files_.size() > max_files_) {
+        util::path::remove_file(files_.front());
+        files_.pop_front();
+    }
+}
+
+} // namespace server
+} // namespace ic
@@ -0,0 +1,174 @@
+#ifndef IC_SERVER_ACCESS_LOG_H_
+#define IC_SERVER_ACCESS_LOG_H_
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "server/logger.h"
+
+namespace ic {
+namespace server {
+
+class Request;
+class Route;
+
+/** 二进制访问日志文件的标识 */
+constexpr char kAccessLogMagic[8] = { 'I', 'C', 'A', 'C', 'L', 'O', 'G', '1' };
+constexpr uint32_t kAccessLogVersion = 1;
+/** 用于判断字节序(按照写入时的本机字节序存储) */
+constexpr uint32_t kAccessLogEndianMark = 0x01020304;
+
+/**
+ * @brief 二进制访问日志的记录类型.
+ */
+enum AccessLogRecordType : uint8_t {
+    /** 未写入(文件末尾或者写入时文件已满) */
+    kAccessLogRecordEmpty = 0,
+    kAccessLogRecordFileHeader = 1,
+    kAccessLogRecordRequest = 2,
+    /** 路由信息，路径依次存放在之后的记录中 */
+    kAccessLogRecordRoute = 3
+};
+
+/**
+ * @brief 文件头(文件中的第一条记录).
+ */
+struct AccessLogFileHeader {
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t endian_mark;
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    /** 创建时间(UNIX时间戳，单位:微秒) */
+    uint64_t create_time_us;
+    /** 文件序号(进程内唯一) */
+    uint64_t file_seq;
+    uint8_t reserved2[24];
+};
+
+/**
+ * @brief 请求记录.
+ */
+struct AccessLogRequestRecord {
+    uint8_t type;
+    /** 客户端IP的类型: 0(未知), 4(IPv4), 6(IPv6) */
+    uint8_t ip_family;
+    /** HTTP版本: 10, 11, 20 */
+    uint8_t http_version;
+    uint8_t reserved;
+    uint16_t status;
+    /** 请求方法(HttpMethod) */
+    uint16_t method;
+    /** 路由ID，0表示没有匹配的路由 */
+    uint32_t route_id;
+    /** 处理耗时(单位:微秒) */
+    uint32_t time_handle_us;
+    /** 到达时间(UNIX时间戳，单位:微秒) */
+    uint64_t arrive_time_us;
+    int64_t request_id;
+    /** 响应body的大小 */
+    uint64_t body_size;
+    /** 总耗时(单位:微秒) */
+    uint32_t time_total_us;
+    /** 客户端真实IP(网络字节序，IPv4只使用前4字节) */
+    uint8_t ip[16];
+    uint8_t reserved2[4];
+};
+
+/**
+ * @brief 路由记录，每个文件中路由第一次出现时写入.
+ */
+struct AccessLogRouteRecord {
+    uint8_t type;
+    uint8_t reserved;
+    /** 路径的长度，超出`path`的部分存放在之后的记录中(整条记录都用于存放路径) */
+    uint16_t path_size;
+    uint32_t route_id;
+    /** 支持的请求方法(HttpMethod，按位或) */
+    uint32_t methods;
+    char path[52];
+};
+
+constexpr size_t kAccessLogRecordSize = 64;
+static_assert(sizeof(AccessLogFileHeader) == kAccessLogRecordSize, "invalid access log record size");
+static_assert(sizeof(AccessLogRequestRecord) == kAccessLogRecordSize, "invalid access log record size");
+static_assert(sizeof(AccessLogRouteRecord) == kAccessLogRecordSize, "invalid access log record size");
+
+class AccessLogFile;
+
+/**
+ * @brief 二进制访问日志，每个请求写入一条固定大小的记录.
+ *
+ * @details 日志文件映射到内存(mmap)，写入时原子地分配位置，然后直接复制记录，不加锁、不格式化、不进行系统调用.
+ * @details 文件写满后(加锁)切换到新的文件，超出`max_files`时删除最早的文件(包括之前运行时创建的文件).
+ * @details 映射的内存由内核写回磁盘，进程崩溃不会丢失已经写入的记录.
+ * @details 使用`tools/decode_access_log.py`转换为文本或者JSON.
+ * @note 线程安全.
+ */
+class AccessLogWriter {
+public:
+    /**
+     * @brief 构造函数.
+     * @param filename 文件路径(UTF8编码)，实际的文件名为`<filename>.<创建时间>-<序号>`
+     * @param file_size 每个文件的大小
+     * @param max_files 最多保留的文件数量，0表示不删除
+     * @param logger 记录打开文件失败等错误
+     */
+    AccessLogWriter(const std::string& filename, uint64_t file_size, unsigned int max_files, std::shared_ptr<ILogger> logger);
+    ~AccessLogWriter();
+
+    AccessLogWriter(const AccessLogWriter&) = delete;
+    AccessLogWriter& operator=(const AccessLogWriter&) = delete;
+
+    /**
+     * @brief 写入一条请求记录.
+     * @param status 响应状态码
+     * @param body_size 响应body的大小
+     */
+    void Write(const Request& req, unsigned int status, uint64_t body_size);
+
+    /**
+     * @brief 关闭当前文件(截断未使用的部分)，之后写入时再打开新的文件.
+     */
+    void Close();
+
+    /**
+     * @brief 因无法打开文件而丢弃的记录数量.
+     */
+    uint64_t dropped_count() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    bool WriteRoute(AccessLogFile* file, const Route& route);
+    std::shared_ptr<AccessLogFile> Rotate(const std::shared_ptr<AccessLogFile>& full);
+    std::shared_ptr<AccessLogFile> OpenFile();
+    void ListOldFiles();
+    void RemoveOldFiles();
+
+private:
+    const std::string filename_;
+    const uint64_t file_size_;
+    const unsigned int max_files_;
+    std::shared_ptr<ILogger> logger_;
+
+    /** 当前文件(通过`std::atomic_load`/`std::atomic_store`访问) */
+    std::shared_ptr<AccessLogFile> current_;
+
+    /** 以下由`mutex_`保护 */
+    std::mutex mutex_;
+    /** 已经创建的文件(按照创建时间排序) */
+    std::deque<std::string> files_;
+    uint64_t next_index_{0};
+    /** 打开文件失败后，一段时间内不再尝试 */
+    std::chrono::steady_clock::time_point retry_timepoint_;
+
+    std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_ACCESS_LOG_H_
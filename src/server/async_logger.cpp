@@ -0,0 +1,338 @@
+#include "server/async_logger.h"
+#include <algorithm>
+#include <cstring>
+#ifndef _WIN32
+#  include <cerrno>
+#  include <sys/uio.h>
+#  include <unistd.h>
+#endif
+
+namespace ic {
+namespace server {
+
+/**
+ * @brief 一条日志(在环形缓冲区中复用，`msg`保留容量).
+ */
+struct AsyncLogRecord {
+    LogLevel level{LogLevel::kInfo};
+    const char* file_name{nullptr};
+    const char* func_name{nullptr};
+    int line_num{0};
+    std::chrono::system_clock::time_point time;
+    std::string msg;
+};
+
+/**
+ * @brief 一个线程的环形缓冲区(单生产者单消费者).
+ *
+ * @details 生产者(写日志的线程)只修改`tail_`，消费者(后台线程)写入完毕后才修改`head_`，
+ * @details 之前的条目在写入期间不会被覆盖，日志内容无需再次复制.
+ */
+class AsyncLogRing {
+public:
+    explicit AsyncLogRing(size_t capacity) : records_(capacity), mask_(capacity - 1) {}
+
+    std::vector<AsyncLogRecord> records_;
+    const size_t mask_;
+    std::atomic<size_t> head_{0};
+    /* 避免`head_`和`tail_`位于同一缓存行 */
+    char padding_[64]{0};
+    std::atomic<size_t> tail_{0};
+    /** 所属线程已经退出，取出剩余的日志后移除 */
+    std::atomic<bool> closed_{false};
+};
+
+/**
+ * @brief 线程局部的缓冲区列表(每个`AsyncLogger`实例一个)，线程退出时标记为已关闭.
+ */
+struct AsyncLogThreadRings {
+    struct Entry {
+        uint64_t logger_id;
+        std::shared_ptr<AsyncLogRing> ring;
+    };
+
+    ~AsyncLogThreadRings() {
+        for (auto& entry : entries) {
+            entry.ring->closed_.store(true, std::memory_order_release);
+        }
+    }
+
+    std::vector<Entry> entries;
+};
+
+static thread_local AsyncLogThreadRings s_thread_rings;
+
+static std::atomic<uint64_t> s_next_logger_id{1};
+
+/** 每次`writev`最多写入的块数(不超过`IOV_MAX`) */
+constexpr size_t kMaxIovecs = 1024;
+
+static size_t s_round_up_pow2(size_t n) {
+    size_t capacity = 16;
+    while (capacity < n) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+AsyncLogger::AsyncLogger(LogLevel min_level, LogLevel detailed_min_level, const std::string& filename/* = std::string()*/,
+    size_t ring_capacity/* = kDefaultRingCapacity*/, unsigned int flush_interval_ms/* = 100*/)
+    : ILogger(min_level), id_(s_next_logger_id.fetch_add(1)), detailed_min_level_(detailed_min_level),
+      ring_capacity_(s_round_up_pow2(ring_capacity)), flush_interval_ms_(std::max(1U, flush_interval_ms))
+{
+    if (!filename.empty()) {
+        FILE* file = fopen(filename.c_str(), "ab");
+        if (file) {
+            file_ = file;
+        }
+        else {
+            fprintf(stderr, "Open log file '%s' failed, write to console\n", filename.c_str());
+        }
+    }
+    thread_ = std::thread(&AsyncLogger::Run, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    if (file_ != stdout) {
+        fclose(file_);
+    }
+}
+
+/**
+ * @brief 放入当前线程的环形缓冲区，缓冲区已满时丢弃.
+ */
+void AsyncLogger::Log(LogLevel level, const LogContext& context, const std::string& msg) const {
+    AsyncLogRing* ring = GetThreadRing();
+    size_t tail = ring->tail_.load(std::memory_order_relaxed);
+    size_t used = tail - ring->head_.load(std::memory_order_acquire);
+    if (used >= ring_capacity_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    AsyncLogRecord& record = ring->records_[tail & ring->mask_];
+    record.level = level;
+    record.file_name = context.file_name;
+    record.func_name = context.func_name;
+    record.line_num = context.line_num;
+    record.time = std::chrono::system_clock::now();
+    record.msg.assign(msg);
+    ring->tail_.store(tail + 1, std::memory_order_release);
+    /* 超过一半时提前唤醒后台线程(不加锁，错过时等到下一次定时写入) */
+    if (used + 1 == ring_capacity_ / 2) {
+        wakeup_.store(true, std::memory_order_relaxed);
+        cv_.notify_one();
+    }
+}
+
+/**
+ * @brief 获取当前线程的缓冲区，第一次写日志时创建.
+ */
+AsyncLogRing* AsyncLogger::GetThreadRing() const {
+    auto& entries = s_thread_rings.entries;
+    for (auto& entry : entries) {
+        if (entry.logger_id == id_) {
+            return entry.ring.get();
+        }
+    }
+    auto ring = std::make_shared<AsyncLogRing>(ring_capacity_);
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        rings_.push_back(ring);
+    }
+    entries.push_back(AsyncLogThreadRings::Entry{ id_, ring });
+    return ring.get();
+}
+
+/**
+ * @brief 后台线程: 定时写入，停止时写入剩余的日志.
+ */
+void AsyncLogger::Run() {
+    std::unique_lock<std::mutex> lck(mutex_);
+    while (true) {
+        cv_.wait_for(lck, std::chrono::milliseconds(flush_interval_ms_), [this] {
+            return stop_ || wakeup_.load(std::memory_order_relaxed);
+        });
+        wakeup_.store(false, std::memory_order_relaxed);
+        bool stop = stop_;
+        lck.unlock();
+        Drain();
+        if (stop) {
+            return;
+        }
+        lck.lock();
+    }
+}
+
+/**
+ * @brief 取出所有缓冲区中的日志并写入，移除所属线程已经退出的缓冲区.
+ *
+ * @return 写入的日志数量
+ */
+size_t AsyncLogger::Drain() {
+    std::vector<std::shared_ptr<AsyncLogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        rings = rings_;
+    }
+    std::vector<size_t> ends(rings.size());
+    size_t count = 0;
+    for (size_t i = 0; i < rings.size(); ++i) {
+        ends[i] = rings[i]->tail_.load(std::memory_order_acquire);
+        count += ends[i] - rings[i]->head_.load(std::memory_order_relaxed);
+    }
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (count > 0 || dropped != dropped_reported_) {
+        Write(rings, ends, dropped - dropped_reported_);
+        dropped_reported_ = dropped;
+    }
+    bool has_closed = false;
+    for (size_t i = 0; i < rings.size(); ++i) {
+        rings[i]->head_.store(ends[i], std::memory_order_release);
+        has_closed = has_closed || rings[i]->closed_.load(std::memory_order_acquire);
+    }
+    if (has_closed) {
+        std::lock_guard<std::mutex> lck(mutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::shared_ptr<AsyncLogRing>& ring) {
+            return ring->closed_.load(std::memory_order_acquire)
+                && ring->head_.load(std::memory_order_relaxed) == ring->tail_.load(std::memory_order_acquire);
+        }), rings_.end());
+    }
+    return count;
+}
+
+/**
+ * @brief 格式化日志的前缀和后缀，与日志内容一起写入.
+ *
+ * @details 前缀和后缀依次存放在`meta_`中(全部格式化完毕后再取地址)，日志内容直接引用缓冲区中的条目.
+ *
+ * @param dropped 上一次写入之后丢弃的日志数量，不为0时先输出一条警告
+ */
+void AsyncLogger::Write(const std::vector<std::shared_ptr<AsyncLogRing>>& rings, const std::vector<size_t>& ends, uint64_t dropped) {
+    meta_.clear();
+    meta_offsets_.clear();
+    if (dropped > 0) {
+        AppendTime(std::chrono::system_clock::now(), &meta_);
+        meta_ += " [";
+        meta_ += to_string_short(LogLevel::kWarn);
+        meta_ += "] ";
+        meta_ += std::to_string(dropped);
+        meta_ += " log records dropped (ring buffer full)\n";
+    }
+    size_t dropped_line_size = meta_.size();
+    for (size_t i = 0; i < rings.size(); ++i) {
+        const AsyncLogRing& ring = *rings[i];
+        for (size_t pos = ring.head_.load(std::memory_order_relaxed); pos != ends[i]; ++pos) {
+            const AsyncLogRecord& record = ring.records_[pos & ring.mask_];
+            AppendTime(record.time, &meta_);
+            meta_ += " [";
+            meta_ += to_string_short(record.level);
+            meta_ += "] ";
+            meta_offsets_.push_back(meta_.size());
+            if (record.level >= detailed_min_level_) {
+                meta_ += " <";
+                meta_ += record.func_name;
+                meta_ += "> <";
+                meta_ += record.file_name;
+                meta_ += ':';
+                meta_ += std::to_string(record.line_num);
+                meta_ += '>';
+            }
+            meta_ += '\n';
+            meta_offsets_.push_back(meta_.size());
+        }
+    }
+
+#ifdef _WIN32
+    fwrite(meta_.data(), 1, dropped_line_size, file_);
+    size_t offset = dropped_line_size;
+    size_t index = 0;
+    for (size_t i = 0; i < rings.size(); ++i) {
+        const AsyncLogRing& ring = *rings[i];
+        for (size_t pos = ring.head_.load(std::memory_order_relaxed); pos != ends[i]; ++pos) {
+            const std::string& msg = ring.records_[pos & ring.mask_].msg;
+            fwrite(meta_.data() + offset, 1, meta_offsets_[index] - offset, file_);
+            fwrite(msg.data(), 1, msg.size(), file_);
+            fwrite(meta_.data() + meta_offsets_[index], 1, meta_offsets_[index + 1] - meta_offsets_[index], file_);
+            offset = meta_offsets_[index + 1];
+            index += 2;
+        }
+    }
+    fflush(file_);
+#else
+    /* 前缀、内容、后缀交替写入 */
+    std::vector<struct iovec> iovecs;
+    iovecs.reserve(meta_offsets_.size() / 2 * 3 + 1);
+    char* meta = &meta_[0];
+    if (dropped_line_size > 0) {
+        iovecs.push_back(iovec{ meta, dropped_line_size });
+    }
+    size_t offset = dropped_line_size;
+    size_t index = 0;
+    for (size_t i = 0; i < rings.size(); ++i) {
+        const AsyncLogRing& ring = *rings[i];
+        for (size_t pos = ring.head_.load(std::memory_order_relaxed); pos != ends[i]; ++pos) {
+            const std::string& msg = ring.records_[pos & ring.mask_].msg;
+            iovecs.push_back(iovec{ meta + offset, meta_offsets_[index] - offset });
+            iovecs.push_back(iovec{ const_cast<char*>(msg.data()), msg.size() });
+            iovecs.push_back(iovec{ meta + meta_offsets_[index], meta_offsets_[index + 1] - meta_offsets_[index] });
+            offset = meta_offsets_[index + 1];
+            index += 2;
+        }
+    }
+    fflush(file_);  /* 与同一文件上的`printf`等保持顺序 */
+    int fd = fileno(file_);
+    struct iovec* iov = iovecs.data();
+    size_t remaining = iovecs.size();
+    while (remaining > 0) {
+        size_t n = std::min(remaining, kMaxIovecs);
+        ssize_t written = ::writev(fd, iov, (int)n);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            break;  /* 写入失败，丢弃本次的日志 */
+        }
+        size_t left = (size_t)written;
+        while (remaining > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --remaining;
+        }
+        if (left > 0) {
+            iov->iov_base = (char*)iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+#endif
+}
+
+/**
+ * @brief 追加时间(例如：2021-10-10 20:08:08.123)，精确到秒的部分每秒只格式化一次.
+ */
+void AsyncLogger::AppendTime(const std::chrono::system_clock::time_point& tp, std::string* out) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+    time_t second = (time_t)(ms / 1000);
+    if (second != cached_second_) {
+        struct tm tm_;
+#ifdef _WIN32
+        localtime_s(&tm_, &second);
+#else
+        localtime_r(&second, &tm_);
+#endif
+        cached_time_len_ = strftime(cached_time_, sizeof(cached_time_), "%Y-%m-%d %H:%M:%S", &tm_);
+        cached_second_ = second;
+    }
+    out->append(cached_time_, cached_time_len_);
+    unsigned int milli = (unsigned int)(ms % 1000);
+    char buf[4] = { '.', (char)('0' + milli / 100), (char)('0' + milli / 10 % 10), (char)('0' + milli % 10) };
+    out->append(buf, sizeof(buf));
+}
+
+} // namespace server
+} // namespace ic
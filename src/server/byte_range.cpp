@@ -0,0 +1,126 @@
+#include "byte_range.h"
+#include <cctype>
+
+namespace ic {
+namespace server {
+
+static boost::string_view s_trim(boost::string_view str) {
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+/**
+ * @brief 解析非负整数，溢出或含有非数字字符时返回false.
+ */
+static bool s_parse_uint64(boost::string_view str, uint64_t* value) {
+    if (str.empty()) {
+        return false;
+    }
+    uint64_t result = 0;
+    for (char c : str) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        uint64_t digit = (uint64_t)(c - '0');
+        if (result > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        result = result * 10 + digit;
+    }
+    *value = result;
+    return true;
+}
+
+/**
+ * @brief 解析`Range`请求头(RFC 7233).
+ */
+ByteRangeResult parse_byte_ranges(boost::string_view range, uint64_t size, std::vector<ByteRange>* ranges) {
+    ranges->clear();
+    range = s_trim(range);
+    static const boost::string_view unit = "bytes=";
+    if (range.size() <= unit.size()) {
+        return ByteRangeResult::kIgnore;
+    }
+    for (size_t i = 0; i < unit.size(); ++i) {
+        if (tolower((unsigned char)range[i]) != unit[i]) {
+            return ByteRangeResult::kIgnore;
+        }
+    }
+    range.remove_prefix(unit.size());
+
+    size_t count = 0;
+    uint64_t total = 0;
+    size_t pos = 0;
+    while (pos <= range.size()) {
+        size_t end = range.find(',', pos);
+        if (end == boost::string_view::npos) {
+            end = range.size();
+        }
+        auto spec = s_trim(range.substr(pos, end - pos));
+        pos = end + 1;
+        if (spec.empty()) {
+            continue;  /* 允许空元素，如`bytes=0-1,,2-3` */
+        }
+        if (++count > kMaxByteRanges) {
+            return ByteRangeResult::kIgnore;
+        }
+        size_t dash = spec.find('-');
+        if (dash == boost::string_view::npos) {
+            return ByteRangeResult::kIgnore;
+        }
+        auto first_str = s_trim(spec.substr(0, dash));
+        auto last_str = s_trim(spec.substr(dash + 1));
+        uint64_t first = 0, last = 0;
+        if (first_str.empty()) {
+            /* `-suffix`: 最后suffix个字节 */
+            uint64_t suffix = 0;
+            if (!s_parse_uint64(last_str, &suffix)) {
+                return ByteRangeResult::kIgnore;
+            }
+            if (suffix == 0 || size == 0) {
+                continue;
+            }
+            first = suffix < size ? size - suffix : 0;
+            last = size - 1;
+        }
+        else {
+            if (!s_parse_uint64(first_str, &first)) {
+                return ByteRangeResult::kIgnore;
+            }
+            if (last_str.empty()) {
+                last = UINT64_MAX;
+            }
+            else if (!s_parse_uint64(last_str, &last) || last < first) {
+                return ByteRangeResult::kIgnore;
+            }
+            if (first >= size) {
+                continue;
+            }
+            if (last >= size) {
+                last = size - 1;
+            }
+        }
+        ranges->push_back(ByteRange{ first, last });
+        total += last - first + 1;
+    }
+
+    if (count == 0) {
+        return ByteRangeResult::kIgnore;
+    }
+    if (ranges->empty()) {
+        return ByteRangeResult::kNotSatisfiable;
+    }
+    if (total > size) {
+        ranges->clear();
+        return ByteRangeResult::kIgnore;
+    }
+    return ByteRangeResult::kPartial;
+}
+
+} // namespace server
+} // namespace ic
@@ -0,0 +1,51 @@
+#ifndef IC_SERVER_BYTE_RANGE_H_
+#define IC_SERVER_BYTE_RANGE_H_
+#include <cstdint>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+namespace ic {
+namespace server {
+
+/** 一次请求最多接受的范围数量，超出时忽略`Range`请求头(返回完整内容) */
+constexpr size_t kMaxByteRanges = 16;
+
+/**
+ * @brief 字节范围(闭区间).
+ */
+struct ByteRange {
+    uint64_t first;
+    uint64_t last;
+
+    uint64_t length() const { return last - first + 1; }
+};
+
+/**
+ * @brief 解析结果.
+ */
+enum class ByteRangeResult {
+    /** 忽略`Range`请求头(格式错误、不是bytes单位、范围过多)，返回完整内容 */
+    kIgnore = 0,
+    /** 返回`206 Partial Content` */
+    kPartial,
+    /** 没有可满足的范围，返回`416 Range Not Satisfiable` */
+    kNotSatisfiable
+};
+
+/**
+ * @brief 解析`Range`请求头(RFC 7233).
+ *
+ * @details 支持`first-last`, `first-`, `-suffix`三种形式，超出内容长度的部分被截断，
+ * @details 不可满足的范围被丢弃.
+ * @details 各范围的总长度超过内容长度时(重叠的范围)忽略该请求头，避免放大响应.
+ *
+ * @param range `Range`请求头的值，如`bytes=0-99,200-`
+ * @param size 内容长度
+ * @param[out] ranges 可满足的范围，保持请求中的顺序
+ */
+ByteRangeResult parse_byte_ranges(boost::string_view range, uint64_t size, std::vector<ByteRange>* ranges);
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_BYTE_RANGE_H_
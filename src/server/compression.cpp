@@ -0,0 +1,216 @@
+#include "compression.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+#include "server/util/mime.h"
+#if IC_SERVER_USE_ZLIB == 1
+#  include <zlib.h>
+#endif
+#if IC_SERVER_USE_BROTLI == 1
+#  include <brotli/encode.h>
+#endif
+
+namespace ic {
+namespace server {
+
+const char* to_string(ContentEncoding encoding) {
+    switch (encoding) {
+    case ContentEncoding::kDeflate: return "deflate";
+    case ContentEncoding::kGzip:    return "gzip";
+    case ContentEncoding::kBrotli:  return "br";
+    default:                        return "identity";
+    }
+}
+
+const char* get_encoding_file_ext(ContentEncoding encoding) {
+    switch (encoding) {
+    case ContentEncoding::kGzip:    return ".gz";
+    case ContentEncoding::kBrotli:  return ".br";
+    default:                        return nullptr;
+    }
+}
+
+/**
+ * @brief 当前是否支持该压缩算法(编译时启用).
+ */
+bool is_encoding_supported(ContentEncoding encoding) {
+    switch (encoding) {
+#if IC_SERVER_USE_ZLIB == 1
+    case ContentEncoding::kDeflate:
+    case ContentEncoding::kGzip:
+        return true;
+#endif
+#if IC_SERVER_USE_BROTLI == 1
+    case ContentEncoding::kBrotli:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+static boost::string_view s_trim(boost::string_view str) {
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+static bool s_iequals(boost::string_view lhs, boost::string_view rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (tolower((unsigned char)lhs[i]) != tolower((unsigned char)rhs[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 根据`Accept-Encoding`请求头，按照客户端偏好排列可接受的编码.
+ */
+int negotiate_encodings(boost::string_view accept_encoding, ContentEncoding* encodings) {
+    /* 每种编码的q值(乘以1000)，-1表示未列出 */
+    int q_values[(int)ContentEncoding::kCount] = { -1, -1, -1, -1 };
+    int q_any = -1;
+    size_t pos = 0;
+    while (pos < accept_encoding.size()) {
+        size_t end = accept_encoding.find(',', pos);
+        if (end == boost::string_view::npos) {
+            end = accept_encoding.size();
+        }
+        auto item = accept_encoding.substr(pos, end - pos);
+        pos = end + 1;
+
+        int q = 1000;
+        size_t semicolon = item.find(';');
+        auto coding = s_trim(item.substr(0, semicolon));
+        if (semicolon != boost::string_view::npos) {
+            auto param = s_trim(item.substr(semicolon + 1));
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                std::string value(param.data() + 2, param.size() - 2);
+                q = (int)(atof(value.c_str()) * 1000);
+            }
+        }
+        if (coding == "*") {
+            q_any = q;
+        }
+        else if (s_iequals(coding, "gzip") || s_iequals(coding, "x-gzip")) {
+            q_values[(int)ContentEncoding::kGzip] = q;
+        }
+        else if (s_iequals(coding, "deflate")) {
+            q_values[(int)ContentEncoding::kDeflate] = q;
+        }
+        else if (s_iequals(coding, "br")) {
+            q_values[(int)ContentEncoding::kBrotli] = q;
+        }
+    }
+
+    /* 同等q值下的优先级 */
+    static const ContentEncoding candidates[] = { ContentEncoding::kBrotli, ContentEncoding::kGzip, ContentEncoding::kDeflate };
+    int count = 0;
+    for (ContentEncoding encoding : candidates) {
+        int q = q_values[(int)encoding] >= 0 ? q_values[(int)encoding] : q_any;
+        if (q > 0) {
+            encodings[count++] = encoding;
+        }
+    }
+    std::stable_sort(encodings, encodings + count, [&q_values, q_any](ContentEncoding lhs, ContentEncoding rhs) {
+        int q_lhs = q_values[(int)lhs] >= 0 ? q_values[(int)lhs] : q_any;
+        int q_rhs = q_values[(int)rhs] >= 0 ? q_values[(int)rhs] : q_any;
+        return q_lhs > q_rhs;
+    });
+    return count;
+}
+
+/**
+ * @brief 该MIME类型(`Content-Type`)的内容是否适合压缩.
+ */
+bool is_compressible_mimetype(boost::string_view content_type) {
+    static const std::unordered_set<std::string> s_mimetypes = [] {
+        static const char* exts[] = {
+            ".html", ".css", ".js", ".json", ".xml", ".xhtml", ".svg", ".txt", ".csv", ".md",
+            ".atom", ".rss", ".eot", ".otf", ".ttf", ".ico"
+        };
+        std::unordered_set<std::string> mimetypes{ "application/javascript", "application/x-javascript" };
+        for (const char* ext : exts) {
+            mimetypes.emplace(util::get_mimetype(ext));
+        }
+        return mimetypes;
+    }();
+
+    auto type = s_trim(content_type.substr(0, content_type.find(';')));
+    std::string lower(type.size(), 0);
+    std::transform(type.begin(), type.end(), lower.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+    return lower.compare(0, 5, "text/") == 0 || s_mimetypes.count(lower) > 0;
+}
+
+#if IC_SERVER_USE_ZLIB == 1
+static bool s_compress_zlib(bool gzip, const char* data, size_t len, int level, std::string* out) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    /* windowBits加16表示gzip格式，否则为zlib格式(HTTP中的deflate) */
+    if (deflateInit2(&zs, level < 0 ? Z_DEFAULT_COMPRESSION : std::min(level, 9), Z_DEFLATED,
+        gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+    out->resize(deflateBound(&zs, (uLong)len) + (gzip ? 18 : 0));
+    zs.next_in = (Bytef*)data;
+    zs.avail_in = (uInt)len;
+    zs.next_out = (Bytef*)&(*out)[0];
+    zs.avail_out = (uInt)out->size();
+    int ret = deflate(&zs, Z_FINISH);
+    out->resize(zs.total_out);
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END;
+}
+#endif
+
+#if IC_SERVER_USE_BROTLI == 1
+static bool s_compress_brotli(const char* data, size_t len, int level, std::string* out) {
+    size_t out_len = BrotliEncoderMaxCompressedSize(len);
+    if (out_len == 0) {
+        return false;
+    }
+    out->resize(out_len);
+    int quality = level < 0 ? 5 : std::min(level, BROTLI_MAX_QUALITY);
+    if (!BrotliEncoderCompress(quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, len, (const uint8_t*)data,
+        &out_len, (uint8_t*)&(*out)[0]))
+    {
+        return false;
+    }
+    out->resize(out_len);
+    return true;
+}
+#endif
+
+/**
+ * @brief 压缩.
+ */
+bool compress(ContentEncoding encoding, const char* data, size_t len, int level, std::string* out) {
+    switch (encoding) {
+#if IC_SERVER_USE_ZLIB == 1
+    case ContentEncoding::kDeflate:
+        return s_compress_zlib(false, data, len, level, out);
+    case ContentEncoding::kGzip:
+        return s_compress_zlib(true, data, len, level, out);
+#endif
+#if IC_SERVER_USE_BROTLI == 1
+    case ContentEncoding::kBrotli:
+        return s_compress_brotli(data, len, level, out);
+#endif
+    default:
+        return false;
+    }
+}
+
+} // namespace server
+} // namespace ic
@@ -0,0 +1,85 @@
+#ifndef IC_SERVER_COMPRESSION_H_
+#define IC_SERVER_COMPRESSION_H_
+#include <string>
+#include <boost/utility/string_view.hpp>
+
+/**
+ * @brief 是否使用`zlib`(gzip、deflate压缩).
+ * @note Linux下默认启用，Windows下需要自行编译`zlib`后启用
+ */
+#ifndef IC_SERVER_USE_ZLIB
+#  ifdef _WIN32
+#    define IC_SERVER_USE_ZLIB 0
+#  else
+#    define IC_SERVER_USE_ZLIB 1
+#  endif
+#endif
+
+/**
+ * @brief 是否使用`brotli`(br压缩).
+ * @note 默认不启用，启用后需要链接`brotlienc`
+ */
+#ifndef IC_SERVER_USE_BROTLI
+#  define IC_SERVER_USE_BROTLI 0
+#endif
+
+namespace ic {
+namespace server {
+
+/**
+ * @brief 响应内容的编码(`Content-Encoding`).
+ */
+enum class ContentEncoding {
+    kIdentity = 0,
+    kDeflate,
+    kGzip,
+    kBrotli,
+    kCount
+};
+
+/**
+ * @brief `Content-Encoding`响应头的值.
+ */
+const char* to_string(ContentEncoding encoding);
+
+/**
+ * @brief 预压缩文件的扩展名(如`.gz`)，不支持时返回nullptr.
+ */
+const char* get_encoding_file_ext(ContentEncoding encoding);
+
+/**
+ * @brief 当前是否支持该压缩算法(编译时启用).
+ *
+ * @note 使用预压缩文件(如`.br`)时不需要支持该算法.
+ */
+bool is_encoding_supported(ContentEncoding encoding);
+
+/**
+ * @brief 根据`Accept-Encoding`请求头，按照客户端偏好排列可接受的编码.
+ *
+ * @details q值相同时，优先级 br > gzip > deflate，q=0表示不接受.
+ *
+ * @param[out] encodings 至少能容纳`ContentEncoding::kCount`个元素
+ * @return 可用的编码数量(不含identity)
+ */
+int negotiate_encodings(boost::string_view accept_encoding, ContentEncoding* encodings);
+
+/**
+ * @brief 该MIME类型(`Content-Type`)的内容是否适合压缩.
+ *
+ * @details 以`text/`开头的文本类型，以及允许列表中的扩展名(如`.json`, `.js`, `.svg`)通过`util::get_mimetype`对应的类型.
+ */
+bool is_compressible_mimetype(boost::string_view content_type);
+
+/**
+ * @brief 压缩.
+ *
+ * @param level 压缩等级，zlib为1~9，brotli为0~11，-1表示使用默认值
+ * @param[out] out 压缩结果
+ */
+bool compress(ContentEncoding encoding, const char* data, size_t len, int level, std::string* out);
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_COMPRESSION_H_
@@ -0,0 +1,138 @@
+#include "server/event_stream.h"
+#include "server/request.h"
+#include "server/response.h"
+
+namespace ic {
+namespace server {
+
+constexpr size_t EventStream::kDefaultMaxQueueSize;
+
+/**
+ * @brief 去掉换行符(`event`、`id`只能是一行).
+ */
+static std::string s_single_line(const std::string& str) {
+    std::string result;
+    result.reserve(str.size());
+    for (char c : str) {
+        if (c != '\r' && c != '\n') {
+            result.push_back(c);
+        }
+    }
+    return result;
+}
+
+EventStream::EventStream(std::shared_ptr<ResponseWriter> writer, const std::string& last_event_id/* = ""*/)
+    : writer_(writer), last_event_id_(last_event_id)
+{
+}
+
+bool EventStream::Send(const std::string& data, const std::string& event/* = ""*/, const std::string& id/* = ""*/) {
+    return Write(Format(data, event, id));
+}
+
+bool EventStream::SendComment(const std::string& comment) {
+    return Write(": " + s_single_line(comment) + "\n\n");
+}
+
+bool EventStream::SetRetry(unsigned int retry_ms) {
+    return Write("retry: " + std::to_string(retry_ms) + "\n\n");
+}
+
+void EventStream::Close() {
+    writer_->Close();
+}
+
+bool EventStream::Write(const std::string& text) {
+    if (writer_->TryWrite(text)) {
+        return true;
+    }
+    if (writer_->is_open()) {
+        ++dropped_count_;
+    }
+    return false;
+}
+
+/**
+ * @brief 格式化事件.
+ *
+ * @details 多行内容拆分为多个`data:`行(`\r\n`、`\r`、`\n`都视为换行).
+ */
+std::string EventStream::Format(const std::string& data, const std::string& event/* = ""*/, const std::string& id/* = ""*/) {
+    std::string text;
+    text.reserve(data.size() + event.size() + id.size() + 32);
+    if (!event.empty()) {
+        text.append("event: ").append(s_single_line(event)).push_back('\n');
+    }
+    if (!id.empty()) {
+        text.append("id: ").append(s_single_line(id)).push_back('\n');
+    }
+    size_t pos = 0;
+    while (true) {
+        size_t eol = data.find_first_of("\r\n", pos);
+        text.append("data: ").append(data, pos, eol == std::string::npos ? std::string::npos : eol - pos).push_back('\n');
+        if (eol == std::string::npos) {
+            break;
+        }
+        pos = eol + ((data[eol] == '\r' && eol + 1 < data.size() && data[eol + 1] == '\n') ? 2 : 1);
+    }
+    text.push_back('\n');
+    return text;
+}
+
+/**
+ * @brief 生成事件流路由的回调函数.
+ */
+Route::ResponseCallback EventStream::MakeResponseCallback(Callback cb, size_t max_queue_size/* = kDefaultMaxQueueSize*/) {
+    return [cb, max_queue_size](Request& req, Response& res) {
+        auto writer = res.SetStreamBody("text/event-stream", max_queue_size);
+        res.SetHeader("Cache-Control", "no-cache");
+        res.SetHeader("X-Accel-Buffering", "no");  /* 禁止nginx缓冲 */
+        writer->set_heartbeat(":\n\n");
+        cb(req, std::make_shared<EventStream>(writer, req.GetHeader("Last-Event-ID")));
+    };
+}
+
+void EventBroadcaster::Add(EventStreamPtr stream) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    streams_.push_back(stream);
+}
+
+/**
+ * @brief 广播一个事件，并移除已断开的订阅者.
+ */
+size_t EventBroadcaster::Publish(const std::string& data, const std::string& event/* = ""*/, const std::string& id/* = ""*/) {
+    std::string text = EventStream::Format(data, event, id);
+    size_t count = 0;
+    std::lock_guard<std::mutex> lck(mutex_);
+    for (size_t i = 0; i < streams_.size();) {
+        if (streams_[i]->Write(text)) {
+            ++count;
+        }
+        else if (!streams_[i]->is_open()) {
+            streams_[i] = std::move(streams_.back());
+            streams_.pop_back();
+            continue;
+        }
+        ++i;
+    }
+    return count;
+}
+
+void EventBroadcaster::CloseAll() {
+    std::vector<EventStreamPtr> streams;
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        streams.swap(streams_);
+    }
+    for (auto& stream : streams) {
+        stream->Close();
+    }
+}
+
+size_t EventBroadcaster::size() const {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return streams_.size();
+}
+
+} // namespace server
+} // namespace ic
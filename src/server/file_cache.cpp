@@ -0,0 +1,369 @@
+#include "file_cache.h"
+#include <algorithm>
+#include <stdio.h>
+#include "server/util/gmt_time.h"
+#include "server/util/hash/md5.h"
+#ifdef _WIN32
+#  include <windows.h>
+#  include <sys/stat.h>
+#  include <sys/types.h>
+#else
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <sys/types.h>
+#  include <unistd.h>
+#endif
+
+namespace ic {
+namespace server {
+
+CachedFile::~CachedFile() {
+#ifndef _WIN32
+    if (fd >= 0) {
+        ::close(fd);
+    }
+#endif
+}
+
+FileCache::FileCache(size_t max_files, unsigned int check_interval_ms, size_t max_content_size, uint64_t max_memory)
+    : max_files_(max_files), check_interval_(std::chrono::milliseconds(check_interval_ms)),
+      max_content_size_((size_t)std::min<uint64_t>(max_content_size, max_memory)), max_memory_(max_memory)
+{
+}
+
+/**
+ * @brief 打开文件.
+ */
+CachedFilePtr FileCache::Open(const std::string& path) {
+    if (max_files_ == 0) {
+        return OpenFile(path);
+    }
+
+    auto now = Clock::now();
+    bool found = false;
+    CachedFilePtr cached;
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        Node* node = Find(path);
+        if (node) {
+            if (now - node->checked_at < check_interval_) {
+                return node->file;
+            }
+            found = true;
+            cached = node->file;
+        }
+    }
+
+    /* 文件系统操作在锁外进行 */
+    if (found) {
+        uint64_t size = 0, inode = 0;
+        int64_t mtime_ns = 0;
+        bool exist = StatFile(path, &size, &mtime_ns, &inode);
+        bool unchanged = cached ? (exist && size == cached->size && mtime_ns == cached->mtime_ns && inode == cached->inode) : !exist;
+        if (unchanged) {
+            std::lock_guard<std::mutex> lck(mutex_);
+            Node* node = Find(path);
+            if (node && node->file == cached) {
+                node->checked_at = now;
+            }
+            return cached;
+        }
+    }
+
+    CachedFilePtr file = OpenFile(path);
+    std::lock_guard<std::mutex> lck(mutex_);
+    if (file) {
+        Put(path, file, now);
+    }
+    else {
+        PutMissing(path, now);
+    }
+    return file;
+}
+
+/**
+ * @brief 获取文件内容的压缩结果，同一文件只压缩一次.
+ */
+std::shared_ptr<const std::string> FileCache::GetCompressed(const CachedFilePtr& file, ContentEncoding encoding) {
+    if (!file || !file->has_content || encoding == ContentEncoding::kIdentity || encoding >= ContentEncoding::kCount) {
+        return nullptr;
+    }
+    auto& slot = file->compressed[(int)encoding];
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        if (slot) {
+            return slot->empty() ? nullptr : slot;
+        }
+    }
+
+    /* 在锁外压缩(只压缩一次，使用最高压缩等级) */
+    auto result = std::make_shared<std::string>();
+    int level = (encoding == ContentEncoding::kBrotli) ? 11 : 9;
+    if (!compress(encoding, file->content.data(), file->content.size(), level, result.get())
+        || result->size() >= file->content.size())
+    {
+        result->clear();
+    }
+
+    std::lock_guard<std::mutex> lck(mutex_);
+    if (!slot) {
+        slot = result;
+        auto iter = index_.find(file->path);
+        if (iter != index_.end() && iter->second->file == file) {
+            file->compressed_size += result->size();
+            memory_used_ += result->size();
+            Evict();
+        }
+    }
+    return slot->empty() ? nullptr : slot;
+}
+
+/**
+ * @brief 移除所有缓存的文件.
+ */
+void FileCache::Clear() {
+    std::lock_guard<std::mutex> lck(mutex_);
+    index_.clear();
+    nodes_.clear();
+    missing_index_.clear();
+    missing_nodes_.clear();
+    memory_used_ = 0;
+}
+
+size_t FileCache::size() {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return nodes_.size();
+}
+
+/**
+ * @brief 缓存的文件内容的总大小.
+ */
+uint64_t FileCache::memory_used() {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return memory_used_;
+}
+
+/**
+ * @brief 查找缓存的文件或不存在的文件，并移动到最前面(调用者持有锁).
+ */
+FileCache::Node* FileCache::Find(const std::string& path) {
+    auto iter = index_.find(path);
+    if (iter != index_.end()) {
+        nodes_.splice(nodes_.begin(), nodes_, iter->second);
+        return &*iter->second;
+    }
+    iter = missing_index_.find(path);
+    if (iter != missing_index_.end()) {
+        missing_nodes_.splice(missing_nodes_.begin(), missing_nodes_, iter->second);
+        return &*iter->second;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 加入缓存(调用者持有锁)，替换同一路径的旧文件.
+ */
+void FileCache::Put(const std::string& path, const CachedFilePtr& file, Clock::time_point now) {
+    auto missing = missing_index_.find(path);
+    if (missing != missing_index_.end()) {
+        missing_nodes_.erase(missing->second);
+        missing_index_.erase(missing);
+    }
+    auto iter = index_.find(path);
+    if (iter != index_.end()) {
+        memory_used_ -= MemoryUsage(iter->second->file);
+        iter->second->file = file;
+        iter->second->checked_at = now;
+        nodes_.splice(nodes_.begin(), nodes_, iter->second);
+    }
+    else {
+        nodes_.push_front(Node{ path, file, now });
+        index_.emplace(path, nodes_.begin());
+    }
+    memory_used_ += MemoryUsage(file);
+    Evict();
+}
+
+/**
+ * @brief 记录不存在的文件(调用者持有锁)，移除同一路径已缓存的文件.
+ */
+void FileCache::PutMissing(const std::string& path, Clock::time_point now) {
+    auto iter = index_.find(path);
+    if (iter != index_.end()) {
+        Erase(iter->second);
+    }
+    iter = missing_index_.find(path);
+    if (iter != missing_index_.end()) {
+        iter->second->checked_at = now;
+        missing_nodes_.splice(missing_nodes_.begin(), missing_nodes_, iter->second);
+        return;
+    }
+    missing_nodes_.push_front(Node{ path, nullptr, now });
+    missing_index_.emplace(path, missing_nodes_.begin());
+    while (missing_nodes_.size() > std::min(max_files_, kFileCacheMaxMissingFiles)) {
+        missing_index_.erase(missing_nodes_.back().path);
+        missing_nodes_.pop_back();
+    }
+}
+
+/**
+ * @brief 超出数量上限或内存上限时，淘汰最久未使用的文件(调用者持有锁).
+ */
+void FileCache::Evict() {
+    while (nodes_.size() > 1 && (nodes_.size() > max_files_ || memory_used_ > max_memory_)) {
+        Erase(std::prev(nodes_.end()));
+    }
+}
+
+/**
+ * @brief 移除缓存的文件(调用者持有锁).
+ */
+void FileCache::Erase(NodeList::iterator iter) {
+    memory_used_ -= MemoryUsage(iter->file);
+    index_.erase(iter->path);
+    nodes_.erase(iter);
+}
+
+/**
+ * @brief 文件占用的内存(文件内容及其压缩结果，调用者持有锁).
+ */
+uint64_t FileCache::MemoryUsage(const CachedFilePtr& file) {
+    return file ? file->content.size() + file->compressed_size : 0;
+}
+
+#ifdef _WIN32
+static std::wstring s_utf8_to_wide(const std::string& str) {
+    int n = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), (int)str.length(), NULL, 0);
+    std::wstring wstr(n, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), (int)str.length(), &wstr[0], n);
+    return wstr;
+}
+#endif
+
+#ifndef _WIN32
+/**
+ * @brief 最后修改时间(单位:纳秒).
+ */
+static int64_t s_mtime_ns(const struct stat& st) {
+#  if defined(__APPLE__)
+    return (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#  elif defined(__linux__)
+    return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#  else
+    return (int64_t)st.st_mtime * 1000000000;
+#  endif
+}
+#endif
+
+/**
+ * @brief 获取普通文件的`stat`信息.
+ *
+ * @param[out] mtime_ns 最后修改时间(单位:纳秒)
+ */
+bool FileCache::StatFile(const std::string& path, uint64_t* size, int64_t* mtime_ns, uint64_t* inode) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_wstat64(s_utf8_to_wide(path).c_str(), &st) != 0 || !(st.st_mode & _S_IFREG)) {
+        return false;
+    }
+    *inode = 0;
+#else
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    *inode = (uint64_t)st.st_ino;
+#endif
+    *size = (uint64_t)st.st_size;
+#ifdef _WIN32
+    *mtime_ns = (int64_t)st.st_mtime * 1000000000;
+#else
+    *mtime_ns = s_mtime_ns(st);
+#endif
+    return true;
+}
+
+/**
+ * @brief 读取文件的全部内容.
+ */
+bool FileCache::ReadContent(CachedFile* file) {
+    file->content.resize((size_t)file->size);
+    size_t total = 0;
+#ifdef _WIN32
+    FILE* fp = _wfopen(s_utf8_to_wide(file->path).c_str(), L"rb");
+    if (!fp) {
+        return false;
+    }
+    while (total < file->content.size()) {
+        size_t n = fread(&file->content[total], 1, file->content.size() - total, fp);
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    fclose(fp);
+#else
+    while (total < file->content.size()) {
+        ssize_t n = ::pread(file->fd, &file->content[total], file->content.size() - total, (off_t)total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+#endif
+    /* 读取过程中文件被截断 */
+    if (total != file->content.size()) {
+        file->content.clear();
+        return false;
+    }
+    file->has_content = true;
+    return true;
+}
+
+/**
+ * @brief 打开文件，获取其`stat`信息，并计算ETag等.
+ */
+CachedFilePtr FileCache::OpenFile(const std::string& path) const {
+    auto file = std::make_shared<CachedFile>();
+    file->path = path;
+#ifdef _WIN32
+    if (!StatFile(path, &file->size, &file->mtime_ns, &file->inode)) {
+        return nullptr;
+    }
+    file->mtime = file->mtime_ns / 1000000000;
+#else
+    file->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file->fd < 0) {
+        return nullptr;
+    }
+    /* 通过已打开的文件描述符获取信息，避免打开前后文件被替换 */
+    struct stat st;
+    if (::fstat(file->fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return nullptr;
+    }
+    file->size = (uint64_t)st.st_size;
+    file->mtime = (int64_t)st.st_mtime;
+    file->mtime_ns = s_mtime_ns(st);
+    file->inode = (uint64_t)st.st_ino;
+#endif
+
+    /* 不缓存文件时每次请求都重新打开，不计算MD5 */
+    bool has_content = max_content_size_ > 0 && file->size <= max_content_size_ && ReadContent(file.get());
+    if (has_content && max_files_ > 0) {
+        file->etag = "\"" + util::hash::md5_lower(file->content) + "\"";
+    }
+    else {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "W/\"%llx-%llx\"", (unsigned long long)file->mtime_ns, (unsigned long long)file->size);
+        file->etag = buf;
+    }
+    file->last_modified = util::get_gmt_time((time_t)file->mtime);
+    return file;
+}
+
+} // namespace server
+} // namespace ic
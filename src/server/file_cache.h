@@ -0,0 +1,165 @@
+#ifndef IC_SERVER_FILE_CACHE_H_
+#define IC_SERVER_FILE_CACHE_H_
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "compression.h"
+
+/** 是否支持`sendfile`(由内核直接将文件内容写入socket) */
+#if defined(__linux__)
+#  define IC_SERVER_HAS_SENDFILE 1
+#endif
+
+namespace ic {
+namespace server {
+
+/** 缓存的不存在的文件的数量上限 */
+constexpr size_t kFileCacheMaxMissingFiles = 256;
+
+/**
+ * @brief 已打开的文件及其`stat`信息.
+ *
+ * @details 只读，可以被多个请求同时持有，最后一个持有者释放时关闭文件描述符.
+ * @details Windows平台只缓存`stat`信息(`fd`始终为-1).
+ * @details 较小的文件同时缓存文件内容，直接从内存返回.
+ */
+struct CachedFile {
+    CachedFile() = default;
+    ~CachedFile();
+
+    CachedFile(const CachedFile&) = delete;
+    CachedFile& operator=(const CachedFile&) = delete;
+
+    /** 文件路径(UTF8编码) */
+    std::string path;
+    /** 只读的文件描述符 */
+    int fd{-1};
+    uint64_t size{0};
+    /** 最后修改时间(单位:秒) */
+    int64_t mtime{0};
+    /** 最后修改时间(单位:纳秒，文件系统支持时精确到纳秒)，用于判断文件是否被修改 */
+    int64_t mtime_ns{0};
+    uint64_t inode{0};
+    /** 文件内容是否缓存在内存中(`content`) */
+    bool has_content{false};
+    std::string content;
+    /**
+     * @brief ETag(含双引号).
+     *
+     * @details 内容缓存在内存中时为内容的MD5(强校验).
+     * @details 否则由文件大小和修改时间生成，无法保证内容逐字节相同，为弱校验(`W/`前缀).
+     */
+    std::string etag;
+    /** 最后修改时间(GMT格式，用于`Last-Modified`响应头) */
+    std::string last_modified;
+
+    /**
+     * @brief 文件内容压缩后的结果，按照`ContentEncoding`索引(由`FileCache::GetCompressed`生成).
+     *
+     * @details 空字符串表示压缩后没有变小. 受`FileCache`的锁保护.
+     */
+    mutable std::shared_ptr<const std::string> compressed[(int)ContentEncoding::kCount];
+    /** 计入文件缓存内存占用的压缩结果的总大小 */
+    mutable uint64_t compressed_size{0};
+};
+
+using CachedFilePtr = std::shared_ptr<const CachedFile>;
+
+/**
+ * @brief 文件缓存，缓存已打开的文件描述符，避免每次请求都打开、关闭文件.
+ *
+ * @details 按照最近最少使用(LRU)淘汰.
+ * @details 距离上次检查超过`check_interval_ms`后重新`stat`，文件被修改或替换时重新打开.
+ * @details 已被淘汰的文件，在正在发送它的请求结束后才关闭.
+ * @details 文件内容、ETag、Last-Modified在打开文件时计算一次，之后的请求(包括条件请求)不再读取磁盘.
+ * @details 文件内容的压缩结果也缓存在其中，同一文件只压缩一次.
+ * @details 不存在的文件单独缓存(在检查间隔内不再`stat`)，用于频繁探测的预压缩文件(如`.gz`)，
+ * @details 数量不超过`kFileCacheMaxMissingFiles`，不计入`max_files`，也不会淘汰已打开的文件.
+ * @note 线程安全.
+ */
+class FileCache {
+public:
+    /**
+     * @brief 构造函数.
+     * @param max_files 最多缓存的文件数量，0表示不缓存(每次都重新打开)
+     * @param check_interval_ms 检查文件是否被修改的时间间隔(单位:毫秒)
+     * @param max_content_size 不超过该大小的文件，内容缓存在内存中，0表示不缓存内容
+     * @param max_memory 缓存的文件内容的总大小上限，超出后淘汰最久未使用的文件
+     */
+    FileCache(size_t max_files, unsigned int check_interval_ms, size_t max_content_size, uint64_t max_memory);
+
+    /**
+     * @brief 打开文件.
+     *
+     * @param path 文件路径(UTF8编码)
+     * @return 文件不存在、不是普通文件或者打开失败时返回nullptr
+     */
+    CachedFilePtr Open(const std::string& path);
+
+    /**
+     * @brief 获取文件内容的压缩结果(仅内容缓存在内存中的文件)，同一文件只压缩一次.
+     *
+     * @return 压缩失败或压缩后没有变小时返回nullptr
+     */
+    std::shared_ptr<const std::string> GetCompressed(const CachedFilePtr& file, ContentEncoding encoding);
+
+    /**
+     * @brief 移除所有缓存的文件.
+     */
+    void Clear();
+
+    /**
+     * @brief 缓存的文件数量(不含不存在的文件).
+     */
+    size_t size();
+
+    /**
+     * @brief 缓存的文件内容的总大小.
+     */
+    uint64_t memory_used();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Node {
+        std::string path;
+        /** 在`missing_nodes_`中时为nullptr(文件不存在) */
+        CachedFilePtr file;
+        /** 上次检查的时间 */
+        Clock::time_point checked_at;
+    };
+    using NodeList = std::list<Node>;
+
+    CachedFilePtr OpenFile(const std::string& path) const;
+    static bool StatFile(const std::string& path, uint64_t* size, int64_t* mtime_ns, uint64_t* inode);
+    static bool ReadContent(CachedFile* file);
+    Node* Find(const std::string& path);
+    void Put(const std::string& path, const CachedFilePtr& file, Clock::time_point now);
+    void PutMissing(const std::string& path, Clock::time_point now);
+    void Erase(NodeList::iterator iter);
+    void Evict();
+    static uint64_t MemoryUsage(const CachedFilePtr& file);
+
+private:
+    size_t max_files_;
+    Clock::duration check_interval_;
+    size_t max_content_size_;
+    uint64_t max_memory_;
+    uint64_t memory_used_{0};
+    std::mutex mutex_;
+    /** 最近使用的在前 */
+    NodeList nodes_;
+    std::unordered_map<std::string, NodeList::iterator> index_;
+    /** 不存在的文件(最近使用的在前) */
+    NodeList missing_nodes_;
+    std::unordered_map<std::string, NodeList::iterator> missing_index_;
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_FILE_CACHE_H_
@@ -0,0 +1,108 @@
+#include "handler_pool.h"
+#include "server/util/thread.h"
+
+namespace ic {
+namespace server {
+
+HandlerPool::HandlerPool(unsigned int num_threads, size_t queue_limit)
+    : num_threads_(num_threads), queue_limit_(queue_limit)
+{
+}
+
+HandlerPool::~HandlerPool() {
+    Stop();
+}
+
+void HandlerPool::Start() {
+    std::lock_guard<std::mutex> lck(mutex_);
+    if (!stopped_) {
+        return;
+    }
+    stopped_ = false;
+}
+
+/**
+ * @brief 停止线程池，取消尚未执行的任务，并等待所有线程退出.
+ */
+void HandlerPool::Stop() {
+    std::deque<Task> dropped;
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        stopped_ = true;
+        dropped.swap(tasks_);
+        threads.swap(threads_);
+    }
+    cv_.notify_all();
+    for (auto& t : threads) {
+        if (t.get_id() == std::this_thread::get_id()) {
+            t.detach();  /* 在任务中停止线程池 */
+        }
+        else if (t.joinable()) {
+            t.join();
+        }
+    }
+    /* 在锁外取消任务(结束对应的请求) */
+    for (auto& task : dropped) {
+        if (task.cancel) {
+            task.cancel();
+        }
+    }
+}
+
+/**
+ * @brief 提交任务.
+ * @return 线程池已停止或队列已满时返回false
+ */
+bool HandlerPool::TryPost(std::function<void()> task, std::function<void()> cancel) {
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        if (stopped_ || tasks_.size() >= queue_limit_) {
+            return false;
+        }
+        /* 第一次提交任务时创建线程 */
+        if (threads_.empty()) {
+            for (unsigned int i = 0; i < num_threads_; ++i) {
+                threads_.emplace_back(&HandlerPool::ThreadFunc, this);
+            }
+        }
+        tasks_.push_back(Task{ std::move(task), std::move(cancel) });
+    }
+    cv_.notify_one();
+    return true;
+}
+
+/**
+ * @brief 当前线程是否属于该线程池.
+ */
+bool HandlerPool::InPoolThread() {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return thread_ids_.find(util::thread_id()) != thread_ids_.end();
+}
+
+size_t HandlerPool::queue_size() {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return tasks_.size();
+}
+
+void HandlerPool::ThreadFunc() {
+    const size_t tid = util::thread_id();
+    std::unique_lock<std::mutex> lck(mutex_);
+    thread_ids_.emplace(tid);
+    while (true) {
+        cv_.wait(lck, [this] { return stopped_ || !tasks_.empty(); });
+        if (stopped_) {
+            break;
+        }
+        Task task = std::move(tasks_.front());
+        tasks_.pop_front();
+        lck.unlock();
+        task.run();
+        task = Task();  /* 在锁外释放任务持有的资源(如会话) */
+        lck.lock();
+    }
+    thread_ids_.erase(tid);
+}
+
+} // namespace server
+} // namespace ic
@@ -0,0 +1,74 @@
+#ifndef IC_SERVER_HANDLER_POOL_H_
+#define IC_SERVER_HANDLER_POOL_H_
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace ic {
+namespace server {
+
+/**
+ * @brief 处理线程池，专门执行阻塞型路由的回调函数，避免占用I/O线程.
+ *
+ * @details 线程数量固定，在提交第一个任务时才创建(没有阻塞型路由时不占用线程).
+ * @details 任务队列有长度上限，队列满时拒绝新任务.
+ */
+class HandlerPool {
+public:
+    /**
+     * @brief 构造函数.
+     * @param num_threads 线程数量
+     * @param queue_limit 等待队列长度上限(不含正在执行的任务)
+     */
+    HandlerPool(unsigned int num_threads, size_t queue_limit);
+    ~HandlerPool();
+
+    void Start();
+
+    /**
+     * @brief 停止线程池，取消尚未执行的任务，并等待所有线程退出.
+     */
+    void Stop();
+
+    /**
+     * @brief 提交任务.
+     * @param task 任务
+     * @param cancel 线程池停止时任务尚未执行，则调用该函数(在调用`Stop()`的线程中)
+     * @return 线程池已停止或队列已满时返回false
+     */
+    bool TryPost(std::function<void()> task, std::function<void()> cancel);
+
+    /**
+     * @brief 当前线程是否属于该线程池.
+     */
+    bool InPoolThread();
+
+    size_t queue_size();
+
+private:
+    struct Task {
+        std::function<void()> run;
+        std::function<void()> cancel;
+    };
+
+    void ThreadFunc();
+
+private:
+    unsigned int num_threads_;
+    size_t queue_limit_;
+    bool stopped_{true};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Task> tasks_;
+    std::vector<std::thread> threads_;
+    std::set<size_t> thread_ids_;
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_HANDLER_POOL_H_
@@ -0,0 +1,498 @@
+#include "hpack.h"
+#include <algorithm>
+
+namespace ic {
+namespace server {
+
+/**
+ * @brief 静态表(RFC 7541 附录A)，索引从1开始.
+ */
+static const struct {
+    const char* name;
+    const char* value;
+} s_static_table[] = {
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+};
+
+constexpr size_t kStaticTableSize = sizeof(s_static_table) / sizeof(s_static_table[0]);
+
+/**
+ * @brief Huffman编码(RFC 7541 附录B)，按符号排列，第257个为EOS.
+ */
+static const struct {
+    uint32_t code;
+    uint8_t bits;
+} s_huffman_codes[257] = {
+    { 0x1ff8, 13 }, { 0x7fffd8, 23 }, { 0xfffffe2, 28 }, { 0xfffffe3, 28 }, { 0xfffffe4, 28 }, { 0xfffffe5, 28 },
+    { 0xfffffe6, 28 }, { 0xfffffe7, 28 }, { 0xfffffe8, 28 }, { 0xffffea, 24 }, { 0x3ffffffc, 30 }, { 0xfffffe9, 28 },
+    { 0xfffffea, 28 }, { 0x3ffffffd, 30 }, { 0xfffffeb, 28 }, { 0xfffffec, 28 }, { 0xfffffed, 28 }, { 0xfffffee, 28 },
+    { 0xfffffef, 28 }, { 0xffffff0, 28 }, { 0xffffff1, 28 }, { 0xffffff2, 28 }, { 0x3ffffffe, 30 }, { 0xffffff3, 28 },
+    { 0xffffff4, 28 }, { 0xffffff5, 28 }, { 0xffffff6, 28 }, { 0xffffff7, 28 }, { 0xffffff8, 28 }, { 0xffffff9, 28 },
+    { 0xffffffa, 28 }, { 0xffffffb, 28 }, { 0x14, 6 }, { 0x3f8, 10 }, { 0x3f9, 10 }, { 0xffa, 12 },
+    { 0x1ff9, 13 }, { 0x15, 6 }, { 0xf8, 8 }, { 0x7fa, 11 }, { 0x3fa, 10 }, { 0x3fb, 10 },
+    { 0xf9, 8 }, { 0x7fb, 11 }, { 0xfa, 8 }, { 0x16, 6 }, { 0x17, 6 }, { 0x18, 6 },
+    { 0x0, 5 }, { 0x1, 5 }, { 0x2, 5 }, { 0x19, 6 }, { 0x1a, 6 }, { 0x1b, 6 },
+    { 0x1c, 6 }, { 0x1d, 6 }, { 0x1e, 6 }, { 0x1f, 6 }, { 0x5c, 7 }, { 0xfb, 8 },
+    { 0x7ffc, 15 }, { 0x20, 6 }, { 0xffb, 12 }, { 0x3fc, 10 }, { 0x1ffa, 13 }, { 0x21, 6 },
+    { 0x5d, 7 }, { 0x5e, 7 }, { 0x5f, 7 }, { 0x60, 7 }, { 0x61, 7 }, { 0x62, 7 },
+    { 0x63, 7 }, { 0x64, 7 }, { 0x65, 7 }, { 0x66, 7 }, { 0x67, 7 }, { 0x68, 7 },
+    { 0x69, 7 }, { 0x6a, 7 }, { 0x6b, 7 }, { 0x6c, 7 }, { 0x6d, 7 }, { 0x6e, 7 },
+    { 0x6f, 7 }, { 0x70, 7 }, { 0x71, 7 }, { 0x72, 7 }, { 0xfc, 8 }, { 0x73, 7 },
+    { 0xfd, 8 }, { 0x1ffb, 13 }, { 0x7fff0, 19 }, { 0x1ffc, 13 }, { 0x3ffc, 14 }, { 0x22, 6 },
+    { 0x7ffd, 15 }, { 0x3, 5 }, { 0x23, 6 }, { 0x4, 5 }, { 0x24, 6 }, { 0x5, 5 },
+    { 0x25, 6 }, { 0x26, 6 }, { 0x27, 6 }, { 0x6, 5 }, { 0x74, 7 }, { 0x75, 7 },
+    { 0x28, 6 }, { 0x29, 6 }, { 0x2a, 6 }, { 0x7, 5 }, { 0x2b, 6 }, { 0x76, 7 },
+    { 0x2c, 6 }, { 0x8, 5 }, { 0x9, 5 }, { 0x2d, 6 }, { 0x77, 7 }, { 0x78, 7 },
+    { 0x79, 7 }, { 0x7a, 7 }, { 0x7b, 7 }, { 0x7ffe, 15 }, { 0x7fc, 11 }, { 0x3ffd, 14 },
+    { 0x1ffd, 13 }, { 0xffffffc, 28 }, { 0xfffe6, 20 }, { 0x3fffd2, 22 }, { 0xfffe7, 20 }, { 0xfffe8, 20 },
+    { 0x3fffd3, 22 }, { 0x3fffd4, 22 }, { 0x3fffd5, 22 }, { 0x7fffd9, 23 }, { 0x3fffd6, 22 }, { 0x7fffda, 23 },
+    { 0x7fffdb, 23 }, { 0x7fffdc, 23 }, { 0x7fffdd, 23 }, { 0x7fffde, 23 }, { 0xffffeb, 24 }, { 0x7fffdf, 23 },
+    { 0xffffec, 24 }, { 0xffffed, 24 }, { 0x3fffd7, 22 }, { 0x7fffe0, 23 }, { 0xffffee, 24 }, { 0x7fffe1, 23 },
+    { 0x7fffe2, 23 }, { 0x7fffe3, 23 }, { 0x7fffe4, 23 }, { 0x1fffdc, 21 }, { 0x3fffd8, 22 }, { 0x7fffe5, 23 },
+    { 0x3fffd9, 22 }, { 0x7fffe6, 23 }, { 0x7fffe7, 23 }, { 0xffffef, 24 }, { 0x3fffda, 22 }, { 0x1fffdd, 21 },
+    { 0xfffe9, 20 }, { 0x3fffdb, 22 }, { 0x3fffdc, 22 }, { 0x7fffe8, 23 }, { 0x7fffe9, 23 }, { 0x1fffde, 21 },
+    { 0x7fffea, 23 }, { 0x3fffdd, 22 }, { 0x3fffde, 22 }, { 0xfffff0, 24 }, { 0x1fffdf, 21 }, { 0x3fffdf, 22 },
+    { 0x7fffeb, 23 }, { 0x7fffec, 23 }, { 0x1fffe0, 21 }, { 0x1fffe1, 21 }, { 0x3fffe0, 22 }, { 0x1fffe2, 21 },
+    { 0x7fffed, 23 }, { 0x3fffe1, 22 }, { 0x7fffee, 23 }, { 0x7fffef, 23 }, { 0xfffea, 20 }, { 0x3fffe2, 22 },
+    { 0x3fffe3, 22 }, { 0x3fffe4, 22 }, { 0x7ffff0, 23 }, { 0x3fffe5, 22 }, { 0x3fffe6, 22 }, { 0x7ffff1, 23 },
+    { 0x3ffffe0, 26 }, { 0x3ffffe1, 26 }, { 0xfffeb, 20 }, { 0x7fff1, 19 }, { 0x3fffe7, 22 }, { 0x7ffff2, 23 },
+    { 0x3fffe8, 22 }, { 0x1ffffec, 25 }, { 0x3ffffe2, 26 }, { 0x3ffffe3, 26 }, { 0x3ffffe4, 26 }, { 0x7ffffde, 27 },
+    { 0x7ffffdf, 27 }, { 0x3ffffe5, 26 }, { 0xfffff1, 24 }, { 0x1ffffed, 25 }, { 0x7fff2, 19 }, { 0x1fffe3, 21 },
+    { 0x3ffffe6, 26 }, { 0x7ffffe0, 27 }, { 0x7ffffe1, 27 }, { 0x3ffffe7, 26 }, { 0x7ffffe2, 27 }, { 0xfffff2, 24 },
+    { 0x1fffe4, 21 }, { 0x1fffe5, 21 }, { 0x3ffffe8, 26 }, { 0x3ffffe9, 26 }, { 0xffffffd, 28 }, { 0x7ffffe3, 27 },
+    { 0x7ffffe4, 27 }, { 0x7ffffe5, 27 }, { 0xfffec, 20 }, { 0xfffff3, 24 }, { 0xfffed, 20 }, { 0x1fffe6, 21 },
+    { 0x3fffe9, 22 }, { 0x1fffe7, 21 }, { 0x1fffe8, 21 }, { 0x7ffff3, 23 }, { 0x3fffea, 22 }, { 0x3fffeb, 22 },
+    { 0x1ffffee, 25 }, { 0x1ffffef, 25 }, { 0xfffff4, 24 }, { 0xfffff5, 24 }, { 0x3ffffea, 26 }, { 0x7ffff4, 23 },
+    { 0x3ffffeb, 26 }, { 0x7ffffe6, 27 }, { 0x3ffffec, 26 }, { 0x3ffffed, 26 }, { 0x7ffffe7, 27 }, { 0x7ffffe8, 27 },
+    { 0x7ffffe9, 27 }, { 0x7ffffea, 27 }, { 0x7ffffeb, 27 }, { 0xffffffe, 28 }, { 0x7ffffec, 27 }, { 0x7ffffed, 27 },
+    { 0x7ffffee, 27 }, { 0x7ffffef, 27 }, { 0x7fffff0, 27 }, { 0x3ffffee, 26 }, { 0x3fffffff, 30 },
+};
+
+/**
+ * @brief Huffman解码树，根节点为0.
+ *
+ * @details 子节点为正数时是内部节点的下标，为负数时是叶子(符号为`-1 - child`)，0表示不存在.
+ */
+class HuffmanTree {
+public:
+    HuffmanTree() : nodes_(1) {
+        for (int sym = 0; sym < 257; ++sym) {
+            uint32_t code = s_huffman_codes[sym].code;
+            int bits = s_huffman_codes[sym].bits;
+            size_t node = 0;
+            for (int i = bits - 1; i > 0; --i) {
+                int bit = (code >> i) & 1;
+                if (nodes_[node].child[bit] == 0) {
+                    nodes_[node].child[bit] = (int16_t)nodes_.size();
+                    nodes_.push_back(Node());
+                }
+                node = (size_t)nodes_[node].child[bit];
+            }
+            nodes_[node].child[code & 1] = (int16_t)(-1 - sym);
+        }
+    }
+
+    int16_t child(size_t node, int bit) const { return nodes_[node].child[bit]; }
+
+private:
+    struct Node {
+        int16_t child[2]{ 0, 0 };
+    };
+    std::vector<Node> nodes_;
+};
+
+static const HuffmanTree& s_huffman_tree() {
+    static const HuffmanTree tree;
+    return tree;
+}
+
+/**
+ * @brief Huffman解码.
+ *
+ * @details 末尾的填充必须是EOS编码的前缀(全为1)，且不超过7位(RFC 7541 5.2).
+ */
+static bool s_huffman_decode(const uint8_t* data, size_t size, std::string* out) {
+    const HuffmanTree& tree = s_huffman_tree();
+    size_t node = 0;
+    int depth = 0;
+    bool all_ones = true;
+    for (size_t i = 0; i < size; ++i) {
+        for (int j = 7; j >= 0; --j) {
+            int bit = (data[i] >> j) & 1;
+            int16_t next = tree.child(node, bit);
+            if (next == 0) {
+                return false;
+            }
+            ++depth;
+            all_ones = all_ones && bit == 1;
+            if (next > 0) {
+                node = (size_t)next;
+                continue;
+            }
+            int sym = -1 - next;
+            if (sym == 256) {
+                return false;  /* 不能包含EOS */
+            }
+            out->push_back((char)sym);
+            node = 0;
+            depth = 0;
+            all_ones = true;
+        }
+    }
+    return depth <= 7 && all_ones;
+}
+
+static size_t s_huffman_encoded_size(boost::string_view str) {
+    uint64_t bits = 0;
+    for (char c : str) {
+        bits += s_huffman_codes[(uint8_t)c].bits;
+    }
+    return (size_t)((bits + 7) / 8);
+}
+
+static void s_huffman_encode(boost::string_view str, std::string* out) {
+    uint64_t acc = 0;
+    int bits = 0;
+    for (char c : str) {
+        const auto& code = s_huffman_codes[(uint8_t)c];
+        acc = (acc << code.bits) | code.code;
+        bits += code.bits;
+        while (bits >= 8) {
+            bits -= 8;
+            out->push_back((char)(acc >> bits));
+        }
+        acc &= ((uint64_t)1 << bits) - 1;
+    }
+    if (bits > 0) {
+        /* 以EOS编码的前缀(全为1)填充 */
+        out->push_back((char)((acc << (8 - bits)) | (0xff >> bits)));
+    }
+}
+
+/**
+ * @brief 编码整数(RFC 7541 5.1).
+ *
+ * @param prefix_bits 第一个字节中用于整数的位数
+ * @param flags 第一个字节中其余的位
+ */
+static void s_encode_integer(uint64_t value, int prefix_bits, uint8_t flags, std::string* out) {
+    uint64_t max = ((uint64_t)1 << prefix_bits) - 1;
+    if (value < max) {
+        out->push_back((char)(flags | value));
+        return;
+    }
+    out->push_back((char)(flags | max));
+    value -= max;
+    while (value >= 128) {
+        out->push_back((char)(value % 128 + 128));
+        value /= 128;
+    }
+    out->push_back((char)value);
+}
+
+/**
+ * @brief 解码整数，超过32位时视为格式错误.
+ */
+static bool s_decode_integer(const uint8_t** p, const uint8_t* end, int prefix_bits, uint64_t* value) {
+    if (*p >= end) {
+        return false;
+    }
+    uint64_t max = ((uint64_t)1 << prefix_bits) - 1;
+    uint64_t v = *(*p)++ & max;
+    if (v == max) {
+        int shift = 0;
+        uint8_t b = 0;
+        do {
+            if (*p >= end || shift > 28) {
+                return false;
+            }
+            b = *(*p)++;
+            v += (uint64_t)(b & 0x7f) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        if (v > UINT32_MAX) {
+            return false;
+        }
+    }
+    *value = v;
+    return true;
+}
+
+/* ---------------------------------------------------------------------------- */
+
+const HpackHeader* HpackTable::Get(uint64_t index) const {
+    static const std::vector<HpackHeader> s_static_headers = [] {
+        std::vector<HpackHeader> headers;
+        for (const auto& entry : s_static_table) {
+            headers.push_back(HpackHeader{ entry.name, entry.value });
+        }
+        return headers;
+    }();
+    if (index == 0) {
+        return nullptr;
+    }
+    if (index <= kStaticTableSize) {
+        return &s_static_headers[index - 1];
+    }
+    index -= kStaticTableSize + 1;
+    return index < entries_.size() ? &entries_[(size_t)index] : nullptr;
+}
+
+uint64_t HpackTable::Find(boost::string_view name, boost::string_view value, uint64_t* name_index) const {
+    *name_index = 0;
+    for (size_t i = 0; i < kStaticTableSize; ++i) {
+        if (name == s_static_table[i].name) {
+            if (value == s_static_table[i].value) {
+                return i + 1;
+            }
+            if (*name_index == 0) {
+                *name_index = i + 1;
+            }
+        }
+    }
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (name == entries_[i].name) {
+            if (value == entries_[i].value) {
+                return kStaticTableSize + i + 1;
+            }
+            if (*name_index == 0) {
+                *name_index = kStaticTableSize + i + 1;
+            }
+        }
+    }
+    return 0;
+}
+
+void HpackTable::Insert(HpackHeader&& header) {
+    size_t size = header.size();
+    if (size > max_size_) {
+        /* 大于整个动态表时，清空动态表(RFC 7541 4.4) */
+        entries_.clear();
+        size_ = 0;
+        return;
+    }
+    size_ += size;
+    entries_.push_front(std::move(header));
+    Evict();
+}
+
+void HpackTable::SetMaxSize(size_t max_size) {
+    max_size_ = max_size;
+    Evict();
+}
+
+void HpackTable::Evict() {
+    while (size_ > max_size_) {
+        size_ -= entries_.back().size();
+        entries_.pop_back();
+    }
+}
+
+/* ---------------------------------------------------------------------------- */
+
+bool HpackDecoder::Decode(const uint8_t* data, size_t size, size_t max_list_size,
+    std::vector<HpackHeader>* headers, bool* truncated)
+{
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    size_t list_size = 0;
+    *truncated = false;
+    while (p < end) {
+        uint8_t b = *p;
+        uint64_t index = 0;
+        HpackHeader header;
+        if (b & 0x80) {
+            /* 索引 */
+            if (!s_decode_integer(&p, end, 7, &index)) {
+                return false;
+            }
+            const HpackHeader* entry = table_.Get(index);
+            if (!entry) {
+                return false;
+            }
+            header = *entry;
+        }
+        else if ((b & 0xe0) == 0x20) {
+            /* 动态表大小更新，不能超过SETTINGS_HEADER_TABLE_SIZE(使用默认值) */
+            if (!s_decode_integer(&p, end, 5, &index) || index > kHpackDefaultTableSize) {
+                return false;
+            }
+            table_.SetMaxSize((size_t)index);
+            continue;
+        }
+        else {
+            /* 字面值: 增量索引(01)、不索引(0000)、永不索引(0001) */
+            bool indexing = (b & 0xc0) == 0x40;
+            if (!s_decode_integer(&p, end, indexing ? 6 : 4, &index)) {
+                return false;
+            }
+            if (index > 0) {
+                const HpackHeader* entry = table_.Get(index);
+                if (!entry) {
+                    return false;
+                }
+                header.name = entry->name;
+            }
+            else if (!DecodeString(&p, end, &header.name)) {
+                return false;
+            }
+            if (!DecodeString(&p, end, &header.value)) {
+                return false;
+            }
+            if (indexing) {
+                table_.Insert(HpackHeader(header));
+            }
+        }
+        /* 超出大小时继续解码(保持动态表同步)，不再保存 */
+        list_size += header.size();
+        if (list_size > max_list_size) {
+            *truncated = true;
+        }
+        else {
+            headers->push_back(std::move(header));
+        }
+    }
+    return true;
+}
+
+bool HpackDecoder::DecodeString(const uint8_t** p, const uint8_t* end, std::string* out) {
+    if (*p >= end) {
+        return false;
+    }
+    bool huffman = (**p & 0x80) != 0;
+    uint64_t length = 0;
+    if (!s_decode_integer(p, end, 7, &length) || length > (uint64_t)(end - *p)) {
+        return false;
+    }
+    const uint8_t* data = *p;
+    *p += length;
+    if (huffman) {
+        return s_huffman_decode(data, (size_t)length, out);
+    }
+    out->assign((const char*)data, (size_t)length);
+    return true;
+}
+
+/* ---------------------------------------------------------------------------- */
+
+void HpackEncoder::SetMaxTableSize(size_t max_size) {
+    max_size = std::min(max_size, kHpackDefaultTableSize);
+    if (max_size == table_.max_size()) {
+        return;
+    }
+    min_table_size_ = std::min(min_table_size_, max_size);
+    table_.SetMaxSize(max_size);
+    table_size_changed_ = true;
+}
+
+void HpackEncoder::Encode(boost::string_view name, boost::string_view value, std::string* out) {
+    if (table_size_changed_) {
+        /* 期间的最小值和最终值都需要通知对端(RFC 7541 4.2) */
+        if (min_table_size_ < table_.max_size()) {
+            s_encode_integer(min_table_size_, 5, 0x20, out);
+        }
+        s_encode_integer(table_.max_size(), 5, 0x20, out);
+        table_size_changed_ = false;
+        min_table_size_ = table_.max_size();
+    }
+
+    uint64_t name_index = 0;
+    uint64_t index = table_.Find(name, value, &name_index);
+    if (index > 0) {
+        s_encode_integer(index, 7, 0x80, out);
+        return;
+    }
+
+    bool sensitive = name == "set-cookie" || name == "authorization" || name == "proxy-authorization";
+    bool volatile_value = name == "content-length" || name == "content-range" || name == "date"
+        || name == "etag" || name == "last-modified" || name == "age" || name == "expires";
+    if (sensitive) {
+        s_encode_integer(name_index, 4, 0x10, out);  /* 永不索引 */
+    }
+    else if (volatile_value) {
+        s_encode_integer(name_index, 4, 0x00, out);  /* 不索引 */
+    }
+    else {
+        s_encode_integer(name_index, 6, 0x40, out);  /* 增量索引 */
+        table_.Insert(HpackHeader{ name.to_string(), value.to_string() });
+    }
+    if (name_index == 0) {
+        EncodeString(name, out);
+    }
+    EncodeString(value, out);
+}
+
+void HpackEncoder::EncodeString(boost::string_view str, std::string* out) {
+    size_t huffman_size = s_huffman_encoded_size(str);
+    if (huffman_size < str.size()) {
+        s_encode_integer(huffman_size, 7, 0x80, out);
+        s_huffman_encode(str, out);
+    }
+    else {
+        s_encode_integer(str.size(), 7, 0x00, out);
+        out->append(str.data(), str.size());
+    }
+}
+
+} // namespace server
+} // namespace ic
@@ -0,0 +1,124 @@
+#ifndef IC_SERVER_HPACK_H_
+#define IC_SERVER_HPACK_H_
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+namespace ic {
+namespace server {
+
+/** 动态表大小的默认值(SETTINGS_HEADER_TABLE_SIZE) */
+constexpr size_t kHpackDefaultTableSize = 4096;
+
+/**
+ * @brief 头部字段.
+ */
+struct HpackHeader {
+    std::string name;
+    std::string value;
+
+    /** 在动态表中占用的大小(RFC 7541 4.1) */
+    size_t size() const { return name.size() + value.size() + 32; }
+};
+
+/**
+ * @brief HPACK动态表(RFC 7541 2.3.2)，最新插入的条目在最前面.
+ */
+class HpackTable {
+public:
+    explicit HpackTable(size_t max_size = kHpackDefaultTableSize) : max_size_(max_size) {}
+
+    /**
+     * @brief 获取条目(索引从1开始，1~61为静态表).
+     */
+    const HpackHeader* Get(uint64_t index) const;
+
+    /**
+     * @brief 查找条目.
+     *
+     * @param[out] name_index 只有名称相同时的索引，不存在时为0
+     * @return 名称和值都相同的条目的索引，不存在时返回0
+     */
+    uint64_t Find(boost::string_view name, boost::string_view value, uint64_t* name_index) const;
+
+    /**
+     * @brief 插入条目，超出大小时移除最早的条目.
+     */
+    void Insert(HpackHeader&& header);
+
+    /**
+     * @brief 修改最大大小，移除超出的条目.
+     */
+    void SetMaxSize(size_t max_size);
+    size_t max_size() const { return max_size_; }
+
+private:
+    void Evict();
+
+private:
+    std::deque<HpackHeader> entries_;
+    size_t size_{0};
+    size_t max_size_;
+};
+
+/**
+ * @brief HPACK解码器(每个连接一个，依次解码对端发送的头部块).
+ */
+class HpackDecoder {
+public:
+    /**
+     * @brief 解码一个完整的头部块.
+     *
+     * @param max_list_size 头部列表(解码后)的最大大小，超出后不再保存之后的头部(仍然解码，保持动态表同步)
+     * @param[out] truncated 是否超出了`max_list_size`
+     *
+     * @return 格式错误时返回false，应当以COMPRESSION_ERROR关闭连接(动态表的状态已经无法同步)
+     */
+    bool Decode(const uint8_t* data, size_t size, size_t max_list_size, std::vector<HpackHeader>* headers, bool* truncated);
+
+private:
+    bool DecodeString(const uint8_t** p, const uint8_t* end, std::string* out);
+
+private:
+    HpackTable table_;
+};
+
+/**
+ * @brief HPACK编码器(每个连接一个，依次编码发送给对端的头部块).
+ *
+ * @details 值相同的头部直接引用静态表或动态表，取值易变的头部(如`content-length`)不插入动态表，
+ * @details 敏感的头部(如`set-cookie`)以"永不索引"的方式发送.
+ * @details 字符串经Huffman编码后更短时使用Huffman编码.
+ */
+class HpackEncoder {
+public:
+    /**
+     * @brief 对端修改了SETTINGS_HEADER_TABLE_SIZE.
+     *
+     * @details 不超过默认大小，下一个头部块的开头通知对端.
+     */
+    void SetMaxTableSize(size_t max_size);
+
+    /**
+     * @brief 编码一个头部，追加到`out`.
+     *
+     * @param name 小写的名称
+     */
+    void Encode(boost::string_view name, boost::string_view value, std::string* out);
+
+private:
+    static void EncodeString(boost::string_view str, std::string* out);
+
+private:
+    HpackTable table_;
+    /** 需要在下一个头部块的开头发送的动态表大小更新 */
+    bool table_size_changed_{false};
+    size_t min_table_size_{kHpackDefaultTableSize};
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_HPACK_H_
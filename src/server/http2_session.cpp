@@ -0,0 +1,1375 @@
+#include "http2_session.h"
+#include "server/http_server.h"
+#include "server/logger.h"
+#include "server/request_raw.h"
+#include "server/router.h"
+#include "handler_pool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <boost/asio/post.hpp>
+
+namespace ic {
+namespace server {
+
+/* 帧的标志位 */
+constexpr uint8_t kFlagEndStream = 0x1;
+constexpr uint8_t kFlagAck = 0x1;
+constexpr uint8_t kFlagEndHeaders = 0x4;
+constexpr uint8_t kFlagPadded = 0x8;
+constexpr uint8_t kFlagPriority = 0x20;
+
+/* SETTINGS的参数 */
+constexpr uint16_t kSettingsHeaderTableSize = 0x1;
+constexpr uint16_t kSettingsEnablePush = 0x2;
+constexpr uint16_t kSettingsMaxConcurrentStreams = 0x3;
+constexpr uint16_t kSettingsInitialWindowSize = 0x4;
+constexpr uint16_t kSettingsMaxFrameSize = 0x5;
+constexpr uint16_t kSettingsMaxHeaderListSize = 0x6;
+
+/** 流量控制窗口的最大值 */
+constexpr int64_t kMaxWindowSize = 0x7fffffff;
+
+/** 每次读取的缓冲区大小 */
+constexpr size_t kReadBufferSize = 64 * 1024;
+
+static uint32_t s_read_uint32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void s_write_uint32(char* p, uint32_t value) {
+    p[0] = (char)(value >> 24);
+    p[1] = (char)(value >> 16);
+    p[2] = (char)(value >> 8);
+    p[3] = (char)value;
+}
+
+static void s_write_frame_header(char* p, size_t length, uint8_t type, uint8_t flags, uint32_t stream_id) {
+    p[0] = (char)(length >> 16);
+    p[1] = (char)(length >> 8);
+    p[2] = (char)length;
+    p[3] = (char)type;
+    p[4] = (char)flags;
+    s_write_uint32(p + 5, stream_id);
+}
+
+static void s_append_setting(std::string* out, uint16_t id, uint32_t value) {
+    char buf[6];
+    buf[0] = (char)(id >> 8);
+    buf[1] = (char)id;
+    s_write_uint32(buf + 2, value);
+    out->append(buf, sizeof(buf));
+}
+
+/**
+ * @brief 去掉填充(PADDED标志).
+ *
+ * @return 填充长度不合法时返回false
+ */
+static bool s_strip_padding(uint8_t flags, const uint8_t** payload, size_t* length) {
+    if (!(flags & kFlagPadded)) {
+        return true;
+    }
+    if (*length < 1 || (size_t)(*payload)[0] >= *length) {
+        return false;
+    }
+    *length -= 1 + (*payload)[0];
+    *payload += 1;
+    return true;
+}
+
+/**
+ * @brief HTTP/2中不允许出现的连接相关的头部(RFC 9113 8.2.2).
+ */
+static bool s_is_connection_header(boost::string_view name) {
+    return beast::iequals(name, "connection") || beast::iequals(name, "keep-alive")
+        || beast::iequals(name, "proxy-connection") || beast::iequals(name, "transfer-encoding")
+        || beast::iequals(name, "upgrade");
+}
+
+Http2Session::Http2Session(SessionStream&& stream, HttpServer* svr, const tcp::endpoint& remote_endpoint)
+    : svr_(svr), stream_(std::move(stream)), remote_endpoint_(remote_endpoint),
+      client_ip_(remote_endpoint.address().to_string()), idle_timer_(stream_.get_executor())
+{
+    svr_->logger()->Debug(LOG_CTX, "New HTTP/2 session from %s:%hu", client_ip_.c_str(), remote_endpoint_.port());
+    svr_->OnNewSession();
+}
+
+Http2Session::~Http2Session() {
+    for (auto& p : streams_) {
+        if (p.second->writer) {
+            p.second->writer->Abort();
+        }
+    }
+    svr_->logger()->Debug(LOG_CTX, "Destroy HTTP/2 session %s:%hu", client_ip_.c_str(), remote_endpoint_.port());
+    svr_->OnDestroySession();
+}
+
+/**
+ * @brief 发送服务器的设置，解析已经读取的数据，开始读取.
+ */
+void Http2Session::Run(beast::flat_buffer&& buffer) {
+    read_buffer_ = std::move(buffer);
+    last_active_ = std::chrono::steady_clock::now();
+
+    std::string settings;
+    s_append_setting(&settings, kSettingsMaxConcurrentStreams, std::max(1U, svr_->config().http2_max_concurrent_streams()));
+    s_append_setting(&settings, kSettingsInitialWindowSize, kHttp2ReceiveWindowSize);
+    s_append_setting(&settings, kSettingsMaxHeaderListSize, (uint32_t)kHttp2MaxHeaderListSize);
+    QueueFrame(kSettings, 0, 0, settings.data(), settings.size());
+    /* 连接的接收窗口只能通过WINDOW_UPDATE扩大(初始为65535) */
+    QueueWindowUpdate(0, kHttp2ReceiveWindowSize - 65535);
+
+    unsigned int tcp_stream_timeout_ms = svr_->config().tcp_stream_timeout_ms();
+    if (tcp_stream_timeout_ms > 0) {
+        StartIdleTimer(std::chrono::milliseconds(tcp_stream_timeout_ms));
+    }
+
+    bool ok = ProcessFrames();
+    Flush();
+    if (ok) {
+        DoRead();
+    }
+}
+
+void Http2Session::DoRead() {
+    if (reading_ || read_closed_) {
+        return;
+    }
+    reading_ = true;
+    /* 读取不限时，没有流时由空闲定时器关闭连接(正在进行的发送不受影响) */
+    stream_.expires_never();
+    stream_.async_read_some(read_buffer_.prepare(kReadBufferSize),
+        beast::bind_front_handler(&Http2Session::OnRead, shared_from_this()));
+}
+
+void Http2Session::OnRead(beast::error_code ec, size_t bytes_transferred) {
+    reading_ = false;
+    if (ec) {
+        if (ec != net::error::eof) {
+            svr_->logger()->Debug(LOG_CTX, "HTTP/2 read error, %s", ec.message().c_str());
+        }
+        read_closed_ = true;
+        closing_ = true;
+        ResetAllStreams();
+        return Flush();
+    }
+    if (read_closed_) {
+        return;
+    }
+    read_buffer_.commit(bytes_transferred);
+    last_active_ = std::chrono::steady_clock::now();
+    bool ok = ProcessFrames();
+    Flush();
+    if (ok) {
+        DoRead();
+    }
+}
+
+/**
+ * @brief 解析缓冲区中完整的帧.
+ *
+ * @return 出现连接错误时返回false(不再读取)
+ */
+bool Http2Session::ProcessFrames() {
+    while (!read_closed_) {
+        const uint8_t* data = (const uint8_t*)read_buffer_.data().data();
+        size_t size = read_buffer_.size();
+        if (preface_received_ < kHttp2ClientPrefaceSize) {
+            size_t n = std::min(size, kHttp2ClientPrefaceSize - preface_received_);
+            if (memcmp(data, kHttp2ClientPreface + preface_received_, n) != 0) {
+                return ConnectionError(kProtocolError, "invalid connection preface");
+            }
+            preface_received_ += n;
+            read_buffer_.consume(n);
+            if (preface_received_ < kHttp2ClientPrefaceSize) {
+                break;
+            }
+            continue;
+        }
+        if (size < kHttp2FrameHeaderSize) {
+            break;
+        }
+        size_t length = ((size_t)data[0] << 16) | ((size_t)data[1] << 8) | (size_t)data[2];
+        if (length > kHttp2MaxFrameSize) {
+            return ConnectionError(kFrameSizeError, "frame too large");
+        }
+        if (size < kHttp2FrameHeaderSize + length) {
+            break;
+        }
+        uint8_t type = data[3];
+        uint8_t flags = data[4];
+        uint32_t stream_id = s_read_uint32(data + 5) & 0x7fffffff;
+        if (!OnFrame(type, flags, stream_id, data + kHttp2FrameHeaderSize, length)) {
+            return false;
+        }
+        read_buffer_.consume(kHttp2FrameHeaderSize + length);
+    }
+    return !read_closed_;
+}
+
+bool Http2Session::OnFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length) {
+    /* 头部块必须连续: HEADERS之后只能是同一个流的CONTINUATION */
+    if (header_block_stream_id_ != 0 && (type != kContinuation || stream_id != header_block_stream_id_)) {
+        return ConnectionError(kProtocolError, "expected CONTINUATION");
+    }
+    /* 连接前言之后的第一个帧必须是SETTINGS */
+    if (!settings_received_ && type != kSettings) {
+        return ConnectionError(kProtocolError, "expected SETTINGS");
+    }
+
+    switch (type) {
+    case kData:
+        return OnDataFrame(flags, stream_id, payload, length);
+    case kHeaders:
+        return OnHeadersFrame(flags, stream_id, payload, length);
+    case kPriority:
+        /* 不支持优先级 */
+        if (stream_id == 0) {
+            return ConnectionError(kProtocolError, "PRIORITY on stream 0");
+        }
+        if (length != 5) {
+            ResetStream(stream_id, kFrameSizeError);
+        }
+        return true;
+    case kRstStream: {
+        if (stream_id == 0 || stream_id > last_stream_id_) {
+            return ConnectionError(kProtocolError, "RST_STREAM on idle stream");
+        }
+        if (length != 4) {
+            return ConnectionError(kFrameSizeError, "invalid RST_STREAM");
+        }
+        auto it = streams_.find(stream_id);
+        if (it != streams_.end()) {
+            /* 防止快速重置(rapid reset): 不断打开并重置流，使服务器处理大量请求 */
+            auto now = std::chrono::steady_clock::now();
+            if (now - client_resets_window_ >= std::chrono::seconds(1)) {
+                client_resets_window_ = now;
+                num_client_resets_ = 0;
+            }
+            if (++num_client_resets_ > kHttp2MaxClientResetsPerSecond) {
+                return ConnectionError(kEnhanceYourCalm, "too many RST_STREAM");
+            }
+            Http2StreamPtr stream = it->second;
+            stream->remote_open = false;
+            CloseStream(stream);
+        }
+        return true;
+    }
+    case kSettings:
+        if (stream_id != 0) {
+            return ConnectionError(kProtocolError, "SETTINGS on stream");
+        }
+        return OnSettingsFrame(flags, payload, length);
+    case kPushPromise:
+        return ConnectionError(kProtocolError, "PUSH_PROMISE from client");
+    case kPing:
+        if (stream_id != 0) {
+            return ConnectionError(kProtocolError, "PING on stream");
+        }
+        if (length != 8) {
+            return ConnectionError(kFrameSizeError, "invalid PING");
+        }
+        if (!(flags & kFlagAck)) {
+            QueueFrame(kPing, kFlagAck, 0, (const char*)payload, length);
+        }
+        return true;
+    case kGoAway:
+        if (stream_id != 0) {
+            return ConnectionError(kProtocolError, "GOAWAY on stream");
+        }
+        /* 不再有新的流，已有的流处理完毕后关闭连接 */
+        goaway_received_ = true;
+        if (streams_.empty()) {
+            read_closed_ = true;
+            closing_ = true;
+        }
+        return true;
+    case kWindowUpdate:
+        return OnWindowUpdateFrame(stream_id, payload, length);
+    case kContinuation:
+        if (header_block_stream_id_ == 0) {
+            return ConnectionError(kProtocolError, "unexpected CONTINUATION");
+        }
+        header_block_.append((const char*)payload, length);
+        if (header_block_.size() > kHttp2MaxHeaderListSize) {
+            return ConnectionError(kEnhanceYourCalm, "header block too large");
+        }
+        if (flags & kFlagEndHeaders) {
+            header_block_stream_id_ = 0;
+            return OnHeaderBlock(stream_id, header_block_end_stream_);
+        }
+        return true;
+    default:
+        /* 忽略未知类型的帧 */
+        return true;
+    }
+}
+
+/**
+ * @brief 请求body，交给路由的回调函数(流式接收)或者放入原始请求对象.
+ *
+ * @details 接收窗口消耗一半后归还，body的大小由`body_limit`限制(超出时返回413).
+ */
+bool Http2Session::OnDataFrame(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length) {
+    if (stream_id == 0) {
+        return ConnectionError(kProtocolError, "DATA on stream 0");
+    }
+    /* 流量控制包括填充 */
+    size_t flow_length = length;
+    if ((int64_t)flow_length > recv_window_) {
+        return ConnectionError(kFlowControlError, "connection receive window exceeded");
+    }
+    recv_window_ -= flow_length;
+    if (recv_window_ <= kHttp2ReceiveWindowSize / 2) {
+        QueueWindowUpdate(0, (uint32_t)(kHttp2ReceiveWindowSize - recv_window_));
+        recv_window_ = kHttp2ReceiveWindowSize;
+    }
+    if (!s_strip_padding(flags, &payload, &length)) {
+        return ConnectionError(kProtocolError, "invalid padding");
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+        if (stream_id > last_stream_id_) {
+            return ConnectionError(kProtocolError, "DATA on idle stream");
+        }
+        return true;  /* 已经关闭(或者被拒绝)的流 */
+    }
+    Http2StreamPtr stream = it->second;
+    if (!stream->remote_open) {
+        ResetStream(stream_id, kStreamClosed);
+        return true;
+    }
+    if ((int64_t)flow_length > stream->recv_window) {
+        ResetStream(stream_id, kFlowControlError);
+        return true;
+    }
+    stream->recv_window -= flow_length;
+    bool end_stream = (flags & kFlagEndStream) != 0;
+    /* DATA的总长度与`content-length`不一致时，请求格式错误(RFC 9113 8.1.1) */
+    stream->data_received += length;
+    if (stream->content_length >= 0 && (stream->data_received > (uint64_t)stream->content_length ||
+        (end_stream && stream->data_received != (uint64_t)stream->content_length)))
+    {
+        svr_->logger()->Debug(LOG_CTX, "HTTP/2 request body does not match content-length");
+        ResetStream(stream_id, kProtocolError);
+        return true;
+    }
+    if (!end_stream && stream->recv_window <= kHttp2ReceiveWindowSize / 2) {
+        QueueWindowUpdate(stream_id, (uint32_t)(kHttp2ReceiveWindowSize - stream->recv_window));
+        stream->recv_window = kHttp2ReceiveWindowSize;
+    }
+
+    auto& ex = stream->ex;
+    if (!stream->dispatched && length > 0) {
+        const Route* route = ex->route_hit ? ex->req->route_.get() : nullptr;
+        stream->body_received += length;
+        if (stream->body_received > stream->body_limit) {
+            svr_->logger()->Error(LOG_CTX, "Body limit");
+            ex->res->SetStringBody(413, "body limit exceeded", "text/plain");
+            ex->body_aborted = true;
+        }
+        else if (route && route->body_chunk_callback) {
+            if (!route->body_chunk_callback(*ex->req, *ex->res, (const char*)payload, length)) {
+                ex->body_aborted = true;
+            }
+        }
+        else {
+            ex->parser->get().body().append((const char*)payload, length);
+        }
+    }
+    if (end_stream) {
+        stream->remote_open = false;
+    }
+    if (!stream->dispatched && (end_stream || ex->body_aborted)) {
+        DispatchStream(stream);
+    }
+    return true;
+}
+
+bool Http2Session::OnHeadersFrame(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length) {
+    if (stream_id == 0) {
+        return ConnectionError(kProtocolError, "HEADERS on stream 0");
+    }
+    if (!s_strip_padding(flags, &payload, &length)) {
+        return ConnectionError(kProtocolError, "invalid padding");
+    }
+    if (flags & kFlagPriority) {
+        /* 不支持优先级，跳过 */
+        if (length < 5) {
+            return ConnectionError(kProtocolError, "invalid HEADERS");
+        }
+        payload += 5;
+        length -= 5;
+    }
+    header_block_.assign((const char*)payload, length);
+    bool end_stream = (flags & kFlagEndStream) != 0;
+    if (!(flags & kFlagEndHeaders)) {
+        header_block_stream_id_ = stream_id;
+        header_block_end_stream_ = end_stream;
+        return true;
+    }
+    return OnHeaderBlock(stream_id, end_stream);
+}
+
+/**
+ * @brief 对端的设置，修改初始窗口大小时调整所有流的发送窗口(RFC 9113 6.9.2).
+ */
+bool Http2Session::OnSettingsFrame(uint8_t flags, const uint8_t* payload, size_t length) {
+    if (flags & kFlagAck) {
+        if (length != 0) {
+            return ConnectionError(kFrameSizeError, "invalid SETTINGS ACK");
+        }
+        return true;
+    }
+    if (length % 6 != 0) {
+        return ConnectionError(kFrameSizeError, "invalid SETTINGS");
+    }
+    for (size_t i = 0; i < length; i += 6) {
+        uint16_t id = (uint16_t)((payload[i] << 8) | payload[i + 1]);
+        uint32_t value = s_read_uint32(payload + i + 2);
+        switch (id) {
+        case kSettingsHeaderTableSize:
+            encoder_.SetMaxTableSize(value);
+            break;
+        case kSettingsEnablePush:
+            if (value > 1) {
+                return ConnectionError(kProtocolError, "invalid SETTINGS_ENABLE_PUSH");
+            }
+            break;
+        case kSettingsInitialWindowSize: {
+            if (value > kMaxWindowSize) {
+                return ConnectionError(kFlowControlError, "invalid SETTINGS_INITIAL_WINDOW_SIZE");
+            }
+            int64_t delta = (int64_t)value - (int64_t)peer_initial_window_size_;
+            for (auto& p : streams_) {
+                p.second->send_window += delta;
+                if (p.second->send_window > kMaxWindowSize) {
+                    return ConnectionError(kFlowControlError, "stream send window overflow");
+                }
+            }
+            peer_initial_window_size_ = value;
+            break;
+        }
+        case kSettingsMaxFrameSize:
+            if (value < 16384 || value > 16777215) {
+                return ConnectionError(kProtocolError, "invalid SETTINGS_MAX_FRAME_SIZE");
+            }
+            peer_max_frame_size_ = value;
+            break;
+        case kSettingsMaxConcurrentStreams:
+        case kSettingsMaxHeaderListSize:
+        default:
+            /* 不推送，响应头的大小由路由决定，忽略 */
+            break;
+        }
+    }
+    settings_received_ = true;
+    QueueFrame(kSettings, kFlagAck, 0, nullptr, 0);
+    return true;
+}
+
+bool Http2Session::OnWindowUpdateFrame(uint32_t stream_id, const uint8_t* payload, size_t length) {
+    if (length != 4) {
+        return ConnectionError(kFrameSizeError, "invalid WINDOW_UPDATE");
+    }
+    uint32_t increment = s_read_uint32(payload) & 0x7fffffff;
+    if (stream_id == 0) {
+        if (increment == 0) {
+            return ConnectionError(kProtocolError, "WINDOW_UPDATE with zero increment");
+        }
+        send_window_ += increment;
+        if (send_window_ > kMaxWindowSize) {
+            return ConnectionError(kFlowControlError, "connection send window overflow");
+        }
+        return true;
+    }
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+        if (stream_id > last_stream_id_) {
+            return ConnectionError(kProtocolError, "WINDOW_UPDATE on idle stream");
+        }
+        return true;
+    }
+    if (increment == 0) {
+        ResetStream(stream_id, kProtocolError);
+        return true;
+    }
+    it->second->send_window += increment;
+    if (it->second->send_window > kMaxWindowSize) {
+        ResetStream(stream_id, kFlowControlError);
+    }
+    return true;
+}
+
+/**
+ * @brief 头部块接收完毕: 新的请求，或者请求的trailer(忽略).
+ *
+ * @details 无论是否处理该流，都需要解码(保持HPACK动态表同步).
+ */
+bool Http2Session::OnHeaderBlock(uint32_t stream_id, bool end_stream) {
+    std::vector<HpackHeader> headers;
+    bool truncated = false;
+    bool ok = decoder_.Decode((const uint8_t*)header_block_.data(), header_block_.size(), kHttp2MaxHeaderListSize, &headers, &truncated);
+    header_block_.clear();
+    if (!ok) {
+        return ConnectionError(kCompressionError, "HPACK decoding failed");
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+        /* trailer必须结束流 */
+        Http2StreamPtr stream = it->second;
+        if (!stream->remote_open || !end_stream) {
+            ResetStream(stream_id, stream->remote_open ? kProtocolError : kStreamClosed);
+            return true;
+        }
+        stream->remote_open = false;
+        if (!stream->dispatched) {
+            DispatchStream(stream);
+        }
+        return true;
+    }
+    if (stream_id % 2 == 0 || stream_id <= last_stream_id_) {
+        return ConnectionError(kProtocolError, "invalid stream id");
+    }
+    last_stream_id_ = stream_id;
+    if (goaway_sent_ || closing_) {
+        return true;  /* 不再处理新的流 */
+    }
+    if (streams_.size() + num_detached_streams_ >= std::max(1U, svr_->config().http2_max_concurrent_streams())) {
+        ResetStream(stream_id, kRefusedStream);
+        return true;
+    }
+    if (truncated) {
+        svr_->logger()->Error(LOG_CTX, "HTTP/2 request header list too large");
+        ResetStream(stream_id, kProtocolError);
+        return true;
+    }
+    OpenStream(stream_id, headers, end_stream);
+    return true;
+}
+
+/**
+ * @brief 新的请求: 将请求头填入原始请求对象，匹配路由.
+ *
+ * @details `:authority`作为`Host`请求头，多个`cookie`合并为一个(RFC 9113 8.3.1, 8.2.3).
+ * @details 请求body在之后的DATA中，没有body时立即处理.
+ */
+void Http2Session::OpenStream(uint32_t stream_id, std::vector<HpackHeader>& headers, bool end_stream) {
+    ExchangePtr ex = AcquireExchange();
+    auto& parser = ex->parser;
+    parser.emplace();
+    auto& raw = parser->get();
+    raw.body().swap(ex->body_buffer);  /* 复用body缓冲区 */
+    raw.version(20);
+
+    const std::string* method = nullptr;
+    const std::string* path = nullptr;
+    const std::string* authority = nullptr;
+    std::string cookie;
+    bool malformed = false;
+    bool regular = false;
+    for (const auto& header : headers) {
+        const std::string& name = header.name;
+        if (!name.empty() && name[0] == ':') {
+            /* 伪头部必须在普通头部之前 */
+            if (regular) {
+                malformed = true;
+                break;
+            }
+            if (name == ":method") {
+                method = &header.value;
+            }
+            else if (name == ":path") {
+                path = &header.value;
+            }
+            else if (name == ":authority") {
+                authority = &header.value;
+            }
+            else if (name != ":scheme") {
+                malformed = true;
+                break;
+            }
+            continue;
+        }
+        regular = true;
+        bool has_upper = std::any_of(name.begin(), name.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+        if (name.empty() || has_upper || s_is_connection_header(name) || (name == "te" && header.value != "trailers")) {
+            malformed = true;
+            break;
+        }
+        if (name == "cookie") {
+            if (!cookie.empty()) {
+                cookie += "; ";
+            }
+            cookie += header.value;
+            continue;
+        }
+        raw.insert(name, header.value);
+    }
+    /* `content-length`必须是数字，没有body时必须为0 */
+    int64_t content_length = -1;
+    auto content_length_field = raw[http::field::content_length];
+    if (!malformed && !content_length_field.empty()) {
+        if (content_length_field.size() > 18 || !std::all_of(content_length_field.begin(), content_length_field.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            malformed = true;
+        }
+        else {
+            content_length = (int64_t)strtoull(content_length_field.to_string().c_str(), nullptr, 10);
+            malformed = end_stream && content_length != 0;
+        }
+    }
+    if (malformed || !method || !path || path->empty()) {
+        RecycleExchange(std::move(ex));
+        ResetStream(stream_id, kProtocolError);
+        return;
+    }
+    raw.method_string(*method);
+    raw.target(*path);
+    if (authority && raw.find(http::field::host) == raw.end()) {
+        raw.set(http::field::host, *authority);
+    }
+    if (!cookie.empty()) {
+        raw.set(http::field::cookie, cookie);
+    }
+
+    auto stream = std::make_shared<Http2Stream>();
+    stream->id = stream_id;
+    stream->ex = ex;
+    stream->remote_open = !end_stream;
+    stream->content_length = content_length;
+    stream->send_window = peer_initial_window_size_;
+    streams_[stream_id] = stream;
+
+    ex->res = std::allocate_shared<Response>(util::ArenaAllocator<Response>(&ex->arena), svr_);
+    ex->req = std::allocate_shared<Request>(util::ArenaAllocator<Request>(&ex->arena),
+        svr_, (RequestRaw*)(&raw), client_ip_, &ex->arena);
+
+    /* 检查是否命中路由 */
+    ex->route_hit = svr_->router()->HitRoute(*ex->req, *ex->res);
+    const Route* route = ex->route_hit ? ex->req->route_.get() : nullptr;
+
+    /* 限制body大小(优先使用路由的设置) */
+    uint64_t body_limit = (route && route->body_limit > 0) ? route->body_limit : svr_->config().body_limit();
+    if (body_limit == 0) {
+        body_limit = (uint64_t)1024 * 1024 * 10;   /* 默认限制大小10MB */
+    }
+    stream->body_limit = body_limit;
+    if (content_length >= 0 && (uint64_t)content_length > body_limit) {
+        svr_->logger()->Error(LOG_CTX, "Body limit");
+        ex->res->SetStringBody(413, "body limit exceeded", "text/plain");
+        ex->body_aborted = true;
+    }
+    else if (route && route->body_chunk_callback && stream->remote_open) {
+        /* 流式接收body，请求拦截器(1)在接收之前执行 */
+        if (svr_->cb_before_parse_body_ && !svr_->cb_before_parse_body_(*ex->req, *ex->res)) {
+            ex->body_aborted = true;
+        }
+    }
+    if (!stream->remote_open || ex->body_aborted) {
+        DispatchStream(stream);
+    }
+}
+
+/**
+ * @brief 请求接收完毕(或者中止接收body)，处理请求.
+ */
+void Http2Session::DispatchStream(const Http2StreamPtr& stream) {
+    stream->dispatched = true;
+    uint32_t stream_id = stream->id;
+    ExchangePtr ex = stream->ex;
+    svr_->OnStartHandlingRequest(ex->req.get());
+    if (!Session::PreHandleRequest(svr_, ex)) {
+        FinishRequest(stream_id, ex);
+    }
+    else if (ex->req->route()->blocking && svr_->handler_pool_) {
+        DispatchToHandlerPool(stream_id, ex);
+    }
+    else {
+        HandleRequest(stream_id, ex, false);
+    }
+}
+
+/**
+ * @brief 处理请求.
+ *
+ * @param in_handler_pool 是否在处理线程池中执行，此时需要回到当前会话的executor返回响应
+ */
+void Http2Session::HandleRequest(uint32_t stream_id, const ExchangePtr& ex, bool in_handler_pool) {
+    ex->handle_start_time = std::chrono::system_clock::now();
+    auto& route = ex->req->route_;
+    if (route->is_async()) {
+        /* 异步路由：等待回调函数调用`ResponseCompletion`后再返回响应 */
+        auto self = shared_from_this();
+        route->InvokeAsync(*ex->req, *ex->res, ResponseCompletion([self, stream_id, ex] {
+            net::post(self->stream_.get_executor(), beast::bind_front_handler(&Http2Session::OnHandleRequestDone, self, stream_id, ex));
+        }, [self, ex] {
+            self->svr_->logger()->Error(LOG_CTX, "Async route did not complete the response. (path:%s)", ex->req->route_->path.c_str());
+            ex->res->SetStringBody(500U, "Internal Server Error", "text/plain");
+        }));
+        return;
+    }
+    route->Invoke(*ex->req, *ex->res);
+    if (in_handler_pool) {
+        net::post(stream_.get_executor(), beast::bind_front_handler(&Http2Session::OnHandleRequestDone, shared_from_this(), stream_id, ex));
+    }
+    else {
+        OnHandleRequestDone(stream_id, ex);
+    }
+}
+
+void Http2Session::OnHandleRequestDone(uint32_t stream_id, const ExchangePtr& ex) {
+    ex->req->time_consumed_handle_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - ex->handle_start_time);
+    FinishRequest(stream_id, ex);
+}
+
+/**
+ * @brief 在处理线程池中执行阻塞型路由.
+ */
+void Http2Session::DispatchToHandlerPool(uint32_t stream_id, const ExchangePtr& ex) {
+    auto self = shared_from_this();
+    bool ok = svr_->handler_pool_->TryPost([self, stream_id, ex] {
+        self->HandleRequest(stream_id, ex, true);
+    }, [self, stream_id, ex] {
+        /* 线程池停止: 立即结束请求(服务器停止后executor可能不再运行)，之后再尝试返回响应 */
+        ex->res->SetStringBody(503U, "Service Unavailable", "text/plain");
+        self->svr_->OnFinishHandlingRequest(ex->req.get());
+        net::post(self->stream_.get_executor(), beast::bind_front_handler(&Http2Session::FinishRequest, self, stream_id, ex));
+    });
+    if (!ok) {
+        svr_->logger()->Warn(LOG_CTX, "Handler pool is busy, reject request: %s", ex->req->path().c_str());
+        ex->res->SetStringBody(503U, "Service Unavailable", "text/plain");
+        FinishRequest(stream_id, ex);
+    }
+}
+
+/**
+ * @brief 请求处理完毕，返回响应(各个流互不等待).
+ */
+void Http2Session::FinishRequest(uint32_t stream_id, const ExchangePtr& ex) {
+    svr_->OnFinishHandlingRequest(ex->req.get());
+    ex->req->time_consumed_total_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - ex->req->arrive_timepoint());
+    ex->done = true;
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || it->second->ex != ex) {
+        /* 流已经被重置，或者连接已经关闭 */
+        --num_detached_streams_;
+        if (ex->res->stream_writer_) {
+            ex->res->stream_writer_->Abort();
+        }
+        return;
+    }
+    Http2StreamPtr stream = it->second;
+    SendResponse(stream);
+    Flush();
+}
+
+/**
+ * @brief 返回响应: 响应头放入发送队列，之后的内容在发送时按照流量控制窗口分为数据帧.
+ */
+void Http2Session::SendResponse(const Http2StreamPtr& stream) {
+    auto& ex = stream->ex;
+    auto& req = ex->req;
+    auto& res = ex->res;
+    /* 响应拦截器 */
+    svr_->cb_before_send_response_ && svr_->cb_before_send_response_(*req, *res);
+    bool head = req->method_ == HttpMethod::kHEAD;
+
+    if (res->stream_writer_) {
+        /* 打印请求日志(内容长度未知) */
+        Session::LogAccess(svr_, ex, 0);
+        if (head) {
+            res->stream_writer_->Abort();
+            return SendResponseHeaders(stream, false, 0, true);
+        }
+        SendResponseHeaders(stream, false, 0, false);
+        return AttachStreamWriter(stream);
+    }
+
+    if (res->is_file_body_) {
+        PreparedFileBody body;
+        Session::PrepareFileBody(svr_, ex, &body);
+        if (body.kind != PreparedFileBody::kString) {
+            Session::LogAccess(svr_, ex, body.content_length);
+            if (body.kind == PreparedFileBody::kHeader || body.content_length == 0) {
+                return SendResponseHeaders(stream, true, body.content_length, true);
+            }
+            stream->file = std::move(body.file);
+            stream->content = std::move(body.compressed);
+            if (stream->content) {
+                stream->file_data = stream->content->data();
+            }
+            else if (stream->file->has_content) {
+                stream->file_data = stream->file->content.data();
+            }
+            if (body.kind == PreparedFileBody::kSegments) {
+                stream->segments = std::move(body.segments);
+            }
+            else {
+                stream->segments.push_back(FileBodySegment{ std::string(), 0, body.content_length });
+            }
+            return SendResponseHeaders(stream, true, body.content_length, false);
+        }
+    }
+
+    /* 文本内容 */
+    Session::CompressStringBody(svr_, ex);
+    stream->data.swap(res->string_body_);
+    Session::LogAccess(svr_, ex, stream->data.size());
+    bool no_content = res->status_code_ == 204U || res->status_code_ == 304U;
+    SendResponseHeaders(stream, !no_content, stream->data.size(), head || no_content || stream->data.empty());
+}
+
+/**
+ * @brief 将响应头编码后放入发送队列.
+ *
+ * @details 去掉连接相关的响应头，超出对端的最大帧长度时分为HEADERS和CONTINUATION(连续放入队列).
+ *
+ * @param end_stream 没有响应内容，结束该流
+ */
+void Http2Session::SendResponseHeaders(const Http2StreamPtr& stream, bool has_length, uint64_t content_length, bool end_stream) {
+    const Response& res = *stream->ex->res;
+    std::string block;
+    encoder_.Encode(":status", std::to_string(res.status_code_), &block);
+    std::string name;
+    for (const auto& p : res.headers_) {
+        name = p.first;
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) { return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c; });
+        if (s_is_connection_header(name) || name == "content-length") {
+            continue;
+        }
+        encoder_.Encode(name, p.second, &block);
+    }
+    if (has_length) {
+        encoder_.Encode("content-length", std::to_string(content_length), &block);
+    }
+
+    size_t offset = 0;
+    uint8_t type = kHeaders;
+    do {
+        size_t n = std::min(block.size() - offset, (size_t)peer_max_frame_size_);
+        uint8_t flags = (offset + n == block.size()) ? kFlagEndHeaders : 0;
+        if (type == kHeaders && end_stream) {
+            flags |= kFlagEndStream;
+        }
+        QueueFrame(type, flags, stream->id, block.data() + offset, n);
+        offset += n;
+        type = kContinuation;
+    } while (offset < block.size());
+
+    if (end_stream) {
+        CloseStream(stream);
+    }
+    else {
+        stream->sending_body = true;
+    }
+}
+
+/**
+ * @brief 开始发送流式响应内容，写入器有新的内容时回到当前会话的executor发送.
+ *
+ * @details 内容在发送时才从写入器中取出(受流量控制窗口限制)，写入器的缓冲区满时阻塞写入(背压).
+ */
+void Http2Session::AttachStreamWriter(const Http2StreamPtr& stream) {
+    stream->writer = stream->ex->res->stream_writer_;
+    std::weak_ptr<Http2Session> weak_self = shared_from_this();
+    uint32_t stream_id = stream->id;
+    ResponseWriter* writer = stream->writer.get();
+    auto executor = stream_.get_executor();
+    stream->writer->Attach([weak_self, stream_id, writer, executor] {
+        net::post(executor, [weak_self, stream_id, writer] {
+            auto self = weak_self.lock();
+            if (!self) {
+                return;
+            }
+            auto it = self->streams_.find(stream_id);
+            if (it != self->streams_.end() && it->second->writer.get() == writer) {
+                self->Flush();
+            }
+        });
+    });
+
+    if (stream->writer->GetHeartbeat(&stream->heartbeat, &stream->heartbeat_interval_ms)) {
+        if (stream->heartbeat_interval_ms == 0) {
+            unsigned int tcp_stream_timeout_ms = svr_->config().tcp_stream_timeout_ms();
+            stream->heartbeat_interval_ms = tcp_stream_timeout_ms > 0 ? std::max(1U, tcp_stream_timeout_ms / 2) : 15000;
+        }
+    }
+    else {
+        stream->heartbeat_interval_ms = 0;
+    }
+    /* 未设置心跳时，写入器超过`tcp_stream_timeout_ms`没有内容则重置该流，避免未关闭的写入器一直占用流 */
+    unsigned int interval_ms = stream->heartbeat_interval_ms > 0 ? stream->heartbeat_interval_ms : svr_->config().tcp_stream_timeout_ms();
+    stream->last_sent = std::chrono::steady_clock::now();
+    if (interval_ms > 0) {
+        stream->heartbeat_timer.reset(new net::steady_timer(stream_.get_executor()));
+        StartStreamHeartbeat(stream_id, std::chrono::milliseconds(interval_ms));
+    }
+    stream->writer->NotifyWritable();
+}
+
+/**
+ * @brief 定时检查流式响应是否空闲，空闲时发送心跳(未设置心跳时重置该流).
+ */
+void Http2Session::StartStreamHeartbeat(uint32_t stream_id, std::chrono::steady_clock::duration delay) {
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || !it->second->heartbeat_timer) {
+        return;
+    }
+    auto self = shared_from_this();
+    net::steady_timer& timer = *it->second->heartbeat_timer;
+    timer.expires_after(delay);
+    timer.async_wait([self, stream_id](beast::error_code ec) {
+        if (!ec) {
+            self->OnStreamHeartbeat(stream_id);
+        }
+    });
+}
+
+void Http2Session::OnStreamHeartbeat(uint32_t stream_id) {
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || !it->second->writer) {
+        return;
+    }
+    Http2Stream& stream = *it->second;
+    auto idle = std::chrono::steady_clock::now() - stream.last_sent;
+    if (stream.heartbeat_interval_ms == 0) {
+        auto timeout = std::chrono::steady_clock::duration(std::chrono::milliseconds(svr_->config().tcp_stream_timeout_ms()));
+        if (idle < timeout) {
+            return StartStreamHeartbeat(stream_id, timeout - idle);
+        }
+        svr_->logger()->Debug(LOG_CTX, "HTTP/2 stream response idle timeout");
+        ResetStream(stream_id, kCancel);
+        return Flush();
+    }
+    auto interval = std::chrono::steady_clock::duration(std::chrono::milliseconds(stream.heartbeat_interval_ms));
+    if (idle < interval) {
+        return StartStreamHeartbeat(stream_id, interval - idle);
+    }
+    stream.writer->TryWrite(stream.heartbeat);
+    StartStreamHeartbeat(stream_id, interval);
+}
+
+/**
+ * @brief 从各个正在发送响应内容的流中轮流取出一帧，直接放入发送队列.
+ *
+ * @param budget 最多放入的字节数
+ * @return 放入的字节数
+ */
+size_t Http2Session::FillDataFrames(size_t budget) {
+    size_t queued = 0;
+    bool progress = true;
+    while (progress && queued < budget && !streams_.empty()) {
+        progress = false;
+        /* 从上一次发送的流之后开始，避免总是优先发送ID较小的流 */
+        auto it = streams_.upper_bound(last_data_stream_id_);
+        size_t count = streams_.size();
+        for (size_t i = 0; i < count && queued < budget && !streams_.empty(); ++i) {
+            if (it == streams_.end()) {
+                it = streams_.begin();
+            }
+            Http2StreamPtr stream = it->second;
+            ++it;
+            if (!stream->sending_body) {
+                continue;
+            }
+            int64_t window = std::min(send_window_, stream->send_window);
+            size_t max_size = (size_t)std::max<int64_t>(0, std::min<int64_t>(window, (int64_t)peer_max_frame_size_));
+            max_size = std::min(max_size, budget - queued);
+
+            /* 预留帧头，内容直接追加到发送队列 */
+            size_t header_pos = write_queue_.size();
+            write_queue_.append(kHttp2FrameHeaderSize, '\0');
+            bool end = false;
+            if (!ReadStreamData(*stream, max_size, &write_queue_, &end)) {
+                write_queue_.resize(header_pos);
+                ResetStream(stream->id, kInternalError);
+                continue;
+            }
+            size_t length = write_queue_.size() - header_pos - kHttp2FrameHeaderSize;
+            if (length == 0 && !end) {
+                write_queue_.resize(header_pos);
+                continue;
+            }
+            s_write_frame_header(&write_queue_[header_pos], length, kData, end ? kFlagEndStream : 0, stream->id);
+            send_window_ -= length;
+            stream->send_window -= length;
+            queued += kHttp2FrameHeaderSize + length;
+            last_data_stream_id_ = stream->id;
+            progress = true;
+
+            if (stream->writer && length > 0) {
+                stream->last_sent = std::chrono::steady_clock::now();
+                if (stream->writer->OnSent(length)) {
+                    stream->writer->NotifyWritable();
+                }
+            }
+            if (end) {
+                if (stream->writer) {
+                    stream->writer->Finish();
+                }
+                stream->sending_body = false;
+                CloseStream(stream);
+            }
+        }
+    }
+    return queued;
+}
+
+/**
+ * @brief 取出流的下一部分响应内容，追加到`out`.
+ *
+ * @param max_size 最多取出的字节数
+ * @param[out] end 是否已经取出全部内容
+ *
+ * @return 读取文件失败时返回false
+ */
+bool Http2Session::ReadStreamData(Http2Stream& stream, size_t max_size, std::string* out, bool* end) {
+    size_t limit = out->size() + max_size;
+
+    /* 流式响应 */
+    if (stream.writer) {
+        while (out->size() < limit) {
+            if (stream.chunk_index >= stream.chunks.size()) {
+                stream.chunks.clear();
+                stream.chunk_index = 0;
+                stream.chunk_offset = 0;
+                bool closed = false;
+                stream.writer->Take(&stream.chunks, &closed);
+                if (stream.chunks.empty()) {
+                    *end = closed;
+                    break;
+                }
+            }
+            const std::string& chunk = stream.chunks[stream.chunk_index];
+            size_t n = std::min(chunk.size() - stream.chunk_offset, limit - out->size());
+            out->append(chunk, stream.chunk_offset, n);
+            stream.chunk_offset += n;
+            if (stream.chunk_offset == chunk.size()) {
+                ++stream.chunk_index;
+                stream.chunk_offset = 0;
+            }
+        }
+        return true;
+    }
+
+    /* 文件 */
+    if (stream.file) {
+        while (out->size() < limit && stream.segment_index < stream.segments.size()) {
+            const FileBodySegment& segment = stream.segments[stream.segment_index];
+            if (!stream.segment_started) {
+                stream.segment_started = true;
+                stream.prefix_offset = 0;
+                stream.offset = segment.offset;
+                stream.remaining = segment.length;
+            }
+            if (stream.prefix_offset < segment.prefix.size()) {
+                size_t n = std::min(segment.prefix.size() - stream.prefix_offset, limit - out->size());
+                out->append(segment.prefix, stream.prefix_offset, n);
+                stream.prefix_offset += n;
+                continue;
+            }
+            if (stream.remaining == 0) {
+                ++stream.segment_index;
+                stream.segment_started = false;
+                continue;
+            }
+            size_t n = (size_t)std::min<uint64_t>(stream.remaining, limit - out->size());
+            if (!stream.file_data) {
+                if (!ReadFileData(stream, n, out)) {
+                    return false;
+                }
+                continue;
+            }
+            out->append(stream.file_data + stream.offset, n);
+            stream.offset += n;
+            stream.remaining -= n;
+        }
+        *end = stream.segment_index >= stream.segments.size();
+        return true;
+    }
+
+    /* 文本 */
+    size_t n = std::min(stream.data.size() - stream.data_offset, max_size);
+    out->append(stream.data, stream.data_offset, n);
+    stream.data_offset += n;
+    *end = stream.data_offset == stream.data.size();
+    return true;
+}
+
+/**
+ * @brief 从文件读取当前段的内容(内容不在内存中时)，不将整个文件读入内存.
+ *
+ * @param size 最多读取的字节数
+ */
+bool Http2Session::ReadFileData(Http2Stream& stream, size_t size, std::string* out) {
+    beast::error_code ec;
+    if (!stream.read_file.is_open()) {
+        stream.read_file.open(stream.file->path.c_str(), beast::file_mode::read, ec);  /* `path`是UTF8编码 */
+    }
+    size_t n = 0;
+    size_t old_size = out->size();
+    if (!ec) {
+        stream.read_file.seek(stream.offset, ec);
+    }
+    if (!ec) {
+        out->resize(old_size + size);
+        n = stream.read_file.read(&(*out)[old_size], size, ec);
+        if (!ec && n == 0) {
+            ec = net::error::eof;  /* 文件在发送过程中被截断 */
+        }
+    }
+    out->resize(old_size + n);
+    if (ec) {
+        svr_->logger()->Error(LOG_CTX, "Read file '%s' failed, %s", stream.file->path.c_str(), ec.message().c_str());
+        return false;
+    }
+    stream.offset += n;
+    stream.remaining -= n;
+    return true;
+}
+
+/**
+ * @brief 响应发送完毕(或者流被重置)，移除该流.
+ *
+ * @details 请求body尚未接收完毕时，通知对端不必继续发送(RST_STREAM NO_ERROR).
+ * @details 流对象可能仍在调用栈中使用，之后再回收其请求对象.
+ */
+void Http2Session::CloseStream(const Http2StreamPtr& stream) {
+    auto it = streams_.find(stream->id);
+    if (it == streams_.end() || it->second != stream) {
+        return;
+    }
+    if (stream->remote_open) {
+        stream->remote_open = false;
+        char payload[4];
+        s_write_uint32(payload, kNoError);
+        QueueFrame(kRstStream, 0, stream->id, payload, sizeof(payload));
+    }
+    if (stream->writer) {
+        stream->writer->Abort();  /* 已经发送完毕时无影响 */
+    }
+    if (stream->heartbeat_timer) {
+        stream->heartbeat_timer->cancel();
+    }
+    if (stream->ex && stream->dispatched && !stream->ex->done) {
+        /* 请求仍在处理中，结束(`FinishRequest`)之前仍然计入并发流的数量 */
+        ++num_detached_streams_;
+    }
+    if (stream->ex) {
+        Session::RecordMetrics(svr_, stream->ex, stream->body_received);
+    }
+    streams_.erase(it);
+    closed_streams_.push_back(stream);
+    if (streams_.empty()) {
+        last_active_ = std::chrono::steady_clock::now();
+        if (goaway_received_) {
+            read_closed_ = true;
+            closing_ = true;
+        }
+    }
+}
+
+void Http2Session::ResetStream(uint32_t stream_id, uint32_t error_code) {
+    char payload[4];
+    s_write_uint32(payload, error_code);
+    QueueFrame(kRstStream, 0, stream_id, payload, sizeof(payload));
+    auto it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+        Http2StreamPtr stream = it->second;
+        stream->remote_open = false;
+        CloseStream(stream);
+    }
+}
+
+/**
+ * @brief 连接关闭，丢弃所有的流(不发送RST_STREAM).
+ */
+void Http2Session::ResetAllStreams() {
+    while (!streams_.empty()) {
+        Http2StreamPtr stream = streams_.begin()->second;
+        stream->remote_open = false;
+        CloseStream(stream);
+    }
+}
+
+/**
+ * @brief 连接错误，发送GOAWAY后关闭连接.
+ *
+ * @return false
+ */
+bool Http2Session::ConnectionError(uint32_t error_code, const char* reason) {
+    svr_->logger()->Debug(LOG_CTX, "HTTP/2 connection error %u, %s", error_code, reason);
+    GoAway(error_code);
+    read_closed_ = true;
+    closing_ = true;
+    ResetAllStreams();
+    return false;
+}
+
+void Http2Session::GoAway(uint32_t error_code) {
+    if (goaway_sent_) {
+        return;
+    }
+    goaway_sent_ = true;
+    char payload[8];
+    s_write_uint32(payload, last_stream_id_);
+    s_write_uint32(payload + 4, error_code);
+    QueueFrame(kGoAway, 0, 0, payload, sizeof(payload));
+}
+
+void Http2Session::QueueFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const char* payload, size_t length) {
+    char header[kHttp2FrameHeaderSize];
+    s_write_frame_header(header, length, type, flags, stream_id);
+    write_queue_.append(header, sizeof(header));
+    if (length > 0) {
+        write_queue_.append(payload, length);
+    }
+}
+
+void Http2Session::QueueWindowUpdate(uint32_t stream_id, uint32_t increment) {
+    char payload[4];
+    s_write_uint32(payload, increment);
+    QueueFrame(kWindowUpdate, 0, stream_id, payload, sizeof(payload));
+}
+
+/**
+ * @brief 没有正在进行的发送时，取出各个流的内容，发送队列中的帧.
+ *
+ * @details 队列为空且需要关闭连接时，关闭连接.
+ */
+void Http2Session::Flush() {
+    if (writing_ || shutdown_) {
+        return;
+    }
+    if (write_queue_.size() < kHttp2MaxWriteBytes) {
+        FillDataFrames(kHttp2MaxWriteBytes - write_queue_.size());
+    }
+    RecycleClosedStreams();
+    if (write_queue_.empty()) {
+        if (closing_) {
+            DoShutdown();
+        }
+        return;
+    }
+    writing_ = true;
+    writing_data_.swap(write_queue_);
+    unsigned int tcp_stream_timeout_ms = svr_->config().tcp_stream_timeout_ms();
+    if (tcp_stream_timeout_ms > 0) {
+        stream_.expires_after(std::chrono::milliseconds(tcp_stream_timeout_ms));
+    }
+    else {
+        stream_.expires_never();
+    }
+    net::async_write(stream_, net::buffer(writing_data_),
+        beast::bind_front_handler(&Http2Session::OnWrite, shared_from_this()));
+}
+
+void Http2Session::OnWrite(beast::error_code ec, size_t/* bytes_transferred*/) {
+    writing_ = false;
+    writing_data_.clear();
+    if (writing_data_.capacity() > kHttp2MaxWriteBytes * 2) {
+        std::string().swap(writing_data_);
+    }
+    if (ec) {
+        svr_->logger()->Debug(LOG_CTX, "HTTP/2 write error, %s", ec.message().c_str());
+        read_closed_ = true;
+        closing_ = true;
+        write_queue_.clear();
+        ResetAllStreams();
+        RecycleClosedStreams();
+        return DoShutdown();
+    }
+    Flush();
+}
+
+/**
+ * @brief 关闭连接，挂起的读取随之结束.
+ *
+ * @details 帧自身有长度，TLS连接不发送`close_notify`(读取始终挂起，不能与关闭同时进行).
+ */
+void Http2Session::DoShutdown() {
+    if (shutdown_) {
+        return;
+    }
+    shutdown_ = true;
+    idle_timer_.cancel();
+    beast::error_code ec;
+    stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+    if (ec && ec != net::error::not_connected) {
+        svr_->logger()->Error(LOG_CTX, "Socket.ShutdownBoth failed, %s", ec.message().c_str());
+    }
+}
+
+/**
+ * @brief 回收已经不再使用的流的请求对象.
+ */
+void Http2Session::RecycleClosedStreams() {
+    size_t kept = 0;
+    for (size_t i = 0; i < closed_streams_.size(); ++i) {
+        Http2StreamPtr& stream = closed_streams_[i];
+        if (stream.use_count() > 1) {
+            if (kept != i) {
+                closed_streams_[kept] = std::move(stream);
+            }
+            ++kept;
+            continue;
+        }
+        RecycleExchange(std::move(stream->ex));
+    }
+    closed_streams_.resize(kept);
+}
+
+void Http2Session::StartIdleTimer(std::chrono::steady_clock::duration delay) {
+    auto self = shared_from_this();
+    idle_timer_.expires_after(delay);
+    idle_timer_.async_wait([self](beast::error_code ec) {
+        if (!ec) {
+            self->OnIdleTimer();
+        }
+    });
+}
+
+/**
+ * @brief 没有流的时间超过`tcp_stream_timeout_ms`时，发送GOAWAY关闭连接.
+ */
+void Http2Session::OnIdleTimer() {
+    if (shutdown_ || closing_) {
+        return;
+    }
+    auto timeout = std::chrono::steady_clock::duration(std::chrono::milliseconds(svr_->config().tcp_stream_timeout_ms()));
+    auto idle = std::chrono::steady_clock::now() - last_active_;
+    if (!streams_.empty()) {
+        return StartIdleTimer(timeout);
+    }
+    if (idle < timeout) {
+        return StartIdleTimer(timeout - idle);
+    }
+    svr_->logger()->Debug(LOG_CTX, "HTTP/2 session idle timeout");
+    GoAway(kNoError);
+    closing_ = true;
+    Flush();
+}
+
+/**
+ * @brief 获取一个空闲的(已回收的)请求对象.
+ */
+ExchangePtr Http2Session::AcquireExchange() {
+    if (free_exchanges_.empty()) {
+        return std::make_shared<Exchange>();
+    }
+    ExchangePtr ex = std::move(free_exchanges_.back());
+    free_exchanges_.pop_back();
+    return ex;
+}
+
+void Http2Session::RecycleExchange(ExchangePtr&& ex) {
+    if (ex && Session::ResetExchange(ex) && free_exchanges_.size() < kHttp2MaxFreeExchanges) {
+        free_exchanges_.push_back(std::move(ex));
+    }
+}
+
+} // namespace server
+} // namespace ic
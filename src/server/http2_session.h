@@ -0,0 +1,225 @@
+#ifndef IC_SERVER_HTTP2_SESSION_H_
+#define IC_SERVER_HTTP2_SESSION_H_
+#include <map>
+#include "hpack.h"
+#include "session.h"
+
+namespace ic {
+namespace server {
+
+/** 客户端连接前言(RFC 9113 3.4) */
+constexpr char kHttp2ClientPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr size_t kHttp2ClientPrefaceSize = sizeof(kHttp2ClientPreface) - 1;
+
+/** 帧头的长度 */
+constexpr size_t kHttp2FrameHeaderSize = 9;
+/** 接收的帧的最大长度(SETTINGS_MAX_FRAME_SIZE的默认值) */
+constexpr size_t kHttp2MaxFrameSize = 16384;
+/** 连接和每个流的接收窗口大小，消耗一半后归还(WINDOW_UPDATE) */
+constexpr uint32_t kHttp2ReceiveWindowSize = 1024 * 1024;
+/** 请求头(解压后)的最大大小(SETTINGS_MAX_HEADER_LIST_SIZE) */
+constexpr size_t kHttp2MaxHeaderListSize = 64 * 1024;
+/** 每次写入最多合并的数据帧的大小，发送完毕后再从各个流取出下一批内容(背压) */
+constexpr size_t kHttp2MaxWriteBytes = 256 * 1024;
+/** 回收后保留的请求对象的数量上限 */
+constexpr size_t kHttp2MaxFreeExchanges = 16;
+/** 每秒最多接受的对端重置的流(RST_STREAM)的数量，超出时发送GOAWAY(ENHANCE_YOUR_CALM)关闭连接 */
+constexpr uint32_t kHttp2MaxClientResetsPerSecond = 200;
+
+/**
+ * @brief HTTP/2连接上的一个流(一次请求和对应的响应).
+ */
+struct Http2Stream {
+    uint32_t id{0};
+    ExchangePtr ex;
+    /** 对端是否还会发送DATA(请求body尚未接收完毕) */
+    bool remote_open{true};
+    /** 请求是否已经交给路由处理 */
+    bool dispatched{false};
+    /** 响应头之后是否还有内容要发送 */
+    bool sending_body{false};
+    /** 发送窗口 */
+    int64_t send_window{0};
+    /** 接收窗口 */
+    int64_t recv_window{kHttp2ReceiveWindowSize};
+    /** 请求body的大小限制(优先使用路由的设置) */
+    uint64_t body_limit{0};
+    uint64_t body_received{0};
+    /** 请求头中的`content-length`，-1表示没有 */
+    int64_t content_length{-1};
+    /** 收到的DATA的总长度(不含填充)，结束时需要与`content_length`一致 */
+    uint64_t data_received{0};
+
+    /* 响应内容: 文本 */
+    std::string data;
+    size_t data_offset{0};
+    /* 响应内容: 文件(依次发送各段) */
+    CachedFilePtr file;
+    std::shared_ptr<const std::string> content;
+    /** 发送的内容在内存中时指向其起始位置，否则从文件读取 */
+    const char* file_data{nullptr};
+    std::vector<FileBodySegment> segments;
+    size_t segment_index{0};
+    /** 当前段的前缀已经发送的长度 */
+    size_t prefix_offset{0};
+    bool segment_started{false};
+    uint64_t offset{0};
+    uint64_t remaining{0};
+    beast::file read_file;
+    /* 响应内容: 流式响应 */
+    std::shared_ptr<ResponseWriter> writer;
+    std::vector<std::string> chunks;
+    size_t chunk_index{0};
+    size_t chunk_offset{0};
+    std::unique_ptr<net::steady_timer> heartbeat_timer;
+    std::string heartbeat;
+    unsigned int heartbeat_interval_ms{0};
+    std::chrono::steady_clock::time_point last_sent;
+};
+
+using Http2StreamPtr = std::shared_ptr<Http2Stream>;
+
+/**
+ * @brief HTTP/2会话(由`Session`在ALPN协商为`h2`，或收到h2c的连接前言后移交TCP/TLS连接).
+ *
+ * @details 每个流按照普通请求处理: 请求头经HPACK解码后填入原始请求对象，之后匹配路由、执行拦截器和回调函数，
+ * @details 阻塞型路由同样在处理线程池中执行，路由的回调函数无需区分HTTP/1.1和HTTP/2.
+ * @details 读取始终挂起；响应头和控制帧放入发送队列，数据帧在发送时按照流量控制窗口从各个流轮流取出(不支持服务器推送和优先级).
+ * @details 没有流时空闲超过`tcp_stream_timeout_ms`则发送GOAWAY关闭连接，发送也受其限制.
+ */
+class Http2Session : public std::enable_shared_from_this<Http2Session> {
+public:
+    Http2Session(SessionStream&& stream, HttpServer* svr, const tcp::endpoint& remote_endpoint);
+    ~Http2Session();
+
+    /**
+     * @param buffer `Session`已经读取、尚未解析的数据(可能包括连接前言)
+     */
+    void Run(beast::flat_buffer&& buffer);
+
+private:
+    enum FrameType : uint8_t {
+        kData = 0x0,
+        kHeaders = 0x1,
+        kPriority = 0x2,
+        kRstStream = 0x3,
+        kSettings = 0x4,
+        kPushPromise = 0x5,
+        kPing = 0x6,
+        kGoAway = 0x7,
+        kWindowUpdate = 0x8,
+        kContinuation = 0x9
+    };
+
+    enum ErrorCode : uint32_t {
+        kNoError = 0x0,
+        kProtocolError = 0x1,
+        kInternalError = 0x2,
+        kFlowControlError = 0x3,
+        kStreamClosed = 0x5,
+        kFrameSizeError = 0x6,
+        kRefusedStream = 0x7,
+        kCancel = 0x8,
+        kCompressionError = 0x9,
+        kEnhanceYourCalm = 0xb
+    };
+
+    void DoRead();
+    void OnRead(beast::error_code ec, size_t bytes_transferred);
+    bool ProcessFrames();
+    bool OnFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length);
+    bool OnDataFrame(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length);
+    bool OnHeadersFrame(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length);
+    bool OnSettingsFrame(uint8_t flags, const uint8_t* payload, size_t length);
+    bool OnWindowUpdateFrame(uint32_t stream_id, const uint8_t* payload, size_t length);
+    bool OnHeaderBlock(uint32_t stream_id, bool end_stream);
+    void OpenStream(uint32_t stream_id, std::vector<HpackHeader>& headers, bool end_stream);
+    void DispatchStream(const Http2StreamPtr& stream);
+    void HandleRequest(uint32_t stream_id, const ExchangePtr& ex, bool in_handler_pool);
+    void OnHandleRequestDone(uint32_t stream_id, const ExchangePtr& ex);
+    void DispatchToHandlerPool(uint32_t stream_id, const ExchangePtr& ex);
+    void FinishRequest(uint32_t stream_id, const ExchangePtr& ex);
+    void SendResponse(const Http2StreamPtr& stream);
+    void SendResponseHeaders(const Http2StreamPtr& stream, bool has_length, uint64_t content_length, bool end_stream);
+    void AttachStreamWriter(const Http2StreamPtr& stream);
+    void StartStreamHeartbeat(uint32_t stream_id, std::chrono::steady_clock::duration delay);
+    void OnStreamHeartbeat(uint32_t stream_id);
+    size_t FillDataFrames(size_t budget);
+    bool ReadStreamData(Http2Stream& stream, size_t max_size, std::string* out, bool* end);
+    bool ReadFileData(Http2Stream& stream, size_t size, std::string* out);
+    void CloseStream(const Http2StreamPtr& stream);
+    void ResetStream(uint32_t stream_id, uint32_t error_code);
+    void ResetAllStreams();
+    bool ConnectionError(uint32_t error_code, const char* reason);
+    void GoAway(uint32_t error_code);
+    void QueueFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const char* payload, size_t length);
+    void QueueWindowUpdate(uint32_t stream_id, uint32_t increment);
+    void Flush();
+    void OnWrite(beast::error_code ec, size_t bytes_transferred);
+    void DoShutdown();
+    void RecycleClosedStreams();
+    void StartIdleTimer(std::chrono::steady_clock::duration delay);
+    void OnIdleTimer();
+    ExchangePtr AcquireExchange();
+    void RecycleExchange(ExchangePtr&& ex);
+
+private:
+    HttpServer* svr_{nullptr};
+    SessionStream stream_;
+    tcp::endpoint remote_endpoint_;
+    std::string client_ip_;
+    beast::flat_buffer read_buffer_;
+    /** 已经校验的连接前言的长度 */
+    size_t preface_received_{0};
+    bool settings_received_{false};
+    bool reading_{false};
+    /** 不再读取(对端关闭、出错或者连接错误) */
+    bool read_closed_{false};
+    /** 发送完队列中的帧后关闭连接 */
+    bool closing_{false};
+    bool shutdown_{false};
+    bool goaway_sent_{false};
+    bool goaway_received_{false};
+
+    HpackDecoder decoder_;
+    HpackEncoder encoder_;
+    /** 正在接收的头部块(HEADERS + CONTINUATION) */
+    std::string header_block_;
+    uint32_t header_block_stream_id_{0};
+    bool header_block_end_stream_{false};
+
+    std::map<uint32_t, Http2StreamPtr> streams_;
+    /** 已经关闭、尚未回收的流(可能仍在调用栈中使用，之后回收其请求对象) */
+    std::vector<Http2StreamPtr> closed_streams_;
+    /** 已经关闭(如被对端重置)、但请求仍在处理中的流的数量，同样计入并发流的数量上限 */
+    uint32_t num_detached_streams_{0};
+    /** 对端重置的流的数量(每秒清零) */
+    uint32_t num_client_resets_{0};
+    std::chrono::steady_clock::time_point client_resets_window_;
+    /** 对端打开的最大的流ID */
+    uint32_t last_stream_id_{0};
+    /** 上一次发送数据帧的流ID(各个流轮流发送) */
+    uint32_t last_data_stream_id_{0};
+    std::vector<ExchangePtr> free_exchanges_;
+
+    /** 对端的设置 */
+    uint32_t peer_initial_window_size_{65535};
+    uint32_t peer_max_frame_size_{16384};
+    /** 连接的发送窗口和接收窗口 */
+    int64_t send_window_{65535};
+    int64_t recv_window_{kHttp2ReceiveWindowSize};
+
+    /** 等待发送的帧(连续存放，一次写入，TLS连接不会拆分为许多小的记录) */
+    std::string write_queue_;
+    /** 正在发送的帧 */
+    std::string writing_data_;
+    bool writing_{false};
+
+    net::steady_timer idle_timer_;
+    std::chrono::steady_clock::time_point last_active_;
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_HTTP2_SESSION_H_
@@ -4,11 +4,18 @@
 #include "server/http_server.h"
 #include "server/logger.h"
 #include "server/request.h"
+#include "server/response.h"
 #include "server/router.h"
 #include "server/util/format_time.h"
 #include "server/util/path.h"
 #include "server/util/thread.h"
+#include "access_log.h"
+#include "file_cache.h"
+#include "handler_pool.h"
 #include "listener.h"
+#include "metrics.h"
+#include "request_registry.h"
+#include "tls_context.h"
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 
@@ -72,8 +79,32 @@ HttpServer::HttpServer(const HttpServerConfig& config, std::shared_ptr<ILogger>
     if (!logger_) {
         logger_ = std::make_shared<ConsoleLogger>(LogLevel::kInfo, LogLevel::kWarn);
     }
-    ioc_ = std::make_shared<net::io_context>(config.max_num_threads());
+    io_context_per_thread_ = config_.io_context_per_thread();
+    if (io_context_per_thread_ && !Listener::IsReusePortSupported()) {
+        logger_->Warn(LOG_CTX, "SO_REUSEPORT is not supported on this platform, all worker threads will share one io_context");
+        io_context_per_thread_ = false;
+    }
+    if (io_context_per_thread_) {
+        /* 每个io_context只由一个线程运行，concurrency_hint=1 可以省去调度器内部的部分加锁 */
+        for (uint32_t i = 0; i < config_.max_num_threads() && i < NUM_THREADS_LIMIT; ++i) {
+            iocs_.push_back(std::make_shared<net::io_context>(1));
+        }
+    }
+    else {
+        iocs_.push_back(std::make_shared<net::io_context>(config.max_num_threads()));
+    }
     router_ = std::make_shared<Router>(this);
+    if (config_.handler_pool_num_threads() > 0) {
+        handler_pool_ = std::make_shared<HandlerPool>(config_.handler_pool_num_threads(), config_.handler_pool_queue_limit());
+    }
+    file_cache_ = std::make_shared<FileCache>(config_.file_cache_max_files(), config_.file_cache_check_interval_ms(),
+        config_.file_cache_max_content_size(), config_.file_cache_max_memory());
+    if (!config_.access_log_file().empty()) {
+        access_log_ = std::make_shared<AccessLogWriter>(config_.access_log_file(), config_.access_log_file_size(),
+            config_.access_log_max_files(), logger_);
+    }
+    unmatched_metrics_ = std::make_shared<RouteMetrics>();
+    handling_requests_ = std::make_shared<RequestRegistry>();
 }
 
 HttpServer::~HttpServer() {
@@ -131,31 +162,39 @@ bool HttpServer::StartAsync() {
         }
 
         /* 启动监听器 */
-        auto& endpoints = config_.endpoints();
-        for (size_t i = 0; i < endpoints.size(); ++i) {
-            auto listener = std::make_shared<Listener>(this);
-            if (!listener->Run(endpoints[i].ip, endpoints[i].port, endpoints[i].reuse_address)) {
-                logger_->Error(LOG_CTX, "Listener start failed");
-                listeners_.clear();
-                return false;
-            }
-            listeners_.push_back(listener);
-        }
-        for (size_t i = 0; i < endpoints.size(); ++i) {
-            /* 如果配置的端口为0，会任意选择一个可用端口，需要获取到该端口 */
-            if (endpoints[i].port == 0) {
-                endpoints[i].port = listeners_[i]->acceptor().local_endpoint().port();
-            }
+        if (!StartListeners()) {
+            listeners_.clear();
+            return false;
         }
 
         is_running_ = true;
         should_stop_ = false;
     }
 
+    /* 内置的统计数据路由 */
+    const std::string& metrics_path = config_.metrics_path();
+    if (config_.metrics_enabled() && !metrics_path.empty() && !router_->GetRoute(metrics_path)) {
+        router_->AddStaticRoute(metrics_path, HttpMethod::kGET | HttpMethod::kHEAD, [this](Request&, Response& res) {
+            res.SetStringBody(200U, CreateMetrics(), "text/plain; version=0.0.4; charset=utf-8");
+        }, "Prometheus metrics");
+    }
+
     logger_->Info(LOG_CTX, "HttpServer started!");
 
-    /* 启动最低数量的工作线程 */
-    NewWorkerThreads(config_.min_num_threads());
+    if (handler_pool_) {
+        handler_pool_->Start();
+    }
+
+    if (io_context_per_thread_) {
+        /* 每个io_context各一个工作线程，线程数量固定 */
+        for (auto& ioc : iocs_) {
+            NewWorkerThread(ioc.get());
+        }
+    }
+    else {
+        /* 启动最低数量的工作线程 */
+        NewWorkerThreads(config_.min_num_threads());
+    }
 
     /* 启动管理者线程 */
     std::thread t([this] {
@@ -179,10 +218,13 @@ void HttpServer::Stop() {
  */
 void HttpServer::StopAsync() {
     std::lock_guard<std::mutex> lck(mutex_server_state_);
-    if (is_running_) {
+    if (is_running_ && !should_stop_) {
         logger_->Info(LOG_CTX, "Waiting for %u worker threads to exit ...", (uint32_t)curr_num_worker_threads_);
         should_stop_ = true;
-        ioc_->stop();
+        for (auto& ioc : iocs_) {
+            ioc->stop();
+        }
+        NotifyManager();
     }
 }
 
@@ -192,8 +234,8 @@ void HttpServer::StopAsync() {
 void HttpServer::WaitForStop() {
     {
         /* 禁止在工作线程中调用该函数，否则服务器永远无法退出 */
-        std::lock_guard<std::mutex> lck(mutex_server_state_);
-        if (worker_thread_ids_.find(util::thread_id()) != worker_thread_ids_.end()) {
+        std::lock_guard<std::mutex> lck(mutex_worker_threads_);
+        if (worker_thread_ids_.find(util::thread_id()) != worker_thread_ids_.end() || (handler_pool_ && handler_pool_->InPoolThread())) {
             logger_->Warn(LOG_CTX,
                 "DO NOT CALL HttpServer::Stop() or HttpServer::WaitForStop() in worker thread(id=%" PRIu64 "). "
                 "Use HttpServer::StopAsync() instead.",
@@ -224,23 +266,20 @@ SnapshotResult HttpServer::CreateSnapshot() {
     snapshot.curr_num_worker_threads = curr_num_worker_threads_;
     snapshot.total_num_sessions = total_num_sessions_;
     snapshot.total_num_requests = total_num_requests_;
-    {
-        std::lock_guard<std::mutex> lck(mutex_requests_);
+    snapshot.handling_request.reserve(curr_num_handling_requests_);
+    handling_requests_->ForEach([&snapshot](const Request& req) {
         SnapshotResult::RequestInfo req_info;
-        snapshot.handling_request.reserve(handling_requests_.size());
-        for (Request* req : handling_requests_) {
-            req_info.thread_id = req->thread_id();
-            req_info.id = req->id();
-            req_info.method = req->method();
-            req_info.content_type = req->content_type();
-            req_info.route = req->route();
-            req_info.arrive_timepoint = req->arrive_timepoint();
-            req_info.path = req->path();
-            req_info.client_ip = req->client_ip();
-            req_info.client_real_ip = req->client_real_ip();
-            snapshot.handling_request.push_back(req_info);
-        }
-    }
+        req_info.thread_id = req.thread_id();
+        req_info.id = req.id();
+        req_info.method = req.method();
+        req_info.content_type = req.content_type();
+        req_info.route = req.route();
+        req_info.arrive_timepoint = req.arrive_timepoint();
+        req_info.path = req.path();
+        req_info.client_ip = req.client_ip();
+        req_info.client_real_ip = req.client_real_ip();
+        snapshot.handling_request.push_back(std::move(req_info));
+    });
     std::sort(snapshot.handling_request.begin(), snapshot.handling_request.end(), [](SnapshotResult::RequestInfo& a, SnapshotResult::RequestInfo& b) {
         return a.arrive_timepoint < b.arrive_timepoint;
     });
@@ -248,97 +287,339 @@ SnapshotResult HttpServer::CreateSnapshot() {
 }
 
 /**
- * @brief 创建新的工作线程.
+ * @brief 启动监听器.
  * @note 调用该函数前，已经对`mutex_server_state_`进行加锁.
  */
+bool HttpServer::StartListeners() {
+    auto& endpoints = config_.endpoints();
+    /* 全部启动成功后才替换`tls_contexts_`(证书的重新加载可能同时在其他线程中进行) */
+    std::vector<std::shared_ptr<TlsContext>> tls_contexts;
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        std::shared_ptr<TlsContext> tls_ctx;
+        if (endpoints[i].tls()) {
+#if IC_SERVER_USE_OPENSSL == 1
+            tls_ctx = std::make_shared<TlsContext>(endpoints[i].cert_file, endpoints[i].key_file,
+                config_.tls_session_cache_size(), config_.tls_session_timeout_s(), config_.http2_enabled());
+            std::string error;
+            if (!tls_ctx->Load(true, &error)) {
+                logger_->Error(LOG_CTX, "%s", error.c_str());
+                return false;
+            }
+#else
+            logger_->Error(LOG_CTX, "TLS is not supported (IC_SERVER_USE_OPENSSL=0), endpoint %s:%hu", endpoints[i].ip.c_str(), endpoints[i].port);
+            return false;
+#endif
+        }
+        tls_contexts.push_back(tls_ctx);
+
+        if (!io_context_per_thread_) {
+            auto listener = std::make_shared<Listener>(this, *iocs_[0], false, tls_ctx);
+            if (!listener->Run(endpoints[i].ip, endpoints[i].port, endpoints[i].reuse_address)) {
+                logger_->Error(LOG_CTX, "Listener start failed");
+                return false;
+            }
+            listeners_.push_back(listener);
+        }
+        else {
+            /* 每个io_context各自监听一次，由内核在这些监听器之间分配新连接 */
+            for (auto& ioc : iocs_) {
+                auto listener = std::make_shared<Listener>(this, *ioc, true, tls_ctx);
+                if (!listener->Run(endpoints[i].ip, endpoints[i].port, endpoints[i].reuse_address, true)) {
+                    logger_->Error(LOG_CTX, "Listener start failed");
+                    return false;
+                }
+                listeners_.push_back(listener);
+                /* 如果配置的端口为0，会任意选择一个可用端口，其余监听器需要绑定到同一端口 */
+                if (endpoints[i].port == 0) {
+                    endpoints[i].port = listener->acceptor().local_endpoint().port();
+                }
+            }
+            logger_->Info(LOG_CTX, "Listening on %s:%hu ... (%u listeners with SO_REUSEPORT)",
+                endpoints[i].ip.c_str(), endpoints[i].port, (uint32_t)iocs_.size());
+        }
+        /* 如果配置的端口为0，会任意选择一个可用端口，需要获取到该端口 */
+        if (endpoints[i].port == 0) {
+            endpoints[i].port = listeners_.back()->acceptor().local_endpoint().port();
+        }
+    }
+
+    std::lock_guard<std::mutex> lck(mutex_tls_contexts_);
+    tls_contexts_.swap(tls_contexts);
+    return true;
+}
+
+/**
+ * @brief 获取统计数据(Prometheus文本格式).
+ */
+std::string HttpServer::CreateMetrics() {
+    MetricsExporter exporter;
+    exporter.AddValue("http_server_sessions", "gauge", "Current number of sessions.", curr_num_sessions_);
+    exporter.AddValue("http_server_worker_threads", "gauge", "Current number of worker threads.", curr_num_worker_threads_);
+    exporter.AddValue("http_server_sessions_total", "counter", "Total number of sessions.", total_num_sessions_);
+    exporter.AddValue("http_server_requests_total", "counter", "Total number of requests.", total_num_requests_);
+    if (config_.metrics_enabled()) {
+        for (const auto& pair : router_->routes()) {
+            exporter.AddRoute(pair.first, *pair.second->metrics());
+        }
+        exporter.AddRoute("", *unmatched_metrics_);
+    }
+    return exporter.ToString();
+}
+
+/**
+ * @brief 重新加载所有TLS监听地址的证书和私钥.
+ */
+bool HttpServer::ReloadTlsCertificates() {
+    return LoadTlsCertificates(true);
+}
+
+/**
+ * @brief 加载TLS证书.
+ */
+bool HttpServer::LoadTlsCertificates(bool force) {
+    bool ok = true;
+#if IC_SERVER_USE_OPENSSL == 1
+    std::vector<std::shared_ptr<TlsContext>> tls_contexts;
+    {
+        std::lock_guard<std::mutex> lck(mutex_tls_contexts_);
+        tls_contexts = tls_contexts_;
+    }
+    for (auto& tls_ctx : tls_contexts) {
+        if (!tls_ctx) {
+            continue;
+        }
+        auto old_ctx = tls_ctx->get();
+        std::string error;
+        if (!tls_ctx->Load(force, &error)) {
+            logger_->Error(LOG_CTX, "Reload TLS certificate failed, %s", error.c_str());
+            ok = false;
+        }
+        else if (tls_ctx->get() != old_ctx) {
+            logger_->Info(LOG_CTX, "TLS certificate reloaded: %s", tls_ctx->cert_file().c_str());
+        }
+    }
+#endif
+    return ok;
+}
+
+/**
+ * @brief 轮换TLS会话票据的密钥.
+ */
+void HttpServer::RotateTlsTicketKeys() {
+#if IC_SERVER_USE_OPENSSL == 1
+    std::vector<std::shared_ptr<TlsContext>> tls_contexts;
+    {
+        std::lock_guard<std::mutex> lck(mutex_tls_contexts_);
+        tls_contexts = tls_contexts_;
+    }
+    for (auto& tls_ctx : tls_contexts) {
+        if (tls_ctx && !tls_ctx->RotateTicketKeys()) {
+            logger_->Error(LOG_CTX, "Rotate TLS session ticket keys failed: %s", tls_ctx->cert_file().c_str());
+        }
+    }
+#endif
+}
+
+/**
+ * @brief 创建新的工作线程.
+ */
 void HttpServer::NewWorkerThreads(uint32_t n) {
     logger_->Debug(LOG_CTX, "Starting %u worker threads. (sessions:%u, threads:%u)", n, (uint32_t)curr_num_sessions_, (uint32_t)curr_num_worker_threads_ + n);
     for (uint32_t i = 0; i < n; ++i) {
-        ++curr_num_worker_threads_;
-        std::thread t([this] {
-            this->ThreadFunc_Worker();
-            if (this->cb_before_worker_thread_exit_) {
-                this->cb_before_worker_thread_exit_();
-            }
-        });
-        t.detach();
+        NewWorkerThread(iocs_[0].get());
     }
 }
 
+/**
+ * @brief 创建新的工作线程，运行指定的io_context.
+ */
+void HttpServer::NewWorkerThread(net::io_context* ioc) {
+    ++curr_num_worker_threads_;
+    std::thread t([this, ioc] {
+        this->ThreadFunc_Worker(ioc);
+    });
+    t.detach();
+}
+
 /**
  * @brief 工作线程.
+ *
+ * @note 热路径上不加锁，只在线程启动和退出时访问`worker_thread_ids_`.
  */
-void HttpServer::ThreadFunc_Worker() {
+void HttpServer::ThreadFunc_Worker(net::io_context* ioc) {
     const size_t tid = util::thread_id();
     logger_->Debug(LOG_CTX, "Worker thread start. (id=%" PRIu64 ")", (uint64_t)tid);
     {
-        std::lock_guard<std::mutex> lck(mutex_server_state_);
+        std::lock_guard<std::mutex> lck(mutex_worker_threads_);
         worker_thread_ids_.emplace(tid);
     }
 
     /* 上次活跃时间 */
     auto last_active_time = std::chrono::steady_clock::now();
-    /* 是否需要退出当前线程 */
-    bool exit = false;
-
-    while (true) {
-        size_t n = ioc_->run_for(std::chrono::milliseconds(1000));
+    /* 是否因空闲而退出 */
+    bool retired = false;
 
-        std::lock_guard<std::mutex> lck(mutex_server_state_);
+    while (!should_stop_) {
+        size_t n = ioc->run_for(std::chrono::milliseconds(1000));
         if (should_stop_) {
-            exit = true;
+            break;
         }
-        else if (n > 0) {
+        if (n > 0) {
             last_active_time = std::chrono::steady_clock::now();
         }
-        else if (curr_num_worker_threads_ > config_.min_num_threads() && curr_num_worker_threads_ > curr_num_sessions_) {
-            /* 超过一定时间未活跃，结束当前线程 */
-            int64_t dur = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - last_active_time).count();
-            if (dur > 5000) {
-                exit = true;
-            }
-        }
-
-        if (exit) {
-            logger_->Debug(LOG_CTX, "Worker thread exit. (id=%" PRIu64 ") (sessions:%u, threads:%u)", (uint64_t)tid, (uint32_t)curr_num_sessions_, (uint32_t)curr_num_worker_threads_);
-            --curr_num_worker_threads_;
-            worker_thread_ids_.erase(tid);
+        else if (!io_context_per_thread_ && TryRetireWorkerThread(last_active_time)) {
+            retired = true;
             break;
         }
     } // end while
+
+    logger_->Debug(LOG_CTX, "Worker thread exit. (id=%" PRIu64 ") (sessions:%u, threads:%u)", (uint64_t)tid, (uint32_t)curr_num_sessions_, (uint32_t)curr_num_worker_threads_);
+    {
+        std::lock_guard<std::mutex> lck(mutex_worker_threads_);
+        worker_thread_ids_.erase(tid);
+    }
+    if (cb_before_worker_thread_exit_) {
+        cb_before_worker_thread_exit_();
+    }
+    /* 在锁内减少计数，保证管理者线程确认所有线程退出时，当前线程不再访问服务器对象 */
+    std::lock_guard<std::mutex> lck(mutex_manager_);
+    if (retired) {
+        --num_retiring_worker_threads_;
+    }
+    if (--curr_num_worker_threads_ == 0) {
+        cv_manager_.notify_one();
+    }
+}
+
+/**
+ * @brief 工作线程空闲时间过长，尝试退出该线程.
+ *
+ * @return 是否需要退出该线程(线程计数在线程结束时减少)
+ */
+bool HttpServer::TryRetireWorkerThread(const std::chrono::steady_clock::time_point& last_active_time) {
+    auto idle_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - last_active_time).count();
+    if (idle_ms <= (int64_t)config_.thread_scale_down_idle_ms()) {
+        return false;
+    }
+    /* 扣除已经决定退出的线程，避免多个线程同时退出后低于下限 */
+    std::lock_guard<std::mutex> lck(mutex_manager_);
+    uint32_t num_threads = curr_num_worker_threads_ - num_retiring_worker_threads_;
+    if (num_threads > config_.min_num_threads() && num_threads > curr_num_sessions_) {
+        ++num_retiring_worker_threads_;
+        return true;
+    }
+    return false;
 }
 
 /**
  * @brief 管理者线程.
+ *
+ * @details 平时阻塞在条件变量上，由`RequestScaleUp()`立即唤醒进行扩容.
  */
 void HttpServer::ThreadFunc_Manager() {
+    const auto cooldown = std::chrono::milliseconds(config_.thread_scale_up_cooldown_ms());
+    auto last_scale_up_time = std::chrono::steady_clock::now() - cooldown;
+    const auto tls_cert_check_interval = std::chrono::milliseconds(config_.tls_cert_check_interval_ms());
+    auto last_tls_cert_check_time = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lck(mutex_manager_);
     while (true) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        cv_manager_.wait_for(lck, std::chrono::seconds(1), [this] {
+            return should_stop_ ? curr_num_worker_threads_ == 0 : scale_up_requested_.load();
+        });
 
-        std::lock_guard<std::mutex> lck(mutex_server_state_);
         if (should_stop_) {
             if (curr_num_worker_threads_ == 0) {
-                logger_->Info(LOG_CTX, "HttpServer stopped!");
-                is_running_ = false;
                 break;
             }
+            continue;
+        }
+
+        /* 检查TLS证书是否更新(加载失败时下次检查再重试)，轮换会话票据的密钥(期间不持有锁，不影响扩容请求) */
+        lck.unlock();
+        if (tls_cert_check_interval.count() > 0 && std::chrono::steady_clock::now() - last_tls_cert_check_time >= tls_cert_check_interval) {
+            LoadTlsCertificates(false);
+            last_tls_cert_check_time = std::chrono::steady_clock::now();
+        }
+        RotateTlsTicketKeys();
+        lck.lock();
+
+        if (io_context_per_thread_) {
+            scale_up_requested_ = false;
+            continue;
+        }
+
+        /* 冷却时间内不重复扩容 */
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_scale_up_time < cooldown) {
+            cv_manager_.wait_for(lck, cooldown - (now - last_scale_up_time), [this] { return should_stop_.load(); });
+            continue;
         }
-        else if ((curr_num_sessions_ > curr_num_worker_threads_ || curr_num_handling_requests_ == curr_num_worker_threads_) &&
-                 curr_num_worker_threads_ < config_.max_num_threads())
-        {
-            /* 扩容为1.5倍, 单次最多32个线程, 且扩容后总线程数量不能超过最大限制 */
-            uint32_t inc_num_threads = s_clamp(curr_num_worker_threads_ / 2U, 1U, std::min(32U, config_.max_num_threads() - curr_num_worker_threads_));
+        scale_up_requested_ = false;
+
+        if (NeedScaleUp()) {
+            /* 扩容为1.5倍, 单次最多`thread_scale_max_step`个线程, 且扩容后总线程数量不能超过最大限制 */
+            uint32_t max_step = std::max(1U, config_.thread_scale_max_step());
+            uint32_t inc_num_threads = s_clamp(curr_num_worker_threads_ / 2U, 1U, std::min(max_step, config_.max_num_threads() - curr_num_worker_threads_));
             NewWorkerThreads(inc_num_threads);
+            last_scale_up_time = std::chrono::steady_clock::now();
             if (curr_num_worker_threads_ == config_.max_num_threads()) {
                 logger_->Debug(LOG_CTX, "Number of worker threads has reached the peak(%u)", config_.max_num_threads());
             }
         }
     } // end while
+    lck.unlock();
+
+    if (handler_pool_) {
+        handler_pool_->Stop();
+    }
+    if (access_log_) {
+        access_log_->Close();
+    }
+    logger_->Info(LOG_CTX, "HttpServer stopped!");
+    is_running_ = false;
+}
+
+/**
+ * @brief 是否需要扩容.
+ */
+bool HttpServer::NeedScaleUp() const {
+    uint32_t num_threads = curr_num_worker_threads_;
+    if (num_threads >= config_.max_num_threads()) {
+        return false;
+    }
+    return curr_num_sessions_ > num_threads ||
+        (uint64_t)curr_num_handling_requests_ * 100U >= (uint64_t)num_threads * config_.thread_scale_up_busy_percent();
+}
+
+/**
+ * @brief 请求管理者线程立即扩容.
+ *
+ * @note 只有在扩容请求尚未被处理时才会加锁通知，热路径上只有一次原子读.
+ */
+void HttpServer::RequestScaleUp() {
+    if (io_context_per_thread_ || scale_up_requested_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (!scale_up_requested_.exchange(true)) {
+        NotifyManager();
+    }
+}
+
+/**
+ * @brief 唤醒管理者线程.
+ */
+void HttpServer::NotifyManager() {
+    std::lock_guard<std::mutex> lck(mutex_manager_);
+    cv_manager_.notify_one();
 }
 
 void HttpServer::OnNewSession() {
-    ++curr_num_sessions_;
+    uint32_t num_sessions = ++curr_num_sessions_;
     ++total_num_sessions_;
+    if (num_sessions > curr_num_worker_threads_) {
+        RequestScaleUp();
+    }
 }
 
 void HttpServer::OnDestroySession() {
@@ -346,16 +627,29 @@ void HttpServer::OnDestroySession() {
 }
 
 void HttpServer::OnStartHandlingRequest(Request* req) {
-    std::lock_guard<std::mutex> lck(mutex_requests_);
-    handling_requests_.emplace(req);
-    ++curr_num_handling_requests_;
+    req->registry_slot_ = handling_requests_->Register(req);
+    uint32_t num_handling = ++curr_num_handling_requests_;
     ++total_num_requests_;
+    if ((uint64_t)num_handling * 100U >= (uint64_t)curr_num_worker_threads_ * config_.thread_scale_up_busy_percent()) {
+        RequestScaleUp();
+    }
 }
 
 void HttpServer::OnFinishHandlingRequest(Request* req) {
-    std::lock_guard<std::mutex> lck(mutex_requests_);
-    handling_requests_.erase(req);
-    --curr_num_handling_requests_;
+    /* 已经结束(如处理线程池停止时取消的请求)，重复调用时忽略 */
+    if (!req->registry_slot_) {
+        return;
+    }
+    handling_requests_->Unregister(req->registry_slot_);
+    req->registry_slot_ = nullptr;
+    uint32_t num_handling = curr_num_handling_requests_--;
+    /* 处理耗时超过延迟目标，且半数以上线程正忙 */
+    uint32_t latency_target_ms = config_.thread_scale_latency_target_ms();
+    if (latency_target_ms > 0 && num_handling * 2U >= curr_num_worker_threads_ &&
+        req->time_consumed_handle() > std::chrono::milliseconds(latency_target_ms))
+    {
+        RequestScaleUp();
+    }
 }
 
 } // namespace server
@@ -62,10 +62,43 @@ bool HttpServerConfig::ReadFromFile(const std::string& filename) {
 
     CHECK_UINT(root, "min_num_threads", min_num_threads_);
     CHECK_UINT(root, "max_num_threads", max_num_threads_);
+    CHECK_UINT(root, "thread_scale_up_busy_percent", thread_scale_up_busy_percent_);
+    CHECK_UINT(root, "thread_scale_up_cooldown_ms", thread_scale_up_cooldown_ms_);
+    CHECK_UINT(root, "thread_scale_down_idle_ms", thread_scale_down_idle_ms_);
+    CHECK_UINT(root, "thread_scale_max_step", thread_scale_max_step_);
+    CHECK_UINT(root, "thread_scale_latency_target_ms", thread_scale_latency_target_ms_);
+    CHECK_UINT(root, "handler_pool_num_threads", handler_pool_num_threads_);
+    CHECK_UINT(root, "handler_pool_queue_limit", handler_pool_queue_limit_);
     CHECK_BOOL(root, "log_access", log_access_);
     CHECK_BOOL(root, "log_access_verbose", log_access_verbose_);
+    CHECK_STRING(root, "access_log_file", access_log_file_);
+    CHECK_UINT64(root, "access_log_file_size", access_log_file_size_);
+    CHECK_UINT(root, "access_log_max_files", access_log_max_files_);
+    CHECK_BOOL(root, "metrics_enabled", metrics_enabled_);
+    /* 允许为空(不添加内置路由)，不使用CHECK_STRING */
+    if (!root["metrics_path"].isNull()) {
+        if (!root["metrics_path"].isString()) {
+            ERROR_KEY("metrics_path");
+        }
+        metrics_path_ = root["metrics_path"].asString();
+    }
     CHECK_UINT(root, "tcp_stream_timeout_ms", tcp_stream_timeout_ms_);
     CHECK_UINT64(root, "body_limit", body_limit_);
+    CHECK_UINT(root, "max_pipeline_depth", max_pipeline_depth_);
+    CHECK_BOOL(root, "io_context_per_thread", io_context_per_thread_);
+    CHECK_BOOL(root, "use_sendfile", use_sendfile_);
+    CHECK_UINT(root, "file_cache_max_files", file_cache_max_files_);
+    CHECK_UINT(root, "file_cache_check_interval_ms", file_cache_check_interval_ms_);
+    CHECK_UINT(root, "file_cache_max_content_size", file_cache_max_content_size_);
+    CHECK_UINT64(root, "file_cache_max_memory", file_cache_max_memory_);
+    CHECK_BOOL(root, "compression_enabled", compression_enabled_);
+    CHECK_UINT(root, "compression_min_size", compression_min_size_);
+    CHECK_UINT(root, "compression_level", compression_level_);
+    CHECK_UINT(root, "tls_session_cache_size", tls_session_cache_size_);
+    CHECK_UINT(root, "tls_session_timeout_s", tls_session_timeout_s_);
+    CHECK_UINT(root, "tls_cert_check_interval_ms", tls_cert_check_interval_ms_);
+    CHECK_BOOL(root, "http2_enabled", http2_enabled_);
+    CHECK_UINT(root, "http2_max_concurrent_streams", http2_max_concurrent_streams_);
     CHECK_STRING(root, "version", version_);
 
     auto& v_endpoints = root["endpoints"];
@@ -89,6 +122,11 @@ bool HttpServerConfig::ReadFromFile(const std::string& filename) {
             ERROR_KEY("port");
         }
         endpoints_[i].port = (unsigned short)port;
+        CHECK_STRING(v_endpoints[i], "cert_file", endpoints_[i].cert_file);
+        CHECK_STRING(v_endpoints[i], "key_file", endpoints_[i].key_file);
+        if (endpoints_[i].cert_file.empty() != endpoints_[i].key_file.empty()) {
+            ERROR_KEY(endpoints_[i].cert_file.empty() ? "cert_file" : "key_file");
+        }
     }
 
     return true;
@@ -124,16 +162,47 @@ Json::Value HttpServerConfig::ToJson() const {
     Json::Value root;
     root["min_num_threads"] = min_num_threads_;
     root["max_num_threads"] = max_num_threads_;
+    root["thread_scale_up_busy_percent"] = thread_scale_up_busy_percent_;
+    root["thread_scale_up_cooldown_ms"] = thread_scale_up_cooldown_ms_;
+    root["thread_scale_down_idle_ms"] = thread_scale_down_idle_ms_;
+    root["thread_scale_max_step"] = thread_scale_max_step_;
+    root["thread_scale_latency_target_ms"] = thread_scale_latency_target_ms_;
+    root["handler_pool_num_threads"] = handler_pool_num_threads_;
+    root["handler_pool_queue_limit"] = handler_pool_queue_limit_;
     root["log_access"] = log_access_;
     root["log_access_verbose"] = log_access_verbose_;
+    root["access_log_file"] = access_log_file_;
+    root["access_log_file_size"] = access_log_file_size_;
+    root["access_log_max_files"] = access_log_max_files_;
+    root["metrics_enabled"] = metrics_enabled_;
+    root["metrics_path"] = metrics_path_;
     root["tcp_stream_timeout_ms"] = tcp_stream_timeout_ms_;
     root["body_limit"] = body_limit_;
+    root["max_pipeline_depth"] = max_pipeline_depth_;
+    root["io_context_per_thread"] = io_context_per_thread_;
+    root["use_sendfile"] = use_sendfile_;
+    root["file_cache_max_files"] = file_cache_max_files_;
+    root["file_cache_check_interval_ms"] = file_cache_check_interval_ms_;
+    root["file_cache_max_content_size"] = file_cache_max_content_size_;
+    root["file_cache_max_memory"] = file_cache_max_memory_;
+    root["compression_enabled"] = compression_enabled_;
+    root["compression_min_size"] = compression_min_size_;
+    root["compression_level"] = compression_level_;
+    root["tls_session_cache_size"] = tls_session_cache_size_;
+    root["tls_session_timeout_s"] = tls_session_timeout_s_;
+    root["tls_cert_check_interval_ms"] = tls_cert_check_interval_ms_;
+    root["http2_enabled"] = http2_enabled_;
+    root["http2_max_concurrent_streams"] = http2_max_concurrent_streams_;
     root["version"] = version_;
     for (const auto& endpoint : endpoints_) {
         Json::Value v_endpoint;
         v_endpoint["ip"] = endpoint.ip;
         v_endpoint["port"] = (unsigned int)endpoint.port;
         v_endpoint["reuse_address"] = endpoint.reuse_address;
+        if (endpoint.tls()) {
+            v_endpoint["cert_file"] = endpoint.cert_file;
+            v_endpoint["key_file"] = endpoint.key_file;
+        }
         root["endpoints"].append(v_endpoint);
     }
     return root;
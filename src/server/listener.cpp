@@ -1,17 +1,35 @@
 #include "listener.h"
 #include "session.h"
+#include "tls_context.h"
 #include "server/http_server.h"
 #include <boost/asio/strand.hpp>
 
 namespace ic {
 namespace server {
 
-Listener::Listener(HttpServer* svr)
-    : svr_(svr), is_running_(false), acceptor_(net::make_strand(*(svr_->ioc_)))
+#ifdef SO_REUSEPORT
+using reuse_port_option = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
+Listener::Listener(HttpServer* svr, net::io_context& ioc, bool exclusive, std::shared_ptr<TlsContext> tls_ctx/* = nullptr*/)
+    : svr_(svr), ioc_(ioc), exclusive_(exclusive), is_running_(false),
+      acceptor_(exclusive ? tcp::acceptor(ioc) : tcp::acceptor(net::make_strand(ioc))),
+      tls_ctx_(tls_ctx)
 {
 }
 
-bool Listener::Run(const std::string& ip, unsigned short port, bool reuse_address) {
+/**
+ * @brief 当前平台是否支持`SO_REUSEPORT`.
+ */
+bool Listener::IsReusePortSupported() {
+#ifdef SO_REUSEPORT
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Listener::Run(const std::string& ip, unsigned short port, bool reuse_address, bool reuse_port/* = false*/) {
     beast::error_code ec;
     net::ip::address address = net::ip::make_address(ip, ec);
     if (ec) {
@@ -33,6 +51,18 @@ bool Listener::Run(const std::string& ip, unsigned short port, bool reuse_addres
         return false;
     }
 
+    if (reuse_port) {
+#ifdef SO_REUSEPORT
+        acceptor_.set_option(reuse_port_option(true), ec);
+#else
+        ec = net::error::operation_not_supported;
+#endif
+        if (ec) {
+            svr_->logger()->Error(LOG_CTX, "reuse port failed, %s", ec.message().c_str());
+            return false;
+        }
+    }
+
     acceptor_.bind(endpoint, ec);
     if (ec) {
         svr_->logger()->Error(LOG_CTX, "bind address %s:%hu failed", endpoint.address().to_string().c_str(), endpoint.port());
@@ -45,7 +75,12 @@ bool Listener::Run(const std::string& ip, unsigned short port, bool reuse_addres
         return false;
     }
 
-    svr_->logger()->Info(LOG_CTX, "Listening on %s:%hu ...", endpoint.address().to_string().c_str(), endpoint.port());
+    if (reuse_port) {
+        svr_->logger()->Debug(LOG_CTX, "Listening on %s:%hu (SO_REUSEPORT) ...", endpoint.address().to_string().c_str(), acceptor_.local_endpoint().port());
+    }
+    else {
+        svr_->logger()->Info(LOG_CTX, "Listening on %s:%hu ...", endpoint.address().to_string().c_str(), endpoint.port());
+    }
     DoAccept();
 
     is_running_ = true;
@@ -53,10 +88,19 @@ bool Listener::Run(const std::string& ip, unsigned short port, bool reuse_addres
 }
 
 void Listener::DoAccept() {
-    acceptor_.async_accept(
-        net::make_strand(*(svr_->ioc_)),
-        beast::bind_front_handler(&Listener::OnAccept, shared_from_this())
-    );
+    if (exclusive_) {
+        /* io_context只由一个线程运行，会话无需strand */
+        acceptor_.async_accept(
+            ioc_,
+            beast::bind_front_handler(&Listener::OnAccept, shared_from_this())
+        );
+    }
+    else {
+        acceptor_.async_accept(
+            net::make_strand(ioc_),
+            beast::bind_front_handler(&Listener::OnAccept, shared_from_this())
+        );
+    }
 }
 
 void Listener::OnAccept(beast::error_code ec, tcp::socket socket) {
@@ -67,8 +111,14 @@ void Listener::OnAccept(beast::error_code ec, tcp::socket socket) {
     if (ec) {
         svr_->logger()->Error(LOG_CTX, "OnAccept error, %s", ec.message().c_str());
     }
+#if IC_SERVER_USE_OPENSSL == 1
+    else if (tls_ctx_) {
+        /* 每个连接持有接受时的证书，之后重新加载证书不影响该连接 */
+        std::make_shared<Session>(SessionStream(std::move(socket), tls_ctx_->get()), svr_)->Run();
+    }
+#endif
     else {
-        std::make_shared<Session>(std::move(socket), svr_)->Run();
+        std::make_shared<Session>(SessionStream(std::move(socket)), svr_)->Run();
     }
     DoAccept();
 }
@@ -11,16 +11,29 @@ namespace net = boost::asio;            // from <boost/asio.hpp>
 using tcp = net::ip::tcp;               // from <boost/asio/ip/tcp.hpp>
 
 class HttpServer;
+class TlsContext;
 
 /**
  * @brief 监听器，接受连接请求.
  */
 class Listener : public std::enable_shared_from_this<Listener> {
 public:
-    Listener(HttpServer* svr);
+    /**
+     * @brief 构造函数.
+     * @param svr 服务器对象
+     * @param ioc 监听器及其接受的会话所使用的io_context
+     * @param exclusive 该io_context是否只由一个线程运行(无需strand)
+     * @param tls_ctx TLS监听地址的证书，为空表示普通TCP连接
+     */
+    Listener(HttpServer* svr, net::io_context& ioc, bool exclusive, std::shared_ptr<TlsContext> tls_ctx = nullptr);
     ~Listener() = default;
 
-    bool Run(const std::string& ip, unsigned short port, bool reuse_address);
+    bool Run(const std::string& ip, unsigned short port, bool reuse_address, bool reuse_port = false);
+
+    /**
+     * @brief 当前平台是否支持`SO_REUSEPORT`.
+     */
+    static bool IsReusePortSupported();
 
     bool is_running() const { return is_running_; }
     const tcp::acceptor& acceptor() const { return acceptor_; }
@@ -31,8 +44,11 @@ private:
 
 private:
     HttpServer* svr_;
+    net::io_context& ioc_;
+    bool exclusive_;
     bool is_running_;
     tcp::acceptor acceptor_;
+    std::shared_ptr<TlsContext> tls_ctx_;
 };
 
 } // namesapce server
@@ -0,0 +1,243 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "server/util/thread.h"
+
+namespace ic {
+namespace server {
+
+static const char* const s_status_classes[kMetricsNumStatusClasses] = { "1xx", "2xx", "3xx", "4xx", "5xx" };
+
+static const struct {
+    const char* name;
+    const char* help;
+} s_latencies[kMetricsNumLatencies] = {
+    { "http_server_request_queue_seconds", "Time from request arrival to the start of the route handler." },
+    { "http_server_request_handle_seconds", "Time spent in the route handler." },
+    { "http_server_response_write_seconds", "Time from response ready to response written." }
+};
+
+/*******************************************************************
+**
+**                          RouteMetrics
+**
+*******************************************************************/
+
+RouteMetrics::RouteMetrics() {
+    for (auto& shard : shards_) {
+        shard.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+RouteMetrics::~RouteMetrics() {
+    for (auto& shard : shards_) {
+        delete shard.load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 获取当前线程的分片，第一次写入时分配.
+ */
+RouteMetrics::Shard* RouteMetrics::GetShard() {
+    auto& slot = shards_[util::thread_index() % kMetricsNumShards];
+    Shard* shard = slot.load(std::memory_order_acquire);
+    if (shard) {
+        return shard;
+    }
+    Shard* new_shard = new Shard;
+    memset((void*)new_shard, 0, sizeof(Shard));
+    if (slot.compare_exchange_strong(shard, new_shard, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return new_shard;
+    }
+    /* 共用该分片的其他线程已经分配 */
+    delete new_shard;
+    return shard;
+}
+
+/**
+ * @brief 记录一个请求.
+ */
+void RouteMetrics::Observe(unsigned int status, const int64_t (&latencies_us)[kMetricsNumLatencies], uint64_t bytes_in, uint64_t bytes_out) {
+    size_t status_class = std::min<size_t>(std::max(status / 100, 1U), kMetricsNumStatusClasses) - 1;
+    Shard* shard = GetShard();
+    for (size_t i = 0; i < kMetricsNumLatencies; ++i) {
+        if (latencies_us[i] < 0) {
+            continue;
+        }
+        uint64_t us = (uint64_t)latencies_us[i];
+        size_t bucket = std::lower_bound(kMetricsBucketBoundsUs, kMetricsBucketBoundsUs + kMetricsNumBounds, us) - kMetricsBucketBoundsUs;
+        Histogram& histogram = shard->histograms[status_class][i];
+        histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        histogram.sum_us.fetch_add(us, std::memory_order_relaxed);
+    }
+    shard->bytes_in[status_class].fetch_add(bytes_in, std::memory_order_relaxed);
+    shard->bytes_out[status_class].fetch_add(bytes_out, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 汇总所有分片.
+ */
+void RouteMetrics::Collect(RouteMetricsSnapshot* snapshot) const {
+    memset(snapshot, 0, sizeof(RouteMetricsSnapshot));
+    for (const auto& slot : shards_) {
+        const Shard* shard = slot.load(std::memory_order_acquire);
+        if (!shard) {
+            continue;
+        }
+        for (size_t c = 0; c < kMetricsNumStatusClasses; ++c) {
+            for (size_t i = 0; i < kMetricsNumLatencies; ++i) {
+                const Histogram& histogram = shard->histograms[c][i];
+                for (size_t b = 0; b < kMetricsNumBuckets; ++b) {
+                    snapshot->buckets[c][i][b] += histogram.buckets[b].load(std::memory_order_relaxed);
+                }
+                snapshot->sum_us[c][i] += histogram.sum_us.load(std::memory_order_relaxed);
+            }
+            snapshot->bytes_in[c] += shard->bytes_in[c].load(std::memory_order_relaxed);
+            snapshot->bytes_out[c] += shard->bytes_out[c].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/*******************************************************************
+**
+**                        MetricsExporter
+**
+*******************************************************************/
+
+/**
+ * @brief 转义标签的值(反斜杠、双引号、换行).
+ */
+static std::string s_escape_label(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.length());
+    for (char ch : value) {
+        switch (ch) {
+        case '\\': escaped += "\\\\"; break;
+        case '"':  escaped += "\\\""; break;
+        case '\n': escaped += "\\n"; break;
+        default:   escaped += ch; break;
+        }
+    }
+    return escaped;
+}
+
+static void s_append_header(std::string* out, const char* name, const char* type, const char* help) {
+    *out += "# HELP ";
+    *out += name;
+    *out += ' ';
+    *out += help;
+    *out += "\n# TYPE ";
+    *out += name;
+    *out += ' ';
+    *out += type;
+    *out += '\n';
+}
+
+static void s_append_sample(std::string* out, const char* name, const char* suffix, const std::string& labels, const char* le, uint64_t value) {
+    char buf[32];
+    *out += name;
+    *out += suffix;
+    *out += '{';
+    *out += labels;
+    if (le) {
+        *out += ",le=\"";
+        *out += le;
+        *out += '"';
+    }
+    *out += "} ";
+    snprintf(buf, sizeof(buf), "%llu\n", (unsigned long long)value);
+    *out += buf;
+}
+
+/**
+ * @brief 添加一个路由的统计数据.
+ */
+void MetricsExporter::AddRoute(const std::string& route, const RouteMetrics& metrics) {
+    routes_.emplace_back();
+    routes_.back().label = s_escape_label(route);
+    metrics.Collect(&routes_.back().snapshot);
+}
+
+/**
+ * @brief 添加一个不区分路由的指标.
+ */
+void MetricsExporter::AddValue(const char* name, const char* type, const char* help, uint64_t value) {
+    values_.push_back(ValueEntry{ name, type, help, value });
+}
+
+std::string MetricsExporter::ToString() const {
+    std::string out;
+    char buf[64];
+    for (const auto& value : values_) {
+        s_append_header(&out, value.name, value.type, value.help);
+        snprintf(buf, sizeof(buf), " %llu\n", (unsigned long long)value.value);
+        out += value.name;
+        out += buf;
+    }
+
+    /* 桶的上界(单位:秒) */
+    std::vector<std::string> les;
+    for (uint64_t bound : kMetricsBucketBoundsUs) {
+        snprintf(buf, sizeof(buf), "%g", bound / 1000000.0);
+        les.push_back(buf);
+    }
+    les.push_back("+Inf");
+
+    for (size_t i = 0; i < kMetricsNumLatencies; ++i) {
+        const char* name = s_latencies[i].name;
+        s_append_header(&out, name, "histogram", s_latencies[i].help);
+        for (const auto& route : routes_) {
+            for (size_t c = 0; c < kMetricsNumStatusClasses; ++c) {
+                const uint64_t* buckets = route.snapshot.buckets[c][i];
+                uint64_t count = 0;
+                for (size_t b = 0; b < kMetricsNumBuckets; ++b) {
+                    count += buckets[b];
+                }
+                /* 没有请求的状态码分类不输出 */
+                if (count == 0) {
+                    continue;
+                }
+                std::string labels = "route=\"" + route.label + "\",status=\"" + s_status_classes[c] + '"';
+                uint64_t cumulative = 0;
+                for (size_t b = 0; b < kMetricsNumBuckets; ++b) {
+                    cumulative += buckets[b];
+                    s_append_sample(&out, name, "_bucket", labels, les[b].c_str(), cumulative);
+                }
+                out += name;
+                out += "_sum{";
+                out += labels;
+                snprintf(buf, sizeof(buf), "} %.6f\n", route.snapshot.sum_us[c][i] / 1000000.0);
+                out += buf;
+                s_append_sample(&out, name, "_count", labels, nullptr, count);
+            }
+        }
+    }
+
+    static const struct {
+        const char* name;
+        const char* help;
+        bool in;
+    } s_bytes[] = {
+        { "http_server_request_bytes_total", "Total size of request bodies.", true },
+        { "http_server_response_bytes_total", "Total size of response bodies (unknown for streaming responses).", false }
+    };
+    for (const auto& bytes : s_bytes) {
+        s_append_header(&out, bytes.name, "counter", bytes.help);
+        for (const auto& route : routes_) {
+            for (size_t c = 0; c < kMetricsNumStatusClasses; ++c) {
+                /* 与直方图一致，没有请求的状态码分类不输出(queue总是统计) */
+                const uint64_t* buckets = route.snapshot.buckets[c][kMetricsQueue];
+                if (std::all_of(buckets, buckets + kMetricsNumBuckets, [](uint64_t n) { return n == 0; })) {
+                    continue;
+                }
+                std::string labels = "route=\"" + route.label + "\",status=\"" + s_status_classes[c] + '"';
+                s_append_sample(&out, bytes.name, "", labels, nullptr, bytes.in ? route.snapshot.bytes_in[c] : route.snapshot.bytes_out[c]);
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace server
+} // namespace ic
@@ -0,0 +1,138 @@
+#ifndef IC_SERVER_METRICS_H_
+#define IC_SERVER_METRICS_H_
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ic {
+namespace server {
+
+/** 耗时直方图的桶的上界(单位:微秒，每个数量级1-2.5-5三个桶)，最后还有一个+Inf桶 */
+constexpr uint64_t kMetricsBucketBoundsUs[] = {
+    10, 25, 50, 100, 250, 500,
+    1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000,
+    10000000, 25000000, 50000000, 100000000
+};
+constexpr size_t kMetricsNumBounds = sizeof(kMetricsBucketBoundsUs) / sizeof(kMetricsBucketBoundsUs[0]);
+constexpr size_t kMetricsNumBuckets = kMetricsNumBounds + 1;
+
+/** 按照状态码分类(1xx ~ 5xx) */
+constexpr size_t kMetricsNumStatusClasses = 5;
+
+/** 每个路由最多的分片数量(线程按照序号分配到各个分片) */
+constexpr size_t kMetricsNumShards = 16;
+
+/**
+ * @brief 统计的耗时.
+ */
+enum MetricsLatency {
+    /** 从请求到达(读取请求头)到开始执行回调函数，包括接收body、在处理线程池中排队 */
+    kMetricsQueue = 0,
+    /** 回调函数的执行时间(异步路由直到调用`ResponseCompletion`) */
+    kMetricsHandle,
+    /** 从响应内容准备好到发送完毕，包括等待之前的管线化请求发送完毕 */
+    kMetricsWrite,
+    kMetricsNumLatencies
+};
+
+/**
+ * @brief 一个路由的统计数据(汇总之后).
+ */
+struct RouteMetricsSnapshot {
+    uint64_t buckets[kMetricsNumStatusClasses][kMetricsNumLatencies][kMetricsNumBuckets];
+    uint64_t sum_us[kMetricsNumStatusClasses][kMetricsNumLatencies];
+    uint64_t bytes_in[kMetricsNumStatusClasses];
+    uint64_t bytes_out[kMetricsNumStatusClasses];
+};
+
+/**
+ * @brief 一个路由的统计数据(延迟直方图、请求和响应body的大小).
+ *
+ * @details 数据分散在多个分片中，每个线程固定写入其中一个分片(线程数量不超过分片数量时互不竞争)，
+ * @details 分片在线程第一次写入时分配，写入只有relaxed原子加法，不加锁.
+ * @details 读取时汇总所有分片(各个计数器之间不是严格一致的快照).
+ */
+class RouteMetrics {
+public:
+    RouteMetrics();
+    ~RouteMetrics();
+
+    RouteMetrics(const RouteMetrics&) = delete;
+    RouteMetrics& operator=(const RouteMetrics&) = delete;
+
+    /**
+     * @brief 记录一个请求.
+     *
+     * @param status 响应状态码
+     * @param latencies_us 各项耗时(单位:微秒)，负数表示不统计该项
+     * @param bytes_in 请求body的大小
+     * @param bytes_out 响应body的大小
+     */
+    void Observe(unsigned int status, const int64_t (&latencies_us)[kMetricsNumLatencies], uint64_t bytes_in, uint64_t bytes_out);
+
+    /**
+     * @brief 汇总所有分片.
+     */
+    void Collect(RouteMetricsSnapshot* snapshot) const;
+
+private:
+    struct Histogram {
+        std::atomic<uint64_t> buckets[kMetricsNumBuckets];
+        std::atomic<uint64_t> sum_us;
+    };
+
+    struct Shard {
+        Histogram histograms[kMetricsNumStatusClasses][kMetricsNumLatencies];
+        std::atomic<uint64_t> bytes_in[kMetricsNumStatusClasses];
+        std::atomic<uint64_t> bytes_out[kMetricsNumStatusClasses];
+    };
+
+    Shard* GetShard();
+
+private:
+    std::atomic<Shard*> shards_[kMetricsNumShards];
+};
+
+/**
+ * @brief 生成Prometheus文本格式(text exposition format 0.0.4)的统计数据.
+ *
+ * @details 同一指标的所有样本连续输出，因此先收集所有路由的数据，最后一起格式化.
+ */
+class MetricsExporter {
+public:
+    /**
+     * @brief 添加一个路由的统计数据.
+     * @param route 路由路径(空字符串表示没有匹配的路由)
+     */
+    void AddRoute(const std::string& route, const RouteMetrics& metrics);
+
+    /**
+     * @brief 添加一个不区分路由的指标.
+     * @param type `gauge`或`counter`
+     */
+    void AddValue(const char* name, const char* type, const char* help, uint64_t value);
+
+    std::string ToString() const;
+
+private:
+    struct RouteEntry {
+        std::string label;
+        RouteMetricsSnapshot snapshot;
+    };
+    struct ValueEntry {
+        const char* name;
+        const char* type;
+        const char* help;
+        uint64_t value;
+    };
+
+    std::vector<RouteEntry> routes_;
+    std::vector<ValueEntry> values_;
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_METRICS_H_
@@ -12,8 +12,8 @@ static constexpr size_t STR_LEN_ContentDisposition = 19;
 static const char* STR_ContentType = "content-type";
 static constexpr size_t STR_LEN_ContentType = 12;
 
-MultipartParser::MultipartParser(const std::string& body, std::shared_ptr<ILogger> logger)
-    : body_{ body.data(), body.size() }, logger_(logger)
+MultipartParser::MultipartParser(const std::string& body, std::shared_ptr<ILogger> logger, util::Arena* arena/* = nullptr*/)
+    : body_{ body.data(), body.size() }, logger_(logger), arena_(arena)
 {
 }
 
@@ -22,6 +22,11 @@ MultipartParser::MultipartParser(StringView body)
 {
 }
 
+MultipartParser::MultipartParser(std::shared_ptr<ILogger> logger)
+    : logger_(logger)
+{
+}
+
 bool MultipartParser::Parse(const std::string& boundary, std::multimap<std::string, const FormParam*>* result) {
     result->clear();
 
@@ -32,9 +37,14 @@ bool MultipartParser::Parse(const std::string& boundary, std::multimap<std::stri
     }
 
     for (const auto& part : parts) {
-        FormParam* value = new FormParam();
+        FormParam* value = arena_ ? new (arena_->Allocate(sizeof(FormParam), alignof(FormParam))) FormParam() : new FormParam();
         if (!Parse_Part(part, value)) {
-            delete value;
+            if (arena_) {
+                value->~FormParam();
+            }
+            else {
+                delete value;
+            }
             return false;
         }
         result->emplace(value->name(), value);
@@ -133,11 +143,21 @@ bool MultipartParser::Parse_Part(const Part& part, FormParam* form_param) const
         (这里是文件的内容，可能是二进制数据)
         ------WebKitFormBoundary7MA4YWxkTrZu0gW--
     */
+    if (!ParsePartHeaders(part.header_lines, form_param)) {
+        return false;
+    }
+    form_param->set_content(part.content);
+    return true;
+}
 
+/**
+ * @brief 解析一个part的头部(Content-Disposition、Content-Type).
+ */
+bool MultipartParser::ParsePartHeaders(const std::vector<StringView>& header_lines, FormParam* form_param) const {
     /* 解析Content-Disposition和Content-Type */
     bool has_content_disposition = false;
     bool has_content_type = false;
-    for (const auto& header_line : part.header_lines) {
+    for (const auto& header_line : header_lines) {
         if (!has_content_disposition && header_line.CompareNoCase(STR_ContentDisposition, STR_LEN_ContentDisposition) == 0) { // Content-Disposition
             has_content_disposition = true;
             if (!Parse_Part_ContentDisposition(header_line, form_param)) {
@@ -157,8 +177,6 @@ bool MultipartParser::Parse_Part(const Part& part, FormParam* form_param) const
             return false;
         }
     }
-
-    form_param->set_content(part.content);
     return true;
 }
 
@@ -6,6 +6,7 @@
 #include "server/form_param.h"
 #include "server/logger.h"
 #include "server/string_view.h"
+#include "server/util/arena.h"
 
 namespace ic {
 namespace server {
@@ -20,11 +21,23 @@ struct Part {
  */
 class MultipartParser {
 public:
-    MultipartParser(const std::string& body, std::shared_ptr<ILogger> logger);
+    /**
+     * @param arena 表单项从内存池分配(可选，为nullptr时使用new)
+     */
+    MultipartParser(const std::string& body, std::shared_ptr<ILogger> logger, util::Arena* arena = nullptr);
     MultipartParser(StringView body);
+    /**
+     * @brief 只用于解析part的头部(`ParsePartHeaders`)，如增量解析时.
+     */
+    explicit MultipartParser(std::shared_ptr<ILogger> logger);
 
     bool Parse(const std::string& boundary, std::multimap<std::string, const FormParam*>* result);
 
+    /**
+     * @brief 解析一个part的头部(Content-Disposition、Content-Type).
+     */
+    bool ParsePartHeaders(const std::vector<StringView>& header_lines, FormParam* form_param) const;
+
 private:
     bool SplitToParts(const std::string& boundary, std::vector<Part>* parts) const;
 
@@ -35,6 +48,7 @@ private:
 private:
     const StringView body_;
     std::shared_ptr<ILogger> logger_;
+    util::Arena* arena_{nullptr};
 };
 
 } // namespace server
@@ -0,0 +1,314 @@
+#include "server/multipart_stream_parser.h"
+#include <atomic>
+#include <chrono>
+#include "server/http_server.h"
+#include "server/request.h"
+#include "server/response.h"
+#include "server/util/path.h"
+#include "multipart_parser.h"
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+namespace ic {
+namespace server {
+
+/** part头部每一行的最大长度(与`MultipartParser`相同) */
+static constexpr size_t kMaxHeaderLineLength = 1024;
+/** part头部的最大长度 */
+static constexpr size_t kMaxHeaderSize = 8192;
+
+static FILE* s_fopen_utf8(const std::string& path, const char* mode) {
+#ifdef _WIN32
+    auto to_wide = [](const std::string& str) {
+        int n = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), (int)str.length(), NULL, 0);
+        std::wstring wstr(n, 0);
+        MultiByteToWideChar(CP_UTF8, 0, str.c_str(), (int)str.length(), &wstr[0], n);
+        return wstr;
+    };
+    return _wfopen(to_wide(path).c_str(), to_wide(mode).c_str());
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
+
+/**
+ * @brief 生成临时文件名.
+ */
+static std::string s_make_temp_filename() {
+    static std::atomic<uint64_t> s_counter{0};
+    uint64_t ticks = (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    char buf[64];
+    snprintf(buf, sizeof(buf), "upload_%llx_%llx.tmp", (unsigned long long)ticks, (unsigned long long)++s_counter);
+    return buf;
+}
+
+MultipartStreamParser::MultipartStreamParser(const std::string& boundary, std::shared_ptr<ILogger> logger)
+    : delimiter_("\r\n--" + boundary), buffer_("\r\n"), logger_(logger), header_parser_(new MultipartParser(logger))
+{
+    /* 在数据之前补上CRLF，第一个分隔符与之后的分隔符按照同样的方式查找 */
+}
+
+MultipartStreamParser::~MultipartStreamParser() {
+    if (file_) {
+        fclose(file_);
+    }
+    for (const auto& file : files_) {
+        util::path::remove_file(file.path);
+    }
+}
+
+void MultipartStreamParser::set_upload_dir(const std::string& dir) {
+    upload_dir_ = util::path::format_dir(dir);
+}
+
+/**
+ * @brief 解析一块数据.
+ */
+bool MultipartStreamParser::Feed(const char* data, size_t size) {
+    if (state_ == State::kError) {
+        return false;
+    }
+    if (state_ == State::kDone) {
+        return true;  /* 忽略结束分隔符之后的内容 */
+    }
+    buffer_.append(data, size);
+
+    size_t pos = 0;
+    bool need_more = false;
+    while (!need_more) {
+        switch (state_) {
+        case State::kPreamble: {
+            /* 第一个分隔符之前的内容被忽略 */
+            size_t found = buffer_.find(delimiter_, pos);
+            if (found == std::string::npos) {
+                if (buffer_.size() - pos >= delimiter_.size()) {
+                    pos = buffer_.size() - delimiter_.size() + 1;
+                }
+                need_more = true;
+                break;
+            }
+            pos = found + delimiter_.size();
+            state_ = State::kBoundaryTail;
+            break;
+        }
+        case State::kBoundaryTail:
+            /* 分隔符之后是`--`(结束)，或者CRLF(下一个part) */
+            if (buffer_.size() - pos < 2) {
+                need_more = true;
+                break;
+            }
+            if (buffer_.compare(pos, 2, "--") == 0) {
+                state_ = State::kDone;
+                buffer_.clear();
+                return true;
+            }
+            if (buffer_.compare(pos, 2, "\r\n") != 0) {
+                return Fail("Invalid boundary");
+            }
+            pos += 2;
+            header_lines_.clear();
+            header_size_ = 0;
+            state_ = State::kHeaders;
+            break;
+        case State::kHeaders: {
+            size_t eol = buffer_.find("\r\n", pos);
+            if (eol == std::string::npos) {
+                if (buffer_.size() - pos > kMaxHeaderLineLength) {
+                    return Fail("Header line is too long");
+                }
+                need_more = true;
+                break;
+            }
+            if (eol == pos) {
+                /* 空行，头部结束 */
+                pos += 2;
+                if (!OnPartBegin()) {
+                    return false;
+                }
+                state_ = State::kData;
+                break;
+            }
+            header_size_ += eol - pos;
+            if (eol - pos > kMaxHeaderLineLength || header_size_ > kMaxHeaderSize) {
+                return Fail("Header of part is too large");
+            }
+            header_lines_.emplace_back(buffer_, pos, eol - pos);
+            pos = eol + 2;
+            break;
+        }
+        case State::kData: {
+            size_t found = buffer_.find(delimiter_, pos);
+            if (found == std::string::npos) {
+                /* 保留可能是分隔符开头的部分，其余的内容可以交出 */
+                size_t keep = delimiter_.size() - 1;
+                if (buffer_.size() - pos > keep) {
+                    size_t end = buffer_.size() - keep;
+                    if (!OnPartData(buffer_.data() + pos, end - pos)) {
+                        return false;
+                    }
+                    pos = end;
+                }
+                need_more = true;
+                break;
+            }
+            if (found > pos && !OnPartData(buffer_.data() + pos, found - pos)) {
+                return false;
+            }
+            pos = found + delimiter_.size();
+            if (!OnPartEnd()) {
+                return false;
+            }
+            state_ = State::kBoundaryTail;
+            break;
+        }
+        default:
+            need_more = true;
+            break;
+        }
+    }
+    buffer_.erase(0, pos);
+    return true;
+}
+
+bool MultipartStreamParser::Fail(const std::string& error) {
+    state_ = State::kError;
+    error_ = error;
+    buffer_.clear();
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+    if (logger_) {
+        logger_->Error(LOG_CTX, "Invalid multipart data. %s", error.c_str());
+    }
+    return false;
+}
+
+bool MultipartStreamParser::Abort(const char* callback) {
+    aborted_ = true;
+    state_ = State::kError;
+    error_ = std::string("Aborted by ") + callback;
+    buffer_.clear();
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+    return false;
+}
+
+/**
+ * @brief part的头部解析完毕.
+ */
+bool MultipartStreamParser::OnPartBegin() {
+    part_ = FormParam();
+    std::vector<StringView> header_lines;
+    for (const auto& line : header_lines_) {
+        header_lines.emplace_back(line.data(), line.size());
+    }
+    if (!header_parser_->ParsePartHeaders(header_lines, &part_)) {
+        return Fail("Invalid header of part");
+    }
+    if (on_part_begin_ && !on_part_begin_(part_)) {
+        return Abort("on_part_begin");
+    }
+    if (on_part_data_) {
+        return true;
+    }
+
+    if (!part_.is_file()) {
+        field_value_.clear();
+        return true;
+    }
+    if (upload_dir_.empty()) {
+        return Fail("Uploading file is not allowed");
+    }
+    File file;
+    file.name = part_.name();
+    file.filename = part_.filename();
+    file.content_type = part_.content_type();
+    file.path = upload_dir_ + s_make_temp_filename();
+    file_ = s_fopen_utf8(file.path, "wb");
+    if (!file_) {
+        return Fail("Create file failed: " + file.path);
+    }
+    files_.push_back(std::move(file));
+    return true;
+}
+
+bool MultipartStreamParser::OnPartData(const char* data, size_t size) {
+    if (on_part_data_) {
+        return on_part_data_(part_, data, size) || Abort("on_part_data");
+    }
+    if (part_.is_file()) {
+        if (fwrite(data, 1, size, file_) != size) {
+            return Fail("Write file failed: " + files_.back().path);
+        }
+        files_.back().size += size;
+        return true;
+    }
+    if (field_value_.size() + size > max_field_size_) {
+        return Fail("Field is too large: " + part_.name());
+    }
+    field_value_.append(data, size);
+    return true;
+}
+
+bool MultipartStreamParser::OnPartEnd() {
+    if (!on_part_data_) {
+        if (part_.is_file()) {
+            bool ok = fclose(file_) == 0;
+            file_ = nullptr;
+            if (!ok) {
+                return Fail("Write file failed: " + files_.back().path);
+            }
+        }
+        else {
+            fields_.emplace(part_.name(), std::move(field_value_));
+            field_value_.clear();
+        }
+    }
+    if (on_part_end_ && !on_part_end_(part_)) {
+        return Abort("on_part_end");
+    }
+    return true;
+}
+
+/**
+ * @brief 生成流式接收multipart/form-data的`Route::body_chunk_callback`.
+ */
+Route::BodyChunkCallback MultipartStreamParser::MakeBodyChunkCallback(SetupCallback setup) {
+    return [setup](Request& req, Response& res, const char* data, size_t size) {
+        MultipartStreamParser* parser = FromRequest(req);
+        if (!parser) {
+            const std::string& boundary = req.content_type().boundary();
+            if (!req.content_type().IsMultipartFormData() || boundary.empty()) {
+                res.SetBadRequest("Content-Type must be multipart/form-data");
+                return false;
+            }
+            auto created = std::make_shared<MultipartStreamParser>(boundary, req.svr()->logger());
+            req.multipart_stream_parser_ = created;
+            parser = created.get();
+            if (setup) {
+                setup(req, *parser);
+            }
+        }
+        if (!parser->Feed(data, size)) {
+            if (!parser->aborted_) {
+                res.SetBadRequest("Invalid multipart/form-data. " + parser->error());
+            }
+            return false;
+        }
+        return true;
+    };
+}
+
+/**
+ * @brief 获取`MakeBodyChunkCallback`附加到请求上的解析器.
+ */
+MultipartStreamParser* MultipartStreamParser::FromRequest(Request& req) {
+    return req.multipart_stream_parser_.get();
+}
+
+} // namespace server
+} // namespace ic
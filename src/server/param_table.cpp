@@ -0,0 +1,107 @@
+#include "server/param_table.h"
+#include "server/util/url_code.h"
+
+namespace ic {
+namespace server {
+
+static inline bool need_url_decode(const StringView& sv) {
+    for (char ch : sv) {
+        if (ch == '%' || ch == '+') {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 解析KeyValue格式的字符串.
+ */
+void ParamTable::Parse(const char* str, size_t len, char outer_delimiter, char inner_delimiter, bool trim) {
+    entries_.clear();
+    const char* end = str + len;
+    while (str < end) {
+        const char* item_end = static_cast<const char*>(memchr(str, outer_delimiter, end - str));
+        if (!item_end) {
+            item_end = end;
+        }
+        StringView item(str, item_end - str);
+        str = item_end + 1;
+        if (item.empty()) {
+            continue;
+        }
+
+        size_t pos = item.Find(&inner_delimiter, 1);
+        if (pos == StringView::npos) {
+            pos = item.length();
+        }
+        StringView key = item.SubStr(0, pos);
+        StringView value = (pos < item.length()) ? item.SubStr(pos + 1) : StringView(item.end(), 0);
+        if (trim) {
+            key.Trim();
+            value.Trim();
+        }
+
+        Entry entry;
+        entry.key = key;
+        entry.value = value;
+        entry.key_encoded = need_url_decode(key);
+        entry.value_encoded = need_url_decode(value);
+        if (entry.key_encoded && !util::url_decode(key.data(), key.length(), &entry.key_decoded)) {
+            continue;
+        }
+        entries_.push_back(std::move(entry));
+    }
+}
+
+/**
+ * @brief 查找第一个指定名称的参数值(已解码).
+ */
+const std::string* ParamTable::Find(const std::string& name) const {
+    for (const auto& entry : entries_) {
+        if (!KeyEquals(entry, name)) {
+            continue;
+        }
+        const std::string* value = Value(entry);
+        if (value) {
+            return value;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 转换为`std::multimap`.
+ */
+std::multimap<std::string, std::string> ParamTable::ToMap() const {
+    std::multimap<std::string, std::string> result;
+    for (const auto& entry : entries_) {
+        const std::string* value = Value(entry);
+        if (value) {
+            result.emplace(entry.key_encoded ? entry.key_decoded : entry.key.ToString(), *value);
+        }
+    }
+    return result;
+}
+
+bool ParamTable::KeyEquals(const Entry& entry, const std::string& name) {
+    return entry.key_encoded ? (entry.key_decoded == name) : (entry.key == name);
+}
+
+/**
+ * @brief 获取解码后的值，第一次访问时才生成.
+ */
+const std::string* ParamTable::Value(const Entry& entry) {
+    if (!entry.materialized) {
+        entry.materialized = true;
+        if (entry.value_encoded) {
+            entry.valid = util::url_decode(entry.value.data(), entry.value.length(), &entry.value_str);
+        }
+        else {
+            entry.value_str.assign(entry.value.data(), entry.value.length());
+        }
+    }
+    return entry.valid ? &entry.value_str : nullptr;
+}
+
+} // namespace server
+} // namespace ic
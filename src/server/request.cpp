@@ -2,6 +2,7 @@
 #include "server/request_raw.h"
 #include "server/http_server.h"
 #include "server/logger.h"
+#include "server/router.h"
 #include "server/util/string/isprint.h"
 #include "server/util/thread.h"
 #include "server/util/url_code.h"
@@ -38,52 +39,24 @@ static HttpMethod from_beast_http_method(boost::beast::http::verb method) {
     }
 }
 
-/**
- * @brief 分隔KeyValue格式的字符串.
- */
-static void s_split_key_value(const char* str, size_t len,
-    const char* outer_delimiter, size_t outer_delimiter_len,
-    const char* inner_delimiter, size_t inner_delimiter_len,
-    bool trim_key, bool trim_value,
-    std::multimap<std::string, std::string>* result)
-{
-    result->clear();
-    StringView sv(str, len);
-    std::vector<StringView> key_values = sv.Split(outer_delimiter, outer_delimiter_len, true);
-    StringView key, value;
-    std::string key_decoded, value_decoded;
-    for (const auto& key_value : key_values) {
-        auto pos = key_value.Find(inner_delimiter, inner_delimiter_len);
-        if (pos == std::string::npos) {
-            pos = key_value.length();
-        }
-        key = key_value.SubStr(0, pos);
-        value = key_value.SubStr(pos + inner_delimiter_len);
-        if (trim_key) {
-            key.Trim();
-        }
-        if (trim_value) {
-            value.Trim();
-        }
-        if (util::url_decode(key.data(), key.length(), &key_decoded) &&
-            util::url_decode(value.data(), value.length(), &value_decoded))
-        {
-            result->emplace(key_decoded, value_decoded);
-        }
-    }
-}
-
-Request::Request(HttpServer* svr, RequestRaw* raw, const std::string& client_ip)
-    : svr_(svr), raw_(raw), arrive_timepoint_(std::chrono::system_clock::now()),
+Request::Request(HttpServer* svr, RequestRaw* raw, const std::string& client_ip, util::Arena* arena/* = nullptr*/)
+    : svr_(svr), raw_(raw), arena_(arena), arrive_timepoint_(std::chrono::system_clock::now()),
       client_ip_(client_ip), client_real_ip_(client_ip),
-      thread_id_(util::thread_id()), id_(svr_->current_request_id())
+      thread_id_(util::thread_id()), id_(svr_->current_request_id()),
+      cookies_(arena), url_params_(arena), body_params_(arena)
 {
     ParseBasic();
 }
 
 Request::~Request() {
     for (auto iter = form_params_.begin(); iter != form_params_.end(); ++iter) {
-        delete iter->second;
+        if (arena_) {
+            /* 内存属于内存池，只需要析构 */
+            iter->second->~FormParam();
+        }
+        else {
+            delete iter->second;
+        }
         iter->second = nullptr;
     }
 }
@@ -103,6 +76,11 @@ std::string Request::GetHeader(const std::string& name) const {
     return to_string(raw_->operator[](name));
 }
 
+StringView Request::GetHeaderView(const std::string& name) const {
+    auto value = raw_->operator[](name);
+    return StringView(value.data(), value.size());
+}
+
 std::vector<std::string> Request::GetHeaders(const std::string& name) const {
     std::vector<std::string> headers;
     auto range = raw_->equal_range(name);
@@ -117,24 +95,42 @@ std::string Request::GetUserAgent() const {
 }
 
 const std::string& Request::GetCookie(const std::string& name, bool* exist/* = nullptr*/) const {
-    auto it = cookies_.find(name);
-    bool _exist = (it != cookies_.end());
+    const std::string* value = cookies_.Find(name);
+    exist && (*exist = (value != nullptr));
+    return value ? *value : s_empty_string;
+}
+
+const std::string& Request::GetRouteRegexMatch(size_t index) const {
+    if (route_regex_match_strings_.size() != route_regex_match_.size()) {
+        route_regex_match_strings_.clear();
+        route_regex_match_strings_.reserve(route_regex_match_.size());
+        for (const auto& match : route_regex_match_) {
+            route_regex_match_strings_.push_back(match.ToString());
+        }
+    }
+    return route_regex_match_strings_[index];
+}
+
+std::string Request::GetRouteParam(const std::string& name, bool* exist/* = nullptr*/) const {
+    int index = -1;
+    if (route_ && route_->is_pattern()) {
+        index = static_cast<const PatternRoute*>(route_.get())->GetParamIndex(name);
+    }
+    bool _exist = (index >= 0 && static_cast<size_t>(index) < route_regex_match_.size());
     exist && (*exist = _exist);
-    return _exist ? it->second : s_empty_string;
+    return _exist ? route_regex_match_[index].ToString() : std::string();
 }
 
 const std::string& Request::GetUrlParam(const std::string& name, bool* exist/* = nullptr*/) const {
-    auto it = url_params_.find(name);
-    bool _exist = (it != url_params_.end());
-    exist && (*exist = _exist);
-    return _exist ? it->second : s_empty_string;
+    const std::string* value = url_params_.Find(name);
+    exist && (*exist = (value != nullptr));
+    return value ? *value : s_empty_string;
 }
 
 const std::string& Request::GetBodyParam(const std::string& name, bool* exist/* = nullptr*/) const {
-    auto it = body_params_.find(name);
-    bool _exist = (it != body_params_.end());
-    exist && (*exist = _exist);
-    return _exist ? it->second : s_empty_string;
+    const std::string* value = body_params_.Find(name);
+    exist && (*exist = (value != nullptr));
+    return value ? *value : s_empty_string;
 }
 
 const FormParam* Request::GetFormParam(const std::string& name) const {
@@ -263,7 +259,7 @@ void Request::ParseClientRealIp() {
  * @brief 解析URL中的参数.
  */
 void Request::ParseUrlParams(const char* str, size_t len) {
-    s_split_key_value(str, len, "&", 1, "=", 1, false, false, &url_params_);
+    url_params_.Parse(str, len, '&', '=', false);
 }
 
 /**
@@ -271,7 +267,7 @@ void Request::ParseUrlParams(const char* str, size_t len) {
  */
 void Request::ParseCookie() {
     auto cookies = raw_->operator[](http::field::cookie);
-    s_split_key_value(cookies.data(), cookies.length(), ";", 1, "=", 1, true, true, &cookies_);
+    cookies_.Parse(cookies.data(), cookies.length(), ';', '=', true);
 }
 
 /**********************************************************************************
@@ -308,7 +304,7 @@ bool Request::ParseBody() {
  * @brief 解析application/x-www-form-urlencoded
  */
 bool Request::ParseBody_XWwwFormUrlEncoded(const std::string& body) {
-    s_split_key_value(body.data(), body.length(), "&", 1, "=", 1, false, false, &body_params_);
+    body_params_.Parse(body.data(), body.length(), '&', '=', false);
     return true;
 }
 
@@ -320,7 +316,7 @@ bool Request::ParseBody_MultipartFormData(const std::string& body) {
         svr_->logger()->Warn(LOG_CTX, "Missing boundary. Content-Type=multipart/form-data");
         return true;
     }
-    MultipartParser parser(body, svr_->logger());
+    MultipartParser parser(body, svr_->logger(), arena_);
     return parser.Parse("--" + content_type_.boundary(), &form_params_);
 }
 
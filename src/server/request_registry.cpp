@@ -0,0 +1,62 @@
+#include "request_registry.h"
+#include <thread>
+#include "server/util/thread.h"
+
+namespace ic {
+namespace server {
+
+RequestRegistry::~RequestRegistry() {
+    for (auto& shard : shards_) {
+        Block* block = shard.next.load(std::memory_order_relaxed);
+        while (block) {
+            Block* next = block->next.load(std::memory_order_relaxed);
+            delete block;
+            block = next;
+        }
+    }
+}
+
+/**
+ * @brief 登记请求.
+ */
+RequestSlot* RequestRegistry::Register(Request* req) {
+    Block* block = &shards_[util::thread_index() % kRequestRegistryNumShards];
+    while (true) {
+        for (auto& slot : block->slots) {
+            if (slot.req.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            Request* expected = nullptr;
+            if (slot.req.compare_exchange_strong(expected, req, std::memory_order_release, std::memory_order_relaxed)) {
+                return &slot;
+            }
+        }
+        /* 当前块已满，使用(或者追加)下一块 */
+        Block* next = block->next.load(std::memory_order_acquire);
+        if (!next) {
+            Block* new_block = new Block;
+            if (block->next.compare_exchange_strong(next, new_block, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                next = new_block;
+            }
+            else {
+                /* 共用该分片的其他线程已经追加 */
+                delete new_block;
+            }
+        }
+        block = next;
+    }
+}
+
+/**
+ * @brief 注销请求，返回后不再有快照读取该请求.
+ */
+void RequestRegistry::Unregister(RequestSlot* slot) {
+    slot->req.store(nullptr, std::memory_order_seq_cst);
+    /* 快照正在读取该请求(很少发生，且只是复制几个字段) */
+    while (slot->readers.load(std::memory_order_seq_cst) > 0) {
+        std::this_thread::yield();
+    }
+}
+
+} // namespace server
+} // namespace ic
@@ -0,0 +1,91 @@
+#ifndef IC_SERVER_REQUEST_REGISTRY_H_
+#define IC_SERVER_REQUEST_REGISTRY_H_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ic {
+namespace server {
+
+class Request;
+
+/** 每个分片中每块的槽位数量 */
+constexpr size_t kRequestRegistryBlockSize = 64;
+/** 分片数量(线程按照序号分配到各个分片) */
+constexpr size_t kRequestRegistryNumShards = 16;
+
+/**
+ * @brief 正在处理的请求所在的槽位.
+ */
+struct RequestSlot {
+    std::atomic<Request*> req{nullptr};
+    /** 正在读取该槽位中的请求的快照数量 */
+    std::atomic<uint32_t> readers{0};
+};
+
+/**
+ * @brief 正在处理的请求的登记表(用于`HttpServer::CreateSnapshot`).
+ *
+ * @details 槽位分为多个分片，每个线程在自己的分片中查找空闲的槽位(原子地占用)，不加锁.
+ * @details 槽位按块分配，块只增不减(直到登记表析构)，登记和注销请求都不分配内存(除非所有槽位都已占用).
+ * @details 快照读取请求之前增加槽位的`readers`，注销时等待正在进行的读取结束，保证读取期间请求对象不被释放.
+ * @note 线程安全.
+ */
+class RequestRegistry {
+public:
+    RequestRegistry() = default;
+    ~RequestRegistry();
+
+    RequestRegistry(const RequestRegistry&) = delete;
+    RequestRegistry& operator=(const RequestRegistry&) = delete;
+
+    /**
+     * @brief 登记请求.
+     * @return 请求所在的槽位，注销时使用
+     */
+    RequestSlot* Register(Request* req);
+
+    /**
+     * @brief 注销请求，返回后不再有快照读取该请求.
+     */
+    void Unregister(RequestSlot* slot);
+
+    /**
+     * @brief 遍历所有正在处理的请求.
+     *
+     * @details 回调函数返回之前，该请求不会被注销(注销的线程等待)，因此回调函数应当只复制所需的信息.
+     */
+    template<typename Func>
+    void ForEach(Func&& func) const {
+        for (const auto& shard : shards_) {
+            for (const Block* block = &shard; block; block = block->next.load(std::memory_order_acquire)) {
+                for (auto& slot : block->slots) {
+                    Request* req = slot.req.load(std::memory_order_acquire);
+                    if (!req) {
+                        continue;
+                    }
+                    slot.readers.fetch_add(1, std::memory_order_seq_cst);
+                    /* 增加`readers`之后再次确认，此时请求仍然登记在该槽位中，注销时会等待读取结束 */
+                    if (slot.req.load(std::memory_order_seq_cst) == req) {
+                        func(*req);
+                    }
+                    slot.readers.fetch_sub(1, std::memory_order_release);
+                }
+            }
+        }
+    }
+
+private:
+    struct Block {
+        mutable RequestSlot slots[kRequestRegistryBlockSize];
+        std::atomic<Block*> next{nullptr};
+    };
+
+    /** 每个分片的第一块 */
+    Block shards_[kRequestRegistryNumShards];
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_REQUEST_REGISTRY_H_
@@ -15,6 +15,7 @@ Response::Response(HttpServer* svr)
 }
 
 Response::~Response() {
+    ResetStreamBody();
 }
 
 void Response::SetHeader(const std::string& name, const std::string& value) {
@@ -39,6 +40,7 @@ void Response::RemoveAllCookies() {
 }
 
 void Response::SetStringBody(unsigned int status_code) {
+    ResetStreamBody();
     is_file_body_ = false;
     status_code_ = status_code;
     string_body_.clear();
@@ -49,6 +51,7 @@ void Response::SetStringBody(const std::string& body, const std::string& content
 }
 
 void Response::SetStringBody(unsigned int status_code, const std::string& body, const std::string& content_type) {
+    ResetStreamBody();
     is_file_body_ = false;
     status_code_ = status_code;
     string_body_ = body;
@@ -79,10 +82,39 @@ void Response::SetFileBody(unsigned int status_code, const std::string& filepath
     else {
         SetContentType(content_type);
     }
+    ResetStreamBody();
     filepath_ = filepath;
     is_file_body_ = true;
 }
 
+std::shared_ptr<ResponseWriter> Response::SetStreamBody(const std::string& content_type,
+    size_t max_buffer_size/* = ResponseWriter::kDefaultMaxBufferSize*/)
+{
+    return SetStreamBody(200U, content_type, max_buffer_size);
+}
+
+std::shared_ptr<ResponseWriter> Response::SetStreamBody(unsigned int status_code, const std::string& content_type,
+    size_t max_buffer_size/* = ResponseWriter::kDefaultMaxBufferSize*/)
+{
+    ResetStreamBody();
+    is_file_body_ = false;
+    status_code_ = status_code;
+    string_body_.clear();
+    SetContentType(content_type);
+    stream_writer_ = std::make_shared<ResponseWriter>(max_buffer_size);
+    return stream_writer_;
+}
+
+/**
+ * @brief 丢弃之前的流式响应，其写入器之后的写入都会失败.
+ */
+void Response::ResetStreamBody() {
+    if (stream_writer_) {
+        stream_writer_->Abort();
+        stream_writer_.reset();
+    }
+}
+
 void Response::SetBadRequest(const std::string& why/* = "Bad Request!"*/) {
     return SetStringBody(400U, why, "text/plain");
 }
@@ -0,0 +1,197 @@
+#include "server/response_writer.h"
+#include <algorithm>
+
+namespace ic {
+namespace server {
+
+constexpr size_t ResponseWriter::kDefaultMaxBufferSize;
+
+ResponseWriter::ResponseWriter(size_t max_buffer_size/* = kDefaultMaxBufferSize*/)
+    : max_buffer_size_(max_buffer_size > 0 ? max_buffer_size : kDefaultMaxBufferSize)
+{
+}
+
+bool ResponseWriter::Write(const char* data, size_t size) {
+    return Push(data, size, true);
+}
+
+bool ResponseWriter::TryWrite(const char* data, size_t size) {
+    return Push(data, size, false);
+}
+
+/**
+ * @brief 放入缓冲区，并通知`Session`发送.
+ *
+ * @details 缓冲区为空时，超过缓冲区大小的一块内容也可以放入.
+ */
+bool ResponseWriter::Push(const char* data, size_t size, bool block) {
+    std::function<void()> notify;
+    {
+        std::unique_lock<std::mutex> lck(mutex_);
+        if (block) {
+            cv_.wait(lck, [this, size] {
+                return closed_ || aborted_ || buffered_ == 0 || buffered_ + size <= max_buffer_size_;
+            });
+        }
+        if (closed_ || aborted_) {
+            return false;
+        }
+        if (buffered_ > 0 && buffered_ + size > max_buffer_size_) {
+            return false;
+        }
+        if (size == 0) {
+            return true;
+        }
+        queue_.emplace_back(data, size);
+        buffered_ += size;
+        if (notify_ && !notified_) {
+            notified_ = true;
+            notify = notify_;
+        }
+    }
+    if (notify) {
+        notify();
+    }
+    return true;
+}
+
+/**
+ * @brief 写入完毕，发送完缓冲区中的内容后结束响应.
+ */
+void ResponseWriter::Close() {
+    std::function<void()> notify;
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        if (closed_ || aborted_) {
+            return;
+        }
+        closed_ = true;
+        if (notify_ && !notified_) {
+            notified_ = true;
+            notify = notify_;
+        }
+    }
+    cv_.notify_all();
+    if (notify) {
+        notify();
+    }
+}
+
+bool ResponseWriter::is_open() const {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return !closed_ && !aborted_;
+}
+
+bool ResponseWriter::aborted() const {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return aborted_;
+}
+
+size_t ResponseWriter::buffered_size() const {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return buffered_;
+}
+
+void ResponseWriter::set_on_writable(WritableCallback cb) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    on_writable_ = cb;
+}
+
+void ResponseWriter::set_heartbeat(const std::string& data, unsigned int interval_ms/* = 0*/) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    heartbeat_ = data;
+    heartbeat_interval_ms_ = interval_ms;
+}
+
+bool ResponseWriter::GetHeartbeat(std::string* data, unsigned int* interval_ms) const {
+    std::lock_guard<std::mutex> lck(mutex_);
+    *data = heartbeat_;
+    *interval_ms = heartbeat_interval_ms_;
+    return !heartbeat_.empty();
+}
+
+void ResponseWriter::Attach(std::function<void()> notify) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    notify_ = notify;
+}
+
+/**
+ * @brief 取出缓冲区中的内容用于发送.
+ */
+void ResponseWriter::Take(std::vector<std::string>* chunks, bool* closed) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    for (auto& chunk : queue_) {
+        chunks->push_back(std::move(chunk));
+    }
+    queue_.clear();
+    notified_ = false;
+    *closed = closed_;
+}
+
+/**
+ * @brief 已发送`size`字节，唤醒阻塞的写入.
+ */
+bool ResponseWriter::OnSent(size_t size) {
+    bool writable = false;
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        buffered_ -= std::min(size, buffered_);
+        writable = on_writable_ && !closed_ && !aborted_ && buffered_ <= max_buffer_size_ / 2;
+    }
+    cv_.notify_all();
+    return writable;
+}
+
+void ResponseWriter::NotifyWritable() {
+    WritableCallback cb;
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        if (closed_ || aborted_) {
+            return;
+        }
+        cb = on_writable_;
+    }
+    if (cb) {
+        cb(*this);
+    }
+}
+
+/**
+ * @brief 全部发送完毕.
+ */
+void ResponseWriter::Finish() {
+    std::function<void()> notify;
+    WritableCallback on_writable;
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        finished_ = true;
+        closed_ = true;
+        /* 释放回调函数(可能持有写入器本身)，在锁外析构 */
+        notify.swap(notify_);
+        on_writable.swap(on_writable_);
+    }
+    cv_.notify_all();
+}
+
+/**
+ * @brief 连接断开或者响应被丢弃，唤醒阻塞的写入.
+ */
+void ResponseWriter::Abort() {
+    std::function<void()> notify;
+    WritableCallback on_writable;
+    std::deque<std::string> queue;
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        if (!finished_) {
+            aborted_ = true;
+        }
+        notify.swap(notify_);
+        on_writable.swap(on_writable_);
+        queue.swap(queue_);
+        buffered_ = 0;
+    }
+    cv_.notify_all();
+}
+
+} // namespace server
+} // namespace ic
@@ -0,0 +1,196 @@
+#include "route_trie.h"
+#include <algorithm>
+#include <string.h>
+
+namespace ic {
+namespace server {
+
+struct RouteTrie::Node {
+    /** 普通字符串子节点(按照字符串排序) */
+    std::vector<std::pair<std::string, NodePtr>> literals;
+    /** 参数子节点(uint, int, str) */
+    NodePtr params[3];
+    /** 以该节点结尾的路由 */
+    PatternRoutePtr route;
+    /** 在该节点匹配剩余全部路径的路由(path类型参数) */
+    PatternRoutePtr path_route;
+};
+
+static inline int ParamSlot(PatternRoute::Segment::Type type) {
+    switch (type) {
+    case PatternRoute::Segment::kUint: return 0;
+    case PatternRoute::Segment::kInt: return 1;
+    default: return 2;
+    }
+}
+
+static inline int CompareSegment(const std::string& lhs, const char* begin, size_t len) {
+    int ret = memcmp(lhs.data(), begin, std::min(lhs.size(), len));
+    if (ret != 0) {
+        return ret;
+    }
+    return lhs.size() < len ? -1 : (lhs.size() > len ? 1 : 0);
+}
+
+RouteTrie::RouteTrie() : root_(new Node()) {
+}
+
+RouteTrie::~RouteTrie() {
+}
+
+RouteTrie::Node* RouteTrie::FindNode(const PatternRoute& route, bool create) {
+    Node* node = root_.get();
+    for (const auto& seg : route.segments) {
+        if (seg.type == PatternRoute::Segment::kPath) {
+            break;
+        }
+        NodePtr* child = nullptr;
+        if (seg.type == PatternRoute::Segment::kLiteral) {
+            auto iter = std::lower_bound(node->literals.begin(), node->literals.end(), seg.text,
+                [](const std::pair<std::string, NodePtr>& lhs, const std::string& rhs) { return lhs.first < rhs; });
+            if (iter != node->literals.end() && iter->first == seg.text) {
+                child = &iter->second;
+            }
+            else if (create) {
+                iter = node->literals.emplace(iter, seg.text, NodePtr(new Node()));
+                child = &iter->second;
+            }
+        }
+        else {
+            child = &node->params[ParamSlot(seg.type)];
+            if (!*child && create) {
+                child->reset(new Node());
+            }
+        }
+        if (!child || !*child) {
+            return nullptr;
+        }
+        node = child->get();
+    }
+    return node;
+}
+
+/**
+ * @brief 插入路由.
+ */
+PatternRoutePtr RouteTrie::Insert(const PatternRoutePtr& route) {
+    Node* node = FindNode(*route, true);
+    bool is_path = !route->segments.empty() && route->segments.back().type == PatternRoute::Segment::kPath;
+    PatternRoutePtr& slot = is_path ? node->path_route : node->route;
+    if (slot) {
+        return slot;
+    }
+    slot = route;
+    return nullptr;
+}
+
+/**
+ * @brief 移除路由.
+ */
+void RouteTrie::Remove(const PatternRoutePtr& route) {
+    Node* node = FindNode(*route, false);
+    if (!node) {
+        return;
+    }
+    if (node->route == route) {
+        node->route.reset();
+    }
+    if (node->path_route == route) {
+        node->path_route.reset();
+    }
+}
+
+/**
+ * @brief 匹配路径.
+ */
+PatternRoutePtr RouteTrie::Match(const std::string& path, std::vector<StringView>* captures) const {
+    PatternRoutePtr route;
+    if (path.empty() || path[0] != '/') {
+        return route;
+    }
+    const char* begin = path.data() + 1;
+    const char* end = path.data() + path.size();
+    captures->clear();
+    MatchNode(root_.get(), begin, end, captures, &route);
+    return route;
+}
+
+/**
+ * @brief 从当前节点开始匹配.
+ *
+ * @param begin 当前路径段的起始位置，nullptr表示路径已经匹配完毕
+ * @param end 路径的结束位置
+ */
+bool RouteTrie::MatchNode(const Node* node, const char* begin, const char* end,
+    std::vector<StringView>* captures, PatternRoutePtr* route)
+{
+    if (!begin) {
+        if (node->route) {
+            *route = node->route;
+            return true;
+        }
+        return false;
+    }
+
+    const char* seg_end = static_cast<const char*>(memchr(begin, '/', end - begin));
+    if (!seg_end) {
+        seg_end = end;
+    }
+    const char* next = (seg_end == end) ? nullptr : seg_end + 1;
+    size_t seg_len = seg_end - begin;
+
+    /* 1. 普通字符串 */
+    auto iter = std::lower_bound(node->literals.begin(), node->literals.end(), seg_len,
+        [begin](const std::pair<std::string, NodePtr>& lhs, size_t len) { return CompareSegment(lhs.first, begin, len) < 0; });
+    if (iter != node->literals.end() && CompareSegment(iter->first, begin, seg_len) == 0) {
+        if (MatchNode(iter->second.get(), next, end, captures, route)) {
+            return true;
+        }
+    }
+
+    /* 2. 参数 uint > int > str */
+    static const PatternRoute::Segment::Type param_types[] = {
+        PatternRoute::Segment::kUint, PatternRoute::Segment::kInt, PatternRoute::Segment::kString
+    };
+    for (int i = 0; i < 3; ++i) {
+        if (!node->params[i] || !MatchType(param_types[i], begin, seg_end)) {
+            continue;
+        }
+        captures->emplace_back(begin, seg_len);
+        if (MatchNode(node->params[i].get(), next, end, captures, route)) {
+            return true;
+        }
+        captures->pop_back();
+    }
+
+    /* 3. 剩余的全部路径 */
+    if (node->path_route) {
+        captures->emplace_back(begin, end - begin);
+        *route = node->path_route;
+        return true;
+    }
+    return false;
+}
+
+bool RouteTrie::MatchType(PatternRoute::Segment::Type type, const char* begin, const char* end) {
+    if (begin == end) {
+        return false;
+    }
+    if (type == PatternRoute::Segment::kString) {
+        return true;
+    }
+    if (type == PatternRoute::Segment::kInt && *begin == '-') {
+        if (++begin == end) {
+            return false;
+        }
+    }
+    for (; begin != end; ++begin) {
+        if (*begin < '0' || *begin > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace server
+} // namespace ic
@@ -0,0 +1,57 @@
+#ifndef IC_SERVER_ROUTE_TRIE_H_
+#define IC_SERVER_ROUTE_TRIE_H_
+#include <memory>
+#include <string>
+#include <vector>
+#include "server/router.h"
+#include "server/string_view.h"
+
+namespace ic {
+namespace server {
+
+/**
+ * @brief 模式路由前缀树，按照`/`分隔的路径段逐级匹配.
+ *
+ * @details 匹配过程不分配内存(捕获项的容量除外)，捕获项是指向请求路径的`StringView`.
+ * @note 非线程安全，由`Router`负责加锁.
+ */
+class RouteTrie {
+public:
+    RouteTrie();
+    ~RouteTrie();
+
+    /**
+     * @brief 插入路由.
+     * @return PatternRoutePtr 路径结构相同的已有路由(如仅参数名称或请求方法不同)，此时不插入；没有则返回nullptr
+     */
+    PatternRoutePtr Insert(const PatternRoutePtr& route);
+
+    /**
+     * @brief 移除路由(仅当节点上的路由就是该路由时).
+     */
+    void Remove(const PatternRoutePtr& route);
+
+    /**
+     * @brief 匹配路径.
+     * @param path 请求路径，必须以`/`开头
+     * @param captures [out] 参数值(按照参数出现顺序)
+     */
+    PatternRoutePtr Match(const std::string& path, std::vector<StringView>* captures) const;
+
+private:
+    struct Node;
+    using NodePtr = std::unique_ptr<Node>;
+
+    Node* FindNode(const PatternRoute& route, bool create);
+    static bool MatchNode(const Node* node, const char* begin, const char* end,
+        std::vector<StringView>* captures, PatternRoutePtr* route);
+    static bool MatchType(PatternRoute::Segment::Type type, const char* begin, const char* end);
+
+private:
+    NodePtr root_;
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_ROUTE_TRIE_H_
@@ -1,13 +1,92 @@
 #include "server/router.h"
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+#include "metrics.h"
+#include "route_trie.h"
+#include "server/event_stream.h"
 #include "server/http_server.h"
 #include "server/logger.h"
 #include "server/request.h"
 #include "server/response.h"
 #include "server/status/base.h"
+#include "server/util/path.h"
+#include "server/websocket.h"
 
 namespace ic {
 namespace server {
 
+ResponseCompletion::ResponseCompletion(std::function<void()> done, std::function<void()> abandoned)
+    : state_(std::make_shared<State>())
+{
+    state_->done = std::move(done);
+    state_->abandoned = std::move(abandoned);
+}
+
+/**
+ * @brief 回调函数没有调用就释放了所有副本，此时仍然需要完成请求，否则请求一直不会结束.
+ */
+ResponseCompletion::State::~State() {
+    if (completed.exchange(true)) {
+        return;
+    }
+    try {
+        if (abandoned) {
+            abandoned();
+        }
+        if (done) {
+            done();
+        }
+    }
+    catch (...) {
+    }
+}
+
+/**
+ * @brief 通知服务器，响应内容已经准备好.
+ */
+void ResponseCompletion::Complete() const {
+    if (state_ && !state_->completed.exchange(true)) {
+        std::function<void()> done;
+        done.swap(state_->done);  /* 释放`done`持有的资源(如会话) */
+        if (done) {
+            done();
+        }
+    }
+}
+
+bool ResponseCompletion::completed() const {
+    return state_ && state_->completed;
+}
+
+Route::~Route() {
+    delete metrics_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief 统计数据(延迟直方图等)，第一次使用时创建.
+ */
+RouteMetrics* Route::metrics() const {
+    RouteMetrics* metrics = metrics_.load(std::memory_order_acquire);
+    if (metrics) {
+        return metrics;
+    }
+    RouteMetrics* new_metrics = new RouteMetrics();
+    if (metrics_.compare_exchange_strong(metrics, new_metrics, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return new_metrics;
+    }
+    delete new_metrics;
+    return metrics;
+}
+
+/**
+ * @brief 生成新的路由ID.
+ */
+uint32_t Route::NextId() {
+    static std::atomic<uint32_t> s_next_id{1};
+    return s_next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
 std::string Route::GetMethodsString() const {
     static const HttpMethod methods_arr[] = {
         HttpMethod::kGET, HttpMethod::kHEAD, HttpMethod::kPOST, HttpMethod::kPUT, HttpMethod::kDELETE,
@@ -30,10 +109,26 @@ std::string Route::GetMethodsString() const {
 
 Json::Value Route::ToJson() const {
     Json::Value root;
+    root["id"] = id;
     root["methods"] = GetMethodsString();
     root["hit_count"] = (uint64_t)hit_count;
     root["path"] = path;
     root["description"] = description;
+    if (is_async()) {
+        root["async"] = true;
+    }
+    if (blocking) {
+        root["blocking"] = true;
+    }
+    if (body_limit > 0) {
+        root["body_limit"] = body_limit;
+    }
+    if (body_chunk_callback) {
+        root["streaming_body"] = true;
+    }
+    if (websocket) {
+        root["websocket"] = true;
+    }
     for (const auto& config : configuration) {
         root["configuration"][config.first] = config.second;
     }
@@ -51,36 +146,210 @@ void Route::Invoke(Request& req, Response& res) const {
     }
 }
 
-Router::Router(HttpServer* svr) : svr_(svr) {
-    cb_invalid_path_ = [](Request& req, Response& res) {
+void Route::InvokeAsync(Request& req, Response& res, ResponseCompletion completion) const {
+    if (response_async_callback_) {
+        response_async_callback_(req, res, completion);
+    }
+    else {
+        Invoke(req, res);
+        completion();
+    }
+}
+
+/**
+ * @brief 编译路由模式，如 /user/{id:int}/posts/{slug}.
+ */
+void PatternRoute::Compile() {
+    if (path.empty() || path[0] != '/') {
+        throw std::invalid_argument("pattern must start with '/'");
+    }
+    size_t start = 1;
+    while (true) {
+        size_t pos = path.find('/', start);
+        std::string text = path.substr(start, pos == std::string::npos ? std::string::npos : pos - start);
+        if (!segments.empty() && segments.back().type == Segment::kPath) {
+            throw std::invalid_argument("'path' parameter must be the last segment");
+        }
+        Segment seg;
+        if (text.size() >= 2 && text.front() == '{' && text.back() == '}') {
+            std::string name = text.substr(1, text.size() - 2);
+            std::string type = "str";
+            size_t colon = name.find(':');
+            if (colon != std::string::npos) {
+                type = name.substr(colon + 1);
+                name.erase(colon);
+            }
+            if (name.empty()) {
+                throw std::invalid_argument("empty parameter name: " + text);
+            }
+            for (char ch : name) {
+                if (!isalnum(static_cast<unsigned char>(ch)) && ch != '_') {
+                    throw std::invalid_argument("invalid parameter name: " + name);
+                }
+            }
+            if (GetParamIndex(name) >= 0) {
+                throw std::invalid_argument("duplicate parameter name: " + name);
+            }
+            if (type == "str") {
+                seg.type = Segment::kString;
+            }
+            else if (type == "int") {
+                seg.type = Segment::kInt;
+            }
+            else if (type == "uint") {
+                seg.type = Segment::kUint;
+            }
+            else if (type == "path") {
+                seg.type = Segment::kPath;
+            }
+            else {
+                throw std::invalid_argument("unknown parameter type: " + type);
+            }
+            seg.text = name;
+            param_names.push_back(name);
+        }
+        else if (text.find_first_of("{}") != std::string::npos) {
+            throw std::invalid_argument("parameter must occupy the whole segment: " + text);
+        }
+        else {
+            seg.type = Segment::kLiteral;
+            seg.text = text;
+        }
+        segments.push_back(seg);
+        if (pos == std::string::npos) {
+            break;
+        }
+        start = pos + 1;
+    }
+}
+
+/**
+ * @brief 获取参数的下标索引，不存在则返回-1.
+ */
+int PatternRoute::GetParamIndex(const std::string& name) const {
+    for (size_t i = 0; i < param_names.size(); ++i) {
+        if (param_names[i] == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 路由表快照，发布之后不再修改.
+ */
+struct RouteTable {
+    /** 所有路由 */
+    std::unordered_map<std::string, RoutePtr> routes;
+
+    /** 静态路由 */
+    std::unordered_map<std::string, StaticRoutePtr> static_routes;
+
+    /** 正则表达式路由 */
+    std::vector<RegexRoutePtr> regex_routes;
+
+    /** 模式路由 */
+    std::unordered_map<std::string, PatternRoutePtr> pattern_routes;
+
+    /** 模式路由前缀树 */
+    RouteTrie pattern_trie;
+
+    /** 路径无效的回调函数 */
+    Route::ResponseCallback cb_invalid_path;
+
+    /** 请求方法无效的回调函数 */
+    Route::ResponseCallback cb_invalid_method;
+};
+
+/**
+ * @brief 每个线程缓存最近使用的路由表，版本号不变时无需访问共享的`table_`.
+ */
+struct RouteTableCache {
+    uint64_t router_id{0};
+    uint64_t version{0};
+    std::shared_ptr<const RouteTable> table;
+};
+
+static thread_local RouteTableCache s_table_cache;
+
+static std::atomic<uint64_t> s_next_router_id{1};
+
+Router::Router(HttpServer* svr) : svr_(svr), id_(s_next_router_id.fetch_add(1)) {
+    std::shared_ptr<RouteTable> table = std::make_shared<RouteTable>();
+    table->cb_invalid_path = [](Request& req, Response& res) {
         Json::Value root;
         root["code"] = status::kInvalidPath;
         root["msg"] = "Invalid request path";
         res.SetJsonBody(root);
     };
-    cb_invalid_method_ = [](Request& req, Response& res) {
+    table->cb_invalid_method = [](Request& req, Response& res) {
         Json::Value root;
         root["code"] = status::kInvalidMethod;
         root["msg"] = "Invalid http method";
         res.SetJsonBody(root);
     };
+    std::lock_guard<std::mutex> lck(mutex_);
+    PublishTable(table);
 }
 
 Router::~Router() {
 }
 
+/**
+ * @brief 获取当前路由表(当前线程缓存的快照，无锁).
+ */
+const RouteTable* Router::GetTable() const {
+    RouteTableCache& cache = s_table_cache;
+    uint64_t version = version_.load(std::memory_order_acquire);
+    if (cache.router_id != id_ || cache.version != version) {
+        cache.table = std::atomic_load(&table_);
+        cache.router_id = id_;
+        cache.version = version;
+    }
+    return cache.table.get();
+}
+
+/**
+ * @brief 复制当前路由表，用于修改.
+ */
+std::shared_ptr<RouteTable> Router::CloneTable() const {
+    /* 持有`mutex_`，没有其他线程修改`table_` */
+    const RouteTable& cur = *table_;
+    std::shared_ptr<RouteTable> table = std::make_shared<RouteTable>();
+    table->routes = cur.routes;
+    table->static_routes = cur.static_routes;
+    table->regex_routes = cur.regex_routes;
+    table->pattern_routes = cur.pattern_routes;
+    for (const auto& pair : table->pattern_routes) {
+        table->pattern_trie.Insert(pair.second);
+    }
+    table->cb_invalid_path = cur.cb_invalid_path;
+    table->cb_invalid_method = cur.cb_invalid_method;
+    return table;
+}
+
+/**
+ * @brief 发布新的路由表.
+ */
+void Router::PublishTable(std::shared_ptr<RouteTable> table) {
+    std::atomic_store(&table_, std::shared_ptr<const RouteTable>(std::move(table)));
+    version_.fetch_add(1, std::memory_order_release);
+}
+
 /**
  * @brief 添加静态路由，如果已存在则覆盖.
  */
 bool Router::AddStaticRoute(StaticRoutePtr route) {
-    WriteLock lck(mutex_);
     if (!CheckRoute(route)) {
         return false;
     }
-    DeleteRoute_WithoutLock(route->path);
+    std::lock_guard<std::mutex> lck(mutex_);
+    std::shared_ptr<RouteTable> table = CloneTable();
+    DeleteRoute(table.get(), route->path);
     svr_->logger()->Debug(LOG_CTX, "Add static route: %4s %s", route->GetMethodsString().c_str(), route->path.c_str());
-    static_routes_.emplace(route->path, route);
-    routes_.emplace(route->path, route);
+    table->static_routes.emplace(route->path, route);
+    table->routes.emplace(route->path, route);
+    PublishTable(table);
     return true;
 }
 
@@ -102,19 +371,31 @@ bool Router::AddStaticRoute(const std::string& path, int methods,
     return AddStaticRoute(route);
 }
 
+bool Router::AddStaticRoute(const std::string& path, int methods,
+    std::function<void(Request&, Response&, ResponseCompletion)> callback,
+    const std::string& description/* = ""*/,
+    const std::unordered_map<std::string, std::string>& configuration/* = {}*/)
+{
+    auto route = std::make_shared<StaticRoute>(path, methods, callback, description, configuration);
+    return AddStaticRoute(route);
+}
+
 /**
  * @brief 添加正则路由，如果已存在则覆盖.
  */
 bool Router::AddRegexRoute(RegexRoutePtr route) {
-    WriteLock lck(mutex_);
     if (!CheckRoute(route)) {
         return false;
     }
-    DeleteRoute_WithoutLock(route->path);
+    std::lock_guard<std::mutex> lck(mutex_);
+    std::shared_ptr<RouteTable> table = CloneTable();
+    DeleteRoute(table.get(), route->path);
     svr_->logger()->Debug(LOG_CTX, "Add  regex route: %4s %s", route->GetMethodsString().c_str(), route->path.c_str());
-    auto iter = std::find_if(regex_routes_.begin(), regex_routes_.end(), [route](RegexRoutePtr rhs) { return rhs->priority < route->priority; });
-    regex_routes_.insert(iter, route);
-    routes_.emplace(route->path, route);
+    auto& regex_routes = table->regex_routes;
+    auto iter = std::find_if(regex_routes.begin(), regex_routes.end(), [route](RegexRoutePtr rhs) { return rhs->priority < route->priority; });
+    regex_routes.insert(iter, route);
+    table->routes.emplace(route->path, route);
+    PublishTable(table);
     return true;
 }
 
@@ -144,6 +425,175 @@ bool Router::AddRegexRoute(const std::string& path, int methods, std::function<v
     }
 }
 
+bool Router::AddRegexRoute(const std::string& path, int methods, std::function<void(Request&, Response&, ResponseCompletion)> callback,
+    const std::string& description/* = ""*/, const std::unordered_map<std::string, std::string>& configuration/* = {}*/, int priority/* = 0*/)
+{
+    try {
+        auto route = std::make_shared<RegexRoute>(path, methods, callback, description, configuration, priority);
+        return AddRegexRoute(route);
+    }
+    catch (const REGEX_NAMESPACE::regex_error& ex) {
+        svr_->logger()->Error(LOG_CTX, "Invalid regex pattern: %s, can not add to router. %s", path.c_str(), ex.what());
+        return false;
+    }
+}
+
+/**
+ * @brief 添加模式路由，如果已存在则覆盖.
+ */
+bool Router::AddPatternRoute(PatternRoutePtr route) {
+    if (!CheckRoute(route)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lck(mutex_);
+    std::shared_ptr<RouteTable> table = CloneTable();
+    DeleteRoute(table.get(), route->path);
+    PatternRoutePtr existing = table->pattern_trie.Insert(route);
+    if (existing) {
+        /* 路径结构相同(如仅参数名称或请求方法不同)时无法区分，需要合并为一个路由(支持多种请求方法) */
+        svr_->logger()->Error(LOG_CTX, "Pattern route %s %s conflicts with %s %s, can not add to router.",
+            route->GetMethodsString().c_str(), route->path.c_str(), existing->GetMethodsString().c_str(), existing->path.c_str());
+        return false;
+    }
+    svr_->logger()->Debug(LOG_CTX, "Add pattern route: %4s %s", route->GetMethodsString().c_str(), route->path.c_str());
+    table->pattern_routes.emplace(route->path, route);
+    table->routes.emplace(route->path, route);
+    PublishTable(table);
+    return true;
+}
+
+bool Router::AddPatternRoute(const std::string& path, int methods, std::function<void(Request&, Response&)> callback,
+    const std::string& description/* = ""*/, const std::unordered_map<std::string, std::string>& configuration/* = {}*/)
+{
+    try {
+        auto route = std::make_shared<PatternRoute>(path, methods, callback, description, configuration);
+        return AddPatternRoute(route);
+    }
+    catch (const std::invalid_argument& ex) {
+        svr_->logger()->Error(LOG_CTX, "Invalid route pattern: %s, can not add to router. %s", path.c_str(), ex.what());
+        return false;
+    }
+}
+
+bool Router::AddPatternRoute(const std::string& path, int methods, std::function<void(Request&, Json::Value&)> callback,
+    const std::string& description/* = ""*/, const std::unordered_map<std::string, std::string>& configuration/* = {}*/)
+{
+    try {
+        auto route = std::make_shared<PatternRoute>(path, methods, callback, description, configuration);
+        return AddPatternRoute(route);
+    }
+    catch (const std::invalid_argument& ex) {
+        svr_->logger()->Error(LOG_CTX, "Invalid route pattern: %s, can not add to router. %s", path.c_str(), ex.what());
+        return false;
+    }
+}
+
+bool Router::AddPatternRoute(const std::string& path, int methods, std::function<void(Request&, Response&, ResponseCompletion)> callback,
+    const std::string& description/* = ""*/, const std::unordered_map<std::string, std::string>& configuration/* = {}*/)
+{
+    try {
+        auto route = std::make_shared<PatternRoute>(path, methods, callback, description, configuration);
+        return AddPatternRoute(route);
+    }
+    catch (const std::invalid_argument& ex) {
+        svr_->logger()->Error(LOG_CTX, "Invalid route pattern: %s, can not add to router. %s", path.c_str(), ex.what());
+        return false;
+    }
+}
+
+/**
+ * @brief URL路径解码(与`util::url_decode`不同，`+`不解码为空格).
+ */
+static bool s_decode_path(const char* str, size_t len, std::string* result) {
+    result->clear();
+    result->reserve(len);
+    for (size_t i = 0; i < len; ++i) {
+        if (str[i] != '%') {
+            result->push_back(str[i]);
+            continue;
+        }
+        if (i + 2 >= len || !isxdigit((unsigned char)str[i + 1]) || !isxdigit((unsigned char)str[i + 2])) {
+            return false;
+        }
+        char hex[3] = { str[i + 1], str[i + 2], 0 };
+        result->push_back((char)strtol(hex, nullptr, 16));
+        i += 2;
+    }
+    return true;
+}
+
+/**
+ * @brief 相对路径是否可以安全地拼接到静态文件目录下.
+ *
+ * @details 不允许`..`路径段、反斜杠和`\0`，Windows下不允许`:`(盘符、数据流).
+ */
+static bool s_is_safe_relative_path(const std::string& path) {
+    size_t begin = 0;
+    while (begin <= path.size()) {
+        size_t end = path.find('/', begin);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        if (end - begin == 2 && path[begin] == '.' && path[begin + 1] == '.') {
+            return false;
+        }
+        begin = end + 1;
+    }
+#ifdef _WIN32
+    return path.find_first_of(std::string("\\:\0", 3)) == std::string::npos;
+#else
+    return path.find_first_of(std::string("\\\0", 2)) == std::string::npos;
+#endif
+}
+
+/**
+ * @brief 添加静态文件目录.
+ */
+bool Router::AddStaticDirectory(const std::string& prefix, const std::string& root, const std::string& index/* = "index.html"*/) {
+    std::string dir = util::path::format_dir(root);
+    std::string pattern = prefix;
+    while (!pattern.empty() && pattern.back() == '/') {
+        pattern.pop_back();
+    }
+    pattern += "/{path:path}";
+    return AddPatternRoute(pattern, HttpMethod::kGET | HttpMethod::kHEAD, [dir, index](Request& req, Response& res) {
+        const auto& matches = req.route_matches();
+        std::string relative;
+        if (matches.empty() || !s_decode_path(matches.back().data(), matches.back().size(), &relative)
+            || !s_is_safe_relative_path(relative))
+        {
+            return res.SetStringBody(404U);
+        }
+        if (relative.empty() || relative.back() == '/') {
+            if (index.empty()) {
+                return res.SetStringBody(404U);
+            }
+            relative += index;
+        }
+        res.SetFileBody(dir + relative);
+    }, "Static directory: " + dir);
+}
+
+bool Router::AddEventStreamRoute(const std::string& path,
+    std::function<void(Request&, std::shared_ptr<EventStream>)> callback,
+    const std::string& description/* = ""*/,
+    const std::unordered_map<std::string, std::string>& configuration/* = {}*/)
+{
+    auto route = std::make_shared<StaticRoute>(path, HttpMethod::kGET, EventStream::MakeResponseCallback(callback), description, configuration);
+    return AddStaticRoute(route);
+}
+
+bool Router::AddWebSocketRoute(const std::string& path, const WebSocketHandler& handler,
+    const std::string& description/* = ""*/,
+    const std::unordered_map<std::string, std::string>& configuration/* = {}*/)
+{
+    auto route = std::make_shared<StaticRoute>(path, HttpMethod::kGET, [](Request& req, Response& res) {
+        res.SetHeader("Upgrade", "websocket");
+        res.SetStringBody(426U, "Upgrade Required", "text/plain");
+    }, description, configuration);
+    route->websocket = std::make_shared<const WebSocketHandler>(handler);
+    return AddStaticRoute(route);
+}
 
 /**
  * @brief 检查路由是否合法.
@@ -164,27 +614,40 @@ bool Router::CheckRoute(RoutePtr route) const {
  * @brief 删除路由.
  */
 void Router::DeleteRoute(const std::string& path) {
-    WriteLock lck(mutex_);
-    DeleteRoute_WithoutLock(path);
+    std::lock_guard<std::mutex> lck(mutex_);
+    if (table_->routes.find(path) == table_->routes.end()) {
+        return;
+    }
+    std::shared_ptr<RouteTable> table = CloneTable();
+    DeleteRoute(table.get(), path);
+    PublishTable(table);
 }
 
 /**
- * @brief 删除路由(无锁).
+ * @brief 删除路由(修改的是尚未发布的路由表).
  */
-void Router::DeleteRoute_WithoutLock(const std::string& path) {
-    if (routes_.find(path) == routes_.end()) {
+void Router::DeleteRoute(RouteTable* table, const std::string& path) const {
+    auto route_iter = table->routes.find(path);
+    if (route_iter == table->routes.end()) {
         return;
     }
-    auto iter = static_routes_.find(path);
-    if (iter != static_routes_.end()) {
+    table->routes.erase(route_iter);
+    auto iter = table->static_routes.find(path);
+    auto pattern_iter = table->pattern_routes.find(path);
+    if (iter != table->static_routes.end()) {
         /* 删除静态路由 */
-        static_routes_.erase(iter);
+        table->static_routes.erase(iter);
+    }
+    else if (pattern_iter != table->pattern_routes.end()) {
+        /* 删除模式路由 */
+        table->pattern_trie.Remove(pattern_iter->second);
+        table->pattern_routes.erase(pattern_iter);
     }
     else {
         /* 删除正则路由 */
-        for (auto iter = regex_routes_.begin(); iter != regex_routes_.end(); ++iter) {
+        for (auto iter = table->regex_routes.begin(); iter != table->regex_routes.end(); ++iter) {
             if ((*iter)->path == path) {
-                regex_routes_.erase(iter);
+                table->regex_routes.erase(iter);
                 break;
             }
         }
@@ -196,45 +659,49 @@ void Router::DeleteRoute_WithoutLock(const std::string& path) {
  * @brief 检查请求是否命中已注册的路由.
  */
 bool Router::HitRoute(Request& req, Response& res) {
-    ReadLock lck(mutex_);
+    const RouteTable* table = GetTable();
     RoutePtr route;
-    auto iter = static_routes_.find(req.path());
-    if (iter != static_routes_.end()) {
+    auto iter = table->static_routes.find(req.path());
+    if (iter != table->static_routes.end()) {
         route = iter->second;
     }
+    else if ((route = table->pattern_trie.Match(req.path(), &req.route_regex_match_))) {
+        /* 命中模式路由，参数已经保存到`route_regex_match_` */
+    }
     else {
         try {
             REGEX_NAMESPACE::smatch match;
-            for (auto& r : regex_routes_) {
+            for (auto& r : table->regex_routes) {
                 if (!REGEX_NAMESPACE::regex_match(req.path(), match, r->regex)) {
                     continue;
                 }
+                /* 匹配项指向`req.path()`，无需复制 */
+                req.route_regex_match_.clear();
                 req.route_regex_match_.reserve(match.size() - 1);
                 for (size_t i = 1; i < match.size(); ++i) {
-#if IC_SERVER_USE_BOOST_REGEX == 1
-                    req.route_regex_match_.push_back(match.str(static_cast<int>(i)));
-#else
-                    req.route_regex_match_.push_back(match.str(i));
-#endif
+                    const auto& sub = match[i];
+                    size_t offset = sub.matched ? static_cast<size_t>(sub.first - req.path().begin()) : 0;
+                    req.route_regex_match_.emplace_back(req.path().data() + offset, static_cast<size_t>(sub.length()));
                 }
                 route = r;
                 break;
             }
-            if (!route) {
-                cb_invalid_path_(req, res);
-                return false;
-            }
         }
         catch (const std::exception& ex) {
             svr_->logger()->Error(LOG_CTX, "regex_match error, path: %s, err_msg: %s", req.path().c_str(), ex.what());
-            cb_invalid_path_(req, res);
+        }
+        if (!route) {
+            /* 回调函数中可能修改路由，先持有当前路由表 */
+            std::shared_ptr<const RouteTable> holder = s_table_cache.table;
+            holder->cb_invalid_path(req, res);
             return false;
         }
     }
 
     /* 检查路由对应的HTTP请求方法是否匹配 */
     if (!(route->methods & (int)req.method())) {
-        cb_invalid_method_(req, res);
+        std::shared_ptr<const RouteTable> holder = s_table_cache.table;
+        holder->cb_invalid_method(req, res);
         return false;
     }
 
@@ -249,40 +716,49 @@ bool Router::HitRoute(Request& req, Response& res) {
  * @brief 获取路由.
  */
 RouteConstPtr Router::GetRoute(const std::string& path) {
-    ReadLock lck(mutex_);
-    auto find_iter = routes_.find(path);
-    if (find_iter != routes_.end()) {
+    std::shared_ptr<const RouteTable> table = std::atomic_load(&table_);
+    auto find_iter = table->routes.find(path);
+    if (find_iter != table->routes.end()) {
         return find_iter->second;
     }
     return nullptr;
 }
 
 std::unordered_map<std::string, RouteConstPtr> Router::routes() {
-    ReadLock lck(mutex_);
-    return std::unordered_map<std::string, RouteConstPtr>(routes_.begin(), routes_.end());
+    std::shared_ptr<const RouteTable> table = std::atomic_load(&table_);
+    return std::unordered_map<std::string, RouteConstPtr>(table->routes.begin(), table->routes.end());
 }
 
 std::unordered_map<std::string, StaticRouteConstPtr> Router::static_routes() {
-    ReadLock lck(mutex_);
-    return std::unordered_map<std::string, StaticRouteConstPtr>(static_routes_.begin(), static_routes_.end());
+    std::shared_ptr<const RouteTable> table = std::atomic_load(&table_);
+    return std::unordered_map<std::string, StaticRouteConstPtr>(table->static_routes.begin(), table->static_routes.end());
 }
 
 std::vector<RegexRouteConstPtr> Router::regex_routes() {
-    ReadLock lck(mutex_);
-    return std::vector<RegexRouteConstPtr>(regex_routes_.begin(), regex_routes_.end());
+    std::shared_ptr<const RouteTable> table = std::atomic_load(&table_);
+    return std::vector<RegexRouteConstPtr>(table->regex_routes.begin(), table->regex_routes.end());
+}
+
+std::unordered_map<std::string, PatternRouteConstPtr> Router::pattern_routes() {
+    std::shared_ptr<const RouteTable> table = std::atomic_load(&table_);
+    return std::unordered_map<std::string, PatternRouteConstPtr>(table->pattern_routes.begin(), table->pattern_routes.end());
 }
 
 void Router::set_cb_invalid_path(Route::ResponseCallback cb) {
-    WriteLock lck(mutex_);
     if (cb) {
-        cb_invalid_path_ = cb;
+        std::lock_guard<std::mutex> lck(mutex_);
+        std::shared_ptr<RouteTable> table = CloneTable();
+        table->cb_invalid_path = cb;
+        PublishTable(table);
     }
 }
 
 void Router::set_cb_invalid_method(Route::ResponseCallback cb) {
-    WriteLock lck(mutex_);
     if (cb) {
-        cb_invalid_method_ = cb;
+        std::lock_guard<std::mutex> lck(mutex_);
+        std::shared_ptr<RouteTable> table = CloneTable();
+        table->cb_invalid_method = cb;
+        PublishTable(table);
     }
 }
 
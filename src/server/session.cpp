@@ -4,102 +4,449 @@
 #include "server/request_raw.h"
 #include "server/router.h"
 #include "server/util/format_time.h"
+#include "server/util/gmt_time.h"
+#include "access_log.h"
+#include "compression.h"
+#include "handler_pool.h"
+#include "http2_session.h"
+#include "metrics.h"
+#include "websocket_session.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/strand.hpp>
+#ifdef IC_SERVER_HAS_SENDFILE
+#  include <errno.h>
+#  include <sys/sendfile.h>
+#endif
 
 namespace ic {
 namespace server {
 
-Session::Session(tcp::socket&& socket, HttpServer* svr)
-    : svr_(svr), stream_(std::move(socket)), remote_endpoint_(stream_.socket().remote_endpoint())
+Session::Session(SessionStream&& stream, HttpServer* svr)
+    : svr_(svr), stream_(std::move(stream)), remote_endpoint_(stream_.socket().remote_endpoint())
+    , heartbeat_timer_(stream_.get_executor())
+#ifdef IC_SERVER_HAS_SENDFILE
+    , send_timer_(stream_.get_executor())
+#endif
 {
     svr_->logger()->Debug(LOG_CTX, "New session from %s:%hu", remote_endpoint_.address().to_string().c_str(), remote_endpoint_.port());
     svr_->OnNewSession();
 }
 
 Session::~Session() {
+    if (stream_writer_) {
+        stream_writer_->Abort();
+    }
     svr_->logger()->Debug(LOG_CTX, "Destroy session %s:%hu", remote_endpoint_.address().to_string().c_str(), remote_endpoint_.port());
     svr_->OnDestroySession();
 }
 
 void Session::Run() {
+#if IC_SERVER_USE_OPENSSL == 1
+    if (stream_.is_tls()) {
+        /* TLS握手也受`tcp_stream_timeout_ms`限制 */
+        UpdateStreamTimeout();
+        stream_.tls().async_handshake(net::ssl::stream_base::server,
+            beast::bind_front_handler(&Session::OnHandshake, shared_from_this()));
+        return;
+    }
+#endif
     net::dispatch(stream_.get_executor(), beast::bind_front_handler(&Session::DoRead, shared_from_this()));
 }
 
+#if IC_SERVER_USE_OPENSSL == 1
+void Session::OnHandshake(beast::error_code ec) {
+    if (ec) {
+        svr_->logger()->Debug(LOG_CTX, "TLS handshake failed, %s", ec.message().c_str());
+        return;
+    }
+    /* ALPN协商为HTTP/2(仅启用HTTP/2时提供) */
+    const unsigned char* alpn = nullptr;
+    unsigned int alpn_len = 0;
+    SSL_get0_alpn_selected(stream_.tls().native_handle(), &alpn, &alpn_len);
+    if (alpn_len == 2 && memcmp(alpn, "h2", 2) == 0) {
+        return UpgradeHttp2();
+    }
+    DoRead();
+}
+#endif
+
 void Session::DoRead() {
-    parser_ = std::make_shared<http::request_parser<http::string_body>>();
-    parser_->eager(true);
-    /* 限制body大小 */
-    uint64_t body_limit = svr_->config().body_limit();
-    parser_->body_limit(body_limit > 0 ? body_limit : (uint64_t)1024 * 1024 * 10);   /* 默认限制大小10MB */
+    if (reading_ || read_closed_ || exchanges_.size() >= std::max(1U, svr_->config().max_pipeline_depth())) {
+        return;
+    }
+    /**
+     * 仍有请求未响应完毕时，只解析已经在缓冲区中的后续请求(管线化)，
+     * 不在此期间等待新数据，避免keep-alive超时中断正在处理的请求.
+     */
+    if (!exchanges_.empty() && buffer_.size() == 0) {
+        return;
+    }
+    reading_ = true;
+    reading_ex_ = AcquireExchange();
+    auto& parser = reading_ex_->parser;
+    parser.emplace();
+    parser->get().body().swap(reading_ex_->body_buffer);  /* 复用body缓冲区 */
+    /* 只解析请求头，body大小在匹配路由之后限制(`boost::none`在boost 1.74中会拒绝所有带`Content-Length`的请求) */
+    parser->eager(false);
+    parser->body_limit(UINT64_MAX);
     /* TCP连接超时(keep-alive最长时间) */
-    unsigned int tcp_stream_timeout_ms = svr_->config().tcp_stream_timeout_ms();
-    if (tcp_stream_timeout_ms > 0) {
-        stream_.expires_after(std::chrono::milliseconds(tcp_stream_timeout_ms));
+    UpdateStreamTimeout();
+    /* 先读取请求头，匹配路由之后再读取body */
+    http::async_read_header(stream_, buffer_, *parser, beast::bind_front_handler(&Session::OnReadHeader, shared_from_this()));
+}
+
+/**
+ * @brief 请求头读取完毕，匹配路由，按照路由的设置读取body.
+ */
+void Session::OnReadHeader(beast::error_code ec, size_t/* bytes_transferred*/) {
+    if (ec) {
+        reading_ = false;
+        RecycleExchange(std::move(reading_ex_));
+        /* HTTP/2连接前言(h2c，客户端预先知道服务器支持HTTP/2)，解析器不接受`HTTP/2.0`，未解析的数据仍在缓冲区中 */
+        if (ec == http::error::bad_version && exchanges_.empty() && svr_->config().http2_enabled()) {
+            size_t size = std::min(buffer_.size(), kHttp2ClientPrefaceSize);
+            if (memcmp(buffer_.data().data(), kHttp2ClientPreface, size) == 0) {
+                return UpgradeHttp2();
+            }
+        }
+        return OnReadError(ec);
     }
-    else {
-        stream_.expires_never();
+
+    auto& ex = reading_ex_;
+    auto& parser = ex->parser;
+    auto req_raw = (RequestRaw*)(&(parser->get()));
+
+    ex->res = std::allocate_shared<Response>(util::ArenaAllocator<Response>(&ex->arena), svr_);
+    ex->res->set_keep_alive(req_raw->keep_alive());
+    if (!req_raw->keep_alive()) {
+        /* 客户端请求关闭连接，不再读取后续请求 */
+        read_closed_ = true;
     }
-    http::async_read(stream_, buffer_, *parser_, beast::bind_front_handler(&Session::OnRead, shared_from_this()));
+
+    ex->req = std::allocate_shared<Request>(util::ArenaAllocator<Request>(&ex->arena),
+        svr_, req_raw, remote_endpoint_.address().to_string(), &ex->arena);
+
+    /* 检查是否命中路由 */
+    ex->route_hit = svr_->router()->HitRoute(*ex->req, *ex->res);
+    const Route* route = ex->route_hit ? ex->req->route_.get() : nullptr;
+
+    /* 限制body大小(优先使用路由的设置) */
+    uint64_t body_limit = (route && route->body_limit > 0) ? route->body_limit : svr_->config().body_limit();
+    if (body_limit == 0) {
+        body_limit = (uint64_t)1024 * 1024 * 10;   /* 默认限制大小10MB */
+    }
+    auto content_length = parser->content_length();
+    if (content_length && *content_length > body_limit) {
+        return OnRead(http::error::body_limit, 0);
+    }
+    parser->body_limit(body_limit);
+    parser->eager(true);
+
+    if (route && route->body_chunk_callback) {
+        /* 流式接收body，请求拦截器(1)在接收之前执行 */
+        if (svr_->cb_before_parse_body_ && !svr_->cb_before_parse_body_(*ex->req, *ex->res)) {
+            ex->body_aborted = true;
+            return OnRead(beast::error_code(), 0);
+        }
+        return OnReadBodyChunk(beast::error_code(), 0);
+    }
+    if (parser->is_done()) {
+        return OnRead(beast::error_code(), 0);
+    }
+    http::async_read(stream_, buffer_, *parser, beast::bind_front_handler(&Session::OnRead, shared_from_this()));
 }
 
-void Session::OnRead(beast::error_code ec, size_t/* bytes_transferred*/) {
-    res_ = std::make_shared<Response>(svr_);
+/**
+ * @brief 流式接收body，将已解析的body交给路由的回调函数后清空，继续读取.
+ *
+ * @details 每次最多读取64KB，内存占用与body大小无关.
+ */
+void Session::OnReadBodyChunk(beast::error_code ec, size_t/* bytes_transferred*/) {
+    if (ec) {
+        return OnRead(ec, 0);
+    }
+    auto& ex = reading_ex_;
+    auto& parser = ex->parser;
+    std::string& body = parser->get().body();
+    if (!body.empty()) {
+        ex->body_streamed += body.size();
+        bool ok = ex->req->route_->body_chunk_callback(*ex->req, *ex->res, body.data(), body.size());
+        body.clear();
+        if (!ok) {
+            ex->body_aborted = true;
+            return OnRead(beast::error_code(), 0);
+        }
+    }
+    if (parser->is_done()) {
+        return OnRead(beast::error_code(), 0);
+    }
+    http::async_read_some(stream_, buffer_, *parser, beast::bind_front_handler(&Session::OnReadBodyChunk, shared_from_this()));
+}
 
+/**
+ * @brief 请求读取完毕(或者中止接收body)，处理请求.
+ */
+void Session::OnRead(beast::error_code ec, size_t/* bytes_transferred*/) {
+    reading_ = false;
+    ExchangePtr ex = std::move(reading_ex_);
     if (ec) {
+        RecycleExchange(std::move(ex));
         return OnReadError(ec);
     }
+    if (ex->body_aborted) {
+        /* body尚未读取完毕，无法继续解析后续请求 */
+        read_closed_ = true;
+        ex->res->set_keep_alive(false);
+    }
+    exchanges_.push_back(ex);
+
+    svr_->OnStartHandlingRequest(ex->req.get());
+    if (!PreHandleRequest(svr_, ex)) {
+        FinishRequest(ex);
+    }
+    else if (ex->req->route()->websocket && UpgradeWebSocket(ex)) {
+        return;
+    }
+    else if (ex->req->route()->blocking && svr_->handler_pool_) {
+        DispatchToHandlerPool(ex);
+    }
+    else {
+        HandleRequest(ex, false);
+    }
 
-    auto req_raw = (RequestRaw*)(&(parser_->get()));
-    res_->set_keep_alive(req_raw->keep_alive());
+    /* 管线化：在返回响应的同时，继续读取(可能已经在缓冲区中的)后续请求 */
+    DoRead();
+}
+
+/**
+ * @brief 将连接移交给WebSocket会话.
+ *
+ * @details 只处理连接上唯一的请求(没有管线化的请求)，之后当前会话不再读写该连接.
+ *
+ * @return 不是升级请求，或者有管线化的请求时返回false(按照普通请求处理)
+ */
+bool Session::UpgradeWebSocket(const ExchangePtr& ex) {
+    const http::request<http::string_body>& raw = *ex->req->raw_;
+    if (!websocket::is_upgrade(raw)) {
+        return false;
+    }
+    if (exchanges_.size() != 1 || buffer_.size() > 0) {
+        svr_->logger()->Warn(LOG_CTX, "WebSocket upgrade refused, %s. (path:%s)",
+            exchanges_.size() != 1 ? "pipelined requests are pending" : "data received after the upgrade request", ex->req->path().c_str());
+        return false;
+    }
+    ex->res->status_code_ = 101;
+    /* 响应拦截器(与普通响应一致)，设置的响应头在握手时写入101响应 */
+    svr_->cb_before_send_response_ && svr_->cb_before_send_response_(*ex->req, *ex->res);
+    ex->req->time_consumed_total_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - ex->req->arrive_timepoint());
+    ex->done = true;
+    LogAccess(svr_, ex, 0);
+    RecordMetrics(svr_, ex, 0);
+    svr_->OnFinishHandlingRequest(ex->req.get());
+    exchanges_.clear();
+    read_closed_ = true;
+    auto ws = std::make_shared<WebSocketSession>(std::move(stream_), svr_, ex->req->route()->websocket);
+    ws->Run(ex);
+    return true;
+}
 
-    auto client_ip = stream_.socket().remote_endpoint().address();
-    req_ = std::make_shared<Request>(svr_, req_raw, client_ip.to_string());
+/**
+ * @brief 将连接移交给HTTP/2会话.
+ *
+ * @details ALPN协商为`h2`(TLS握手之后)，或者收到h2c的连接前言(没有其他请求)，之后当前会话不再读写该连接.
+ * @details 缓冲区中已经读取的数据(包括连接前言)交给HTTP/2会话解析.
+ */
+void Session::UpgradeHttp2() {
+    read_closed_ = true;
+    auto h2 = std::make_shared<Http2Session>(std::move(stream_), svr_, remote_endpoint_);
+    h2->Run(std::move(buffer_));
+}
 
-    svr_->OnStartHandlingRequest(req_.get());
-    if (PreHandleRequest()) {
-        HandleRequest();
+/**
+ * @brief 在处理线程池中执行阻塞型路由，完成后回到当前会话的executor返回响应.
+ */
+void Session::DispatchToHandlerPool(const ExchangePtr& ex) {
+    auto self = shared_from_this();
+    bool ok = svr_->handler_pool_->TryPost([self, ex] {
+        self->HandleRequest(ex, true);
+    }, [self, ex] {
+        /* 线程池停止: 立即结束请求(服务器停止后executor可能不再运行)，之后再尝试返回响应 */
+        ex->res->SetStringBody(503U, "Service Unavailable", "text/plain");
+        self->svr_->OnFinishHandlingRequest(ex->req.get());
+        net::post(self->stream_.get_executor(), beast::bind_front_handler(&Session::FinishRequest, self, ex));
+    });
+    if (!ok) {
+        svr_->logger()->Warn(LOG_CTX, "Handler pool is busy, reject request: %s", ex->req->path().c_str());
+        ex->res->SetStringBody(503U, "Service Unavailable", "text/plain");
+        FinishRequest(ex);
     }
-    svr_->OnFinishHandlingRequest(req_.get());
+}
 
-    req_->time_consumed_total_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - req_->arrive_timepoint());
-    SendResponse();
+/**
+ * @brief 请求处理完毕，按照请求顺序返回响应内容.
+ */
+void Session::FinishRequest(const ExchangePtr& ex) {
+    svr_->OnFinishHandlingRequest(ex->req.get());
+    ex->req->time_consumed_total_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - ex->req->arrive_timepoint());
+    ex->done = true;
+    DoWrite();
+}
+
+/**
+ * @brief 设置TCP连接超时时间.
+ */
+void Session::UpdateStreamTimeout() {
+    unsigned int tcp_stream_timeout_ms = svr_->config().tcp_stream_timeout_ms();
+    if (tcp_stream_timeout_ms > 0) {
+        stream_.expires_after(std::chrono::milliseconds(tcp_stream_timeout_ms));
+    }
+    else {
+        stream_.expires_never();
+    }
 }
 
 void Session::OnReadError(beast::error_code ec) {
+    read_closed_ = true;
     if (ec == beast::error::timeout) {
         svr_->logger()->Debug(LOG_CTX, "OnRead error, %s", ec.message().c_str());
     }
     else if (ec == http::error::body_limit) {
         svr_->logger()->Error(LOG_CTX, "Body limit");
-        res_->SetStringBody(413, "body limit exceeded", "text/plain");
-        close_ = true;  /* 返回413后关闭连接，不然会出现 http:error::bad_method 错误 */
-        SendResponse();
+        /* 返回413后关闭连接，不然会出现 http:error::bad_method 错误 */
+        auto ex = AcquireExchange();
+        ex->res = std::allocate_shared<Response>(util::ArenaAllocator<Response>(&ex->arena), svr_);
+        ex->res->SetStringBody(413, "body limit exceeded", "text/plain");
+        ex->res->set_keep_alive(false);
+        ex->done = true;
+        exchanges_.push_back(ex);
+        return DoWrite();
     }
-    else {
-        if (ec != http::error::end_of_stream) {
-            svr_->logger()->Error(LOG_CTX, "OnRead error, %s", ec.message().c_str());
-        }
+#if IC_SERVER_USE_OPENSSL == 1
+    else if (ec == net::ssl::error::stream_truncated) {
+        /* 客户端未发送`close_notify`直接断开TLS连接 */
+        svr_->logger()->Debug(LOG_CTX, "OnRead error, %s", ec.message().c_str());
+    }
+#endif
+    else if (ec != http::error::end_of_stream) {
+        svr_->logger()->Error(LOG_CTX, "OnRead error, %s", ec.message().c_str());
+    }
+    /* 等待已读取的请求响应完毕后再关闭连接 */
+    if (exchanges_.empty()) {
         DoClose();
     }
 }
 
-void Session::OnWrite(bool close, beast::error_code ec, size_t/* bytes_transferred*/) {
-    if (string_res_) {
-        string_res_.reset();
+/**
+ * @brief 如果最早的请求已经处理完毕，返回其响应内容.
+ */
+void Session::DoWrite() {
+    if (closing_ || writing_ || exchanges_.empty() || !exchanges_.front()->done) {
+        return;
+    }
+    writing_ = true;
+    SendResponse(exchanges_.front());
+}
+
+/**
+ * @brief 获取一个空闲的(已回收的)请求对象.
+ */
+ExchangePtr Session::AcquireExchange() {
+    if (free_exchanges_.empty()) {
+        return std::make_shared<Exchange>();
+    }
+    ExchangePtr ex = std::move(free_exchanges_.back());
+    free_exchanges_.pop_back();
+    return ex;
+}
+
+/**
+ * @brief 回收已经响应完毕的请求，供后续请求复用.
+ *
+ * @details 如果其他地方(如处理线程池中尚未析构的任务)仍然持有该请求，则不回收.
+ */
+void Session::RecycleExchange(ExchangePtr&& ex) {
+    if (ex && ResetExchange(ex) && free_exchanges_.size() < std::max(1U, svr_->config().max_pipeline_depth())) {
+        free_exchanges_.push_back(std::move(ex));
     }
-    if (file_res_) {
-        if (file_res_->body().is_open()) {
-            file_res_->body().close();
+}
+
+/**
+ * @brief 清空请求对象，以便复用.
+ *
+ * @return 其他地方(如处理线程池中尚未析构的任务)仍然持有该请求时，不清空，返回false
+ */
+bool Session::ResetExchange(const ExchangePtr& ex) {
+    if (ex.use_count() != 1) {
+        return false;
+    }
+    ex->req.reset();
+    ex->res.reset();
+    if (ex->parser) {
+        /* 取回body缓冲区，保留其容量(过大的直接释放) */
+        ex->body_buffer.swap(ex->parser->get().body());
+        ex->parser = boost::none;
+        if (ex->body_buffer.capacity() > kExchangeMaxRetainedBodyCapacity) {
+            std::string().swap(ex->body_buffer);
         }
-        file_res_.reset();
+        ex->body_buffer.clear();
+    }
+    ex->arena.Reset();
+    ex->handle_start_time = std::chrono::system_clock::time_point();
+    ex->body_streamed = 0;
+    ex->response_body_size = 0;
+    ex->route_hit = false;
+    ex->body_aborted = false;
+    ex->done = false;
+    return true;
+}
+
+void Session::OnWrite(bool close, beast::error_code ec, size_t/* bytes_transferred*/) {
+    writing_ = false;
+    /* 先释放响应对象(从该请求的内存池分配)，再回收请求 */
+    string_res_ = boost::none;
+    file_serializer_ = boost::none;
+    file_res_ = boost::none;
+    span_res_ = boost::none;
+    header_serializer_ = boost::none;
+    header_res_ = boost::none;
+    sending_file_.reset();
+    sending_content_.reset();
+    sending_data_ = nullptr;
+    send_segments_.clear();
+    if (stream_writer_) {
+        stream_writer_->Abort();  /* 已经发送完毕时无影响 */
+        stream_writer_.reset();
+    }
+    stream_chunks_.clear();
+    stream_writing_ = false;
+    heartbeat_timer_.cancel();
+    if (read_file_.is_open()) {
+        beast::error_code close_ec;
+        read_file_.close(close_ec);
+    }
+    ExchangePtr& ex = exchanges_.front();
+    if (ex->req) {
+        RecordMetrics(svr_, ex, ex->req->raw_->body().size() + ex->body_streamed);
     }
+    RecycleExchange(std::move(ex));
+    exchanges_.pop_front();
     if (ec) {
-        return OnWriteError(ec);
+        OnWriteError(ec);
+        return DoClose();
+    }
+    if (close) {
+        /* 丢弃之后的请求 */
+        read_closed_ = true;
+        return DoClose();
     }
-    if (close || close_) {
+    if (read_closed_ && exchanges_.empty() && !reading_) {
         return DoClose();
     }
+    DoWrite();
     DoRead();
 }
 
@@ -113,40 +460,84 @@ void Session::OnWriteError(beast::error_code ec) {
 }
 
 void Session::DoClose() {
+    if (closing_) {
+        return;
+    }
+    closing_ = true;
+    /**
+     * 丢弃尚未返回的响应: 已经处理完毕的请求已经结束(`FinishRequest`)，直接回收；
+     * 仍在处理中的请求由处理完毕时的`FinishRequest`结束，之后不再发送.
+     */
+    while (!exchanges_.empty()) {
+        RecycleExchange(std::move(exchanges_.front()));
+        exchanges_.pop_front();
+    }
+#if IC_SERVER_USE_OPENSSL == 1
+    /**
+     * TLS连接先发送`close_notify`(客户端据此判断以关闭连接结束的响应是否完整)，
+     * 仍有读取挂起时(读写不能与关闭同时进行)直接关闭TCP连接.
+     */
+    if (stream_.is_tls() && !reading_) {
+        UpdateStreamTimeout();
+        stream_.tls().async_shutdown(beast::bind_front_handler(&Session::OnShutdown, shared_from_this()));
+        return;
+    }
+#endif
     beast::error_code ec;
     stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
-    if (ec) {
+    if (ec && ec != net::error::not_connected) {
         svr_->logger()->Error(LOG_CTX, "Socket.ShutdownBoth failed, %s", ec.message().c_str());
     }
 }
 
+#if IC_SERVER_USE_OPENSSL == 1
+void Session::OnShutdown(beast::error_code ec) {
+    /* 客户端可能不回复`close_notify`就断开连接 */
+    if (ec && ec != net::error::eof && ec != net::ssl::error::stream_truncated && ec != beast::error::timeout) {
+        svr_->logger()->Debug(LOG_CTX, "TLS shutdown failed, %s", ec.message().c_str());
+    }
+    stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+}
+#endif
+
 /**
  * @brief 预处理请求.
  */
-bool Session::PreHandleRequest() {
-    /* 检查是否命中路由 */
-    if (!svr_->router()->HitRoute(*req_, *res_)) {
+bool Session::PreHandleRequest(HttpServer* svr, const ExchangePtr& ex) {
+    Request& req = *ex->req;
+    Response& res = *ex->res;
+
+    /* 检查是否命中路由(读取请求头之后已经匹配) */
+    if (!ex->route_hit || ex->body_aborted) {
         return false;
     }
 
+    /* 流式接收的body已经交给路由的回调函数，不再解析 */
+    if (req.route_->body_chunk_callback) {
+        if (svr->config().log_access_verbose()) {
+            req.LogAccessVerbose();
+        }
+        return !svr->cb_before_handle_request_ || svr->cb_before_handle_request_(req, res);
+    }
+
     /* 请求拦截器(1) */
-    if (svr_->cb_before_parse_body_ && !svr_->cb_before_parse_body_(*req_, *res_)) {
+    if (svr->cb_before_parse_body_ && !svr->cb_before_parse_body_(req, res)) {
         return false;
     }
 
     /* 解析body */
-    bool ok = req_->ParseBody();
-    if (svr_->config().log_access_verbose()) {
-        req_->LogAccessVerbose();
+    bool ok = req.ParseBody();
+    if (svr->config().log_access_verbose()) {
+        req.LogAccessVerbose();
     }
     if (!ok) {
-        res_->SetBadRequest("Bad request!");
-        svr_->logger()->Error(LOG_CTX, "Bad request. Parse request body failed");
+        res.SetBadRequest("Bad request!");
+        svr->logger()->Error(LOG_CTX, "Bad request. Parse request body failed");
         return false;
     }
 
     /* 请求拦截器(2) */
-    if (svr_->cb_before_handle_request_ && !svr_->cb_before_handle_request_(*req_, *res_)) {
+    if (svr->cb_before_handle_request_ && !svr->cb_before_handle_request_(req, res)) {
         return false;
     }
 
@@ -155,55 +546,461 @@ bool Session::PreHandleRequest() {
 
 /**
  * @brief 处理请求.
+ *
+ * @param in_handler_pool 是否在处理线程池中执行，此时需要回到当前会话的executor返回响应
  */
-void Session::HandleRequest() {
-    auto start = std::chrono::system_clock::now();
-    req_->route()->Invoke(*req_, *res_);
-    auto finish = std::chrono::system_clock::now();
-    req_->time_consumed_handle_ = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start);
+void Session::HandleRequest(const ExchangePtr& ex, bool in_handler_pool) {
+    ex->handle_start_time = std::chrono::system_clock::now();
+    auto& route = ex->req->route_;
+    if (route->is_async()) {
+        /* 异步路由：等待回调函数调用`ResponseCompletion`后再返回响应 */
+        auto self = shared_from_this();
+        route->InvokeAsync(*ex->req, *ex->res, ResponseCompletion([self, ex] {
+            net::post(self->stream_.get_executor(), beast::bind_front_handler(&Session::OnHandleRequestDone, self, ex));
+        }, [self, ex] {
+            self->svr_->logger()->Error(LOG_CTX, "Async route did not complete the response. (path:%s)", ex->req->route_->path.c_str());
+            ex->res->SetStringBody(500U, "Internal Server Error", "text/plain");
+        }));
+        return;
+    }
+    route->Invoke(*ex->req, *ex->res);
+    if (in_handler_pool) {
+        net::post(stream_.get_executor(), beast::bind_front_handler(&Session::OnHandleRequestDone, shared_from_this(), ex));
+    }
+    else {
+        OnHandleRequestDone(ex);
+    }
+}
+
+/**
+ * @brief 路由回调函数执行完毕.
+ */
+void Session::OnHandleRequestDone(const ExchangePtr& ex) {
+    ex->req->time_consumed_handle_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - ex->handle_start_time);
+    FinishRequest(ex);
 }
 
 /**
  * @brief 返回响应内容.
  */
-void Session::SendResponse() {
+void Session::SendResponse(const ExchangePtr& ex) {
+    /* 处理请求可能耗时较长，重新计算超时时间 */
+    UpdateStreamTimeout();
     /* 响应拦截器 */
-    svr_->cb_before_send_response_ && svr_->cb_before_send_response_(*req_, *res_);
-    return res_->is_file_body_ ? SendFileBodyResponse() : SendStringBodyResponse();
+    if (ex->req) {
+        svr_->cb_before_send_response_ && svr_->cb_before_send_response_(*ex->req, *ex->res);
+    }
+    if (ex->res->stream_writer_) {
+        return SendStreamBodyResponse(ex);
+    }
+    return ex->res->is_file_body_ ? SendFileBodyResponse(ex) : SendStringBodyResponse(ex);
+}
+
+/**
+ * @brief 查找响应头(不区分大小写).
+ */
+static const std::string* s_find_header(const std::multimap<std::string, std::string>& headers, const char* name) {
+    for (const auto& p : headers) {
+        if (beast::iequals(p.first, name)) {
+            return &p.second;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief ETag列表(`If-None-Match`请求头)中是否包含指定的ETag(弱比较).
+ */
+static bool s_etag_list_contains(boost::string_view list, boost::string_view etag) {
+    if (etag.starts_with("W/")) {
+        etag.remove_prefix(2);
+    }
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == boost::string_view::npos) {
+            end = list.size();
+        }
+        auto item = list.substr(pos, end - pos);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+            item.remove_suffix(1);
+        }
+        if (item.starts_with("W/")) {
+            item.remove_prefix(2);
+        }
+        if (item == "*" || item == etag) {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+/**
+ * @brief 文件是否未被修改(条件请求，返回`304 Not Modified`).
+ *
+ * @details 优先检查`If-None-Match`，不存在时检查`If-Modified-Since`.
+ */
+static bool s_is_not_modified(const Request& req, const std::string& etag, int64_t mtime) {
+    if (req.method() != HttpMethod::kGET && req.method() != HttpMethod::kHEAD) {
+        return false;
+    }
+    const RequestRaw& raw = *req.raw();
+    auto if_none_match = raw[http::field::if_none_match];
+    if (!if_none_match.empty()) {
+        return s_etag_list_contains(if_none_match, etag);
+    }
+    auto if_modified_since = raw[http::field::if_modified_since];
+    if (!if_modified_since.empty()) {
+        time_t since = 0;
+        return util::parse_gmt_time(if_modified_since.data(), if_modified_since.size(), &since) && mtime <= (int64_t)since;
+    }
+    return false;
+}
+
+/**
+ * @brief `If-Range`请求头是否与当前文件匹配(不存在时视为匹配).
+ *
+ * @details 值为ETag时使用强比较，为日期时须与最后修改时间完全相同.
+ */
+static bool s_is_if_range_matched(const Request& req, const std::string& etag, int64_t mtime) {
+    auto if_range = (*req.raw())[http::field::if_range];
+    if (if_range.empty()) {
+        return true;
+    }
+    /* 弱校验的ETag不匹配 */
+    if (if_range.front() == '"') {
+        return if_range == etag;
+    }
+    if (if_range.starts_with("W/")) {
+        return false;
+    }
+    time_t time = 0;
+    return util::parse_gmt_time(if_range.data(), if_range.size(), &time) && (int64_t)time == mtime;
+}
+
+/**
+ * @brief `multipart/byteranges`的分隔符.
+ */
+static std::string s_make_boundary() {
+    static std::atomic<uint64_t> s_counter{0};
+    uint64_t ticks = (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%016llx%08llx", (unsigned long long)ticks, (unsigned long long)(++s_counter & 0xffffffff));
+    return buf;
+}
+
+static std::string s_content_range(uint64_t first, uint64_t last, uint64_t size) {
+    return "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(size);
 }
 
 /**
  * @brief 返回文件内容.
+ *
+ * @details 内容缓存在内存中的文件直接从内存发送，否则支持时使用`sendfile`，不支持时使用`http::file_body`.
+ */
+void Session::SendFileBodyResponse(const ExchangePtr& ex) {
+    PreparedFileBody body;
+    PrepareFileBody(svr_, ex, &body);
+    switch (body.kind) {
+    case PreparedFileBody::kString:
+        return SendStringBodyResponse(ex);
+    case PreparedFileBody::kHeader:
+        return SendFileHeader(ex, std::move(body.file), std::move(body.compressed), body.content_length, true);
+    case PreparedFileBody::kContent:
+        return SendCachedFileResponse(ex, std::move(body.file), std::move(body.compressed));
+    case PreparedFileBody::kSegments:
+        send_segments_ = std::move(body.segments);
+        return SendFileHeader(ex, std::move(body.file), std::move(body.compressed), body.content_length, false);
+    default:
+        break;
+    }
+#ifdef IC_SERVER_HAS_SENDFILE
+    if (svr_->config().use_sendfile() && body.file->fd >= 0 && !stream_.is_tls()) {
+        send_segments_.push_back(FileBodySegment{ std::string(), 0, body.content_length });
+        return SendFileHeader(ex, std::move(body.file), nullptr, body.content_length, false);
+    }
+#endif
+    SendFileByFileBody(ex, body.file->path);
+}
+
+/**
+ * @brief 准备文件响应的内容.
+ *
+ * @details 文件从文件缓存中获取，附带`ETag`和`Last-Modified`响应头，条件请求命中时返回`304 Not Modified`.
+ * @details 支持`Range`请求(`206 Partial Content`，多个范围时为`multipart/byteranges`)，范围针对所选的(压缩)版本.
+ */
+void Session::PrepareFileBody(HttpServer* svr, const ExchangePtr& ex, PreparedFileBody* body) {
+    auto& req = ex->req;
+    auto& res = ex->res;
+    CachedFilePtr file = svr->file_cache_->Open(res->filepath_);
+    if (!file) {
+        res->SetStringBody(404U); // return 404 Not Found
+        body->kind = PreparedFileBody::kString;
+        return;
+    }
+
+    std::shared_ptr<const std::string> compressed;
+    if (res->status_code_ == 200U) {
+        /* 条件请求按照原始文件的修改时间、所选版本的ETag判断 */
+        int64_t mtime = file->mtime;
+        std::string etag = file->etag;
+        res->SetHeader("Last-Modified", file->last_modified);
+        res->SetHeader("Accept-Ranges", "bytes");
+        SelectFileEncoding(svr, ex, &file, &compressed, &etag);
+        res->SetHeader("ETag", etag);
+        if (req && s_is_not_modified(*req, etag, mtime)) {
+            res->SetStringBody(304U);
+            body->kind = PreparedFileBody::kString;
+            return;
+        }
+
+        /* 范围请求(仅GET)，`If-Range`不匹配时返回完整内容 */
+        if (req && req->method_ == HttpMethod::kGET) {
+            auto range = (*req->raw_)[http::field::range];
+            if (!range.empty() && s_is_if_range_matched(*req, etag, mtime)) {
+                uint64_t size = compressed ? compressed->size() : file->size;
+                std::vector<ByteRange> ranges;
+                switch (parse_byte_ranges(range, size, &ranges)) {
+                case ByteRangeResult::kPartial:
+                    body->file = std::move(file);
+                    body->compressed = std::move(compressed);
+                    return PrepareFileRanges(ex, ranges, body);
+                case ByteRangeResult::kNotSatisfiable:
+                    res->SetStringBody(416U);
+                    res->SetHeader("Content-Range", "bytes */" + std::to_string(size));
+                    body->kind = PreparedFileBody::kString;
+                    return;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+
+    body->content_length = compressed ? compressed->size() : file->size;
+    if (req && req->method_ == HttpMethod::kHEAD) {
+        /* HEAD请求只返回响应头 */
+        body->kind = PreparedFileBody::kHeader;
+    }
+    else if (compressed || file->has_content) {
+        body->kind = PreparedFileBody::kContent;
+    }
+    else {
+        body->kind = PreparedFileBody::kFile;
+    }
+    body->file = std::move(file);
+    body->compressed = std::move(compressed);
+}
+
+/**
+ * @brief 根据`Accept-Encoding`请求头选择文件的压缩版本.
+ *
+ * @details 只处理类型适合压缩的文件(图片等二进制文件不查找预压缩文件).
+ * @details 优先使用同目录下的预压缩文件(如`app.js.br`, `app.js.gz`)，
+ * @details 其次使用文件缓存中的压缩结果(仅内容缓存在内存中的文件).
+ *
+ * @param[in,out] file 使用预压缩文件时，替换为预压缩文件
+ * @param[out] compressed 使用文件缓存中的压缩结果
+ * @param[in,out] etag 所选版本的ETag
+ */
+void Session::SelectFileEncoding(HttpServer* svr, const ExchangePtr& ex, CachedFilePtr* file,
+    std::shared_ptr<const std::string>* compressed, std::string* etag)
+{
+    auto& req = ex->req;
+    auto& res = ex->res;
+    const auto& config = svr->config();
+    if (!req || !config.compression_enabled() || s_find_header(res->headers_, "Content-Encoding")) {
+        return;
+    }
+    const std::string* content_type = s_find_header(res->headers_, "Content-Type");
+    if (!content_type || !is_compressible_mimetype(*content_type)) {
+        return;
+    }
+    res->SetHeader("Vary", "Accept-Encoding");
+
+    ContentEncoding encodings[(int)ContentEncoding::kCount];
+    int count = negotiate_encodings(req->raw_->operator[](http::field::accept_encoding), encodings);
+
+    /* 预压缩文件 */
+    for (int i = 0; i < count; ++i) {
+        const char* ext = get_encoding_file_ext(encodings[i]);
+        if (!ext) {
+            continue;
+        }
+        CachedFilePtr precompressed = svr->file_cache_->Open((*file)->path + ext);
+        if (precompressed) {
+            *etag = precompressed->etag;
+            *file = std::move(precompressed);
+            res->SetHeader("Content-Encoding", to_string(encodings[i]));
+            return;
+        }
+    }
+
+    if (!(*file)->has_content || (*file)->size < config.compression_min_size()) {
+        return;
+    }
+
+    /* 文件缓存中的压缩结果(同一文件只压缩一次) */
+    for (int i = 0; i < count; ++i) {
+        if (!is_encoding_supported(encodings[i])) {
+            continue;
+        }
+        *compressed = svr->file_cache_->GetCompressed(*file, encodings[i]);
+        if (*compressed) {
+            etag->insert(etag->size() - 1, std::string("-") + to_string(encodings[i]));
+            res->SetHeader("Content-Encoding", to_string(encodings[i]));
+        }
+        return;
+    }
+}
+
+/**
+ * @brief 返回内容缓存在内存中的文件，或者其压缩结果(不复制，发送完毕前持有).
+ */
+void Session::SendCachedFileResponse(const ExchangePtr& ex, CachedFilePtr&& file, std::shared_ptr<const std::string>&& compressed) {
+    auto& res = ex->res;
+    const std::string& content = compressed ? *compressed : file->content;
+    span_res_.emplace(std::piecewise_construct, std::make_tuple(), std::make_tuple(util::ArenaAllocator<char>(&ex->arena)));
+    span_res_->keep_alive(res->keep_alive_);
+    span_res_->result(res->status_code_);
+    span_res_->body() = http::span_body<const char>::value_type(content.data(), content.size());
+    for (const auto& p : res->headers_) {
+        span_res_->set(p.first, p.second);
+    }
+    span_res_->prepare_payload();
+
+    /* 打印请求日志 */
+    LogAccess(svr_, ex, content.size());
+
+    /* 发送响应内容 */
+    sending_file_ = std::move(file);
+    sending_content_ = std::move(compressed);
+    http::async_write(
+        stream_,
+        *span_res_,
+        beast::bind_front_handler(&Session::OnWrite, shared_from_this(), span_res_->need_eof())
+    );
+}
+
+/**
+ * @brief 准备文件的部分内容(`206 Partial Content`).
+ *
+ * @details 单个范围时附带`Content-Range`响应头，多个范围时为`multipart/byteranges`，每个部分附带各自的头部.
+ * @details 各部分的头部预先生成，以便计算`Content-Length`，文件内容在发送时才读取(或`sendfile`).
+ */
+void Session::PrepareFileRanges(const ExchangePtr& ex, const std::vector<ByteRange>& ranges, PreparedFileBody* body) {
+    auto& res = ex->res;
+    uint64_t size = body->compressed ? body->compressed->size() : body->file->size;
+    uint64_t content_length = 0;
+    res->status_code_ = 206U;
+    if (ranges.size() == 1) {
+        const ByteRange& range = ranges.front();
+        res->SetHeader("Content-Range", s_content_range(range.first, range.last, size));
+        body->segments.push_back(FileBodySegment{ std::string(), range.first, range.length() });
+        content_length = range.length();
+    }
+    else {
+        std::string boundary = s_make_boundary();
+        std::string part_content_type;
+        const std::string* content_type = s_find_header(res->headers_, "Content-Type");
+        if (content_type) {
+            part_content_type = "Content-Type: " + *content_type + "\r\n";
+        }
+        for (const ByteRange& range : ranges) {
+            std::string prefix = "\r\n--" + boundary + "\r\n" + part_content_type
+                + "Content-Range: " + s_content_range(range.first, range.last, size) + "\r\n\r\n";
+            content_length += prefix.size() + range.length();
+            body->segments.push_back(FileBodySegment{ std::move(prefix), range.first, range.length() });
+        }
+        std::string epilogue = "\r\n--" + boundary + "--\r\n";
+        content_length += epilogue.size();
+        body->segments.push_back(FileBodySegment{ std::move(epilogue), 0, 0 });
+        res->RemoveHeader("Content-Type");
+        res->SetHeader("Content-Type", "multipart/byteranges; boundary=" + boundary);
+    }
+    body->kind = PreparedFileBody::kSegments;
+    body->content_length = content_length;
+}
+
+/**
+ * @brief 发送文件的响应头.
+ *
+ * @param compressed 文件缓存中的压缩结果，发送其内容而不是文件内容
+ * @param content_length 响应内容的长度
+ * @param head_only 是否只发送响应头，否则之后依次发送`send_segments_`
+ */
+void Session::SendFileHeader(const ExchangePtr& ex, CachedFilePtr&& file, std::shared_ptr<const std::string>&& compressed,
+    uint64_t content_length, bool head_only)
+{
+    auto& res = ex->res;
+    header_res_.emplace(std::piecewise_construct, std::make_tuple(), std::make_tuple(util::ArenaAllocator<char>(&ex->arena)));
+    header_res_->keep_alive(res->keep_alive_);
+    header_res_->result(res->status_code_);
+    for (const auto& p : res->headers_) {
+        header_res_->set(p.first, p.second);
+    }
+    header_res_->content_length(content_length);
+
+    /* 打印请求日志 */
+    LogAccess(svr_, ex, content_length);
+
+    sending_file_ = std::move(file);
+    sending_content_ = std::move(compressed);
+    if (sending_content_) {
+        sending_data_ = sending_content_->data();
+    }
+    else if (sending_file_->has_content) {
+        sending_data_ = sending_file_->content.data();
+    }
+    header_serializer_.emplace(*header_res_);
+    if (head_only) {
+        http::async_write_header(
+            stream_,
+            *header_serializer_,
+            beast::bind_front_handler(&Session::OnWrite, shared_from_this(), header_res_->need_eof())
+        );
+        return;
+    }
+    send_segment_index_ = 0;
+    http::async_write_header(
+        stream_,
+        *header_serializer_,
+        beast::bind_front_handler(&Session::OnWriteFileHeader, shared_from_this(), header_res_->need_eof())
+    );
+}
+
+/**
+ * @brief 使用`http::file_body`返回文件内容(不支持`sendfile`时).
  */
-void Session::SendFileBodyResponse() {
+void Session::SendFileByFileBody(const ExchangePtr& ex, const std::string& filepath) {
+    auto& res = ex->res;
     http::file_body::value_type file;
     beast::error_code ec;
-    file.open(res_->filepath_.c_str(), beast::file_mode::read, ec);  /* `filepath_`是UTF8编码 */
+    file.open(filepath.c_str(), beast::file_mode::read, ec);  /* `filepath`是UTF8编码 */
     if (ec) {
-        res_->SetStringBody(404U); // return 404 Not Found
-        return SendStringBodyResponse();
+        res->SetStringBody(404U); // return 404 Not Found
+        return SendStringBodyResponse(ex);
     }
+    uint64_t file_size = file.size();
 
-    file_res_ = std::make_shared<http::response<http::file_body>>();
-    file_res_->keep_alive(res_->keep_alive_);
-    file_res_->result(res_->status_code_);
+    file_res_.emplace(std::piecewise_construct, std::make_tuple(), std::make_tuple(util::ArenaAllocator<char>(&ex->arena)));
+    file_res_->keep_alive(res->keep_alive_);
+    file_res_->result(res->status_code_);
     file_res_->body() = std::move(file);
-    for (const auto& p : res_->headers_) {
+    for (const auto& p : res->headers_) {
         file_res_->set(p.first, p.second);
     }
     file_res_->prepare_payload();
 
     /* 打印请求日志 */
-    if (svr_->config().log_access()) {
-        svr_->logger()->Info(LOG_CTX, "ACCESS \"%s %.*s\" -- %s -- %u %" PRIu64 " %s",
-            to_string(req_->method_), (int)req_->raw_->target().length(), req_->raw_->target().data(),
-            req_->client_real_ip_.c_str(), res_->status_code_, file.size(),
-            util::format_duration(req_->time_consumed_total_).c_str()
-        );
-    }
+    LogAccess(svr_, ex, file_size);
 
     /* 发送响应内容 */
-    file_serializer_ = std::make_shared<http::response_serializer<http::file_body>>(*file_res_);
+    file_serializer_.emplace(*file_res_);
     http::async_write(
         stream_,
         *file_serializer_,
@@ -211,27 +1008,203 @@ void Session::SendFileBodyResponse() {
     );
 }
 
+void Session::OnWriteFileHeader(bool close, beast::error_code ec, size_t bytes_transferred) {
+    if (ec) {
+        return OnWrite(close, ec, bytes_transferred);
+    }
+    SendNextFileSegment(close);
+}
+
+/**
+ * @brief 发送下一段内容，全部发送完毕后结束该响应.
+ */
+void Session::SendNextFileSegment(bool close) {
+    if (send_segment_index_ >= send_segments_.size()) {
+        return OnWrite(close, beast::error_code(), 0);
+    }
+    const FileBodySegment& segment = send_segments_[send_segment_index_];
+    send_offset_ = segment.offset;
+    send_remaining_ = segment.length;
+    if (segment.prefix.empty()) {
+        return SendFileSegmentBody(close);
+    }
+    net::async_write(
+        stream_,
+        net::buffer(segment.prefix),
+        beast::bind_front_handler(&Session::OnWriteFileSegment, shared_from_this(), close)
+    );
+}
+
+/**
+ * @brief 发送当前段的文件内容.
+ *
+ * @details 内容在内存中时直接发送，否则支持时使用`sendfile`，不支持时分段读取文件.
+ */
+void Session::SendFileSegmentBody(bool close) {
+    if (send_remaining_ == 0) {
+        ++send_segment_index_;
+        return SendNextFileSegment(close);
+    }
+    if (sending_data_) {
+        const char* data = sending_data_ + send_offset_;
+        size_t size = (size_t)send_remaining_;
+        send_offset_ += send_remaining_;
+        send_remaining_ = 0;
+        net::async_write(
+            stream_,
+            net::buffer(data, size),
+            beast::bind_front_handler(&Session::OnWriteFileSegment, shared_from_this(), close)
+        );
+        return;
+    }
+#ifdef IC_SERVER_HAS_SENDFILE
+    if (svr_->config().use_sendfile() && sending_file_->fd >= 0 && !stream_.is_tls()) {
+        return DoSendfile(close);
+    }
+#endif
+    ReadFileSegment(close);
+}
+
+void Session::OnWriteFileSegment(bool close, beast::error_code ec, size_t bytes_transferred) {
+    if (ec) {
+        return OnWrite(close, ec, bytes_transferred);
+    }
+    SendFileSegmentBody(close);
+}
+
+/**
+ * @brief 读取一块文件内容并发送(不支持`sendfile`时)，不将整个范围读入内存.
+ */
+void Session::ReadFileSegment(bool close) {
+    beast::error_code ec;
+    if (!read_file_.is_open()) {
+        read_file_.open(sending_file_->path.c_str(), beast::file_mode::read, ec);  /* `path`是UTF8编码 */
+    }
+    size_t n = 0;
+    if (!ec) {
+        read_file_.seek(send_offset_, ec);
+    }
+    if (!ec) {
+        read_buffer_.resize(kFileReadBufferSize);
+        n = read_file_.read(&read_buffer_[0], (size_t)std::min<uint64_t>(send_remaining_, read_buffer_.size()), ec);
+        if (!ec && n == 0) {
+            ec = net::error::eof;  /* 文件在发送过程中被截断 */
+        }
+    }
+    if (ec) {
+        svr_->logger()->Error(LOG_CTX, "Read file '%s' failed, %s", sending_file_->path.c_str(), ec.message().c_str());
+        return OnWrite(close, ec, 0);
+    }
+    send_offset_ += n;
+    send_remaining_ -= n;
+    net::async_write(
+        stream_,
+        net::buffer(read_buffer_.data(), n),
+        beast::bind_front_handler(&Session::OnWriteFileSegment, shared_from_this(), close)
+    );
+}
+
+#ifdef IC_SERVER_HAS_SENDFILE
+/**
+ * @brief 发送文件内容，socket缓冲区已满时等待可写.
+ */
+void Session::DoSendfile(bool close) {
+    auto& socket = stream_.socket();
+    beast::error_code ec;
+    if (!socket.native_non_blocking()) {
+        socket.native_non_blocking(true, ec);
+        if (ec) {
+            return OnWrite(close, ec, 0);
+        }
+    }
+
+    uint64_t sent = 0;
+    while (send_remaining_ > 0 && sent < kSendfileMaxBytesPerRound) {
+        size_t count = (size_t)std::min<uint64_t>(send_remaining_, kSendfileMaxBytesPerRound - sent);
+        off_t offset = (off_t)send_offset_;
+        ssize_t n = ::sendfile(socket.native_handle(), sending_file_->fd, &offset, count);
+        if (n > 0) {
+            send_offset_ += (uint64_t)n;
+            send_remaining_ -= (uint64_t)n;
+            sent += (uint64_t)n;
+        }
+        else if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return WaitSendfileWritable(close);
+        }
+        else {
+            /* n == 0: 文件在发送过程中被截断 */
+            ec = (n < 0) ? beast::error_code(errno, beast::system_category()) : beast::error_code(net::error::eof);
+            svr_->logger()->Error(LOG_CTX, "Sendfile '%s' failed, %s", sending_file_->path.c_str(), ec.message().c_str());
+            return OnWrite(close, ec, 0);
+        }
+    }
+
+    if (send_remaining_ > 0) {
+        /* 让出线程，处理其他连接后再继续发送 */
+        net::post(stream_.get_executor(), beast::bind_front_handler(&Session::DoSendfile, shared_from_this(), close));
+        return;
+    }
+    ++send_segment_index_;
+    SendNextFileSegment(close);
+}
+
+/**
+ * @brief 等待socket可写.
+ */
+void Session::WaitSendfileWritable(bool close) {
+    auto self = shared_from_this();
+    uint64_t wait_id = ++send_wait_id_;
+    unsigned int tcp_stream_timeout_ms = svr_->config().tcp_stream_timeout_ms();
+    if (tcp_stream_timeout_ms > 0) {
+        send_timer_.expires_after(std::chrono::milliseconds(tcp_stream_timeout_ms));
+        send_timer_.async_wait([self, wait_id](beast::error_code ec) {
+            if (!ec && wait_id == self->send_wait_id_) {
+                self->send_timed_out_ = true;
+                self->stream_.socket().cancel(ec);
+            }
+        });
+    }
+    stream_.socket().async_wait(tcp::socket::wait_write,
+        beast::bind_front_handler(&Session::OnSendfileWritable, self, wait_id, close));
+}
+
+void Session::OnSendfileWritable(uint64_t wait_id, bool close, beast::error_code ec) {
+    if (wait_id != send_wait_id_) {
+        return;
+    }
+    ++send_wait_id_;  /* 使定时器回调失效 */
+    send_timer_.cancel();
+    if (send_timed_out_) {
+        send_timed_out_ = false;
+        ec = beast::error::timeout;
+    }
+    if (ec) {
+        return OnWrite(close, ec, 0);
+    }
+    DoSendfile(close);
+}
+#endif // IC_SERVER_HAS_SENDFILE
+
 /**
  * @brief 返回文本内容.
  */
-void Session::SendStringBodyResponse() {
-    string_res_ = std::make_shared<http::response<http::string_body>>();
-    string_res_->keep_alive(res_->keep_alive_);
-    string_res_->result(res_->status_code_);
-    string_res_->body().swap(res_->string_body_);
+void Session::SendStringBodyResponse(const ExchangePtr& ex) {
+    auto& res = ex->res;
+    CompressStringBody(svr_, ex);
+    string_res_.emplace(std::piecewise_construct, std::make_tuple(), std::make_tuple(util::ArenaAllocator<char>(&ex->arena)));
+    string_res_->keep_alive(res->keep_alive_);
+    string_res_->result(res->status_code_);
+    string_res_->body().swap(res->string_body_);
     string_res_->prepare_payload();
-    for (const auto& p : res_->headers_) {
+    for (const auto& p : res->headers_) {
         string_res_->set(p.first, p.second);
     }
 
     /* 打印请求日志 */
-    if (svr_->config().log_access()) {
-        svr_->logger()->Info(LOG_CTX, "ACCESS \"%s %.*s\" -- %s -- %u %" PRIu64 " %s",
-            to_string(req_->method_), (int)req_->raw_->target().length(), req_->raw_->target().data(),
-            req_->client_real_ip_.c_str(), res_->status_code_, (uint64_t)string_res_->body().size(),
-            util::format_duration(req_->time_consumed_total_).c_str()
-        );
-    }
+    LogAccess(svr_, ex, string_res_->body().size());
 
     /* 发送响应内容 */
     http::async_write(
@@ -241,5 +1214,279 @@ void Session::SendStringBodyResponse() {
     );
 }
 
+/**
+ * @brief 根据`Accept-Encoding`请求头压缩文本内容.
+ *
+ * @details 只压缩不小于`compression_min_size`、且`Content-Type`适合压缩的内容.
+ */
+void Session::CompressStringBody(HttpServer* svr, const ExchangePtr& ex) {
+    auto& req = ex->req;
+    auto& res = ex->res;
+    const auto& config = svr->config();
+    if (!req || !config.compression_enabled() || res->string_body_.size() < std::max(1U, config.compression_min_size())) {
+        return;
+    }
+    const std::string* content_type = s_find_header(res->headers_, "Content-Type");
+    if (!content_type || !is_compressible_mimetype(*content_type) || s_find_header(res->headers_, "Content-Encoding")) {
+        return;
+    }
+    res->SetHeader("Vary", "Accept-Encoding");
+
+    ContentEncoding encodings[(int)ContentEncoding::kCount];
+    int count = negotiate_encodings(req->raw_->operator[](http::field::accept_encoding), encodings);
+    for (int i = 0; i < count; ++i) {
+        if (!is_encoding_supported(encodings[i])) {
+            continue;
+        }
+        std::string compressed;
+        int level = (encodings[i] == ContentEncoding::kBrotli) ? -1 : (int)config.compression_level();
+        if (compress(encodings[i], res->string_body_.data(), res->string_body_.size(), level, &compressed)
+            && compressed.size() < res->string_body_.size())
+        {
+            res->string_body_.swap(compressed);
+            res->SetHeader("Content-Encoding", to_string(encodings[i]));
+        }
+        return;
+    }
+}
+
+/**
+ * @brief 返回流式响应内容(`Response::SetStreamBody`).
+ *
+ * @details 发送响应头之后，依次发送写入器缓冲区中的内容(分块传输编码)，每次发送完毕后才取出下一批内容(背压).
+ */
+void Session::SendStreamBodyResponse(const ExchangePtr& ex) {
+    auto& req = ex->req;
+    auto& res = ex->res;
+    header_res_.emplace(std::piecewise_construct, std::make_tuple(), std::make_tuple(util::ArenaAllocator<char>(&ex->arena)));
+    header_res_->keep_alive(res->keep_alive_);
+    header_res_->result(res->status_code_);
+    for (const auto& p : res->headers_) {
+        header_res_->set(p.first, p.second);
+    }
+    stream_chunked_ = !req || req->raw_->version() >= 11;
+    if (stream_chunked_) {
+        header_res_->chunked(true);
+    }
+    else {
+        header_res_->keep_alive(false);
+    }
+    stream_close_ = header_res_->need_eof();
+
+    /* 打印请求日志(内容长度未知) */
+    LogAccess(svr_, ex, 0);
+
+    stream_writer_ = res->stream_writer_;
+    header_serializer_.emplace(*header_res_);
+    if (req && req->method_ == HttpMethod::kHEAD) {
+        stream_writer_->Abort();
+        http::async_write_header(
+            stream_,
+            *header_serializer_,
+            beast::bind_front_handler(&Session::OnWrite, shared_from_this(), stream_close_)
+        );
+        return;
+    }
+
+    /* 写入器有新的内容时，回到当前会话的executor发送 */
+    std::weak_ptr<Session> weak_self = shared_from_this();
+    ResponseWriter* writer = stream_writer_.get();
+    auto executor = stream_.get_executor();
+    stream_writer_->Attach([weak_self, writer, executor] {
+        net::post(executor, [weak_self, writer] {
+            auto self = weak_self.lock();
+            if (self && self->stream_writer_.get() == writer) {
+                self->DoWriteStream();
+            }
+        });
+    });
+    if (stream_writer_->GetHeartbeat(&heartbeat_, &heartbeat_interval_ms_)) {
+        if (heartbeat_interval_ms_ == 0) {
+            unsigned int tcp_stream_timeout_ms = svr_->config().tcp_stream_timeout_ms();
+            heartbeat_interval_ms_ = tcp_stream_timeout_ms > 0 ? std::max(1U, tcp_stream_timeout_ms / 2) : 15000;
+        }
+    }
+    else {
+        heartbeat_interval_ms_ = 0;
+    }
+    stream_last_sent_ = std::chrono::steady_clock::now();
+    StartStreamHeartbeat(std::chrono::milliseconds(heartbeat_interval_ms_ > 0 ? heartbeat_interval_ms_ : svr_->config().tcp_stream_timeout_ms()));
+    stream_writing_ = true;
+    http::async_write_header(
+        stream_,
+        *header_serializer_,
+        beast::bind_front_handler(&Session::OnWriteStreamHeader, shared_from_this())
+    );
+}
+
+void Session::OnWriteStreamHeader(beast::error_code ec, size_t bytes_transferred) {
+    stream_writing_ = false;
+    if (ec) {
+        return OnWrite(stream_close_, ec, bytes_transferred);
+    }
+    stream_writer_->NotifyWritable();
+    DoWriteStream();
+}
+
+/**
+ * @brief 发送写入器缓冲区中的内容，没有内容时等待写入器通知.
+ */
+void Session::DoWriteStream() {
+    if (!stream_writer_ || stream_writing_) {
+        return;
+    }
+    bool closed = false;
+    stream_writer_->Take(&stream_chunks_, &closed);
+    if (stream_chunks_.empty()) {
+        if (!closed) {
+            return;
+        }
+        /* 写入完毕 */
+        stream_writing_ = true;
+        if (!stream_chunked_) {
+            return OnWriteStreamLast(beast::error_code(), 0);
+        }
+        UpdateStreamTimeout();
+        net::async_write(stream_, http::make_chunk_last(),
+            beast::bind_front_handler(&Session::OnWriteStreamLast, shared_from_this()));
+        return;
+    }
+
+    size_t size = 0;
+    stream_buffers_.clear();
+    for (const auto& chunk : stream_chunks_) {
+        stream_buffers_.emplace_back(chunk.data(), chunk.size());
+        size += chunk.size();
+    }
+    stream_writing_ = true;
+    /* 每次发送前重新计算超时时间，响应时间不受限制 */
+    UpdateStreamTimeout();
+    if (stream_chunked_) {
+        net::async_write(stream_, http::make_chunk(stream_buffers_),
+            beast::bind_front_handler(&Session::OnWriteStream, shared_from_this(), size));
+    }
+    else {
+        net::async_write(stream_, stream_buffers_,
+            beast::bind_front_handler(&Session::OnWriteStream, shared_from_this(), size));
+    }
+}
+
+void Session::OnWriteStream(size_t size, beast::error_code ec, size_t bytes_transferred) {
+    stream_writing_ = false;
+    stream_chunks_.clear();
+    if (ec) {
+        return OnWrite(stream_close_, ec, bytes_transferred);
+    }
+    stream_last_sent_ = std::chrono::steady_clock::now();
+    if (stream_writer_->OnSent(size)) {
+        stream_writer_->NotifyWritable();
+    }
+    DoWriteStream();
+}
+
+/**
+ * @brief 定时检查连接是否空闲，空闲时发送心跳.
+ *
+ * @details 心跳与普通内容一样经过写入器发送，每次发送都受`tcp_stream_timeout_ms`限制，客户端长时间不接收时关闭连接.
+ * @details 未设置心跳时，写入器超过`tcp_stream_timeout_ms`没有内容则关闭连接，避免未关闭的写入器一直占用连接.
+ * @details 等待写入期间没有其他异步操作，由定时器持有会话，服务器停止时随之释放.
+ */
+void Session::StartStreamHeartbeat(std::chrono::steady_clock::duration delay) {
+    auto self = shared_from_this();
+    ResponseWriter* writer = stream_writer_.get();
+    if (heartbeat_interval_ms_ > 0 || svr_->config().tcp_stream_timeout_ms() > 0) {
+        heartbeat_timer_.expires_after(delay);
+    }
+    else {
+        heartbeat_timer_.expires_at(std::chrono::steady_clock::time_point::max());
+    }
+    heartbeat_timer_.async_wait([self, writer](beast::error_code ec) {
+        if (!ec && self->stream_writer_.get() == writer) {
+            self->OnStreamHeartbeat();
+        }
+    });
+}
+
+void Session::OnStreamHeartbeat() {
+    auto idle = std::chrono::steady_clock::now() - stream_last_sent_;
+    if (heartbeat_interval_ms_ == 0) {
+        /* 正在发送时由发送超时限制 */
+        auto timeout = std::chrono::steady_clock::duration(std::chrono::milliseconds(svr_->config().tcp_stream_timeout_ms()));
+        if (stream_writing_ || idle < timeout) {
+            return StartStreamHeartbeat(stream_writing_ ? timeout : timeout - idle);
+        }
+        svr_->logger()->Debug(LOG_CTX, "Stream response idle timeout");
+        return OnWrite(true, beast::error::timeout, 0);
+    }
+    auto interval = std::chrono::steady_clock::duration(std::chrono::milliseconds(heartbeat_interval_ms_));
+    if (idle < interval) {
+        return StartStreamHeartbeat(interval - idle);
+    }
+    if (!stream_writing_) {
+        stream_writer_->TryWrite(heartbeat_);
+    }
+    StartStreamHeartbeat(interval);
+}
+
+void Session::OnWriteStreamLast(beast::error_code ec, size_t bytes_transferred) {
+    if (!ec) {
+        stream_writer_->Finish();
+    }
+    OnWrite(stream_close_, ec, bytes_transferred);
+}
+
+/**
+ * @brief 打印请求日志.
+ */
+void Session::LogAccess(HttpServer* svr, const ExchangePtr& ex, uint64_t body_size) {
+    auto& req = ex->req;
+    auto& res = ex->res;
+    ex->response_body_size = body_size;
+    if (!req || !svr->config().log_access()) {
+        return;
+    }
+    /* 二进制访问日志只复制固定大小的记录，不进行格式化 */
+    if (svr->access_log_) {
+        svr->access_log_->Write(*req, res->status_code_, body_size);
+        return;
+    }
+    /* 先检查日志级别，避免无用的格式化 */
+    if (svr->logger()->min_level() <= LogLevel::kInfo) {
+        svr->logger()->Info(LOG_CTX, "ACCESS \"%s %.*s\" -- %s -- %u %" PRIu64 " %s",
+            to_string(req->method_), (int)req->raw_->target().length(), req->raw_->target().data(),
+            req->client_real_ip_.c_str(), res->status_code_, body_size,
+            util::format_duration(req->time_consumed_total_).c_str()
+        );
+    }
+}
+
+/**
+ * @brief 统计请求的耗时和body的大小(响应发送完毕之后).
+ *
+ * @param bytes_in 请求body的大小
+ */
+void Session::RecordMetrics(HttpServer* svr, const ExchangePtr& ex, uint64_t bytes_in) {
+    auto& req = ex->req;
+    if (!req || !ex->done || !svr->config().metrics_enabled()) {
+        return;
+    }
+    auto to_us = [](std::chrono::nanoseconds ns) {
+        return std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(ns).count());
+    };
+    int64_t latencies_us[kMetricsNumLatencies];
+    if (ex->handle_start_time != std::chrono::system_clock::time_point()) {
+        latencies_us[kMetricsQueue] = to_us(ex->handle_start_time - req->arrive_timepoint_);
+        latencies_us[kMetricsHandle] = to_us(req->time_consumed_handle_);
+    }
+    else {
+        /* 没有执行回调函数(如没有匹配的路由、请求拦截器拒绝)，不统计处理耗时 */
+        latencies_us[kMetricsQueue] = to_us(req->time_consumed_total_);
+        latencies_us[kMetricsHandle] = -1;
+    }
+    latencies_us[kMetricsWrite] = to_us(std::chrono::system_clock::now() - req->arrive_timepoint_ - req->time_consumed_total_);
+    RouteMetrics* metrics = req->route_ ? req->route_->metrics() : svr->unmatched_metrics_.get();
+    metrics->Observe(ex->res->status_code_, latencies_us, bytes_in, ex->response_body_size);
+}
+
 } // namespace server
 } // namespace ic
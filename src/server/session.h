@@ -1,9 +1,15 @@
 #ifndef IC_SERVER_SESSION_H_
 #define IC_SERVER_SESSION_H_
+#include <deque>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/optional.hpp>
 #include "server/request.h"
 #include "server/response.h"
+#include "server/util/arena.h"
+#include "byte_range.h"
+#include "file_cache.h"
+#include "session_stream.h"
 
 namespace ic {
 namespace server {
@@ -15,40 +21,230 @@ namespace http = beast::http;       // from <boost/beast/http.hpp>
 namespace net = boost::asio;        // from <boost/asio.hpp>
 using tcp = boost::asio::ip::tcp;   // from <boost/asio/ip/tcp.hpp>
 
+/** 每个请求的内存池的内存块大小(足够容纳`Request`、`Response`和响应对象) */
+constexpr size_t kExchangeArenaBlockSize = 8192;
+
+/** 回收请求时，保留的body缓冲区的最大容量 */
+constexpr size_t kExchangeMaxRetainedBodyCapacity = 64 * 1024;
+
+/** 发送的响应对象，响应头从请求的内存池分配 */
+using ArenaFields = http::basic_fields<util::ArenaAllocator<char>>;
+using StringResponse = http::response<http::string_body, ArenaFields>;
+using FileResponse = http::response<http::file_body, ArenaFields>;
+using FileResponseSerializer = http::response_serializer<http::file_body, ArenaFields>;
+using SpanResponse = http::response<http::span_body<const char>, ArenaFields>;
+using HeaderResponse = http::response<http::empty_body, ArenaFields>;
+using HeaderResponseSerializer = http::response_serializer<http::empty_body, ArenaFields>;
+
+/** 不支持`sendfile`时，分段读取文件内容的缓冲区大小 */
+constexpr size_t kFileReadBufferSize = 64 * 1024;
+
+#ifdef IC_SERVER_HAS_SENDFILE
+/** 每次调用`sendfile`最多发送的字节数，发送完后让出线程，避免大文件长时间占用I/O线程 */
+constexpr size_t kSendfileMaxBytesPerRound = 4 * 1024 * 1024;
+#endif
+
+/**
+ * @brief 同一连接上一次请求和对应的响应.
+ *
+ * @details 开启HTTP管线化时，一个会话中可能同时存在多个，按照请求顺序返回响应.
+ * @details 响应完毕后由会话回收复用(解析器原地重建，内存池和body缓冲区保留容量).
+ */
+struct Exchange {
+    /** 内存池，`Request`、`Response`等从中分配(必须第一个声明，最后析构) */
+    util::Arena arena{kExchangeArenaBlockSize};
+    /** 解析器，持有原始请求对象 */
+    boost::optional<http::request_parser<http::string_body>> parser;
+    /** 请求body的缓冲区(回收时从解析器中取回，保留容量) */
+    std::string body_buffer;
+    std::shared_ptr<Request> req;
+    std::shared_ptr<Response> res;
+    std::chrono::system_clock::time_point handle_start_time;
+    /** 流式接收的请求body的大小(其他请求的body在原始请求对象中) */
+    uint64_t body_streamed{0};
+    /** 响应body的大小(返回响应时记录，流式响应为0) */
+    uint64_t response_body_size{0};
+    /** 是否命中路由(读取请求头之后匹配) */
+    bool route_hit{false};
+    /** 是否中止接收body(流式接收body时，回调函数或请求拦截器拒绝) */
+    bool body_aborted{false};
+    /** 响应内容是否已经准备好 */
+    bool done{false};
+};
+
+using ExchangePtr = std::shared_ptr<Exchange>;
+
+/**
+ * @brief 文件响应内容中的一段(如`multipart/byteranges`的一个部分).
+ */
+struct FileBodySegment {
+    /** 在文件内容之前发送的文本(分隔行及该部分的头部)，可以为空 */
+    std::string prefix;
+    /** 文件内容的偏移和长度 */
+    uint64_t offset;
+    uint64_t length;
+};
+
+/**
+ * @brief 文件响应的内容(`Session::PrepareFileBody`的结果).
+ */
+struct PreparedFileBody {
+    enum Kind {
+        /** 返回文本内容(文件不存在、`304 Not Modified`、`416 Range Not Satisfiable`)，已设置到响应中 */
+        kString = 0,
+        /** 只返回响应头(HEAD请求) */
+        kHeader,
+        /** 返回内容缓存在内存中的文件，或者其压缩结果 */
+        kContent,
+        /** 依次返回`segments`(范围请求) */
+        kSegments,
+        /** 返回整个文件(内容不在内存中) */
+        kFile
+    };
+
+    Kind kind{kString};
+    /** 所选的文件(可能是预压缩文件) */
+    CachedFilePtr file;
+    /** 文件缓存中的压缩结果，返回其内容而不是文件内容 */
+    std::shared_ptr<const std::string> compressed;
+    std::vector<FileBodySegment> segments;
+    /** 响应内容的长度 */
+    uint64_t content_length{0};
+};
+
 class Session : public std::enable_shared_from_this<Session> {
 public:
-    Session(tcp::socket&& socket, HttpServer* svr);
+    Session(SessionStream&& stream, HttpServer* svr);
     ~Session();
 
     void Run();
+    void OnReadHeader(beast::error_code ec, size_t bytes_transferred);
+    void OnReadBodyChunk(beast::error_code ec, size_t bytes_transferred);
     void OnRead(beast::error_code ec, size_t bytes_transferred);
     void OnWrite(bool close, beast::error_code ec, size_t bytes_transferred);
     void DoRead();
     void DoClose();
+#if IC_SERVER_USE_OPENSSL == 1
+    void OnHandshake(beast::error_code ec);
+    void OnShutdown(beast::error_code ec);
+#endif
 
     HttpServer* svr() { return svr_; }
 
+    /**
+     * 以下步骤与连接无关，HTTP/2会话(`Http2Session`)的每个流也使用.
+     */
+    static bool PreHandleRequest(HttpServer* svr, const ExchangePtr& ex);
+    static void PrepareFileBody(HttpServer* svr, const ExchangePtr& ex, PreparedFileBody* body);
+    static void CompressStringBody(HttpServer* svr, const ExchangePtr& ex);
+    static void LogAccess(HttpServer* svr, const ExchangePtr& ex, uint64_t body_size);
+    static void RecordMetrics(HttpServer* svr, const ExchangePtr& ex, uint64_t bytes_in);
+    static bool ResetExchange(const ExchangePtr& ex);
+
 private:
     void OnReadError(beast::error_code ec);
     void OnWriteError(beast::error_code ec);
-    bool PreHandleRequest();
-    void HandleRequest();
-    void SendResponse();
-    void SendFileBodyResponse();
-    void SendStringBodyResponse();
+    void UpdateStreamTimeout();
+    void HandleRequest(const ExchangePtr& ex, bool in_handler_pool);
+    void OnHandleRequestDone(const ExchangePtr& ex);
+    void DispatchToHandlerPool(const ExchangePtr& ex);
+    void FinishRequest(const ExchangePtr& ex);
+    bool UpgradeWebSocket(const ExchangePtr& ex);
+    void UpgradeHttp2();
+    void DoWrite();
+    ExchangePtr AcquireExchange();
+    void RecycleExchange(ExchangePtr&& ex);
+    void SendResponse(const ExchangePtr& ex);
+    void SendFileBodyResponse(const ExchangePtr& ex);
+    void SendStringBodyResponse(const ExchangePtr& ex);
+    void SendStreamBodyResponse(const ExchangePtr& ex);
+    void OnWriteStreamHeader(beast::error_code ec, size_t bytes_transferred);
+    void DoWriteStream();
+    void OnWriteStream(size_t size, beast::error_code ec, size_t bytes_transferred);
+    void OnWriteStreamLast(beast::error_code ec, size_t bytes_transferred);
+    void StartStreamHeartbeat(std::chrono::steady_clock::duration delay);
+    void OnStreamHeartbeat();
+    static void SelectFileEncoding(HttpServer* svr, const ExchangePtr& ex, CachedFilePtr* file,
+        std::shared_ptr<const std::string>* compressed, std::string* etag);
+    static void PrepareFileRanges(const ExchangePtr& ex, const std::vector<ByteRange>& ranges, PreparedFileBody* body);
+    void SendCachedFileResponse(const ExchangePtr& ex, CachedFilePtr&& file, std::shared_ptr<const std::string>&& compressed);
+    void SendFileHeader(const ExchangePtr& ex, CachedFilePtr&& file, std::shared_ptr<const std::string>&& compressed,
+        uint64_t content_length, bool head_only);
+    void SendFileByFileBody(const ExchangePtr& ex, const std::string& filepath);
+    void OnWriteFileHeader(bool close, beast::error_code ec, size_t bytes_transferred);
+    void SendNextFileSegment(bool close);
+    void SendFileSegmentBody(bool close);
+    void OnWriteFileSegment(bool close, beast::error_code ec, size_t bytes_transferred);
+    void ReadFileSegment(bool close);
+#ifdef IC_SERVER_HAS_SENDFILE
+    void DoSendfile(bool close);
+    void WaitSendfileWritable(bool close);
+    void OnSendfileWritable(uint64_t wait_id, bool close, beast::error_code ec);
+#endif
 
 private:
     HttpServer* svr_{nullptr};
-    bool close_{false};
-    std::shared_ptr<http::request_parser<http::string_body>> parser_;
-    std::shared_ptr<http::response_serializer<http::file_body>> file_serializer_;
-    std::shared_ptr<Request> req_;
-    std::shared_ptr<Response> res_;
-    std::shared_ptr<http::response<http::string_body>> string_res_;
-    std::shared_ptr<http::response<http::file_body>> file_res_;
+    /** 是否不再读取新的请求(对端关闭、出错或者请求关闭连接) */
+    bool read_closed_{false};
+    bool reading_{false};
+    bool writing_{false};
+    /** 是否已经开始关闭连接 */
+    bool closing_{false};
+    /** 正在读取的请求 */
+    ExchangePtr reading_ex_;
+    /** 已读取、尚未响应完毕的请求(按照请求顺序) */
+    std::deque<ExchangePtr> exchanges_;
+    /** 已回收的请求，供后续请求复用 */
+    std::vector<ExchangePtr> free_exchanges_;
+    /** 正在发送的响应(响应头从队首请求的内存池分配，在该请求出队之前释放) */
+    boost::optional<StringResponse> string_res_;
+    boost::optional<FileResponse> file_res_;
+    boost::optional<FileResponseSerializer> file_serializer_;
     beast::flat_buffer buffer_;
-    beast::tcp_stream stream_;
+    SessionStream stream_;
     tcp::endpoint remote_endpoint_;
+    /** 内容缓存在内存中的文件，直接引用缓存的内容发送 */
+    boost::optional<SpanResponse> span_res_;
+    /** 只发送响应头(HEAD请求，或者之后分段发送文件内容) */
+    boost::optional<HeaderResponse> header_res_;
+    boost::optional<HeaderResponseSerializer> header_serializer_;
+    /** 正在发送的文件(持有期间文件描述符不会被关闭，缓存的内容不会被释放) */
+    CachedFilePtr sending_file_;
+    /** 正在发送的文件缓存中的压缩结果 */
+    std::shared_ptr<const std::string> sending_content_;
+    /** 发送的内容在内存中时指向其起始位置，否则从文件读取 */
+    const char* sending_data_{nullptr};
+    /** 在响应头之后依次发送的各段内容 */
+    std::vector<FileBodySegment> send_segments_;
+    size_t send_segment_index_{0};
+    /** 当前段剩余内容的偏移和长度 */
+    uint64_t send_offset_{0};
+    uint64_t send_remaining_{0};
+    /** 不使用`sendfile`时，分段读取文件 */
+    beast::file read_file_;
+    std::string read_buffer_;
+    /** 正在发送的流式响应 */
+    std::shared_ptr<ResponseWriter> stream_writer_;
+    /** 正在发送的内容(从写入器的缓冲区中取出) */
+    std::vector<std::string> stream_chunks_;
+    std::vector<net::const_buffer> stream_buffers_;
+    bool stream_writing_{false};
+    /** 是否使用分块传输编码(HTTP/1.0的客户端不支持，直接发送内容，结束时关闭连接) */
+    bool stream_chunked_{true};
+    bool stream_close_{false};
+    /** 流式响应的心跳(连接空闲时发送) */
+    net::steady_timer heartbeat_timer_;
+    std::string heartbeat_;
+    unsigned int heartbeat_interval_ms_{0};
+    /** 上一次发送内容的时间 */
+    std::chrono::steady_clock::time_point stream_last_sent_;
+#ifdef IC_SERVER_HAS_SENDFILE
+    /** 等待socket可写的超时定时器(`sendfile`不经过`tcp_stream`，需要单独计时) */
+    net::steady_timer send_timer_;
+    /** 每次等待socket可写时递增，用于忽略过期的定时器回调 */
+    uint64_t send_wait_id_{0};
+    bool send_timed_out_{false};
+#endif
 };
 
 } // namespace server
@@ -0,0 +1,141 @@
+#ifndef IC_SERVER_SESSION_STREAM_H_
+#define IC_SERVER_SESSION_STREAM_H_
+#include <memory>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket/teardown.hpp>
+#include <boost/optional.hpp>
+#include "tls_context.h"
+#if IC_SERVER_USE_OPENSSL == 1
+#  include <boost/beast/ssl.hpp>
+#  include <boost/beast/websocket/ssl.hpp>
+#endif
+
+namespace ic {
+namespace server {
+
+namespace beast = boost::beast;     // from <boost/beast.hpp>
+namespace net = boost::asio;        // from <boost/asio.hpp>
+using tcp = boost::asio::ip::tcp;   // from <boost/asio/ip/tcp.hpp>
+
+#if IC_SERVER_USE_OPENSSL == 1
+using TlsStream = beast::ssl_stream<beast::tcp_stream>;
+#endif
+
+/**
+ * @brief 会话的连接: 普通TCP连接，或者TLS连接(`beast::ssl_stream`).
+ *
+ * @details 满足AsyncReadStream/AsyncWriteStream，读写时根据连接类型转发，`Session`和`WebSocketSession`无需区分.
+ * @details 超时始终由最底层的`tcp_stream`计时(TLS握手和关闭也受其限制).
+ * @note 可以移动(移交给WebSocket会话)，TLS连接持有其`ssl::context`，证书重新加载后不受影响.
+ */
+class SessionStream {
+public:
+    using executor_type = beast::tcp_stream::executor_type;
+
+    explicit SessionStream(tcp::socket&& socket) { tcp_.emplace(std::move(socket)); }
+#if IC_SERVER_USE_OPENSSL == 1
+    SessionStream(tcp::socket&& socket, SslContextPtr ssl_ctx)
+        : ssl_ctx_(ssl_ctx), tls_(new TlsStream(std::move(socket), *ssl_ctx)) {}
+#endif
+
+    SessionStream(SessionStream&&) = default;
+    SessionStream& operator=(SessionStream&&) = default;
+
+    executor_type get_executor() { return lowest_layer().get_executor(); }
+
+    /**
+     * @brief 最底层的`tcp_stream`(超时设置).
+     */
+    beast::tcp_stream& lowest_layer() {
+#if IC_SERVER_USE_OPENSSL == 1
+        if (tls_) {
+            return tls_->next_layer();
+        }
+#endif
+        return *tcp_;
+    }
+
+    tcp::socket& socket() { return lowest_layer().socket(); }
+
+    template<class Rep, class Period>
+    void expires_after(const std::chrono::duration<Rep, Period>& expiry_time) { lowest_layer().expires_after(expiry_time); }
+    void expires_never() { lowest_layer().expires_never(); }
+
+    /**
+     * @brief 是否是TLS连接(不能使用`sendfile`等直接读写socket的操作).
+     */
+    bool is_tls() const {
+#if IC_SERVER_USE_OPENSSL == 1
+        return (bool)tls_;
+#else
+        return false;
+#endif
+    }
+
+#if IC_SERVER_USE_OPENSSL == 1
+    TlsStream& tls() { return *tls_; }
+#endif
+
+    template<class MutableBufferSequence, class ReadHandler>
+    BOOST_BEAST_ASYNC_RESULT2(ReadHandler)
+    async_read_some(const MutableBufferSequence& buffers, ReadHandler&& handler) {
+#if IC_SERVER_USE_OPENSSL == 1
+        if (tls_) {
+            return tls_->async_read_some(buffers, std::forward<ReadHandler>(handler));
+        }
+#endif
+        return tcp_->async_read_some(buffers, std::forward<ReadHandler>(handler));
+    }
+
+    template<class ConstBufferSequence, class WriteHandler>
+    BOOST_BEAST_ASYNC_RESULT2(WriteHandler)
+    async_write_some(const ConstBufferSequence& buffers, WriteHandler&& handler) {
+#if IC_SERVER_USE_OPENSSL == 1
+        if (tls_) {
+            return tls_->async_write_some(buffers, std::forward<WriteHandler>(handler));
+        }
+#endif
+        return tcp_->async_write_some(buffers, std::forward<WriteHandler>(handler));
+    }
+
+    /**
+     * @brief WebSocket关闭时断开连接(TLS连接先发送`close_notify`).
+     */
+    template<class TeardownHandler>
+    friend void async_teardown(beast::role_type role, SessionStream& stream, TeardownHandler&& handler) {
+        using beast::websocket::async_teardown;
+#if IC_SERVER_USE_OPENSSL == 1
+        if (stream.tls_) {
+            return async_teardown(role, *stream.tls_, std::forward<TeardownHandler>(handler));
+        }
+#endif
+        async_teardown(role, *stream.tcp_, std::forward<TeardownHandler>(handler));
+    }
+
+    friend void teardown(beast::role_type role, SessionStream& stream, beast::error_code& ec) {
+        using beast::websocket::teardown;
+#if IC_SERVER_USE_OPENSSL == 1
+        if (stream.tls_) {
+            return teardown(role, *stream.tls_, ec);
+        }
+#endif
+        teardown(role, stream.tcp_->socket(), ec);
+    }
+
+    friend void beast_close_socket(SessionStream& stream) {
+        beast::close_socket(stream.lowest_layer());
+    }
+
+private:
+    boost::optional<beast::tcp_stream> tcp_;
+#if IC_SERVER_USE_OPENSSL == 1
+    /** 先于`tls_`声明，后析构 */
+    SslContextPtr ssl_ctx_;
+    std::unique_ptr<TlsStream> tls_;
+#endif
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_SESSION_STREAM_H_
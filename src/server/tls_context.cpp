@@ -0,0 +1,291 @@
+#include "tls_context.h"
+#if IC_SERVER_USE_OPENSSL == 1
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#  include <openssl/core_names.h>
+#  include <openssl/params.h>
+#else
+#  include <openssl/hmac.h>
+#endif
+
+namespace ic {
+namespace server {
+
+/** 服务器支持的ALPN协议(按照优先级排列，每项以长度开头，不含'\0') */
+static const char s_alpn_protocols[] = "\x08http/1.1";
+static const char s_alpn_protocols_h2[] = "\x02h2\x08http/1.1";
+
+/** 会话ID上下文，同一上下文中的会话才能恢复 */
+static const unsigned char s_session_id_context[] = "ic_server";
+
+/**
+ * @brief 会话票据的密钥: 名称16字节 + HMAC密钥32字节 + AES密钥32字节.
+ */
+struct TlsTicketKey {
+    unsigned char name[16];
+    unsigned char hmac_key[32];
+    unsigned char aes_key[32];
+};
+
+/**
+ * @brief 会话票据的密钥环(所有`ssl::context`共用).
+ *
+ * @details 当前密钥用于签发和解密票据，上一个密钥只用于解密(解密后签发新的票据)，轮换后旧票据在一个周期内仍然有效.
+ */
+struct TlsTicketKeyRing {
+    std::mutex mutex;
+    TlsTicketKey current;
+    TlsTicketKey previous;
+    bool has_previous{false};
+    std::chrono::steady_clock::time_point rotate_time;
+};
+
+/**
+ * @brief `SSL_CTX`中保存密钥环指针的位置.
+ */
+static int s_ticket_keys_index() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+/**
+ * @brief 文件的修改时间，文件不存在时返回-1.
+ */
+static int64_t s_file_mtime(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return -1;
+    }
+    return (int64_t)st.st_mtime;
+}
+
+TlsContext::TlsContext(const std::string& cert_file, const std::string& key_file,
+    unsigned int session_cache_size, unsigned int session_timeout_s, bool http2)
+    : cert_file_(cert_file), key_file_(key_file),
+      session_cache_size_(session_cache_size), session_timeout_s_(session_timeout_s), http2_(http2)
+{
+    auto ticket_keys = std::make_shared<TlsTicketKeyRing>();
+    /* 生成失败时，由OpenSSL为每个`ssl::context`各自生成(重新加载后之前的会话票据失效) */
+    if (RAND_bytes((unsigned char*)&ticket_keys->current, sizeof(TlsTicketKey)) == 1) {
+        ticket_keys->rotate_time = std::chrono::steady_clock::now();
+        ticket_keys_ = ticket_keys;
+    }
+}
+
+/**
+ * @brief 加载证书和私钥.
+ *
+ * @details 文件正在更新时(如证书已经替换，私钥尚未替换)可能加载失败，只在加载成功后记录文件的修改时间，
+ * @details 因此失败后的每次检查都会重新尝试，直到加载成功.
+ */
+bool TlsContext::Load(bool force, std::string* error) {
+    int64_t cert_mtime = s_file_mtime(cert_file_);
+    int64_t key_mtime = s_file_mtime(key_file_);
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        if (!force && ctx_ && cert_mtime == cert_mtime_ && key_mtime == key_mtime_) {
+            return true;
+        }
+    }
+    SslContextPtr ctx = CreateContext(error);
+    if (!ctx) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lck(mutex_);
+    ctx_ = ctx;
+    cert_mtime_ = cert_mtime;
+    key_mtime_ = key_mtime;
+    return true;
+}
+
+/**
+ * @brief 距离上一次轮换超过会话有效期时，轮换会话票据的密钥.
+ */
+bool TlsContext::RotateTicketKeys() {
+    if (!ticket_keys_) {
+        return true;
+    }
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lck(ticket_keys_->mutex);
+        if (now - ticket_keys_->rotate_time < std::chrono::seconds(std::max(session_timeout_s_, 1U))) {
+            return true;
+        }
+    }
+    TlsTicketKey key;
+    if (RAND_bytes((unsigned char*)&key, sizeof(key)) != 1) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lck(ticket_keys_->mutex);
+    ticket_keys_->previous = ticket_keys_->current;
+    ticket_keys_->has_previous = true;
+    ticket_keys_->current = key;
+    ticket_keys_->rotate_time = now;
+    return true;
+}
+
+SslContextPtr TlsContext::get() const {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return ctx_;
+}
+
+/**
+ * @brief 创建`ssl::context`，加载证书链和私钥，设置会话恢复和ALPN.
+ */
+SslContextPtr TlsContext::CreateContext(std::string* error) const {
+    boost::system::error_code ec;
+    /* `ssl::context`可能比当前对象存在得更久，由它持有会话票据的密钥环 */
+    auto ticket_keys = ticket_keys_;
+    SslContextPtr ctx(new net::ssl::context(net::ssl::context::tls_server), [ticket_keys](net::ssl::context* p) {
+        delete p;
+    });
+    ctx->set_options(
+        net::ssl::context::default_workarounds |
+        net::ssl::context::no_sslv2 |
+        net::ssl::context::no_sslv3 |
+        net::ssl::context::no_tlsv1 |
+        net::ssl::context::no_tlsv1_1 |
+        net::ssl::context::single_dh_use,
+        ec
+    );
+    if (ec) {
+        *error = "Set TLS options failed, " + ec.message();
+        return nullptr;
+    }
+    ctx->use_certificate_chain_file(cert_file_, ec);
+    if (ec) {
+        *error = "Load certificate '" + cert_file_ + "' failed, " + ec.message();
+        return nullptr;
+    }
+    ctx->use_private_key_file(key_file_, net::ssl::context::pem, ec);
+    if (ec) {
+        *error = "Load private key '" + key_file_ + "' failed, " + ec.message();
+        return nullptr;
+    }
+
+    SSL_CTX* native = ctx->native_handle();
+    if (SSL_CTX_check_private_key(native) != 1) {
+        *error = "Private key '" + key_file_ + "' does not match certificate '" + cert_file_ + "'";
+        return nullptr;
+    }
+
+    /* 会话恢复: 会话ID缓存 + 会话票据 */
+    SSL_CTX_set_session_id_context(native, s_session_id_context, sizeof(s_session_id_context) - 1);
+    if (session_cache_size_ > 0) {
+        SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(native, (long)session_cache_size_);
+    }
+    else {
+        SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_OFF);
+    }
+    SSL_CTX_set_timeout(native, (long)session_timeout_s_);
+    if (ticket_keys_ && s_ticket_keys_index() >= 0) {
+        SSL_CTX_set_ex_data(native, s_ticket_keys_index(), ticket_keys_.get());
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(native, &TlsContext::OnTicketKey);
+#else
+        SSL_CTX_set_tlsext_ticket_key_cb(native, &TlsContext::OnTicketKey);
+#endif
+    }
+
+    /* 回调函数的参数为协议列表(静态变量，`ssl::context`可能比当前对象存在得更久) */
+    SSL_CTX_set_alpn_select_cb(native, &TlsContext::OnSelectAlpn, (void*)(http2_ ? s_alpn_protocols_h2 : s_alpn_protocols));
+    return ctx;
+}
+
+/**
+ * @brief 按照服务器的优先级选择ALPN协议.
+ */
+int TlsContext::OnSelectAlpn(SSL* /*ssl*/, const unsigned char** out, unsigned char* outlen,
+    const unsigned char* in, unsigned int inlen, void* arg)
+{
+    const char* protocols = (const char*)arg;
+    unsigned char* selected = nullptr;
+    if (SSL_select_next_proto(&selected, outlen, (const unsigned char*)protocols, (unsigned int)strlen(protocols), in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+/**
+ * @brief 签发(`enc`为1)或解密会话票据时设置密钥.
+ *
+ * @return 1表示成功，2表示使用上一个密钥解密成功(需要签发新的票据)，0表示密钥不存在(完整握手)，-1表示出错
+ */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+int TlsContext::OnTicketKey(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+    EVP_CIPHER_CTX* cipher_ctx, EVP_MAC_CTX* mac_ctx, int enc)
+#else
+int TlsContext::OnTicketKey(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+    EVP_CIPHER_CTX* cipher_ctx, HMAC_CTX* hmac_ctx, int enc)
+#endif
+{
+    auto ticket_keys = (TlsTicketKeyRing*)SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), s_ticket_keys_index());
+    if (!ticket_keys) {
+        return -1;
+    }
+
+    TlsTicketKey key;
+    int ret = 1;
+    if (enc) {
+        {
+            std::lock_guard<std::mutex> lck(ticket_keys->mutex);
+            key = ticket_keys->current;
+        }
+        if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1) {
+            return -1;
+        }
+        memcpy(key_name, key.name, sizeof(key.name));
+    }
+    else {
+        std::lock_guard<std::mutex> lck(ticket_keys->mutex);
+        if (memcmp(key_name, ticket_keys->current.name, sizeof(key.name)) == 0) {
+            key = ticket_keys->current;
+        }
+        else if (ticket_keys->has_previous && memcmp(key_name, ticket_keys->previous.name, sizeof(key.name)) == 0) {
+            key = ticket_keys->previous;
+            ret = 2;
+        }
+        else {
+            return 0;
+        }
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[3];
+    params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac_key, sizeof(key.hmac_key));
+    params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA256"), 0);
+    params[2] = OSSL_PARAM_construct_end();
+    if (EVP_MAC_CTX_set_params(mac_ctx, params) != 1) {
+        return -1;
+    }
+#else
+    if (HMAC_Init_ex(hmac_ctx, key.hmac_key, sizeof(key.hmac_key), EVP_sha256(), nullptr) != 1) {
+        return -1;
+    }
+#endif
+    if (enc) {
+        if (EVP_EncryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), nullptr, key.aes_key, iv) != 1) {
+            return -1;
+        }
+    }
+    else {
+        if (EVP_DecryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), nullptr, key.aes_key, iv) != 1) {
+            return -1;
+        }
+    }
+    return ret;
+}
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_USE_OPENSSL
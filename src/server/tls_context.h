@@ -0,0 +1,115 @@
+#ifndef IC_SERVER_TLS_CONTEXT_H_
+#define IC_SERVER_TLS_CONTEXT_H_
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief 是否使用`OpenSSL`(TLS监听地址).
+ * @note Linux下默认启用，需要链接`ssl`和`crypto`；Windows下需要自行编译`OpenSSL`后启用
+ */
+#ifndef IC_SERVER_USE_OPENSSL
+#  ifdef _WIN32
+#    define IC_SERVER_USE_OPENSSL 0
+#  else
+#    define IC_SERVER_USE_OPENSSL 1
+#  endif
+#endif
+
+#if IC_SERVER_USE_OPENSSL == 1
+#  include <boost/asio/ssl/context.hpp>
+#endif
+
+namespace ic {
+namespace server {
+
+#if IC_SERVER_USE_OPENSSL == 1
+
+namespace net = boost::asio;        // from <boost/asio.hpp>
+
+using SslContextPtr = std::shared_ptr<net::ssl::context>;
+
+struct TlsTicketKeyRing;
+
+/**
+ * @brief 一个TLS监听地址的证书及TLS设置.
+ *
+ * @details 重新加载证书时创建新的`ssl::context`，新连接使用新的证书，已建立的连接继续持有旧的`ssl::context`.
+ * @details 会话票据的密钥在重新加载后保持不变，客户端仍然可以恢复之前的会话(会话ID缓存在每个`ssl::context`中，重新加载后清空).
+ * @details 会话票据的密钥按照会话有效期定期轮换(`RotateTicketKeys`)，避免长期使用同一密钥.
+ * @details ALPN按照服务器的优先级协商`h2`(启用HTTP/2时)和`http/1.1`，客户端都不支持时不返回ALPN扩展(不中断握手).
+ * @note 线程安全.
+ */
+class TlsContext {
+public:
+    /**
+     * @param session_cache_size 会话ID缓存的数量上限，0表示不缓存(只使用会话票据)
+     * @param session_timeout_s 会话(包括会话票据)的有效期(单位:秒)
+     * @param http2 是否通过ALPN提供HTTP/2
+     */
+    TlsContext(const std::string& cert_file, const std::string& key_file,
+        unsigned int session_cache_size, unsigned int session_timeout_s, bool http2);
+
+    /**
+     * @brief 加载证书和私钥.
+     *
+     * @param force 为false时，只在文件的修改时间变化后重新加载
+     * @param[out] error 失败原因
+     *
+     * @return 加载失败时返回false，继续使用原来的证书
+     */
+    bool Load(bool force, std::string* error);
+
+    /**
+     * @brief 距离上一次轮换超过会话有效期时，轮换会话票据的密钥.
+     *
+     * @return 生成新密钥失败时返回false，继续使用原来的密钥
+     */
+    bool RotateTicketKeys();
+
+    /**
+     * @brief 新连接使用的`ssl::context`(尚未加载成功时为空).
+     */
+    SslContextPtr get() const;
+
+    const std::string& cert_file() const { return cert_file_; }
+    const std::string& key_file() const { return key_file_; }
+
+private:
+    SslContextPtr CreateContext(std::string* error) const;
+
+    static int OnSelectAlpn(SSL* ssl, const unsigned char** out, unsigned char* outlen,
+        const unsigned char* in, unsigned int inlen, void* arg);
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    static int OnTicketKey(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+        EVP_CIPHER_CTX* cipher_ctx, EVP_MAC_CTX* mac_ctx, int enc);
+#else
+    static int OnTicketKey(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+        EVP_CIPHER_CTX* cipher_ctx, HMAC_CTX* hmac_ctx, int enc);
+#endif
+
+private:
+    std::string cert_file_;
+    std::string key_file_;
+    unsigned int session_cache_size_;
+    unsigned int session_timeout_s_;
+    bool http2_;
+
+    /** 所有`ssl::context`共用的会话票据密钥(启动时随机生成，生成失败时为空，由OpenSSL为每个`ssl::context`各自生成) */
+    std::shared_ptr<TlsTicketKeyRing> ticket_keys_;
+
+    mutable std::mutex mutex_;
+    SslContextPtr ctx_;
+    /** 上一次加载成功时证书和私钥文件的修改时间 */
+    int64_t cert_mtime_{-1};
+    int64_t key_mtime_{-1};
+};
+
+#endif // IC_SERVER_USE_OPENSSL
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_TLS_CONTEXT_H_
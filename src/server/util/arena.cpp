@@ -0,0 +1,83 @@
+#include "server/util/arena.h"
+#include <cstdint>
+#include <cstdlib>
+
+namespace ic {
+namespace server {
+namespace util {
+
+Arena::Arena(size_t block_size/* = 4096*/)
+    : block_size_(block_size < 256 ? 256 : block_size)
+{
+}
+
+Arena::~Arena() {
+    while (head_) {
+        Block* next = head_->next;
+        free(head_);
+        head_ = next;
+    }
+}
+
+/**
+ * @brief 分配内存.
+ */
+void* Arena::Allocate(size_t size, size_t align/* = alignof(std::max_align_t)*/) {
+    uintptr_t p = (reinterpret_cast<uintptr_t>(ptr_) + align - 1) & ~(uintptr_t)(align - 1);
+    if (!ptr_ || p + size > reinterpret_cast<uintptr_t>(end_)) {
+        NewBlock(size + align);
+        p = (reinterpret_cast<uintptr_t>(ptr_) + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    ptr_ = reinterpret_cast<char*>(p + size);
+    bytes_allocated_ += size;
+    return reinterpret_cast<void*>(p);
+}
+
+/**
+ * @brief 回收全部内存.
+ *
+ * @details 只保留一个默认大小的内存块，超出的部分(如较大的请求)归还给系统.
+ */
+void Arena::Reset() {
+    Block* keep = nullptr;
+    while (head_) {
+        Block* next = head_->next;
+        if (!keep && head_->size == block_size_) {
+            keep = head_;
+        }
+        else {
+            free(head_);
+        }
+        head_ = next;
+    }
+    head_ = keep;
+    if (head_) {
+        head_->next = nullptr;
+        ptr_ = reinterpret_cast<char*>(head_ + 1);
+        end_ = reinterpret_cast<char*>(head_) + head_->size;
+    }
+    else {
+        ptr_ = end_ = nullptr;
+    }
+    bytes_allocated_ = 0;
+}
+
+void Arena::NewBlock(size_t min_size) {
+    size_t size = block_size_;
+    if (min_size + sizeof(Block) > size) {
+        size = min_size + sizeof(Block);
+    }
+    Block* block = static_cast<Block*>(malloc(size));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    block->size = size;
+    block->next = head_;
+    head_ = block;
+    ptr_ = reinterpret_cast<char*>(block + 1);
+    end_ = reinterpret_cast<char*>(block) + size;
+}
+
+} // namespace util
+} // namespace server
+} // namespace ic
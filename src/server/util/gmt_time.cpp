@@ -1,4 +1,6 @@
 #include "server/util/gmt_time.h"
+#include <stdio.h>
+#include <string.h>
 
 namespace ic {
 namespace server {
@@ -21,6 +23,46 @@ std::string get_gmt_time(time_t time) {
     return buf;
 }
 
+/**
+ * @brief 解析GMT格式的时间(如`If-Modified-Since`请求头).
+ *
+ * @note 仅支持`Wed, 09 Jun 2021 10:18:14 GMT`格式
+ */
+bool parse_gmt_time(const char* str, size_t len, time_t* time) {
+    static const char* months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    char buf[32] = { 0 };
+    if (len != 29) {
+        return false;
+    }
+    memcpy(buf, str, len);
+
+    struct tm tm_gmt;
+    memset(&tm_gmt, 0, sizeof(tm_gmt));
+    char month[4] = { 0 };
+    if (sscanf(buf + 5, "%2d %3s %4d %2d:%2d:%2d GMT", &tm_gmt.tm_mday, month, &tm_gmt.tm_year,
+        &tm_gmt.tm_hour, &tm_gmt.tm_min, &tm_gmt.tm_sec) != 6)
+    {
+        return false;
+    }
+    tm_gmt.tm_mon = -1;
+    for (int i = 0; i < 12; ++i) {
+        if (strcmp(month, months[i]) == 0) {
+            tm_gmt.tm_mon = i;
+            break;
+        }
+    }
+    if (tm_gmt.tm_mon < 0) {
+        return false;
+    }
+    tm_gmt.tm_year -= 1900;
+#ifdef _WIN32
+    *time = _mkgmtime(&tm_gmt);
+#else
+    *time = timegm(&tm_gmt);
+#endif
+    return *time != (time_t)-1;
+}
+
 } // namespace util
 } // namespace server
 } // namespace ic
@@ -1,4 +1,5 @@
 #include "server/util/thread.h"
+#include <atomic>
 #ifdef _WIN32
 #  include <Windows.h>
 #elif defined(__linux__)
@@ -27,6 +28,12 @@ size_t thread_id() {
     return tid;
 }
 
+size_t thread_index() {
+    static std::atomic<size_t> s_next_index{0};
+    static thread_local const size_t index = s_next_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
 } // namespace util
 } // namespace server
 } // namespace ic
@@ -0,0 +1,258 @@
+#include "websocket_session.h"
+#include "server/http_server.h"
+#include "server/logger.h"
+#include "server/request_raw.h"
+#include "server/response.h"
+
+namespace ic {
+namespace server {
+
+WebSocketConnection::WebSocketConnection(std::weak_ptr<WebSocketSession> session, int64_t id, const std::string& client_ip)
+    : session_(session), id_(id), client_ip_(client_ip)
+{
+}
+
+bool WebSocketConnection::SendText(const std::string& message) {
+    auto session = session_.lock();
+    return session && session->Send(message, false);
+}
+
+bool WebSocketConnection::SendBinary(const std::string& data) {
+    auto session = session_.lock();
+    return session && session->Send(data, true);
+}
+
+void WebSocketConnection::Close(uint16_t code/* = 1000*/, const std::string& reason/* = ""*/) {
+    auto session = session_.lock();
+    if (session) {
+        session->Close(code, reason);
+    }
+}
+
+bool WebSocketConnection::is_open() const {
+    auto session = session_.lock();
+    return session && session->is_open();
+}
+
+size_t WebSocketConnection::queued_size() const {
+    auto session = session_.lock();
+    return session ? session->queued_size() : 0;
+}
+
+WebSocketSession::WebSocketSession(SessionStream&& stream, HttpServer* svr, std::shared_ptr<const WebSocketHandler> handler)
+    : svr_(svr), ws_(std::move(stream)), handler_(handler)
+{
+    svr_->OnNewSession();
+}
+
+WebSocketSession::~WebSocketSession() {
+    /* 服务器停止时，未关闭的连接也回调`on_close` */
+    Finish();
+    svr_->OnDestroySession();
+}
+
+/**
+ * @brief 设置超时、压缩等选项，完成握手.
+ */
+void WebSocketSession::Run(ExchangePtr ex) {
+    ex_ = ex;
+    unsigned int tcp_stream_timeout_ms = svr_->config().tcp_stream_timeout_ms();
+    unsigned int idle_timeout_ms = handler_->idle_timeout_ms > 0 ? handler_->idle_timeout_ms : tcp_stream_timeout_ms;
+    websocket::stream_base::timeout timeout;
+    timeout.handshake_timeout = tcp_stream_timeout_ms > 0 ? std::chrono::milliseconds(tcp_stream_timeout_ms) : websocket::stream_base::none();
+    timeout.idle_timeout = idle_timeout_ms > 0 ? std::chrono::milliseconds(idle_timeout_ms) : websocket::stream_base::none();
+    timeout.keep_alive_pings = true;
+    /* 由`websocket::stream`管理超时，关闭`tcp_stream`的超时 */
+    beast::get_lowest_layer(ws_).expires_never();
+    ws_.set_option(timeout);
+    if (handler_->permessage_deflate) {
+        websocket::permessage_deflate pmd;
+        pmd.server_enable = true;
+        ws_.set_option(pmd);
+    }
+    ws_.read_message_max(handler_->max_message_size);
+    /* 响应拦截器设置的响应头 */
+    auto headers = ex_->res->headers();
+    if (!headers.empty()) {
+        ws_.set_option(websocket::stream_base::decorator([headers](websocket::response_type& res) {
+            for (const auto& p : headers) {
+                res.insert(p.first, p.second);
+            }
+        }));
+    }
+
+    const http::request<http::string_body>& req = *ex_->req->raw();
+    ws_.async_accept(req, beast::bind_front_handler(&WebSocketSession::OnAccept, shared_from_this()));
+}
+
+void WebSocketSession::OnAccept(beast::error_code ec) {
+    if (ec) {
+        svr_->logger()->Debug(LOG_CTX, "WebSocket accept failed, %s", ec.message().c_str());
+        ex_.reset();
+        return;
+    }
+    conn_.reset(new WebSocketConnection(shared_from_this(), ex_->req->id(), ex_->req->client_real_ip()));
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        open_ = true;
+    }
+    if (handler_->on_open) {
+        handler_->on_open(conn_, *ex_->req);
+    }
+    ex_.reset();
+    DoRead();
+}
+
+void WebSocketSession::DoRead() {
+    ws_.async_read(read_buffer_, beast::bind_front_handler(&WebSocketSession::OnRead, shared_from_this()));
+}
+
+void WebSocketSession::OnRead(beast::error_code ec, size_t/* bytes_transferred*/) {
+    if (ec) {
+        if (ec != websocket::error::closed && ec != beast::error::timeout) {
+            svr_->logger()->Debug(LOG_CTX, "WebSocket read error, %s", ec.message().c_str());
+        }
+        return Finish();
+    }
+    std::string message = beast::buffers_to_string(read_buffer_.data());
+    read_buffer_.consume(read_buffer_.size());
+    if (handler_->on_message) {
+        handler_->on_message(conn_, message, ws_.got_binary());
+    }
+    DoRead();
+}
+
+/**
+ * @brief 放入发送队列(任意线程).
+ *
+ * @details 队列为空时，超过队列大小的一条消息也可以放入.
+ */
+bool WebSocketSession::Send(const std::string& data, bool binary) {
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        if (!open_ || close_requested_) {
+            return false;
+        }
+        if (queued_size_ > 0 && queued_size_ + data.size() > handler_->max_send_queue_size) {
+            return false;
+        }
+        send_queue_.push_back(Message{ data, binary });
+        queued_size_ += data.size();
+        if (writing_) {
+            return true;
+        }
+        writing_ = true;
+    }
+    net::post(ws_.get_executor(), beast::bind_front_handler(&WebSocketSession::DoWrite, shared_from_this()));
+    return true;
+}
+
+/**
+ * @brief 发送队列中的第一条消息.
+ */
+void WebSocketSession::DoWrite() {
+    std::lock_guard<std::mutex> lck(mutex_);
+    if (send_queue_.empty()) {
+        return;
+    }
+    const Message& msg = send_queue_.front();
+    ws_.binary(msg.binary);
+    /* 只有当前线程会移除队首的消息，发送期间其他线程只在队尾追加 */
+    ws_.async_write(net::buffer(msg.data), beast::bind_front_handler(&WebSocketSession::OnWrite, shared_from_this()));
+}
+
+void WebSocketSession::OnWrite(beast::error_code ec, size_t/* bytes_transferred*/) {
+    bool close = false;
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        queued_size_ -= send_queue_.front().data.size();
+        send_queue_.pop_front();
+        if (ec || !open_) {
+            /* 读取也会出错，由`OnRead`结束会话 */
+            if (ec) {
+                svr_->logger()->Debug(LOG_CTX, "WebSocket write error, %s", ec.message().c_str());
+            }
+            send_queue_.clear();
+            queued_size_ = 0;
+            return;
+        }
+        if (send_queue_.empty()) {
+            writing_ = false;
+            close = close_requested_;
+        }
+    }
+    if (close) {
+        return DoClose();
+    }
+    DoWrite();
+}
+
+/**
+ * @brief 请求关闭(任意线程)，发送完队列中的消息后发送关闭帧.
+ */
+void WebSocketSession::Close(uint16_t code, const std::string& reason) {
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        if (!open_ || close_requested_) {
+            return;
+        }
+        close_requested_ = true;
+        close_reason_.code = code;
+        close_reason_.reason.assign(reason.data(), std::min(reason.size(), close_reason_.reason.max_size()));
+        if (writing_) {
+            return;  /* 发送完毕后关闭 */
+        }
+        writing_ = true;
+    }
+    net::post(ws_.get_executor(), beast::bind_front_handler(&WebSocketSession::DoClose, shared_from_this()));
+}
+
+void WebSocketSession::DoClose() {
+    ws_.async_close(close_reason_, beast::bind_front_handler(&WebSocketSession::OnClose, shared_from_this()));
+}
+
+void WebSocketSession::OnClose(beast::error_code ec) {
+    if (ec) {
+        svr_->logger()->Debug(LOG_CTX, "WebSocket close error, %s", ec.message().c_str());
+    }
+    /* 挂起的读取收到客户端的关闭帧后结束，由`OnRead`结束会话 */
+}
+
+bool WebSocketSession::is_open() const {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return open_ && !close_requested_;
+}
+
+size_t WebSocketSession::queued_size() const {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return queued_size_;
+}
+
+/**
+ * @brief 连接已关闭，回调`on_close`(只回调一次).
+ */
+void WebSocketSession::Finish() {
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        if (!open_) {
+            return;
+        }
+        open_ = false;
+        /* 正在发送的消息在发送完毕(或出错)后释放 */
+        if (writing_ && !send_queue_.empty()) {
+            send_queue_.erase(send_queue_.begin() + 1, send_queue_.end());
+            queued_size_ = send_queue_.front().data.size();
+        }
+        else {
+            send_queue_.clear();
+            queued_size_ = 0;
+        }
+    }
+    if (handler_->on_close) {
+        handler_->on_close(conn_);
+    }
+    conn_.reset();
+}
+
+} // namespace server
+} // namespace ic
@@ -0,0 +1,75 @@
+#ifndef IC_SERVER_WEBSOCKET_SESSION_H_
+#define IC_SERVER_WEBSOCKET_SESSION_H_
+#include <deque>
+#include <mutex>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include "server/websocket.h"
+#include "session.h"
+
+namespace ic {
+namespace server {
+
+namespace websocket = beast::websocket;  // from <boost/beast/websocket.hpp>
+
+/**
+ * @brief WebSocket会话(由`Session`收到升级请求后移交TCP/TLS连接).
+ *
+ * @details 读取始终挂起，收到消息后回调`on_message`；发送队列由任意线程写入，在I/O线程中依次发送.
+ * @details ping/pong与空闲超时由`websocket::stream`处理.
+ */
+class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
+public:
+    WebSocketSession(SessionStream&& stream, HttpServer* svr, std::shared_ptr<const WebSocketHandler> handler);
+    ~WebSocketSession();
+
+    /**
+     * @brief 完成握手.
+     *
+     * @param ex 升级请求，握手完成(回调`on_open`)之后释放
+     */
+    void Run(ExchangePtr ex);
+
+    bool Send(const std::string& data, bool binary);
+    void Close(uint16_t code, const std::string& reason);
+    bool is_open() const;
+    size_t queued_size() const;
+
+private:
+    void OnAccept(beast::error_code ec);
+    void DoRead();
+    void OnRead(beast::error_code ec, size_t bytes_transferred);
+    void DoWrite();
+    void OnWrite(beast::error_code ec, size_t bytes_transferred);
+    void DoClose();
+    void OnClose(beast::error_code ec);
+    void Finish();
+
+private:
+    struct Message {
+        std::string data;
+        bool binary;
+    };
+
+    HttpServer* svr_;
+    websocket::stream<SessionStream> ws_;
+    std::shared_ptr<const WebSocketHandler> handler_;
+    ExchangePtr ex_;
+    WebSocketConnectionPtr conn_;
+    beast::flat_buffer read_buffer_;
+
+    mutable std::mutex mutex_;
+    /** 发送队列(第一条消息正在发送) */
+    std::deque<Message> send_queue_;
+    size_t queued_size_{0};
+    bool writing_{false};
+    bool open_{false};
+    /** 是否已经请求关闭(发送完队列中的消息后关闭) */
+    bool close_requested_{false};
+    websocket::close_reason close_reason_;
+};
+
+} // namespace server
+} // namespace ic
+
+#endif // IC_SERVER_WEBSOCKET_SESSION_H_
@@ -0,0 +1,148 @@
+#!/usr/bin/python3
+
+###############################################################################################
+##
+##  @file: decode_access_log.py
+##  @brief：将二进制访问日志(配置项`access_log_file`)转换为文本或者JSON
+##
+##  使用示例: (-h 查看帮助)
+##    ./decode_access_log.py /var/log/example/access.bin.20231129-120000-000000
+##    ./decode_access_log.py /var/log/example/access.bin.* -f json
+##
+##  记录格式见 src/server/access_log.h
+##
+###############################################################################################
+
+import argparse
+import datetime
+import ipaddress
+import json
+import struct
+import sys
+
+RECORD_SIZE = 64
+MAGIC = b'ICACLOG1'
+ENDIAN_MARK = 0x01020304
+
+RECORD_EMPTY = 0
+RECORD_FILE_HEADER = 1
+RECORD_REQUEST = 2
+RECORD_ROUTE = 3
+
+METHODS = ['GET', 'HEAD', 'POST', 'PUT', 'DELETE', 'CONNECT', 'OPTIONS', 'TRACE', 'PATCH']
+
+# 与 AccessLogFileHeader/AccessLogRequestRecord/AccessLogRouteRecord 对应(不含字节序前缀)
+FILE_HEADER_FORMAT = 'B3xI8sIIQQ24x'
+REQUEST_FORMAT = 'BBBxHHIIQqQI16s4x'
+ROUTE_FORMAT = 'BxHII52s'
+
+
+def method_name(method: int) -> str:
+    for i, name in enumerate(METHODS):
+        if method == (1 << i):
+            return name
+    return 'NOTSUPPORT'
+
+
+def methods_string(methods: int) -> str:
+    names = [name for i, name in enumerate(METHODS) if methods & (1 << i)]
+    return ','.join(names) if names else 'NOTSUPPORT'
+
+
+def format_time_us(time_us: int) -> str:
+    tp = datetime.datetime.fromtimestamp(time_us // 1000000)
+    return '%s.%06d' % (tp.strftime('%Y-%m-%d %H:%M:%S'), time_us % 1000000)
+
+
+def format_duration_us(us: int) -> str:
+    if us < 1000:
+        return '%dus' % us
+    if us < 1000000:
+        return '%.3fms' % (us / 1000)
+    return '%.3fs' % (us / 1000000)
+
+
+def format_ip(family: int, ip: bytes) -> str:
+    if family == 4:
+        return str(ipaddress.IPv4Address(ip[:4]))
+    if family == 6:
+        return str(ipaddress.IPv6Address(ip))
+    return '-'
+
+
+def decode_file(filename: str):
+    """ 解析一个文件，依次返回每一条请求记录(dict) """
+    with open(filename, 'rb') as f:
+        data = f.read()
+    if len(data) < RECORD_SIZE or data[0] != RECORD_FILE_HEADER:
+        raise ValueError('invalid access log file: %s' % filename)
+    # 按照写入时的字节序解析
+    endian = '<' if struct.unpack_from('<I', data, 4)[0] == ENDIAN_MARK else '>'
+    _, _, magic, version, record_size, create_time_us, file_seq = struct.unpack_from(endian + FILE_HEADER_FORMAT, data, 0)
+    if magic != MAGIC or version != 1 or record_size != RECORD_SIZE:
+        raise ValueError('invalid access log file: %s' % filename)
+
+    # 第一遍: 路由记录(多个线程同时写入，路由记录可能在使用该路由的请求记录之后)
+    routes = {}
+    requests = []
+    offset = RECORD_SIZE
+    while offset + RECORD_SIZE <= len(data):
+        record_type = data[offset]
+        if record_type == RECORD_ROUTE:
+            _, path_size, route_id, methods, path = struct.unpack_from(endian + ROUTE_FORMAT, data, offset)
+            num_extra = max(0, (path_size - len(path) + RECORD_SIZE - 1) // RECORD_SIZE)
+            path = data[offset + 12:offset + 12 + path_size]
+            routes[route_id] = {'path': path.decode('utf-8', 'replace'), 'methods': methods_string(methods)}
+            offset += RECORD_SIZE * (1 + num_extra)
+            continue
+        if record_type == RECORD_REQUEST:
+            requests.append(offset)
+        offset += RECORD_SIZE
+
+    # 第二遍: 请求记录
+    for offset in requests:
+        (_, ip_family, http_version, status, method, route_id, time_handle_us,
+            arrive_time_us, request_id, body_size, time_total_us, ip) = struct.unpack_from(endian + REQUEST_FORMAT, data, offset)
+        route = routes.get(route_id)
+        yield {
+            'arrive_time': format_time_us(arrive_time_us),
+            'arrive_time_us': arrive_time_us,
+            'id': request_id,
+            'method': method_name(method),
+            'http_version': '%d.%d' % (http_version // 10, http_version % 10),
+            'route_id': route_id,
+            'route': route['path'] if route else None,
+            'client_real_ip': format_ip(ip_family, ip),
+            'status': status,
+            'body_size': body_size,
+            'time_total_us': time_total_us,
+            'time_handle_us': time_handle_us,
+        }
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode binary access log files.')
+    parser.add_argument('files', nargs='+', help='access log files (decoded in the given order)')
+    parser.add_argument('-f', '--format', choices=['text', 'json'], default='text',
+                        help='output format, json: one object per line')
+    args = parser.parse_args()
+
+    try:
+        for filename in args.files:
+            for r in decode_file(filename):
+                if args.format == 'json':
+                    print(json.dumps(r, ensure_ascii=False))
+                else:
+                    print('%s ACCESS "%s %s" HTTP/%s -- %s -- %u %u %s (handle %s) id=%d' % (
+                        r['arrive_time'], r['method'], r['route'] if r['route'] is not None else '-', r['http_version'],
+                        r['client_real_ip'], r['status'], r['body_size'], format_duration_us(r['time_total_us']),
+                        format_duration_us(r['time_handle_us']), r['id']))
+    except BrokenPipeError:
+        pass
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -31,8 +31,8 @@ target("example")
     add_files("example/**.cpp")
     add_includedirs("example/src")
     add_deps("http_server")
-    add_links("boost_regex", "boost_thread", "pthread", "dl")
-    add_linkorders("http_server", "boost_regex", "boost_thread", "pthread", "dl")
+    add_links("boost_regex", "boost_thread", "ssl", "crypto", "pthread", "dl", "z")
+    add_linkorders("http_server", "boost_regex", "boost_thread", "ssl", "crypto", "pthread", "dl", "z")
     set_targetdir("bin")
 
 --
@@ -42,6 +42,6 @@ target("example2")
     set_kind("binary")
     add_files("example2/**.cpp")
     add_deps("http_server")
-    add_links("boost_regex", "boost_thread", "pthread", "dl")
-    add_linkorders("http_server", "boost_regex", "boost_thread", "pthread", "dl")
+    add_links("boost_regex", "boost_thread", "ssl", "crypto", "pthread", "dl", "z")
+    add_linkorders("http_server", "boost_regex", "boost_thread", "ssl", "crypto", "pthread", "dl", "z")
     set_targetdir("bin")